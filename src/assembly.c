@@ -6,6 +6,7 @@
 
 #include "builder.h"
 #include "stb_ds.h"
+#include "table.h"
 #include <string.h>
 
 // Total size of all small arrays allocated later in a single arena.
@@ -403,6 +404,7 @@ static void thread_local_init(struct assembly *assembly) {
 		scope_thread_local_init(&assembly->thread_local_contexts[i].scope_thread_local, i);
 		mir_arenas_init(&assembly->thread_local_contexts[i].mir_arenas, i);
 		ast_arena_init(&assembly->thread_local_contexts[i].ast_arena, i);
+		arena_init(&assembly->thread_local_contexts[i].location_arena, sizeof(struct location) * LOCATION_BLOCK_SIZE, alignment_of(struct location), 16, i, NULL);
 		arena_init(&assembly->thread_local_contexts[i].small_array, SARR_TOTAL_SIZE, 16, 2048, i, (arena_elem_dtor_t)sarr_dtor);
 	}
 	return_zone();
@@ -414,6 +416,7 @@ static void thread_local_terminate(struct assembly *assembly) {
 		scope_thread_local_terminate(&assembly->thread_local_contexts[i].scope_thread_local);
 		mir_arenas_terminate(&assembly->thread_local_contexts[i].mir_arenas);
 		ast_arena_terminate(&assembly->thread_local_contexts[i].ast_arena);
+		arena_terminate(&assembly->thread_local_contexts[i].location_arena);
 		arena_terminate(&assembly->thread_local_contexts[i].small_array);
 		scfree(&assembly->thread_local_contexts[i].string_cache);
 	}
@@ -429,6 +432,7 @@ struct assembly *assembly_new(const struct target *target) {
 	assembly->target = target;
 
 	mtx_init(&assembly->units_lock, mtx_plain);
+	mtx_init(&assembly->source_paths_lock, mtx_plain);
 	mtx_init(&assembly->modules_lock, mtx_plain);
 	spl_init(&assembly->custom_linker_opt_lock);
 	spl_init(&assembly->lib_paths_lock);
@@ -541,8 +545,11 @@ void assembly_delete(struct assembly *assembly) {
 	arrfree(assembly->lib_paths);
 	arrfree(assembly->testing.cases);
 	arrfree(assembly->units);
+	tbl_free(assembly->units_index);
+	tbl_free(assembly->source_paths);
 
 	mtx_destroy(&assembly->units_lock);
+	mtx_destroy(&assembly->source_paths_lock);
 	mtx_destroy(&assembly->modules_lock);
 	spl_destroy(&assembly->custom_linker_opt_lock);
 	spl_destroy(&assembly->lib_paths_lock);
@@ -576,7 +583,17 @@ void assembly_append_linker_options(struct assembly *assembly, const char *opt)
 	spl_unlock(&assembly->custom_linker_opt_lock);
 }
 
-static inline struct unit *lookup_unit(struct assembly *assembly, const hash_t hash, str_t filepath, struct scope *parent_scope) {
+static inline hash_t get_unit_index_hash(const hash_t hash, struct scope *parent_scope) {
+	return hashcomb(hash, (hash_t)((uintptr_t)parent_scope >> 4));
+}
+
+static struct unit *lookup_unit(struct assembly *assembly, const hash_t hash, str_t filepath, struct scope *parent_scope) {
+	const s32 index = tbl_lookup_index_with_key(assembly->units_index, get_unit_index_hash(hash, parent_scope), filepath);
+	if (index != -1 && assembly->units_index[index].unit->parent_scope == parent_scope) {
+		return assembly->units_index[index].unit;
+	}
+	if (index == -1) return NULL;
+	// Hash collision of two different parent scopes, fallback to slow lookup.
 	for (usize i = 0; i < arrlenu(assembly->units); ++i) {
 		struct unit *unit = assembly->units[i];
 		if (hash == unit->hash && parent_scope == unit->parent_scope && str_match(filepath, unit->filepath)) {
@@ -586,17 +603,58 @@ static inline struct unit *lookup_unit(struct assembly *assembly, const hash_t h
 	return NULL;
 }
 
-void assembly_add_unit(struct assembly *assembly, const str_t filepath, struct token *load_from, struct scope *parent_scope, struct module *module) {
+// Same as search_source_file, but the result is cached. Searching for the file may stat many
+// locations (including all system PATH entries), so also failed searches are cached. We expect the
+// file system does not change during compilation.
+static bool search_source_file_cached(struct assembly *assembly, const str_t filepath, const str_t preferred_directory, str_buf_t *out_filepath) {
+	zone();
+	batomic_fetch_add_s32(&assembly->stats.source_path_search_count, 1);
+	str_buf_t key = get_tmp_str();
+	str_buf_append_fmt(&key, "{str}\n{str}", preferred_directory, filepath);
+	const hash_t hash = strhash(key);
+
+	mtx_lock(&assembly->source_paths_lock);
+	const s32 index = tbl_lookup_index_with_key(assembly->source_paths, hash, str_buf_view(key));
+	if (index != -1) {
+		const str_t fullpath = assembly->source_paths[index].fullpath;
+		mtx_unlock(&assembly->source_paths_lock);
+		put_tmp_str(key);
+		batomic_fetch_add_s32(&assembly->stats.source_path_hit_count, 1);
+		if (fullpath.len && out_filepath) str_buf_append(out_filepath, fullpath);
+		return_zone(fullpath.len > 0);
+	}
+	mtx_unlock(&assembly->source_paths_lock);
+
+	str_buf_t  fullpath = get_tmp_str();
+	const bool found    = search_source_file(filepath, preferred_directory, &fullpath);
+
+	mtx_lock(&assembly->source_paths_lock);
+	// Another thread might resolve the same path meanwhile.
+	if (tbl_lookup_index_with_key(assembly->source_paths, hash, str_buf_view(key)) == -1) {
+		struct string_cache    **string_cache = &assembly->thread_local_contexts[get_worker_index()].string_cache;
+		struct source_path_entry entry        = {.hash = hash, .key = scdup2(string_cache, str_buf_view(key))};
+		if (found) entry.fullpath = scdup2(string_cache, str_buf_view(fullpath));
+		tbl_insert(assembly->source_paths, entry);
+	}
+	mtx_unlock(&assembly->source_paths_lock);
+
+	if (found && out_filepath) str_buf_append(out_filepath, fullpath);
+	put_tmp_str(fullpath);
+	put_tmp_str(key);
+	return_zone(found);
+}
+
+void assembly_add_unit(struct assembly *assembly, const str_t filepath, struct location *load_from, struct scope *parent_scope, struct module *module) {
 	zone();
 	bassert(filepath.len && filepath.ptr);
 	bassert(parent_scope);
 	struct unit *unit = NULL;
 
 	str_buf_t    tmp_fullpath = get_tmp_str();
-	struct unit *parent_unit  = load_from ? load_from->location.unit : NULL;
-	if (!search_source_file(filepath, parent_unit ? parent_unit->dirpath : str_empty, &tmp_fullpath)) {
+	struct unit *parent_unit  = load_from ? load_from->unit : NULL;
+	if (!search_source_file_cached(assembly, filepath, parent_unit ? parent_unit->dirpath : str_empty, &tmp_fullpath)) {
 		put_tmp_str(tmp_fullpath);
-		builder_msg(MSG_ERR, ERR_FILE_NOT_FOUND, TOKEN_OPTIONAL_LOCATION(load_from), CARET_WORD, "File not found '" STR_FMT "'.", STR_ARG(filepath));
+		builder_msg(MSG_ERR, ERR_FILE_NOT_FOUND, load_from, CARET_WORD, "File not found '" STR_FMT "'.", STR_ARG(filepath));
 		return_zone();
 	}
 
@@ -610,6 +668,9 @@ void assembly_add_unit(struct assembly *assembly, const str_t filepath, struct t
 		unit = unit_new(assembly, str_buf_view(tmp_fullpath), filepath, hash, load_from, parent_scope, module);
 		arrput(assembly->units, unit);
 
+		struct unit_index_entry entry = {.hash = get_unit_index_hash(hash, parent_scope), .key = unit->filepath, .unit = unit};
+		tbl_insert(assembly->units_index, entry);
+
 		submit = true;
 	}
 	mtx_unlock(&assembly->units_lock);
@@ -621,7 +682,7 @@ void assembly_add_unit(struct assembly *assembly, const str_t filepath, struct t
 
 void assembly_add_native_lib(struct assembly      *assembly,
                              const char           *lib_name,
-                             struct token         *link_token,
+                             struct location      *link_location,
                              enum native_lib_flags flags) {
 	const u32 thread_index = get_worker_index();
 
@@ -636,7 +697,7 @@ void assembly_add_native_lib(struct assembly      *assembly,
 	struct native_lib lib = {0};
 	lib.hash              = hash;
 	lib.user_name         = scdup2(&assembly->thread_local_contexts[thread_index].string_cache, make_str_from_c(lib_name));
-	lib.linked_from       = link_token;
+	lib.linked_from       = link_location;
 	lib.flags             = flags;
 	arrput(assembly->libs, lib);
 DONE:
@@ -700,7 +761,7 @@ static inline struct module *lookup_module(struct assembly *assembly, const hash
 	return NULL;
 }
 
-static struct module *import_module(struct assembly *assembly, str_t module_path, hash_t module_hash, struct token *import_from) {
+static struct module *import_module(struct assembly *assembly, str_t module_path, hash_t module_hash, struct location *import_from) {
 	builder_log("Import module: '" STR_FMT "'", STR_ARG(module_path));
 	bassert(mtx_trylock(&assembly->modules_lock) != thrd_success && "Unsafe import!");
 
@@ -708,7 +769,7 @@ static struct module *import_module(struct assembly *assembly, str_t module_path
 	if (!config) {
 		builder_msg(MSG_ERR,
 		            ERR_FILE_NOT_FOUND,
-		            TOKEN_OPTIONAL_LOCATION(import_from),
+		            import_from,
 		            CARET_WORD,
 		            "Failed to load module configuration file '" STR_FMT "'.",
 		            STR_ARG(module_path));
@@ -768,7 +829,7 @@ static struct module *import_module(struct assembly *assembly, str_t module_path
 		if (!ctx.is_supported_for_current_target) {
 			builder_msg(MSG_ERR,
 			            ERR_UNSUPPORTED_TARGET,
-			            TOKEN_OPTIONAL_LOCATION(import_from),
+			            import_from,
 			            CARET_WORD,
 			            "Module is not supported for compilation target platform triple '%s'. "
 			            "The module explicitly specifies supported platforms in 'supported' module configuration section. "
@@ -808,14 +869,14 @@ static struct module *import_module(struct assembly *assembly, str_t module_path
 
 struct module *assembly_import_module(struct assembly *assembly,
                                       str_t            modulepath,
-                                      struct token    *import_from,
+                                      struct location *import_from,
                                       struct scope    *scope) {
 	struct module *module = NULL;
 
 	if (!modulepath.len) {
 		builder_msg(MSG_ERR,
 		            ERR_FILE_NOT_FOUND,
-		            TOKEN_OPTIONAL_LOCATION(import_from),
+		            import_from,
 		            CARET_WORD,
 		            "Module name is empty.");
 		return module;
@@ -828,13 +889,13 @@ struct module *assembly_import_module(struct assembly *assembly,
 
 	str_buf_t path = get_tmp_str();
 	str_buf_append_fmt(&path, "{str}/{s}", modulepath, MODULE_CONFIG_FILE);
-	found = search_source_file(str_buf_view(path), str_buf_view(target->module_dir), &module_config_path);
+	found = search_source_file_cached(assembly, str_buf_view(path), str_buf_view(target->module_dir), &module_config_path);
 	put_tmp_str(path);
 
 	if (!found) {
 		builder_msg(MSG_ERR,
 		            ERR_FILE_NOT_FOUND,
-		            TOKEN_OPTIONAL_LOCATION(import_from),
+		            import_from,
 		            CARET_WORD,
 		            "Module not found.");
 		goto DONE;
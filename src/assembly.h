@@ -107,7 +107,7 @@ enum native_lib_flags {
 struct native_lib {
 	hash_t        hash;
 	DLLib        *handle;
-	struct token *linked_from;
+	struct location *linked_from;
 	str_t         user_name;
 	str_t         filename;
 	str_t         filepath;
@@ -147,6 +147,7 @@ struct assembly_user_define {
 	enum scope_dump_mode  print_scopes_mode;           \
 	bool                  emit_llvm;                   \
 	bool                  emit_mir;                    \
+	bool                  emit_mir_binary;             \
 	bool                  emit_asm;                    \
 	bool                  no_bin;                      \
 	bool                  no_llvm;                     \
@@ -157,6 +158,7 @@ struct assembly_user_define {
 	bool                  vmdbg_enabled;               \
 	s32                   vmdbg_break_on;              \
 	bool                  enable_experimental_targets; \
+	bool                  compact_rtti;                \
 	struct target_triple  triple;
 
 struct target {
@@ -183,12 +185,40 @@ struct target {
 	bmagic_member
 };
 
+#define LOCATION_BLOCK_SIZE 1024
+
 struct assembly_thread_local_context {
 	struct scope_thread_local scope_thread_local;
 	struct mir_arenas         mir_arenas;
 	struct arena              small_array;
 	struct arena              ast_arena;
 	struct string_cache      *string_cache;
+	// Analyze context reused by RTTI generated on demand (see mir_gen_rtti).
+	struct mir_rtti_context *rtti_context;
+
+	// Persistent location records of tokens referenced from scopes and units are allocated in
+	// blocks. Locations of AST nodes are computed from token positions on demand.
+	struct arena     location_arena;
+	struct location *location_block;
+	s32              location_block_used;
+};
+
+struct unit_index_entry {
+	hash_t       hash; // Combination of the unit full path hash and parent scope.
+	str_t        key;  // Unit full path.
+	struct unit *unit;
+};
+
+struct source_path_entry {
+	hash_t hash;
+	str_t  key;      // Preferred directory and searched file path.
+	str_t  fullpath; // Empty in case the file was not found.
+};
+
+struct assembly_stage_time {
+	const char *name;
+	f64         wall_ms;
+	f64         cpu_ms;
 };
 
 struct assembly {
@@ -244,21 +274,62 @@ struct assembly {
 		batomic_s32 mir_generate_ms;
 		batomic_s32 mir_analyze_ms;
 		batomic_s32 llvm_ms;
+		batomic_s32 llvm_opt_ms;
 		batomic_s32 llvm_obj_ms;
 		batomic_s32 linking_ms;
 		batomic_s32 polymorph_ms;
 
 		batomic_s32 polymorph_count; // @Incomplete: rename to generated.
+		batomic_s32 mixed_fn_reused_count;
+		batomic_s32 lazy_fn_count;
+		batomic_s32 lazy_fn_parsed_count;
+		batomic_s32 analyzed_fn_count;
+		batomic_s32 deferred_fn_count;
+		batomic_s32 complete_check_count;
+		batomic_s32 complete_check_hit_count;
+		batomic_s64 complete_check_node_count;
+		batomic_s64 scope_unit_lock_count; // Scope locks taken by unit jobs (before scopes are sealed).
+		batomic_s32 type_struct_cache_hit_count;
+		batomic_s32 type_name_lookup_count;
 		batomic_s32 comptime_call_stacks_count;
+		batomic_s32 comptime_memo_hit_count; // Compile-time calls of pure functions reused.
+		batomic_s32 comptime_memo_miss_count;
+		batomic_s32 rtti_vm_count;  // RTTI entries generated in compile-time memory.
+		batomic_s64 rtti_vm_bytes;
+		batomic_s32 rtti_bin_count; // RTTI entries emitted into the binary.
+		batomic_s64 rtti_bin_bytes;
+		batomic_s32 rtti_bin_dedup_count;
+		batomic_s64 rtti_us;
+		batomic_s32 mir_opt_inlined_count;
+		batomic_s32 mir_opt_propagated_count;   // Variable loads replaced by the initializer value.
+		batomic_s32 mir_opt_const_folded_count; // Expressions with compile-time known operands folded.
+		batomic_s32 mir_opt_dead_store_count;
+		batomic_s32 mir_opt_folded_count; // Branches with compile-time known condition folded.
+		batomic_s32 mir_opt_threaded_count;
+		batomic_s32 mir_opt_dead_block_count;
+		batomic_s32 mir_opt_merged_count;
+		batomic_s64 mir_opt_us;
+		batomic_s32 token_count;
+		batomic_s64 token_bytes;
+		batomic_s32 source_path_search_count;
+		batomic_s32 source_path_hit_count; // Searches resolved from the cache.
 	} stats;
 
+	// Wall and CPU time of compilation stages, collected only for the '--stats-json' report.
+	array(struct assembly_stage_time) stage_times;
+
 	// DynCall/Lib data used for external method execution in compile time
 	DCCallVM              *dc_vm;
 	struct virtual_machine vm;
 
 	array(struct unit *) units; // array of all units in assembly
+	hash_table(struct unit_index_entry) units_index;
 	mtx_t units_lock;
 
+	// Results of source file searches including the failed ones.
+	hash_table(struct source_path_entry) source_paths;
+	mtx_t source_paths_lock;
+
 	array(struct module *) modules;
 	mtx_t modules_lock;
 
@@ -302,16 +373,16 @@ void           target_add_bool_user_define(struct target *target, struct ast *no
 
 struct assembly *assembly_new(const struct target *target);
 void             assembly_delete(struct assembly *assembly);
-void             assembly_add_unit(struct assembly *assembly, const str_t filepath, struct token *load_from, struct scope *parent_scope, struct module *module);
+void             assembly_add_unit(struct assembly *assembly, const str_t filepath, struct location *load_from, struct scope *parent_scope, struct module *module);
 void             assembly_add_lib_path(struct assembly *assembly, const char *path);
 void             assembly_append_linker_options(struct assembly *assembly, const char *opt);
 void             assembly_add_native_lib(struct assembly      *assembly,
                                          const char           *lib_name,
-                                         struct token         *link_token,
+                                         struct location      *link_location,
                                          enum native_lib_flags flags);
 struct module   *assembly_import_module(struct assembly *assembly,
                                         str_t            modulepath,
-                                        struct token    *import_from,
+                                        struct location *import_from,
                                         struct scope    *scope);
 DCpointer        assembly_find_extern(struct assembly *assembly, const str_t symbol);
 
@@ -319,6 +390,15 @@ DCpointer        assembly_find_extern(struct assembly *assembly, const str_t sym
 void assembly_dump_scope_structure(struct assembly *assembly, FILE *stream, enum scope_dump_mode mode);
 
 // Convert opt level to string.
+// Allocate new zero initialized location record in the thread local storage.
+static inline struct location *new_location(struct assembly_thread_local_context *local) {
+	if (!local->location_block || local->location_block_used == LOCATION_BLOCK_SIZE) {
+		local->location_block      = arena_alloc(&local->location_arena);
+		local->location_block_used = 0;
+	}
+	return &local->location_block[local->location_block_used++];
+}
+
 static inline const char *opt_to_str(enum assembly_opt opt) {
 	switch (opt) {
 	case ASSEMBLY_OPT_DEBUG:
@@ -2,13 +2,15 @@
 #include "atomics.h"
 #include "stb_ds.h"
 #include "tokens.h"
+#include "unit.h"
 
 struct ast *
-ast_create_node(struct arena *arena, enum ast_kind c, struct token *tok, struct scope *parent_scope) {
+ast_create_node(struct arena *arena, enum ast_kind c, struct unit *unit, u32 token_index, struct scope *parent_scope) {
 	struct ast *node  = arena_alloc(arena);
 	node->kind        = c;
 	node->owner_scope = parent_scope;
-	node->location    = tok ? &tok->location : NULL;
+	node->unit        = unit;
+	node->token_index = token_index;
 #ifdef BL_DEBUG
 	static batomic_s64 serial = 0;
 	node->_serial             = batomic_fetch_add_s64(&serial, 1);
@@ -16,6 +18,19 @@ ast_create_node(struct arena *arena, enum ast_kind c, struct token *tok, struct
 	return node;
 }
 
+struct location *ast_location(const struct ast *node, struct location *dest) {
+	if (!node || !node->unit) return NULL;
+	// Token positions are kept for the whole compilation even if the rest of token data is released.
+	const struct tokens *tokens = &node->unit->tokens;
+	bassert(node->token_index < arrlenu(tokens->positions));
+	const u32 position = tokens->positions[node->token_index];
+	dest->line         = (u16)(position >> 16);
+	dest->col          = (u16)(position & 0xFFFF);
+	dest->len          = tokens->lens[node->token_index];
+	dest->unit         = node->unit;
+	return dest;
+}
+
 // public
 void ast_arena_init(struct arena *arena, u32 owner_thread_index) {
 	arena_init(arena, sizeof(struct ast), alignment_of(struct ast), 8192, owner_thread_index, NULL);
@@ -12,6 +12,7 @@ struct token;
 struct location;
 struct ast;
 struct module;
+struct unit;
 
 enum ast_kind {
 #define GEN_AST_KINDS
@@ -37,6 +38,7 @@ enum ast_flags {
 	FLAG_COMPTIME     = 1 << 14, // compile-time execution
 	FLAG_MAYBE_UNUSED = 1 << 15, // to markup unused declarations
 	FLAG_OBSOLETE     = 1 << 16, // obsolete functions
+	FLAG_PURE         = 1 << 17, // side-effect free functions
 };
 
 // map symbols to binary operation kind
@@ -128,6 +130,10 @@ struct ast_ublock {
 
 struct ast_block {
 	ast_nodes_t *nodes;
+	// Set for function body skipped by the parser, the body content is parsed later when the
+	// function is used (see parser_parse_fn_body).
+	struct ast  *lazy_decl;
+	u32          lazy_token_index;
 	bool         has_return;
 };
 
@@ -369,10 +375,13 @@ struct ast_call_loc {
 
 // struct ast base type
 struct ast {
-	enum ast_kind    kind;
-	struct location *location;
-	struct scope    *owner_scope;
-	str_t            docs; // Optional documentation string.
+	enum ast_kind kind;
+	// Index of the token the node was created from; the node location is computed from token data
+	// of the unit on demand (see ast_location).
+	u32           token_index;
+	struct unit  *unit; // Null in case the node has no location.
+	struct scope *owner_scope;
+	str_t         docs; // Optional documentation string.
 
 	union {
 #define GEN_AST_DATA
@@ -387,10 +396,16 @@ struct ast {
 
 void        ast_arena_init(struct arena *arena, u32 owner_thread_index);
 void        ast_arena_terminate(struct arena *arena);
-struct ast *ast_create_node(struct arena *arena,
-                            enum ast_kind c,
-                            struct token *tok,
-                            struct scope *parent_scope);
+struct ast *ast_create_node(struct arena  *arena,
+                            enum ast_kind  c,
+                            struct unit   *unit,
+                            u32            token_index,
+                            struct scope  *parent_scope);
+// Fill the 'dest' with location of the node and return pointer to the 'dest' or return null in case
+// the node has no location.
+struct location *ast_location(const struct ast *node, struct location *dest);
+// Location of the node valid till the end of the current block.
+#define ast_tmp_location(node) ast_location((node), &(struct location){0})
 const char *ast_binop_to_str(enum binop_kind op);
 const char *ast_unop_to_str(enum unop_kind op);
 const char *ast_get_name(const struct ast *n);
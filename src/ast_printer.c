@@ -17,14 +17,15 @@ static inline void print_address(struct ast *node, FILE *stream) {
 #define print_head(_node, _pad, _stream) _print_head((struct ast *)(_node), (_pad), (_stream))
 
 static inline void _print_head(struct ast *node, s32 pad, FILE *stream) {
-	if (node->location)
+	struct location *location = ast_tmp_location(node);
+	if (location)
 		fprintf(stream,
 		        "\n%*s%s <%d:%d>",
 		        pad * 2,
 		        "",
 		        ast_get_name(node),
-		        node->location->line,
-		        node->location->col);
+		        location->line,
+		        location->col);
 	else
 		fprintf(stream, "\n%*s%s <IMPLICIT>", pad * 2, "", ast_get_name(node));
 
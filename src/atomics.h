@@ -7,11 +7,11 @@
 
 #define batomic_store_s32(a, val)     InterlockedExchange((a), (val));
 #define batomic_load_s32(a)           InterlockedCompareExchange((a), 0, 0)
-#define batomic_fetch_add_s32(a, val) InterlockedAdd((a), (val))
-#define batomic_fetch_add_u32(a, val) (u32) InterlockedAdd((volatile LONG *)(a), (LONG)(val))
+#define batomic_fetch_add_s32(a, val) InterlockedExchangeAdd((a), (val))
+#define batomic_fetch_add_u32(a, val) (u32) InterlockedExchangeAdd((volatile LONG *)(a), (LONG)(val))
 #define batomic_store_s64(a, val)     InterlockedExchange64((a), (val));
 #define batomic_load_s64(a)           InterlockedCompareExchange64((a), 0, 0)
-#define batomic_fetch_add_s64(a, val) InterlockedAdd64((a), (val))
+#define batomic_fetch_add_s64(a, val) InterlockedExchangeAdd64((a), (val))
 
 typedef volatile LONG   batomic_s32;
 typedef volatile ULONG  batomic_u32;
@@ -27,6 +27,7 @@
 // =================================================================================================
 
 #include "blmemory.h"
+#include "atomics.h"
 #include "common.h"
 
 #ifdef BL_USE_SIMD
@@ -35,6 +36,36 @@
 #include <nmmintrin.h>
 #endif
 
+static bool        is_stats_enabled = false;
+static batomic_s64 malloc_count;
+static batomic_s64 realloc_count;
+static batomic_s64 free_count;
+static batomic_s64 allocated_bytes;
+
+#define count_allocation(counter, size)                       \
+	if (is_stats_enabled) {                                   \
+		batomic_fetch_add_s64(&(counter), 1);                 \
+		batomic_fetch_add_s64(&allocated_bytes, (s64)(size)); \
+	}                                                         \
+	(void)0
+
+#define count_free(ptr)                        \
+	if (is_stats_enabled && (ptr)) {           \
+		batomic_fetch_add_s64(&free_count, 1); \
+	}                                          \
+	(void)0
+
+void bl_alloc_enable_stats(void) {
+	is_stats_enabled = true;
+}
+
+void bl_alloc_get_stats(struct bl_alloc_stats *stats) {
+	stats->malloc_count    = batomic_load_s64(&malloc_count);
+	stats->realloc_count   = batomic_load_s64(&realloc_count);
+	stats->free_count      = batomic_load_s64(&free_count);
+	stats->allocated_bytes = batomic_load_s64(&allocated_bytes);
+}
+
 #if BL_RPMALLOC_ENABLE
 #include "rpmalloc.h"
 
@@ -42,6 +73,7 @@ void *bl_realloc_impl(void *ptr, const size_t size, const char UNUSED(*filename)
 	zone();
 	void *mem = rprealloc(ptr, size);
 	if (!mem) abort();
+	count_allocation(realloc_count, size);
 	TracyCFree(ptr);
 	TracyCAlloc(mem, size);
 	return_zone(mem);
@@ -51,12 +83,14 @@ void *bl_malloc_impl(const size_t size, const char UNUSED(*filename), s32 UNUSED
 	zone();
 	void *mem = rpmalloc(size);
 	if (!mem) abort();
+	count_allocation(malloc_count, size);
 	TracyCAlloc(mem, size);
 	return_zone(mem);
 }
 
 void bl_free_impl(void *ptr, const char UNUSED(*filename), s32 UNUSED(line)) {
 	TracyCFree(ptr);
+	count_free(ptr);
 	rpfree(ptr);
 }
 
@@ -87,6 +121,7 @@ void *bl_realloc_impl(void *ptr, const size_t size, const char UNUSED(*filename)
 	zone();
 	void *mem = realloc(ptr, size);
 	if (!mem) abort();
+	count_allocation(realloc_count, size);
 	TracyCFree(ptr);
 	TracyCAlloc(mem, size);
 	return_zone(mem);
@@ -96,12 +131,14 @@ void *bl_malloc_impl(const size_t size, const char UNUSED(*filename), s32 UNUSED
 	zone();
 	void *mem = malloc(size);
 	if (!mem) abort();
+	count_allocation(malloc_count, size);
 	TracyCAlloc(mem, size);
 	return_zone(mem);
 }
 
 void bl_free_impl(void *ptr, const char UNUSED(*filename), s32 UNUSED(line)) {
 	TracyCFree(ptr);
+	count_free(ptr);
 	free(ptr);
 }
 
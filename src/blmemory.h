@@ -19,4 +19,16 @@ void *bl_malloc_impl(const size_t size, const char *filename, s32 line);
 void  bl_free_impl(void *ptr, const char *filename, s32 line);
 void *bl_zeromem(void *dest, usize size);
 
+struct bl_alloc_stats {
+	s64 malloc_count;
+	s64 realloc_count;
+	s64 free_count;
+	s64 allocated_bytes; // Total count of bytes requested by malloc and realloc.
+};
+
+// Start counting of allocations done by bmalloc, brealloc and bfree; counting is disabled by
+// default.
+void bl_alloc_enable_stats(void);
+void bl_alloc_get_stats(struct bl_alloc_stats *stats);
+
 #endif // BL_BLMEMORY_H
@@ -1,11 +1,14 @@
 #include "builder.h"
 #include "conf.h"
 #include "stb_ds.h"
+#include "table.h"
 #include "threading.h"
 #include "vmdbg.h"
 #include <stdarg.h>
 
 #if !BL_PLATFORM_WIN
+#include <sys/mman.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #endif
 
@@ -16,6 +19,7 @@ struct builder builder;
 // =================================================================================================
 
 void file_loader_run(struct assembly *assembly, struct unit *unit);
+void lexer_init(void);
 void lexer_run(struct assembly *assembly, struct unit *unit);
 void token_printer_run(struct assembly *assembly, struct unit *unit);
 void parser_run(struct assembly *assembly, struct unit *unit);
@@ -28,6 +32,8 @@ void linker_run(struct assembly *assembly);
 void bc_writer_run(struct assembly *assembly);
 void native_bin_run(struct assembly *assembly);
 void mir_writer_run(struct assembly *assembly);
+void mir_binary_writer_run(struct assembly *assembly);
+void mir_binary_loader_run(struct assembly *assembly);
 void asm_writer_run(struct assembly *assembly);
 void x86_64run(struct assembly *assembly);
 
@@ -57,8 +63,55 @@ const char *supported_targets_experimental[] = {
 // =================================================================================================
 
 static int  compile_assembly(struct assembly *assembly);
+static void append_stats_json(struct assembly *assembly);
+static void print_time_report(struct assembly *assembly);
 static bool llvm_initialized = false;
 
+static void entry_run(struct assembly *assembly);
+static void build_entry_run(struct assembly *assembly);
+static void tests_run(struct assembly *assembly);
+static void attach_dbg(struct assembly *assembly);
+static void detach_dbg(struct assembly *assembly);
+
+// Resolve name of the pipeline stage reported in trace.
+static const char *get_stage_name(void *stage) {
+	static const struct {
+		void       *stage;
+		const char *name;
+	} names[] = {
+	    {(void *)&file_loader_run, "Load"},
+	    {(void *)&lexer_run, "Lex"},
+	    {(void *)&token_printer_run, "Print tokens"},
+	    {(void *)&parser_run, "Parse"},
+	    {(void *)&mir_unit_run, "MIR generation"},
+	    {(void *)&unit_release_run, "Release unit"},
+	    {(void *)&ast_printer_run, "Print AST"},
+	    {(void *)&docs_run, "Generate documentation"},
+	    {(void *)&linker_run, "Load libraries"},
+	    {(void *)&mir_analyze_run, "Analyze"},
+	    {(void *)&print_scopes_run, "Print scopes"},
+	    {(void *)&attach_dbg, "Attach debugger"},
+	    {(void *)&detach_dbg, "Detach debugger"},
+	    {(void *)&entry_run, "Run"},
+	    {(void *)&build_entry_run, "Run build script"},
+	    {(void *)&tests_run, "Run tests"},
+	    {(void *)&mir_writer_run, "Emit MIR"},
+	    {(void *)&mir_binary_writer_run, "Emit MIR binary"},
+	    {(void *)&mir_binary_loader_run, "Load MIR binary"},
+	    {(void *)&x86_64run, "x64 generation"},
+	    {(void *)&ir_run, "IR generation"},
+	    {(void *)&ir_opt_run, "LLVM passes"},
+	    {(void *)&bc_writer_run, "Emit LLVM IR"},
+	    {(void *)&asm_writer_run, "Emit assembly"},
+	    {(void *)&obj_writer_run, "Emit object file"},
+	    {(void *)&native_bin_run, "Link"},
+	};
+	for (usize i = 0; i < static_arrlenu(names); ++i) {
+		if (names[i].stage == stage) return names[i].name;
+	}
+	return "Stage";
+}
+
 static void unit_job(struct job_context *ctx) {
 	bassert(ctx);
 
@@ -68,15 +121,19 @@ static void unit_job(struct job_context *ctx) {
 	array(unit_stage_fn_t) pipeline = assembly->current_pipelines.unit;
 	bassert(pipeline && "Invalid unit pipeline!");
 	if (unit->loaded_from) {
-		const str_t loaded_from_unit_name = unit->loaded_from->location.unit->name;
+		const str_t loaded_from_unit_name = unit->loaded_from->unit->name;
 		builder_log("Compile: " STR_FMT " (loaded from '" STR_FMT "')", STR_ARG(unit->name), STR_ARG(loaded_from_unit_name));
 	} else {
 		builder_log("Compile: " STR_FMT "", STR_ARG(unit->name));
 	}
+	builder_trace_begin("Unit", unit->name);
 	for (usize i = 0; i < arrlenu(pipeline); ++i) {
+		builder_trace_begin(get_stage_name((void *)pipeline[i]), str_empty);
 		pipeline[i](assembly, unit);
-		if (builder.errorc) return;
+		builder_trace_end();
+		if (builder.errorc) break;
 	}
+	builder_trace_end();
 }
 
 static void submit_unit(struct assembly *assembly, struct unit *unit) {
@@ -111,13 +168,40 @@ static void llvm_terminate(void) {
 	LLVMShutdown();
 }
 
+struct stage_timer {
+	const char *name;
+	f64         wall_ms;
+	f64         cpu_ms;
+};
+
+// Stage times are measured only for the JSON statistics report.
+static inline struct stage_timer stage_timer_begin(const char *name) {
+	if (!builder.options->stats_json_file) return (struct stage_timer){0};
+	return (struct stage_timer){.name = name, .wall_ms = get_tick_ms(), .cpu_ms = get_process_cpu_ms()};
+}
+
+static inline void stage_timer_end(struct assembly *assembly, struct stage_timer timer) {
+	if (!timer.name) return;
+	struct assembly_stage_time time = {
+	    .name    = timer.name,
+	    .wall_ms = get_tick_ms() - timer.wall_ms,
+	    .cpu_ms  = get_process_cpu_ms() - timer.cpu_ms,
+	};
+	arrput(assembly->stage_times, time);
+}
+
 int compile_assembly(struct assembly *assembly) {
 	bassert(assembly);
 	array(assembly_stage_fn_t) pipeline = assembly->current_pipelines.assembly;
 	bassert(pipeline && "Invalid assembly pipeline!");
 	for (usize i = 0; i < arrlenu(pipeline); ++i) {
 		if (builder.errorc) return COMPILE_FAIL;
+		const char              *name  = get_stage_name((void *)pipeline[i]);
+		const struct stage_timer timer = stage_timer_begin(name);
+		builder_trace_begin(name, str_empty);
 		pipeline[i](assembly);
+		builder_trace_end();
+		stage_timer_end(assembly, timer);
 	}
 	return COMPILE_OK;
 }
@@ -155,6 +239,7 @@ static void setup_unit_pipeline(struct assembly *assembly) {
 	if (t->print_tokens) arrput(*stages, &token_printer_run);
 	arrput(*stages, &parser_run);
 	if (!t->syntax_only) arrput(*stages, &mir_unit_run);
+	if (builder.options->streaming_memory) arrput(*stages, &unit_release_run);
 }
 
 static void setup_assembly_pipeline(struct assembly *assembly) {
@@ -164,6 +249,12 @@ static void setup_assembly_pipeline(struct assembly *assembly) {
 	array(assembly_stage_fn_t) *stages = &assembly->current_pipelines.assembly;
 	arrsetcap(*stages, 16);
 
+	if (builder.options->load_mir) {
+		arrput(*stages, &mir_binary_loader_run);
+		if (t->emit_mir) arrput(*stages, &mir_writer_run);
+		if (t->emit_mir_binary) arrput(*stages, &mir_binary_writer_run);
+		return;
+	}
 	if (t->print_ast) arrput(*stages, &ast_printer_run);
 	if (t->kind == ASSEMBLY_DOCS) {
 		arrput(*stages, &docs_run);
@@ -181,6 +272,7 @@ static void setup_assembly_pipeline(struct assembly *assembly) {
 		if (t->vmdbg_enabled) arrput(*stages, &detach_dbg);
 	}
 	if (t->emit_mir) arrput(*stages, &mir_writer_run);
+	if (t->emit_mir_binary) arrput(*stages, &mir_binary_writer_run);
 	if (t->no_analyze) return;
 	if (t->no_llvm) return;
 	if (t->kind == ASSEMBLY_BUILD_PIPELINE) return;
@@ -206,7 +298,37 @@ static void print_stats(struct assembly *assembly) {
 #define SECONDS(t)     ((f32)t / 1000.f)
 #define PERC(t, total) ((f32)t / (f32)total * 100.f)
 
+	f64 loading_ms_precise = 0.;
+	s64 page_faults        = 0;
+	s32 mapped_count       = 0;
+	s64 source_bytes       = 0;
+	for (usize i = 0; i < arrlenu(assembly->units); ++i) {
+		struct unit *unit = assembly->units[i];
+		loading_ms_precise += unit->stats.load_ms;
+		page_faults += unit->stats.page_faults;
+		if (unit->src_mapped_size) ++mapped_count;
+		source_bytes += (s64)unit->src_len;
+	}
+	const s32 loading_ms = (s32)loading_ms_precise;
+	// Tokens are consumed by lexer and parser only.
+	const s32 token_ms = MAX(1, assembly->stats.lexing_ms + assembly->stats.parsing_ms);
+
+	s64 lookup_count = 0, lookup_cache_hit_count = 0, bloom_skip_count = 0, lock_count = 0, lock_free_count = 0;
+	for (usize i = 0; i < arrlenu(assembly->thread_local_contexts); ++i) {
+		const struct scope_thread_local *local = &assembly->thread_local_contexts[i].scope_thread_local;
+		lookup_count += local->lookup_count;
+		lookup_cache_hit_count += local->lookup_cache_hit_count;
+		bloom_skip_count += local->bloom_skip_count;
+		lock_count += local->lock_count;
+		lock_free_count += local->lock_free_count;
+	}
+
+	s64 instr_count, instr_bytes;
+	mir_instr_memory_usage(assembly, &instr_count, &instr_bytes);
+	const f64 instr_mb = (f64)instr_bytes / (1024. * 1024.);
+
 	const s32 total_ms =
+	    loading_ms +
 	    assembly->stats.parsing_ms +
 	    assembly->stats.lexing_ms +
 	    assembly->stats.mir_generate_ms +
@@ -221,6 +343,7 @@ static void print_stats(struct assembly *assembly) {
 	    "Compilation stats for '%s'\n"
 	    "--------------------------------------------------------------------------------\n"
 	    "Time:\n"
+	    "  Loading:          %10.3f seconds    %3.0f%%\n"
 	    "  Lexing:           %10.3f seconds    %3.0f%%\n"
 	    "  Parsing:          %10.3f seconds    %3.0f%%\n"
 	    "  MIR Generate:     %10.3f seconds    %3.0f%%\n"
@@ -228,13 +351,33 @@ static void print_stats(struct assembly *assembly) {
 	    "  LLVM IR:          %10.3f seconds    %3.0f%%\n"
 	    "  LLVM Obj:         %10.3f seconds    %3.0f%%\n"
 	    "  Linking:          %10.3f seconds    %3.0f%%\n\n"
-	    "  Polymorph:        %10d generated in %.3f seconds\n\n"
+	    "  Polymorph:        %10d generated in %.3f seconds, %d mixed function instances reused\n"
+	    "  Lazy functions:   %10d bodies skipped by parser, %d parsed on demand\n"
+	    "  Functions:        %10d analyzed, %d not referenced (not analyzed)\n"
+	    "  Complete checks:  %10d (%d memoized, %lld types visited)\n"
+	    "  Scope lookups:    %10lld (%.1f%% cached, %lld scope probes skipped by filter)\n"
+	    "  Scope locks:      %10lld in unit jobs, %lld in assembly stages (%lld lock-free)\n"
+	    "  Type cache:       %10d types (%d structural hits, %d name lookups)\n"
+	    "  RTTI:             %10d compile-time entries (%.2f kB), %d binary entries (%.2f kB, %d deduplicated) in %.3f seconds\n"
+	    "  MIR passes:       %10d calls inlined, %d copies propagated, %d expressions folded, %d dead stores removed in %.3f seconds\n"
+	    "  MIR blocks:       %10d branches folded, %d jumps threaded, %d dead blocks removed, %d blocks merged\n"
+	    "  Comptime memo:    %10d hits, %d misses\n\n"
 	    "  Total:            %10.3f seconds\n"
 	    "  Lines:              %8d\n"
-	    "  Speed:            %10.0f lines/second\n\n"
+	    "  Speed:            %10.0f lines/second\n"
+	    "  Tokens:             %8d (%.2f MB%s)\n"
+	    "  Token speed:      %10.0f tokens/second (lexing + parsing)\n"
+	    "  Lexing speed:     %10.2f MB/second (%.2f MB of source code)\n"
+	    "  MIR instructions:   %8lld (%.2f MB, %.0f instructions/MB)\n\n"
 	    "MISC:\n"
-	    "  Allocated stack snapshot count: %d\n",
+	    "  Allocated stack snapshot count: %d\n"
+	    "  Source files mapped:            %d/%d\n"
+	    "  Source file searches:           %d (%d cached)\n"
+	    "  Page faults (loading + lexing): %lld\n"
+	    "  Peak memory:                    %.2f MB\n",
 	    assembly->target->name,
+	    SECONDS(loading_ms),
+	    PERC(loading_ms, total_ms),
 	    SECONDS(assembly->stats.lexing_ms),
 	    PERC(assembly->stats.lexing_ms, total_ms),
 	    SECONDS(assembly->stats.parsing_ms),
@@ -251,17 +394,79 @@ static void print_stats(struct assembly *assembly) {
 	    PERC(assembly->stats.linking_ms, total_ms),
 	    assembly->stats.polymorph_count,
 	    SECONDS(assembly->stats.polymorph_ms),
+	    assembly->stats.mixed_fn_reused_count,
+	    assembly->stats.lazy_fn_count,
+	    assembly->stats.lazy_fn_parsed_count,
+	    assembly->stats.analyzed_fn_count,
+	    assembly->stats.deferred_fn_count,
+	    assembly->stats.complete_check_count,
+	    assembly->stats.complete_check_hit_count,
+	    (long long)assembly->stats.complete_check_node_count,
+	    (long long)lookup_count,
+	    lookup_count ? (f64)lookup_cache_hit_count / (f64)lookup_count * 100. : 0.,
+	    (long long)bloom_skip_count,
+	    (long long)assembly->stats.scope_unit_lock_count,
+	    (long long)(lock_count - assembly->stats.scope_unit_lock_count),
+	    (long long)lock_free_count,
+	    tbl_len(assembly->mir.type_cache),
+	    assembly->stats.type_struct_cache_hit_count,
+	    assembly->stats.type_name_lookup_count,
+	    assembly->stats.rtti_vm_count,
+	    (f64)assembly->stats.rtti_vm_bytes / 1024.,
+	    assembly->stats.rtti_bin_count,
+	    (f64)assembly->stats.rtti_bin_bytes / 1024.,
+	    assembly->stats.rtti_bin_dedup_count,
+	    (f64)assembly->stats.rtti_us / 1000000.,
+	    assembly->stats.mir_opt_inlined_count,
+	    assembly->stats.mir_opt_propagated_count,
+	    assembly->stats.mir_opt_const_folded_count,
+	    assembly->stats.mir_opt_dead_store_count,
+	    (f64)assembly->stats.mir_opt_us / 1000000.,
+	    assembly->stats.mir_opt_folded_count,
+	    assembly->stats.mir_opt_threaded_count,
+	    assembly->stats.mir_opt_dead_block_count,
+	    assembly->stats.mir_opt_merged_count,
+	    assembly->stats.comptime_memo_hit_count,
+	    assembly->stats.comptime_memo_miss_count,
 	    SECONDS(total_ms),
 	    builder.total_lines,
 	    ((f32)builder.total_lines) / SECONDS(total_ms),
-	    assembly->stats.comptime_call_stacks_count);
+	    assembly->stats.token_count,
+	    (f64)assembly->stats.token_bytes / (1024. * 1024.),
+	    builder.options->streaming_memory ? ", released per unit" : "",
+	    ((f32)assembly->stats.token_count) / SECONDS(token_ms),
+	    ((f64)source_bytes / (1024. * 1024.)) / SECONDS(MAX(1, assembly->stats.lexing_ms)),
+	    (f64)source_bytes / (1024. * 1024.),
+	    instr_count,
+	    instr_mb,
+	    instr_mb > 0. ? (f64)instr_count / instr_mb : 0.,
+	    assembly->stats.comptime_call_stacks_count,
+	    mapped_count,
+	    (s32)arrlen(assembly->units),
+	    assembly->stats.source_path_search_count,
+	    assembly->stats.source_path_hit_count,
+	    page_faults,
+	    (f64)get_peak_memory_bytes() / (1024. * 1024.));
 
 #undef SECONDS
 #undef PERC
 }
 
+// All unit jobs are done at this point and the rest of the compilation (assembly pipeline) uses
+// scopes only from the main thread; so we can seal all scopes and avoid locking.
+static void seal_scopes(struct assembly *assembly) {
+	s64 lock_count = 0;
+	for (usize i = 0; i < arrlenu(assembly->thread_local_contexts); ++i) {
+		struct scope_thread_local *local = &assembly->thread_local_contexts[i].scope_thread_local;
+		scope_thread_local_seal(local);
+		lock_count += local->lock_count;
+	}
+	batomic_store_s64(&assembly->stats.scope_unit_lock_count, lock_count);
+}
+
 static void clear_stats(struct assembly *assembly) {
 	memset(&assembly->stats, 0, sizeof(assembly->stats));
+	arrfree(assembly->stage_times);
 }
 
 static int compile(struct assembly *assembly) {
@@ -274,7 +479,9 @@ static int compile(struct assembly *assembly) {
 	setup_assembly_pipeline(assembly);
 
 	{
-		builder.auto_submit = true;
+		const struct stage_timer timer = stage_timer_begin("Units");
+		builder.auto_submit            = true;
+		builder_begin_message_buffering();
 
 		// !!! we modify original array while compiling !!!
 		usize         len = arrlenu(assembly->units);
@@ -287,10 +494,14 @@ static int compile(struct assembly *assembly) {
 
 		bfree(dup);
 		wait_threads();
+		builder_flush_messages();
 
 		builder.auto_submit = false;
+		stage_timer_end(assembly, timer);
 	}
 
+	seal_scopes(assembly);
+
 	// Compile assembly using pipeline.
 	if (state == COMPILE_OK) state = compile_assembly(assembly);
 
@@ -310,6 +521,12 @@ static int compile(struct assembly *assembly) {
 	if (builder.options->stats && assembly->target->kind != ASSEMBLY_BUILD_PIPELINE) {
 		print_stats(assembly);
 	}
+	if (builder.options->stats_json_file && assembly->target->kind != ASSEMBLY_BUILD_PIPELINE) {
+		append_stats_json(assembly);
+	}
+	if (builder.options->time_report && assembly->target->kind != ASSEMBLY_BUILD_PIPELINE) {
+		print_time_report(assembly);
+	}
 	clear_stats(assembly);
 
 	if (builder.errorc) return builder.max_error;
@@ -341,6 +558,8 @@ void builder_init(struct builder_options *options) {
 	for (s32 i = 0; i < _BUILTIN_ID_COUNT; ++i) {
 		builtin_ids[i].hash = strhash(builtin_ids[i].str);
 	}
+	tokens_init_lookup_tables();
+	lexer_init();
 
 	mtx_init(&builder.log_mutex, mtx_plain);
 
@@ -356,6 +575,12 @@ void builder_terminate(void) {
 
 	mtx_destroy(&builder.log_mutex);
 
+	for (usize i = 0; i < arrlenu(builder.message_buffers); ++i) {
+		bassert(arrlenu(builder.message_buffers[i].records) == 0 && "Unflushed messages!");
+		arrfree(builder.message_buffers[i].records);
+	}
+	arrfree(builder.message_buffers);
+
 	for (usize i = 0; i < arrlenu(builder.targets); ++i) {
 		target_delete(builder.targets[i]);
 	}
@@ -434,14 +659,174 @@ struct target *_builder_add_target(const char *name, bool is_default) {
 	return target;
 }
 
+#if !BL_PLATFORM_WIN
+// Written by the child process into memory shared with the parent.
+struct target_process_result {
+	s32  state;
+	s32  errorc;
+	s32  max_error;
+	bool is_set;
+};
+
+struct target_process {
+	const struct target          *target;
+	struct target_process_result *result;
+	pid_t                         pid;
+	FILE                         *out;
+	FILE                         *err;
+	bool                          is_done;
+};
+
+static void print_captured_output(FILE *captured, FILE *stream) {
+	char  buf[4096];
+	usize len;
+	rewind(captured);
+	while ((len = fread(buf, 1, static_arrlenu(buf), captured))) {
+		fwrite(buf, 1, len, stream);
+	}
+	fclose(captured);
+}
+
+static bool start_target_process(struct target_process *process, const s32 jobs) {
+	process->out = tmpfile();
+	process->err = tmpfile();
+	if (!process->out || !process->err) {
+		builder_error("Cannot create temporary output file for target '%s'.", process->target->name);
+		return false;
+	}
+	// Nothing buffered should be duplicated into the child process.
+	fflush(stdout);
+	fflush(stderr);
+	process->pid = fork();
+	if (process->pid == -1) {
+		builder_error("Cannot start compilation process of target '%s'.", process->target->name);
+		return false;
+	}
+	if (process->pid == 0) {
+		// Child process compiles the target and exits, the output is captured and later printed by
+		// the parent. The thread pool was stopped before fork, so the child starts its own one.
+		dup2(fileno(process->out), STDOUT_FILENO);
+		dup2(fileno(process->err), STDERR_FILENO);
+		start_threads(MAX(cpu_thread_count() / jobs, 2));
+		// Only errors of this target are reported back, the parent already counts the rest.
+		builder.errorc    = 0;
+		builder.max_error = 0;
+		const s32 state   = builder_compile(process->target);
+		fflush(stdout);
+		fflush(stderr);
+		(*process->result) = (struct target_process_result){
+		    .state     = state,
+		    .errorc    = builder.errorc,
+		    .max_error = builder.max_error,
+		    .is_set    = true,
+		};
+		_exit(state == COMPILE_OK ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+	return true;
+}
+
+// The builder keeps global state (error counters, job queue, thread local contexts) so each
+// target is compiled in a separate forked process. Output of each process is captured and printed
+// in order of targets to keep messages grouped and deterministic. Worker threads are stopped for
+// the whole time, so no thread holds any lock while the process is forked. No more targets are
+// started after the first failure, same as in sequential compilation.
+static s32 compile_targets_in_parallel(array(const struct target *) targets, const s32 jobs) {
+	const usize            len        = arrlenu(targets);
+	usize                  started    = 0;
+	usize                  printed    = 0;
+	s32                    running    = 0;
+	s32                    state      = COMPILE_OK;
+	bool                   has_failed = false;
+	struct target_process *processes  = bmalloc(sizeof(struct target_process) * len);
+	bl_zeromem(processes, sizeof(struct target_process) * len);
+
+	const usize                   results_size = sizeof(struct target_process_result) * len;
+	struct target_process_result *results      = mmap(NULL, results_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (results == MAP_FAILED) babort("Cannot allocate shared memory for target compilation.");
+	bl_zeromem(results, results_size);
+
+	stop_threads();
+	while (printed < started || (started < len && !has_failed)) {
+		while (running < jobs && started < len && !has_failed) {
+			struct target_process *process = &processes[started];
+			process->target                = targets[started];
+			process->result                = &results[started];
+			++started;
+			if (start_target_process(process, jobs)) {
+				++running;
+			} else {
+				process->is_done = true;
+				has_failed       = true;
+			}
+		}
+
+		if (running) {
+			s32         status = 0;
+			const pid_t pid    = wait(&status);
+			if (pid == -1) babort("Waiting for target compilation process failed.");
+			for (usize i = 0; i < started; ++i) {
+				struct target_process *process = &processes[i];
+				if (process->pid != pid || process->is_done) continue;
+				process->is_done = true;
+				--running;
+				if (!process->result->is_set || process->result->state != COMPILE_OK) has_failed = true;
+				break;
+			}
+		}
+
+		for (; printed < started && processes[printed].is_done; ++printed) {
+			struct target_process *process = &processes[printed];
+			if (process->out) print_captured_output(process->out, stdout);
+			if (process->err) print_captured_output(process->err, stderr);
+			fflush(stdout);
+			fflush(stderr);
+
+			struct target_process_result *result = process->result;
+			if (!result->is_set) {
+				// Process failed to start or crashed.
+				builder_error("Compilation of target '%s' failed.", process->target->name);
+				result->state = COMPILE_FAIL;
+			}
+			builder.errorc += result->errorc;
+			builder.max_error = MAX(builder.max_error, result->max_error);
+			if (state == COMPILE_OK) state = result->state;
+		}
+	}
+
+	start_threads(MAX(cpu_thread_count(), 2));
+
+	munmap(results, results_size);
+	bfree(processes);
+	return state;
+}
+#endif
+
 int builder_compile_all(void) {
-	s32 state = COMPILE_OK;
+	s32 state                            = COMPILE_OK;
+	array(const struct target *) targets = NULL;
 	for (usize i = 0; i < arrlenu(builder.targets); ++i) {
 		struct target *target = builder.targets[i];
 		if (target->kind == ASSEMBLY_BUILD_PIPELINE) continue;
-		state = builder_compile(target);
-		if (state != COMPILE_OK) break;
+		arrput(targets, target);
+	}
+
+	s32 jobs = builder.options->jobs > 0 ? builder.options->jobs : cpu_thread_count();
+	jobs     = MIN(jobs, (s32)arrlen(targets));
+#if BL_PLATFORM_WIN
+	jobs = 1;
+#endif
+
+	if (jobs > 1) {
+#if !BL_PLATFORM_WIN
+		state = compile_targets_in_parallel(targets, jobs);
+#endif
+	} else {
+		for (usize i = 0; i < arrlenu(targets); ++i) {
+			state = builder_compile(targets[i]);
+			if (state != COMPILE_OK) break;
+		}
 	}
+	arrfree(targets);
 	return state;
 }
 
@@ -456,7 +841,9 @@ s32 builder_compile(const struct target *target) {
 	// Each invocation creates new assembly, this way we can compile the same target multiple times.
 	struct assembly *assembly = assembly_new(target);
 
+	builder_trace_begin("Target", make_str_from_c(target->name));
 	const s32 state = compile(assembly);
+	builder_trace_end();
 
 	// @Note 2024-09-09 This might be problematic in case we compile lot of targets, however in such
 	// case programmer can decide and enable do_cleanup_when_done to reduce memory usage, but lost a
@@ -467,22 +854,72 @@ s32 builder_compile(const struct target *target) {
 	return state;
 }
 
-void builder_print_location(FILE *stream, struct location *loc, s32 col, s32 len) {
+static void append_vfmt(str_buf_t *buf, const char *format, va_list args) {
+	va_list args_copy;
+	va_copy(args_copy, args);
+	const s32 len = vsnprintf(NULL, 0, format, args_copy);
+	va_end(args_copy);
+	if (len <= 0) return;
+	if (buf->len + len >= buf->cap) str_buf_setcap(buf, MAX(buf->len + len, buf->cap * 2));
+	vsnprintf(buf->ptr + buf->len, len + 1, format, args);
+	buf->len += len;
+}
+
+static void append_fmt(str_buf_t *buf, const char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	append_vfmt(buf, format, args);
+	va_end(args);
+}
+
+// Same as color_print, but the output is appended into the buffer. Only ANSI color codes are
+// supported; legacy console colors are set when the text is printed (see print_text).
+static void append_color_fmt(str_buf_t *buf, s32 color, const char *format, ...) {
+	if (builder.options->no_color) color = BL_NO_COLOR;
+	const char *c = "";
+	switch (color) {
+	case BL_RED:
+		c = "\x1b[31m";
+		break;
+	case BL_GREEN:
+		c = "\x1b[32m";
+		break;
+	case BL_YELLOW:
+		c = "\x1b[33m";
+		break;
+	case BL_BLUE:
+		c = "\x1b[34m";
+		break;
+	case BL_CYAN:
+		c = "\x1b[36m";
+		break;
+	default:
+		break;
+	}
+	va_list args;
+	va_start(args, format);
+	if (color != BL_NO_COLOR) append_fmt(buf, "%s", c);
+	append_vfmt(buf, format, args);
+	if (color != BL_NO_COLOR) append_fmt(buf, "\x1b[0m");
+	va_end(args);
+}
+
+static void append_location(str_buf_t *buf, struct location *loc, s32 col, s32 len) {
 	long      line_len = 0;
 	const s32 padding  = snprintf(NULL, 0, "%+d", loc->line) + 2;
 	// Line one
 	const char *line_str = unit_get_src_ln(loc->unit, loc->line - 1, &line_len);
 	if (line_str && line_len) {
-		fprintf(stream, "\n%*d | %.*s", padding, loc->line - 1, (int)line_len, line_str);
+		append_fmt(buf, "\n%*d | %.*s", padding, loc->line - 1, (int)line_len, line_str);
 	}
 	// Line two
 	line_str = unit_get_src_ln(loc->unit, loc->line, &line_len);
 	if (line_str && line_len) {
-		color_print(stream, BL_YELLOW, "\n>%*d | %.*s", padding - 1, loc->line, (int)line_len, line_str);
+		append_color_fmt(buf, BL_YELLOW, "\n>%*d | %.*s", padding - 1, loc->line, (int)line_len, line_str);
 	}
 	// Line cursors
-	if (len > 0) {
-		char buf[256];
+	if (len > 0 && line_str) {
+		char buf_cursor[256];
 		s32  written_bytes = 0;
 		for (s32 i = 0; i < col + len - 1; ++i) {
 			// We need to do this to properly handle tab indentation.
@@ -491,57 +928,146 @@ void builder_print_location(FILE *stream, struct location *loc, s32 col, s32 len
 			if (i >= col - 1) insert = '^';
 
 			written_bytes +=
-			    snprintf(buf + written_bytes, static_arrlenu(buf) - written_bytes, "%c", insert);
+			    snprintf(buf_cursor + written_bytes, static_arrlenu(buf_cursor) - written_bytes, "%c", insert);
 		}
-		fprintf(stream, "\n%*s | ", padding, "");
-		color_print(stream, BL_GREEN, "%s", buf);
+		append_fmt(buf, "\n%*s | ", padding, "");
+		append_color_fmt(buf, BL_GREEN, "%s", buf_cursor);
 	}
 
 	// Line three
 	line_str = unit_get_src_ln(loc->unit, loc->line + 1, &line_len);
 	if (line_str && line_len) {
-		fprintf(stream, "\n%*d | %.*s", padding, loc->line + 1, (int)line_len, line_str);
+		append_fmt(buf, "\n%*d | %.*s", padding, loc->line + 1, (int)line_len, line_str);
 	}
-	fprintf(stream, "\n\n");
+	append_fmt(buf, "\n\n");
 }
 
-static inline bool should_report(enum builder_msg_type type) {
-	const struct builder_options *opt = builder.options;
+static s32 get_ansi_color(s32 code) {
+	switch (code) {
+	case 31:
+		return BL_RED;
+	case 32:
+		return BL_GREEN;
+	case 33:
+		return BL_YELLOW;
+	case 34:
+		return BL_BLUE;
+	case 36:
+		return BL_CYAN;
+	default:
+		return BL_NO_COLOR;
+	}
+}
+
+// Print the text rendered by append_color_fmt; in case legacy console colors are used, ANSI color
+// codes are translated into color_print calls.
+static void print_text(FILE *stream, const char *text) {
+	if (!builder.options->legacy_colors) {
+		fputs(text, stream);
+		return;
+	}
+	s32 color = BL_NO_COLOR;
+	while (*text) {
+		const char *escape = strstr(text, "\x1b[");
+		const s32   len    = escape ? (s32)(escape - text) : (s32)strlen(text);
+		if (len) color_print(stream, color, "%.*s", len, text);
+		if (!escape) break;
+		char *end = NULL;
+		color     = get_ansi_color((s32)strtol(escape + 2, &end, 10));
+		text      = *end == 'm' ? end + 1 : end;
+	}
+}
+
+void builder_print_location(FILE *stream, struct location *loc, s32 col, s32 len) {
+	str_buf_t buf = get_tmp_str();
+	append_location(&buf, loc, col, len);
+	print_text(stream, str_buf_to_c(buf));
+	put_tmp_str(buf);
+}
+
+static void append_json_string(str_buf_t *buf, const char *ptr, s32 len) {
+	str_buf_append(buf, cstr("\""));
+	for (s32 i = 0; i < len; ++i) {
+		const char c = ptr[i];
+		switch (c) {
+		case '"':
+			str_buf_append(buf, cstr("\\\""));
+			break;
+		case '\\':
+			str_buf_append(buf, cstr("\\\\"));
+			break;
+		case '\n':
+			str_buf_append(buf, cstr("\\n"));
+			break;
+		case '\r':
+			str_buf_append(buf, cstr("\\r"));
+			break;
+		case '\t':
+			str_buf_append(buf, cstr("\\t"));
+			break;
+		default:
+			if ((u8)c < 0x20) {
+				append_fmt(buf, "\\u%04x", (u32)(u8)c);
+			} else {
+				_str_buf_append(buf, (char *)&ptr[i], 1);
+			}
+		}
+	}
+	str_buf_append(buf, cstr("\""));
+}
+
+static const char *get_msg_type_name(enum builder_msg_type type) {
 	switch (type) {
 	case MSG_LOG:
-		return opt->verbose && !opt->silent;
+		return "log";
 	case MSG_INFO:
-		return !opt->silent;
+		return "info";
 	case MSG_WARN:
-		return !opt->no_warning && !opt->silent;
+		return "warning";
 	case MSG_ERR_NOTE:
+		return "note";
 	case MSG_ERR:
-		return builder.errorc < opt->error_limit;
+		return "error";
 	}
 	babort("Unknown message type!");
 }
 
-void builder_vmsg(enum builder_msg_type type,
-                  s32                   code,
-                  struct location      *src,
-                  enum builder_cur_pos  pos,
-                  const char           *format,
-                  va_list               args) {
-	mtx_lock(&builder.log_mutex);
-	if (!should_report(type)) goto DONE;
-
-	FILE *stream = stdout;
-	if (type == MSG_ERR || type == MSG_ERR_NOTE) {
-		stream = stderr;
-		builder.errorc++;
-		builder.max_error = code > builder.max_error ? code : builder.max_error;
+// Produce one JSON object per line.
+static void render_json_message(str_buf_t           *buf,
+                                enum builder_msg_type type,
+                                s32                   code,
+                                struct location      *src,
+                                s32                   col,
+                                s32                   len,
+                                const char           *format,
+                                va_list               args) {
+	append_fmt(buf, "{\"type\":\"%s\"", get_msg_type_name(type));
+	if (code > NO_ERR) append_fmt(buf, ",\"code\":%d", code);
+	if (src) {
+		str_buf_append(buf, cstr(",\"file\":"));
+		append_json_string(buf, src->unit->filepath.ptr, src->unit->filepath.len);
+		append_fmt(buf, ",\"line\":%d,\"col\":%d,\"len\":%d", src->line, col, len);
 	}
+	str_buf_t message = get_tmp_str();
+	append_vfmt(&message, format, args);
+	str_buf_append(buf, cstr(",\"message\":"));
+	append_json_string(buf, message.ptr, message.len);
+	str_buf_append(buf, cstr("}\n"));
+	put_tmp_str(message);
+}
 
+static void render_message(str_buf_t           *buf,
+                           enum builder_msg_type type,
+                           s32                   code,
+                           struct location      *src,
+                           enum builder_cur_pos  pos,
+                           const char           *format,
+                           va_list               args) {
+	s32 col = 0;
+	s32 len = 0;
 	if (src) {
-		const str_t filepath = builder.options->full_path_reports ? src->unit->filepath : src->unit->filename;
-		s32         line     = src->line;
-		s32         col      = src->col;
-		s32         len      = src->len;
+		col = src->col;
+		len = src->len;
 		switch (pos) {
 		case CARET_AFTER:
 			col += len;
@@ -557,46 +1083,146 @@ void builder_vmsg(enum builder_msg_type type,
 		default:
 			break;
 		}
-		fprintf(stream, "" STR_FMT ":%d:%d: ", STR_ARG(filepath), line, col);
-		switch (type) {
-		case MSG_ERR: {
-			if (code > NO_ERR)
-				color_print(stream, BL_RED, "error(%04d): ", code);
-			else
-				color_print(stream, BL_RED, "error: ");
-			break;
-		}
-		case MSG_WARN: {
-			color_print(stream, BL_YELLOW, "warning: ");
-			break;
-		}
+	}
 
-		default:
-			break;
-		}
-		vfprintf(stream, format, args);
-		builder_print_location(stream, src, col, len);
+	if (builder.options->message_format == MESSAGE_FORMAT_JSON) {
+		render_json_message(buf, type, code, src, col, len, format, args);
+		return;
+	}
+
+	if (src) {
+		const str_t filepath = builder.options->full_path_reports ? src->unit->filepath : src->unit->filename;
+		append_fmt(buf, "" STR_FMT ":%d:%d: ", STR_ARG(filepath), src->line, col);
+	}
+	switch (type) {
+	case MSG_ERR: {
+		if (code > NO_ERR)
+			append_color_fmt(buf, BL_RED, "error(%04d): ", code);
+		else
+			append_color_fmt(buf, BL_RED, "error: ");
+		break;
+	}
+	case MSG_WARN: {
+		append_color_fmt(buf, BL_YELLOW, "warning: ");
+		break;
+	}
+	default:
+		break;
+	}
+	append_vfmt(buf, format, args);
+	if (src) {
+		append_location(buf, src, col, len);
 	} else {
-		switch (type) {
-		case MSG_ERR: {
-			if (code > NO_ERR)
-				color_print(stream, BL_RED, "error(%04d): ", code);
-			else
-				color_print(stream, BL_RED, "error: ");
-			break;
-		}
-		case MSG_WARN: {
-			color_print(stream, BL_YELLOW, "warning: ");
-			break;
+		append_fmt(buf, "\n");
+	}
+}
+
+static inline bool should_report(enum builder_msg_type type) {
+	const struct builder_options *opt = builder.options;
+	switch (type) {
+	case MSG_LOG:
+		return opt->verbose && !opt->silent;
+	case MSG_INFO:
+		return !opt->silent;
+	case MSG_WARN:
+		return !opt->no_warning && !opt->silent;
+	case MSG_ERR_NOTE:
+	case MSG_ERR:
+		return true;
+	}
+	babort("Unknown message type!");
+}
+
+static void print_message(str_buf_t text, s32 code, bool is_error) {
+	mtx_lock(&builder.log_mutex);
+	if (is_error) builder.max_error = MAX(builder.max_error, code);
+	print_text(is_error ? stderr : stdout, str_buf_to_c(text));
+	mtx_unlock(&builder.log_mutex);
+}
+
+static s32 compare_messages(const void *a, const void *b) {
+	const struct builder_msg_record *first  = a;
+	const struct builder_msg_record *second = b;
+
+	const s32 len    = MIN(first->filepath.len, second->filepath.len);
+	s32       result = len ? memcmp(first->filepath.ptr, second->filepath.ptr, len) : 0;
+	if (result) return result;
+	if (first->filepath.len != second->filepath.len) return first->filepath.len < second->filepath.len ? -1 : 1;
+	if (first->line != second->line) return first->line < second->line ? -1 : 1;
+	if (first->col != second->col) return first->col < second->col ? -1 : 1;
+	return strcmp(str_buf_to_c(first->text), str_buf_to_c(second->text));
+}
+
+void builder_begin_message_buffering(void) {
+	bassert(!builder.is_buffering_messages);
+	// Thread count might change (e.g. restarted after fork).
+	const usize thread_count = (usize)get_thread_count();
+	while (arrlenu(builder.message_buffers) < thread_count) {
+		arrput(builder.message_buffers, (struct builder_msg_buffer){0});
+	}
+	builder.is_buffering_messages = true;
+}
+
+void builder_flush_messages(void) {
+	zone();
+	builder.is_buffering_messages = false;
+	array(struct builder_msg_record) records = NULL;
+	for (usize i = 0; i < arrlenu(builder.message_buffers); ++i) {
+		struct builder_msg_buffer *buffer = &builder.message_buffers[i];
+		for (usize j = 0; j < arrlenu(buffer->records); ++j) {
+			arrput(records, buffer->records[j]);
 		}
-		default:
-			break;
+		arrsetlen(buffer->records, 0);
+	}
+	if (!arrlenu(records)) return_zone();
+	qsort(records, arrlenu(records), sizeof(struct builder_msg_record), &compare_messages);
+	for (usize i = 0; i < arrlenu(records); ++i) {
+		struct builder_msg_record *record = &records[i];
+		print_message(record->text, record->code, record->is_error);
+		str_buf_free(&record->text);
+	}
+	arrfree(records);
+	return_zone();
+}
+
+void builder_vmsg(enum builder_msg_type type,
+                  s32                   code,
+                  struct location      *src,
+                  enum builder_cur_pos  pos,
+                  const char           *format,
+                  va_list               args) {
+	if (!should_report(type)) return;
+
+	const bool is_error = type == MSG_ERR || type == MSG_ERR_NOTE;
+	if (is_error && batomic_fetch_add_s32(&builder.errorc, 1) >= builder.options->error_limit) {
+		batomic_fetch_add_s32(&builder.errorc, -1);
+		return;
+	}
+
+	if (builder.is_buffering_messages) {
+		// Message is rendered right away, the source might not be available when the buffer is
+		// flushed.
+		struct builder_msg_buffer *buffer = &builder.message_buffers[get_worker_index()];
+		if (type == MSG_ERR_NOTE && arrlenu(buffer->records)) {
+			// Keep notes together with the reported error.
+			render_message(&arrlast(buffer->records).text, type, code, src, pos, format, args);
+		} else {
+			struct builder_msg_record record = {
+			    .filepath = src ? src->unit->filepath : str_empty,
+			    .line     = src ? src->line : 0,
+			    .col      = src ? src->col : 0,
+			    .code     = code,
+			    .is_error = is_error,
+			};
+			render_message(&record.text, type, code, src, pos, format, args);
+			arrput(buffer->records, record);
 		}
-		vfprintf(stream, format, args);
-		fprintf(stream, "\n");
+	} else {
+		str_buf_t text = get_tmp_str();
+		render_message(&text, type, code, src, pos, format, args);
+		print_message(text, code, is_error);
+		put_tmp_str(text);
 	}
-DONE:
-	mtx_unlock(&builder.log_mutex);
 
 #if ASSERT_ON_CMP_ERROR
 	if (type == MSG_ERR) bassert(false);
@@ -615,6 +1241,303 @@ void builder_msg(enum builder_msg_type type,
 	va_end(args);
 }
 
+// Buffer cached by the thread is valid only for the tracing session it was created in, buffers are
+// released when the trace is written.
+static _Thread_local struct builder_trace_buffer *thread_trace_buffer     = NULL;
+static _Thread_local s32                          thread_trace_generation = 0;
+
+static struct builder_trace_buffer *get_trace_buffer(void) {
+	if (thread_trace_buffer && thread_trace_generation == builder.trace_generation) return thread_trace_buffer;
+	struct builder_trace_buffer *buffer = bmalloc(sizeof(struct builder_trace_buffer));
+	bl_zeromem(buffer, sizeof(struct builder_trace_buffer));
+
+	mtx_lock(&builder.log_mutex);
+	buffer->tid = (s32)arrlenu(builder.trace_buffers);
+	arrput(builder.trace_buffers, buffer);
+	mtx_unlock(&builder.log_mutex);
+
+	if (thrd_equal(thrd_current(), MAIN_THREAD)) {
+		append_fmt(&buffer->events, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Main\"}}", buffer->tid);
+	} else {
+		append_fmt(&buffer->events,
+		           ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Worker %u\"}}",
+		           buffer->tid,
+		           get_worker_index());
+	}
+	thread_trace_buffer     = buffer;
+	thread_trace_generation = builder.trace_generation;
+	return buffer;
+}
+
+static inline f64 get_trace_timestamp_us(void) {
+	return (get_tick_ms() - builder.trace_start_ms) * 1000.;
+}
+
+void _builder_trace_begin(const char *name, str_t detail) {
+	struct builder_trace_buffer *buffer = get_trace_buffer();
+	append_fmt(&buffer->events, ",\n{\"name\":\"%s\",\"ph\":\"B\",\"pid\":1,\"tid\":%d,\"ts\":%.3f", name, buffer->tid, get_trace_timestamp_us());
+	if (detail.len) {
+		str_buf_append(&buffer->events, cstr(",\"args\":{\"detail\":"));
+		append_json_string(&buffer->events, detail.ptr, detail.len);
+		str_buf_append(&buffer->events, cstr("}"));
+	}
+	str_buf_append(&buffer->events, cstr("}"));
+}
+
+void _builder_trace_end(void) {
+	struct builder_trace_buffer *buffer = get_trace_buffer();
+	append_fmt(&buffer->events, ",\n{\"ph\":\"E\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}", buffer->tid, get_trace_timestamp_us());
+}
+
+void builder_start_tracing(void) {
+	if (!builder.options->trace_file) return;
+	builder.trace_start_ms = get_tick_ms();
+	builder.is_tracing     = true;
+	++builder.trace_generation;
+}
+
+void builder_write_trace(void) {
+	if (!builder.is_tracing) return;
+	zone();
+	builder.is_tracing = false;
+
+	FILE *file = fopen(builder.options->trace_file, "w");
+	if (file) {
+		fputs("{\"traceEvents\":[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"blc\"}}", file);
+		for (usize i = 0; i < arrlenu(builder.trace_buffers); ++i) {
+			fputs(str_buf_to_c(builder.trace_buffers[i]->events), file);
+		}
+		fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+		fclose(file);
+	} else {
+		builder_error("Cannot open trace file '%s' for writing.", builder.options->trace_file);
+	}
+
+	for (usize i = 0; i < arrlenu(builder.trace_buffers); ++i) {
+		str_buf_free(&builder.trace_buffers[i]->events);
+		bfree(builder.trace_buffers[i]);
+	}
+	arrfree(builder.trace_buffers);
+	return_zone();
+}
+
+// Append total size of elements allocated in the arena of the specified kind in all thread local
+// contexts; the arena is identified by offset in the context structure.
+static void append_arena_bytes(str_buf_t *buf, struct assembly *assembly, const char *kind, usize offset) {
+	s64 bytes = 0;
+	for (usize i = 0; i < arrlenu(assembly->thread_local_contexts); ++i) {
+		const struct arena *arena = (struct arena *)((u8 *)&assembly->thread_local_contexts[i] + offset);
+		bytes += (s64)(arena->num_allocations * arena->elem_size_bytes);
+	}
+	append_fmt(buf, "\"%s\":%lld,", kind, (long long)bytes);
+}
+
+static void append_stats_json(struct assembly *assembly) {
+	zone();
+	str_buf_t *buf = &builder.stats_json;
+	if (buf->len) str_buf_append(buf, cstr(","));
+	str_buf_append(buf, cstr("\n    {\"name\":"));
+	append_json_string(buf, assembly->target->name, (s32)strlen(assembly->target->name));
+
+	// Stages
+	str_buf_append(buf, cstr(",\n     \"stages\":["));
+	for (usize i = 0; i < arrlenu(assembly->stage_times); ++i) {
+		struct assembly_stage_time *time = &assembly->stage_times[i];
+		append_fmt(buf, "%s{\"name\":\"%s\",\"wall_ms\":%.3f,\"cpu_ms\":%.3f}", i ? "," : "", time->name, time->wall_ms, time->cpu_ms);
+	}
+
+	// Units
+	str_buf_append(buf, cstr("],\n     \"units\":["));
+	for (usize i = 0; i < arrlenu(assembly->units); ++i) {
+		struct unit *unit = assembly->units[i];
+		append_fmt(buf, "%s\n      {\"file\":", i ? "," : "");
+		append_json_string(buf, unit->filepath.ptr, unit->filepath.len);
+		append_fmt(buf,
+		           ",\"bytes\":%llu,\"load_ms\":%.3f,\"lex_ms\":%.3f,\"parse_ms\":%.3f,\"mir_generate_ms\":%.3f}",
+		           (unsigned long long)unit->src_len,
+		           unit->stats.load_ms,
+		           unit->stats.lex_ms,
+		           unit->stats.parse_ms,
+		           unit->stats.mir_generate_ms);
+	}
+
+	// Arenas (bytes of allocated elements)
+	s64 instr_count, instr_bytes;
+	mir_instr_memory_usage(assembly, &instr_count, &instr_bytes);
+
+#define ARENA_OFFSET(member) offsetof(struct assembly_thread_local_context, member)
+	str_buf_append(buf, cstr("],\n     \"arena_bytes\":{"));
+	append_arena_bytes(buf, assembly, "ast", ARENA_OFFSET(ast_arena));
+	append_arena_bytes(buf, assembly, "small_array", ARENA_OFFSET(small_array));
+	append_arena_bytes(buf, assembly, "location", ARENA_OFFSET(location_arena));
+	append_arena_bytes(buf, assembly, "mir_type", ARENA_OFFSET(mir_arenas.type));
+	append_arena_bytes(buf, assembly, "mir_var", ARENA_OFFSET(mir_arenas.var));
+	append_arena_bytes(buf, assembly, "mir_fn", ARENA_OFFSET(mir_arenas.fn));
+	append_arena_bytes(buf, assembly, "mir_member", ARENA_OFFSET(mir_arenas.member));
+	append_arena_bytes(buf, assembly, "mir_variant", ARENA_OFFSET(mir_arenas.variant));
+	append_arena_bytes(buf, assembly, "mir_arg", ARENA_OFFSET(mir_arenas.arg));
+	append_arena_bytes(buf, assembly, "mir_fn_group", ARENA_OFFSET(mir_arenas.fn_group));
+	append_arena_bytes(buf, assembly, "mir_fn_generated", ARENA_OFFSET(mir_arenas.fn_generated));
+	append_fmt(buf, "\"mir_instr\":%lld}", (long long)instr_bytes);
+#undef ARENA_OFFSET
+
+	// Counts
+	s64 ast_count = 0, type_count = 0;
+	for (usize i = 0; i < arrlenu(assembly->thread_local_contexts); ++i) {
+		ast_count += (s64)assembly->thread_local_contexts[i].ast_arena.num_allocations;
+		type_count += (s64)assembly->thread_local_contexts[i].mir_arenas.type.num_allocations;
+	}
+	append_fmt(buf,
+	           ",\n     \"counts\":{\"lines\":%d,\"tokens\":%d,\"ast_nodes\":%lld,\"mir_instructions\":%lld,\"types\":%lld,\"polymorphs\":%d}}",
+	           builder.total_lines,
+	           assembly->stats.token_count,
+	           (long long)ast_count,
+	           (long long)instr_count,
+	           (long long)type_count,
+	           assembly->stats.polymorph_count);
+	return_zone();
+}
+
+#define TIME_REPORT_TOP_COUNT 10
+
+static int compare_fn_analyze(const void *a, const void *b) {
+	const f64 ta = (*(struct mir_fn **)a)->report.analyze_ms;
+	const f64 tb = (*(struct mir_fn **)b)->report.analyze_ms;
+	return (ta < tb) - (ta > tb);
+}
+
+static int compare_fn_postpone(const void *a, const void *b) {
+	return (*(struct mir_fn **)b)->report.postpone_count - (*(struct mir_fn **)a)->report.postpone_count;
+}
+
+static int compare_fn_comptime(const void *a, const void *b) {
+	const f64 ta = (*(struct mir_fn **)a)->report.comptime_ms;
+	const f64 tb = (*(struct mir_fn **)b)->report.comptime_ms;
+	return (ta < tb) - (ta > tb);
+}
+
+static int compare_fn_llvm(const void *a, const void *b) {
+	return (*(struct mir_fn **)b)->report.llvm_instr_count - (*(struct mir_fn **)a)->report.llvm_instr_count;
+}
+
+static int compare_fn_polymorph(const void *a, const void *b) {
+	return (*(struct mir_fn **)b)->report.polymorph_count - (*(struct mir_fn **)a)->report.polymorph_count;
+}
+
+static void append_report_fn(str_buf_t *buf, struct mir_fn *fn) {
+	const str_t name = fn->full_name.len ? fn->full_name : fn->linkage_name;
+	append_fmt(buf, "  %.*s", name.len, name.ptr);
+	if (fn->generated.debug_replacement_types.len) {
+		append_fmt(buf, " [%.*s]", fn->generated.debug_replacement_types.len, fn->generated.debug_replacement_types.ptr);
+	}
+	struct ast      *node = fn->decl_node ? fn->decl_node : (fn->prototype ? fn->prototype->node : NULL);
+	struct location *loc  = node ? ast_tmp_location(node) : NULL;
+	if (loc && loc->unit) {
+		append_fmt(buf, " (%.*s:%d)", loc->unit->filepath.len, loc->unit->filepath.ptr, loc->line);
+	}
+	str_buf_append(buf, cstr("\n"));
+}
+
+static void print_time_report(struct assembly *assembly) {
+	zone();
+	array(struct mir_fn *) fns = NULL;
+	for (usize i = 0; i < arrlenu(assembly->thread_local_contexts); ++i) {
+		arena_get_flatten(&assembly->thread_local_contexts[i].mir_arenas.fn, (array(void *) *)&fns);
+	}
+	const usize len = arrlenu(fns);
+	if (!len) {
+		arrfree(fns);
+		return_zone();
+	}
+
+	str_buf_t buf = get_tmp_str();
+	append_fmt(&buf,
+	           "--------------------------------------------------------------------------------\n"
+	           "Time report for '%s'\n"
+	           "--------------------------------------------------------------------------------\n",
+	           assembly->target->name);
+
+	// Analyze time includes compile-time execution and generation of polymorphs triggered by
+	// instructions of the function.
+	qsort(fns, len, sizeof(struct mir_fn *), &compare_fn_analyze);
+	str_buf_append(&buf, cstr("MIR analyze:\n  Time (ms)  Postponed  Function\n"));
+	for (usize i = 0; i < MIN(len, TIME_REPORT_TOP_COUNT) && fns[i]->report.analyze_ms > 0.; ++i) {
+		append_fmt(&buf, "%11.3f %10d", fns[i]->report.analyze_ms, fns[i]->report.postpone_count);
+		append_report_fn(&buf, fns[i]);
+	}
+
+	qsort(fns, len, sizeof(struct mir_fn *), &compare_fn_postpone);
+	str_buf_append(&buf, cstr("\nMIR analyze postponed:\n  Postponed  Time (ms)  Function\n"));
+	for (usize i = 0; i < MIN(len, TIME_REPORT_TOP_COUNT) && fns[i]->report.postpone_count; ++i) {
+		append_fmt(&buf, "%11d %10.3f", fns[i]->report.postpone_count, fns[i]->report.analyze_ms);
+		append_report_fn(&buf, fns[i]);
+	}
+
+	qsort(fns, len, sizeof(struct mir_fn *), &compare_fn_comptime);
+	str_buf_append(&buf, cstr("\nCompile-time execution:\n  Time (ms)  Function\n"));
+	for (usize i = 0; i < MIN(len, TIME_REPORT_TOP_COUNT) && fns[i]->report.comptime_ms > 0.; ++i) {
+		append_fmt(&buf, "%11.3f", fns[i]->report.comptime_ms);
+		append_report_fn(&buf, fns[i]);
+	}
+
+	// LLVM passes run on the whole module, so only the total optimization time is known; size of
+	// the function after optimization shows how much work the passes did on it (0 when the function
+	// was removed, i.e. inlined into all callers).
+	qsort(fns, len, sizeof(struct mir_fn *), &compare_fn_llvm);
+	append_fmt(&buf,
+	           "\nLLVM IR (optimized in %.3f seconds):\n  Instructions  Optimized  Time (ms)  Function\n",
+	           (f64)assembly->stats.llvm_opt_ms / 1000.);
+	for (usize i = 0; i < MIN(len, TIME_REPORT_TOP_COUNT) && fns[i]->report.llvm_instr_count; ++i) {
+		struct mir_fn *fn           = fns[i];
+		LLVMValueRef   llvm_fn      = llvm_get_named_function(assembly->llvm.module, fn->linkage_name);
+		const s32      optimized_ic = llvm_fn ? (s32)llvm_get_instruction_count(llvm_fn) : 0;
+		append_fmt(&buf, "%14d %10d %10.3f", fn->report.llvm_instr_count, optimized_ic, fn->report.ir_ms);
+		append_report_fn(&buf, fn);
+	}
+
+	qsort(fns, len, sizeof(struct mir_fn *), &compare_fn_polymorph);
+	str_buf_append(&buf, cstr("\nPolymorph instances:\n  Generated  Function\n"));
+	for (usize i = 0; i < MIN(len, TIME_REPORT_TOP_COUNT) && fns[i]->report.polymorph_count; ++i) {
+		append_fmt(&buf, "%11d", fns[i]->report.polymorph_count);
+		append_report_fn(&buf, fns[i]);
+	}
+
+	builder_info("%s", str_buf_to_c(buf));
+	put_tmp_str(buf);
+	arrfree(fns);
+	return_zone();
+}
+
+#undef TIME_REPORT_TOP_COUNT
+
+void builder_write_stats_json(void) {
+	if (!builder.options->stats_json_file) return;
+	zone();
+	FILE *file = fopen(builder.options->stats_json_file, "w");
+	if (!file) {
+		builder_error("Cannot open statistics file '%s' for writing.", builder.options->stats_json_file);
+		str_buf_free(&builder.stats_json);
+		return_zone();
+	}
+
+	struct bl_alloc_stats alloc_stats;
+	bl_alloc_get_stats(&alloc_stats);
+
+	fprintf(file, "{\n  \"version\":\"%s\",\n  \"targets\":[", BL_VERSION);
+	fputs(str_buf_to_c(builder.stats_json), file);
+	fprintf(file,
+	        "\n  ],\n  \"malloc\":{\"malloc_count\":%lld,\"realloc_count\":%lld,\"free_count\":%lld,\"allocated_bytes\":%lld},"
+	        "\n  \"peak_rss_bytes\":%lld\n}\n",
+	        (long long)alloc_stats.malloc_count,
+	        (long long)alloc_stats.realloc_count,
+	        (long long)alloc_stats.free_count,
+	        (long long)alloc_stats.allocated_bytes,
+	        (long long)get_peak_memory_bytes());
+	fclose(file);
+	str_buf_free(&builder.stats_json);
+	return_zone();
+}
+
 str_buf_t get_tmp_str(void) {
 	zone();
 	str_buf_t str = {0};
@@ -8,6 +8,12 @@
 
 struct config;
 
+// Keep in sync with build.bl API!!!
+enum builder_message_format {
+	MESSAGE_FORMAT_TEXT = 0,
+	MESSAGE_FORMAT_JSON = 1,
+};
+
 // Keep in sync with build.bl API!!!
 struct builder_options {
 	bool verbose;
@@ -22,8 +28,45 @@ struct builder_options {
 	bool do_cleanup_when_done;
 	s32  error_limit;
 	bool legacy_colors;
-
+	bool streaming_memory;
+	bool lazy_fn_bodies;
+	bool reachable_only;
+	bool no_mir_fold_branches;
+	bool no_mir_jump_threading;
+	bool no_mir_dead_blocks;
+	bool no_mir_merge_blocks;
+	bool no_mir_inline;
+	bool no_mir_copy_propagation;
+	bool no_mir_dead_stores;
+	s32  jobs;
+	bool time_report;
+
+	enum builder_message_format message_format;
+
+	char *load_mir;
 	char *doc_out_dir;
+	char *trace_file;
+	char *stats_json_file;
+};
+
+// Rendered compiler message waiting in the thread local buffer to be flushed.
+struct builder_msg_record {
+	str_t     filepath;
+	s32       line;
+	s32       col;
+	s32       code;
+	bool      is_error;
+	str_buf_t text;
+};
+
+struct builder_msg_buffer {
+	array(struct builder_msg_record) records;
+};
+
+// Trace events recorded by one thread, serialized directly into JSON.
+struct builder_trace_buffer {
+	s32       tid;
+	str_buf_t events;
 };
 
 struct builder {
@@ -31,7 +74,7 @@ struct builder {
 	const struct target    *default_target;
 	str_buf_t               exec_dir;
 	batomic_s32             total_lines;
-	s32                     errorc;
+	batomic_s32             errorc;
 	s32                     max_error;
 	s32                     test_failc;
 	s32                     last_script_mode_run_status;
@@ -45,6 +88,21 @@ struct builder {
 	bool  auto_submit;
 	mtx_t log_mutex;
 	bool  is_initialized;
+
+	// Messages reported from unit jobs are buffered per worker thread and flushed sorted by
+	// location once all jobs are done; this way the output does not depend on scheduling.
+	array(struct builder_msg_buffer) message_buffers;
+	bool is_buffering_messages;
+
+	// Trace events are collected per thread in case the '--trace' option is used.
+	array(struct builder_trace_buffer *) trace_buffers;
+	f64  trace_start_ms;
+	// Incremented for each tracing session to invalidate trace buffers cached by threads.
+	s32  trace_generation;
+	bool is_tracing;
+
+	// Reports of compiled targets written by '--stats-json'.
+	str_buf_t stats_json;
 };
 
 // struct builder global instance.
@@ -111,6 +169,27 @@ inline static str_buf_t get_tmp_str_from(const str_t s) {
 	return tmp;
 }
 
+// Record begin and end of traced event (in Chrome trace format) in case tracing is enabled. The
+// 'detail' string is optional, events must be properly nested on each thread.
+#define builder_trace_begin(name, detail) (builder.is_tracing ? _builder_trace_begin((name), (detail)) : (void)0)
+#define builder_trace_end()               (builder.is_tracing ? _builder_trace_end() : (void)0)
+
+void _builder_trace_begin(const char *name, str_t detail);
+void _builder_trace_end(void);
+// Enable tracing in case the trace output file is set in the builder options.
+void builder_start_tracing(void);
+// Write all recorded trace events into the trace output file; must be called when no jobs are
+// running.
+void builder_write_trace(void);
+// Write JSON statistics report of all compiled targets in case the output file is set in the
+// builder options.
+void builder_write_stats_json(void);
+
+// Start buffering of all reported messages in per-thread buffers.
+void builder_begin_message_buffering(void);
+// Stop buffering and print all buffered messages sorted by location.
+void builder_flush_messages(void);
+
 void builder_print_location(FILE *stream, struct location *loc, s32 col, s32 len);
 
 #endif
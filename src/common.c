@@ -34,15 +34,18 @@
 #include <mach-o/dyld.h>
 #include <mach/mach_time.h>
 #include <stdlib.h>
+#include <sys/resource.h>
 #include <sys/time.h>
 #endif
 
 #if BL_PLATFORM_LINUX
 #include <ctype.h>
 #include <errno.h>
+#include <sys/resource.h>
 #endif
 
 #if BL_PLATFORM_WIN
+#include <psapi.h>
 #include <shlwapi.h>
 #ifndef popen
 #define popen _popen
@@ -814,6 +817,49 @@ f64 get_tick_ms(void) {
 #endif
 }
 
+s64 get_thread_page_faults(void) {
+#if BL_PLATFORM_LINUX
+	struct rusage usage;
+	if (getrusage(RUSAGE_THREAD, &usage) != 0) return 0;
+	return (s64)usage.ru_minflt + (s64)usage.ru_majflt;
+#else
+	// Per-thread counters are not available on this platform.
+	return 0;
+#endif
+}
+
+s64 get_peak_memory_bytes(void) {
+#if BL_PLATFORM_WIN
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+	return (s64)counters.PeakWorkingSetSize;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if BL_PLATFORM_MACOS
+	return (s64)usage.ru_maxrss; // Already in bytes.
+#else
+	return (s64)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+f64 get_process_cpu_ms(void) {
+#if BL_PLATFORM_WIN
+	FILETIME creation_time, exit_time, kernel_time, user_time;
+	if (!GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time, &kernel_time, &user_time)) return 0.;
+	const u64 kernel = ((u64)kernel_time.dwHighDateTime << 32) | (u64)kernel_time.dwLowDateTime;
+	const u64 user   = ((u64)user_time.dwHighDateTime << 32) | (u64)user_time.dwLowDateTime;
+	return (f64)(kernel + user) / 10000.; // 100-nanosecond intervals.
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.;
+	const f64 user   = (f64)usage.ru_utime.tv_sec * 1000. + (f64)usage.ru_utime.tv_usec / 1000.;
+	const f64 system = (f64)usage.ru_stime.tv_sec * 1000. + (f64)usage.ru_stime.tv_usec / 1000.;
+	return user + system;
+#endif
+}
+
 s32 get_last_error(char *buf, s32 buf_len) {
 #if BL_PLATFORM_MACOS
 	const s32 error_code = errno;
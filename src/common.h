@@ -450,6 +450,15 @@ void        print_bits(s32 const size, void const *const ptr);
 int         count_bits(u64 n);
 str_buf_t   platform_lib_name(const str_t name);
 f64         get_tick_ms(void);
+// Returns count of page faults (minor + major) caused by the calling thread so far or 0 in case
+// it's not supported on the current platform.
+s64         get_thread_page_faults(void);
+// Returns peak resident memory size of the current process in bytes or 0 in case it's not
+// available.
+s64         get_peak_memory_bytes(void);
+// Returns CPU time (user + system) consumed by all threads of the current process so far in
+// milliseconds or 0 in case it's not available.
+f64         get_process_cpu_ms(void);
 s32         get_last_error(char *buf, s32 buf_len);
 u32         next_pow_2(u32 n);
 void        color_print(FILE *stream, s32 color, const char *format, ...);
@@ -85,7 +85,7 @@ void doc_decl_entity(struct context *ctx, struct ast *decl) {
 	// @Performance: we can do it better I guess.
 	if (text.len && (str_match(text, cstr("@INCOMPLETE")) || str_match(text, cstr("@Incomplete")) ||
 	                 str_match(text, cstr("@incomplete")))) {
-		builder_msg(MSG_WARN, 0, ident->location, CARET_WORD, "Found incomplete documentation!");
+		builder_msg(MSG_WARN, 0, ast_tmp_location(ident), CARET_WORD, "Found incomplete documentation!");
 	}
 
 	if (!decl->owner_scope) return;
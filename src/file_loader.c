@@ -6,7 +6,8 @@
 void file_loader_run(struct assembly *UNUSED(assembly), struct unit *unit) {
 	char error_buf[256];
 	zone();
-	const str_t path = unit->filepath;
+	const f64   start_ms = get_tick_ms();
+	const str_t path     = unit->filepath;
 	bassert(path.len);
 
 	str_buf_t tmp_path = get_tmp_str();
@@ -15,14 +16,14 @@ void file_loader_run(struct assembly *UNUSED(assembly), struct unit *unit) {
 
 	if (f == INVALID_HANDLE_VALUE) {
 		get_last_error(error_buf, static_arrlenu(error_buf));
-		builder_msg(MSG_ERR, ERR_FILE_NOT_FOUND, TOKEN_OPTIONAL_LOCATION(unit->loaded_from), CARET_WORD, "Cannot open file '" STR_FMT "': %s", STR_ARG(path), error_buf);
+		builder_msg(MSG_ERR, ERR_FILE_NOT_FOUND, unit->loaded_from, CARET_WORD, "Cannot open file '" STR_FMT "': %s", STR_ARG(path), error_buf);
 		return_zone();
 	}
 
 	DWORD bytes = GetFileSize(f, NULL);
 	if (bytes == INVALID_FILE_SIZE) {
 		CloseHandle(f);
-		builder_msg(MSG_ERR, ERR_FILE_NOT_FOUND, TOKEN_OPTIONAL_LOCATION(unit->loaded_from), CARET_WORD, "Cannot get size of file '" STR_FMT "'.", STR_ARG(path));
+		builder_msg(MSG_ERR, ERR_FILE_NOT_FOUND, unit->loaded_from, CARET_WORD, "Cannot get size of file '" STR_FMT "'.", STR_ARG(path));
 		return_zone();
 	}
 	char *data = bmalloc(bytes + 1);
@@ -31,19 +32,53 @@ void file_loader_run(struct assembly *UNUSED(assembly), struct unit *unit) {
 		bfree(data);
 		CloseHandle(f);
 		get_last_error(error_buf, static_arrlenu(error_buf));
-		builder_msg(MSG_ERR, ERR_FILE_NOT_FOUND, TOKEN_OPTIONAL_LOCATION(unit->loaded_from), CARET_WORD, "Cannot read file '" STR_FMT "': %s", STR_ARG(path), error_buf);
+		builder_msg(MSG_ERR, ERR_FILE_NOT_FOUND, unit->loaded_from, CARET_WORD, "Cannot read file '" STR_FMT "': %s", STR_ARG(path), error_buf);
 		return_zone();
 	}
 	bassert(rbytes == bytes);
 	data[rbytes] = '\0';
 	CloseHandle(f);
-	unit->src = data;
+	unit->src           = data;
+	unit->src_len       = rbytes;
+	unit->stats.load_ms = get_tick_ms() - start_ms;
 	return_zone();
 }
 #else
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Files smaller than this are read into the heap buffer, mapping of small files does not pay off.
+#define MMAP_MIN_FILE_SIZE 16384
+// Minimal count of zero bytes guaranteed behind the mapped source data; the first one is used as
+// SYM_EOF terminator by the lexer.
+#define MMAP_TAIL_PADDING 64
+
+// Map the file read-only into the memory. The mapping is followed by zero-filled padding, so the
+// source can be lexed directly without copying. Returns NULL in case the mapping failed.
+static char *map_file(FILE *f, usize fsize, usize *out_mapped_size) {
+	const usize page_size   = (usize)sysconf(_SC_PAGESIZE);
+	usize       mapped_size = (fsize + page_size - 1) / page_size * page_size;
+	if (mapped_size - fsize < MMAP_TAIL_PADDING) mapped_size += page_size;
+
+	// Reserve the whole block as anonymous (zero-filled) memory first and map the file over it.
+	// The rest of the last file page is zero-filled by the system.
+	void *base = mmap(NULL, mapped_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED) return NULL;
+	void *data = mmap(base, fsize, PROT_READ, MAP_PRIVATE | MAP_FIXED, fileno(f), 0);
+	if (data == MAP_FAILED) {
+		munmap(base, mapped_size);
+		return NULL;
+	}
+	bassert(data == base);
+	*out_mapped_size = mapped_size;
+	return data;
+}
+
 void file_loader_run(struct assembly *UNUSED(assembly), struct unit *unit) {
 	zone();
-	const str_t path = unit->filepath;
+	const f64   start_ms    = get_tick_ms();
+	const s64   page_faults = get_thread_page_faults();
+	const str_t path        = unit->filepath;
 	bassert(path.len);
 
 	str_buf_t tmp_path = get_tmp_str();
@@ -51,7 +86,7 @@ void file_loader_run(struct assembly *UNUSED(assembly), struct unit *unit) {
 	put_tmp_str(tmp_path);
 
 	if (f == NULL) {
-		builder_msg(MSG_ERR, ERR_FILE_READ, TOKEN_OPTIONAL_LOCATION(unit->loaded_from), CARET_WORD, "Cannot read file '" STR_FMT "'.", STR_ARG(path));
+		builder_msg(MSG_ERR, ERR_FILE_READ, unit->loaded_from, CARET_WORD, "Cannot read file '" STR_FMT "'.", STR_ARG(path));
 		return_zone();
 	}
 
@@ -59,16 +94,26 @@ void file_loader_run(struct assembly *UNUSED(assembly), struct unit *unit) {
 	usize fsize = (usize)ftell(f);
 	if (fsize == 0) {
 		fclose(f);
-		builder_msg(MSG_ERR, ERR_FILE_EMPTY, TOKEN_OPTIONAL_LOCATION(unit->loaded_from), CARET_WORD, "Invalid or empty source file '" STR_FMT "'.", STR_ARG(path));
+		builder_msg(MSG_ERR, ERR_FILE_EMPTY, unit->loaded_from, CARET_WORD, "Invalid or empty source file '" STR_FMT "'.", STR_ARG(path));
 		return_zone();
 	}
 	fseek(f, 0, SEEK_SET);
 
-	char *src = bmalloc(fsize + 1);
-	if (!fread(src, sizeof(char), fsize, f)) babort("Cannot read file '" STR_FMT "'.", STR_ARG(path));
-	src[fsize] = '\0';
+	char *src = NULL;
+	if (fsize >= MMAP_MIN_FILE_SIZE) {
+		src = map_file(f, fsize, &unit->src_mapped_size);
+	}
+	if (!src) {
+		// Fallback to regular read.
+		src = bmalloc(fsize + 1);
+		if (!fread(src, sizeof(char), fsize, f)) babort("Cannot read file '" STR_FMT "'.", STR_ARG(path));
+		src[fsize] = '\0';
+	}
 	fclose(f);
-	unit->src = src;
+	unit->src               = src;
+	unit->src_len           = fsize;
+	unit->stats.load_ms     = get_tick_ms() - start_ms;
+	unit->stats.page_faults = (s32)(get_thread_page_faults() - page_faults);
 	return_zone();
 }
 #endif
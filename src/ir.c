@@ -44,6 +44,11 @@ struct cache_entry {
 	LLVMValueRef value;
 };
 
+struct rtti_dedup_entry {
+	LLVMValueRef hash; // Initializer of the global.
+	LLVMValueRef value;
+};
+
 struct context {
 	struct assembly *assembly;
 
@@ -62,6 +67,9 @@ struct context {
 	hash_table(struct cache_entry) gstring_cache;
 	hash_table(struct cache_entry) llvm_fn_cache;
 	array(struct rtti_incomplete) incomplete_rtti;
+	hash_table(struct cache_entry) rtti_cache; // Map type ids to RTTI globals.
+	hash_table(struct rtti_dedup_entry) rtti_dedup_cache;
+	bool compact_rtti;
 
 	struct builtin_types *builtin_types;
 	bool                  generate_debug_info;
@@ -94,6 +102,8 @@ static LLVMValueRef build_call_memcpy(struct context *ctx, LLVMValueRef src, LLV
 static LLVMValueRef rtti_emit(struct context *ctx, struct mir_type *type);
 static void         rtti_satisfy_incomplete(struct context *ctx, struct rtti_incomplete incomplete);
 static LLVMValueRef _rtti_emit(struct context *ctx, struct mir_type *type);
+static LLVMValueRef rtti_emit_global(struct context *ctx, LLVMValueRef llvm_value, const char *name);
+static str_t        rtti_type_name(struct context *ctx, struct mir_type *type);
 static LLVMValueRef rtti_emit_base(struct context    *ctx,
                                    struct mir_type   *type,
                                    enum mir_type_kind kind,
@@ -213,7 +223,7 @@ static inline void emit_DI_instr_loc(struct context *ctx, struct mir_instr *inst
 	bassert(instr && "Invalid instruction!");
 	bassert(instr->node && "Invalid instruction ast node!");
 	struct scope    *scope = instr->node->owner_scope;
-	struct location *loc   = instr->node->location;
+	struct location *loc   = ast_tmp_location(instr->node);
 	bassert(scope && "Missing scope for DI!");
 	bassert(loc && "Missing location for DI!");
 	LLVMMetadataRef llvm_scope =
@@ -519,7 +529,7 @@ LLVMMetadataRef DI_complete_type(struct context *ctx, struct mir_type *type) {
 		mir_members_t *members    = type->data.strct.members;
 		for (usize i = 0; i < sarrlenu(members); ++i) {
 			struct mir_member *elem      = sarrpeek(members, i);
-			unsigned           elem_line = elem->decl_node ? (unsigned)elem->decl_node->location->line : 0;
+			unsigned           elem_line = elem->decl_node ? (unsigned)ast_tmp_location(elem->decl_node)->line : 0;
 			LLVMMetadataRef    llvm_elem = LLVMDIBuilderCreateMemberType(
                 ctx->llvm_di_builder,
                 llvm_scope,
@@ -625,7 +635,7 @@ void emit_DI_fn(struct context *ctx, struct mir_fn *fn) {
 	// We use file scope for debug info even for global functions to prevent some problems with
 	// DWARF generation, caused mainly by putting subprogram info into lexical scopes i.e. in case
 	// local function is generated.
-	struct location *location  = fn->decl_node->location;
+	struct location *location  = ast_tmp_location(fn->decl_node);
 	LLVMMetadataRef  llvm_file = DI_unit_init(ctx, location->unit);
 	bassert(llvm_file && "Missing DI file scope data!");
 	const str_t name          = fn->id ? fn->id->str : fn->linkage_name;
@@ -653,7 +663,7 @@ void emit_DI_var(struct context *ctx, struct mir_var *var) {
 	bassert(var->id && "Variable has no id!");
 	bassert(isnotflag(var->iflags, MIR_VAR_IMPLICIT) &&
 	        "Attempt to generate debug info for implicit variable!");
-	struct location *location = var->decl_node->location;
+	struct location *location = ast_tmp_location(var->decl_node);
 	bassert(location);
 	if (isflag(var->iflags, MIR_VAR_GLOBAL)) {
 		const str_t     name         = var->id->str;
@@ -1016,8 +1026,7 @@ LLVMValueRef rtti_emit_enum(struct context *ctx, struct mir_type *type) {
 	    rtti_emit_base(ctx, base_type, type->kind, type->store_size_bytes, type->alignment);
 
 	// name
-	const str_t name = type->user_id ? type->user_id->str : type->id.str;
-	llvm_vals[1]     = emit_const_string(ctx, name);
+	llvm_vals[1] = emit_const_string(ctx, rtti_type_name(ctx, type));
 
 	// base_type
 	llvm_vals[2] = _rtti_emit(ctx, type->data.enm.base_type);
@@ -1069,11 +1078,7 @@ LLVMValueRef rtti_emit_enum_variants_array(struct context *ctx, mir_variants_t *
 	LLVMValueRef llvm_result =
 	    LLVMConstArray(get_type(ctx, elem_type), sarrdata(&llvm_vals), (u32)sarrlenu(&llvm_vals));
 
-	LLVMValueRef llvm_rtti_var =
-	    LLVMAddGlobal(ctx->llvm_module, LLVMTypeOf(llvm_result), ".rtti_variants");
-	LLVMSetLinkage(llvm_rtti_var, LLVMPrivateLinkage);
-	LLVMSetGlobalConstant(llvm_rtti_var, true);
-	LLVMSetInitializer(llvm_rtti_var, llvm_result);
+	LLVMValueRef llvm_rtti_var = rtti_emit_global(ctx, llvm_result, ".rtti_variants");
 
 	sarrfree(&llvm_vals);
 	return llvm_rtti_var;
@@ -1099,8 +1104,7 @@ LLVMValueRef rtti_emit_struct(struct context *ctx, struct mir_type *type) {
 	    rtti_emit_base(ctx, base_type, MIR_TYPE_STRUCT, type->store_size_bytes, type->alignment);
 
 	// name
-	const str_t name = type->user_id ? type->user_id->str : type->id.str;
-	llvm_vals[1]     = emit_const_string(ctx, name);
+	llvm_vals[1] = emit_const_string(ctx, rtti_type_name(ctx, type));
 
 	// members
 	llvm_vals[2] = rtti_emit_struct_members_slice(ctx, type->data.strct.members);
@@ -1170,11 +1174,7 @@ LLVMValueRef rtti_emit_struct_members_array(struct context *ctx, mir_members_t *
 	LLVMValueRef llvm_result =
 	    LLVMConstArray(get_type(ctx, elem_type), sarrdata(&llvm_vals), (u32)sarrlenu(&llvm_vals));
 
-	LLVMValueRef llvm_rtti_var =
-	    LLVMAddGlobal(ctx->llvm_module, LLVMTypeOf(llvm_result), ".rtti_members");
-	LLVMSetLinkage(llvm_rtti_var, LLVMPrivateLinkage);
-	LLVMSetGlobalConstant(llvm_rtti_var, true);
-	LLVMSetInitializer(llvm_rtti_var, llvm_result);
+	LLVMValueRef llvm_rtti_var = rtti_emit_global(ctx, llvm_result, ".rtti_members");
 
 	sarrfree(&llvm_vals);
 	return llvm_rtti_var;
@@ -1254,11 +1254,7 @@ LLVMValueRef rtti_emit_fn_array(struct context *ctx, mir_types_t *fns) {
 	LLVMValueRef llvm_result =
 	    LLVMConstArray(get_type(ctx, elem_type), sarrdata(&llvm_vals), (u32)sarrlenu(&llvm_vals));
 
-	LLVMValueRef llvm_rtti_var =
-	    LLVMAddGlobal(ctx->llvm_module, LLVMTypeOf(llvm_result), ".rtti_args");
-	LLVMSetLinkage(llvm_rtti_var, LLVMPrivateLinkage);
-	LLVMSetGlobalConstant(llvm_rtti_var, true);
-	LLVMSetInitializer(llvm_rtti_var, llvm_result);
+	LLVMValueRef llvm_rtti_var = rtti_emit_global(ctx, llvm_result, ".rtti_args");
 	sarrfree(&llvm_vals);
 	return llvm_rtti_var;
 }
@@ -1267,7 +1263,7 @@ LLVMValueRef rtti_emit_fn_arg(struct context *ctx, struct mir_arg *arg) {
 	struct mir_type *rtti_type = ctx->builtin_types->t_TypeInfoFnArg;
 	LLVMValueRef     llvm_vals[2];
 	// name
-	const str_t arg_name = arg->id ? arg->id->str : str_empty;
+	const str_t arg_name = arg->id && !ctx->compact_rtti ? arg->id->str : str_empty;
 	llvm_vals[0]         = emit_const_string(ctx, arg_name);
 	// base_type
 	llvm_vals[1] = _rtti_emit(ctx, arg->type);
@@ -1286,11 +1282,7 @@ LLVMValueRef rtti_emit_fn_args_array(struct context *ctx, mir_args_t *args) {
 	LLVMValueRef llvm_result =
 	    LLVMConstArray(get_type(ctx, elem_type), sarrdata(&llvm_vals), (u32)sarrlenu(&llvm_vals));
 
-	LLVMValueRef llvm_rtti_var =
-	    LLVMAddGlobal(ctx->llvm_module, LLVMTypeOf(llvm_result), ".rtti_args");
-	LLVMSetLinkage(llvm_rtti_var, LLVMPrivateLinkage);
-	LLVMSetGlobalConstant(llvm_rtti_var, true);
-	LLVMSetInitializer(llvm_rtti_var, llvm_result);
+	LLVMValueRef llvm_rtti_var = rtti_emit_global(ctx, llvm_result, ".rtti_args");
 
 	sarrfree(&llvm_vals);
 	return llvm_rtti_var;
@@ -1369,8 +1361,7 @@ LLVMValueRef rtti_emit_array(struct context *ctx, struct mir_type *type) {
 	    rtti_emit_base(ctx, base_type, type->kind, type->store_size_bytes, type->alignment);
 
 	// name
-	const str_t name = type->user_id ? type->user_id->str : type->id.str;
-	llvm_vals[1]     = emit_const_string(ctx, name);
+	llvm_vals[1] = emit_const_string(ctx, rtti_type_name(ctx, type));
 
 	// elem_type
 	llvm_vals[2] = _rtti_emit(ctx, type->data.array.elem_type);
@@ -1384,15 +1375,45 @@ LLVMValueRef rtti_emit_array(struct context *ctx, struct mir_type *type) {
 }
 
 LLVMValueRef rtti_emit(struct context *ctx, struct mir_type *type) {
+	const f64    start      = get_tick_ms();
 	LLVMValueRef llvm_value = _rtti_emit(ctx, type);
 
 	while (arrlen(ctx->incomplete_rtti)) {
 		rtti_satisfy_incomplete(ctx, arrpop(ctx->incomplete_rtti));
 	}
 
+	batomic_fetch_add_s64(&ctx->assembly->stats.rtti_us, (s64)((get_tick_ms() - start) * 1000.));
 	return llvm_value;
 }
 
+// Nested arrays of RTTI entries (members, variants, arguments) are emitted as separate globals;
+// LLVM constants are uniqued, so the same initializer means the same content and already emitted
+// global can be reused.
+LLVMValueRef rtti_emit_global(struct context *ctx, LLVMValueRef llvm_value, const char *name) {
+	const s32 index = tbl_lookup_index(ctx->rtti_dedup_cache, llvm_value);
+	if (index != -1) {
+		batomic_fetch_add_s32(&ctx->assembly->stats.rtti_bin_dedup_count, 1);
+		return ctx->rtti_dedup_cache[index].value;
+	}
+
+	LLVMValueRef llvm_rtti_var = LLVMAddGlobal(ctx->llvm_module, LLVMTypeOf(llvm_value), name);
+	LLVMSetLinkage(llvm_rtti_var, LLVMPrivateLinkage);
+	LLVMSetGlobalConstant(llvm_rtti_var, true);
+	LLVMSetInitializer(llvm_rtti_var, llvm_value);
+
+	struct rtti_dedup_entry entry = {.hash = llvm_value, .value = llvm_rtti_var};
+	tbl_insert(ctx->rtti_dedup_cache, entry);
+
+	batomic_fetch_add_s32(&ctx->assembly->stats.rtti_bin_count, 1);
+	batomic_fetch_add_s64(&ctx->assembly->stats.rtti_bin_bytes, (s64)LLVMABISizeOfType(ctx->llvm_td, LLVMTypeOf(llvm_value)));
+	return llvm_rtti_var;
+}
+
+str_t rtti_type_name(struct context *ctx, struct mir_type *type) {
+	if (ctx->compact_rtti) return str_empty;
+	return type->user_id ? type->user_id->str : type->id.str;
+}
+
 void rtti_satisfy_incomplete(struct context *ctx, struct rtti_incomplete incomplete) {
 	struct mir_type *type          = incomplete.type;
 	LLVMValueRef     llvm_rtti_var = incomplete.llvm_var;
@@ -1407,16 +1428,25 @@ void rtti_satisfy_incomplete(struct context *ctx, struct rtti_incomplete incompl
 LLVMValueRef _rtti_emit(struct context *ctx, struct mir_type *type) {
 	bassert(type);
 
-	struct mir_var *rtti_var = mir_get_rtti(ctx->assembly, type->id.hash);
-	bassert(rtti_var && "RTTI variable not generated for the type!");
-	if (rtti_var->llvm_value) {
-		return rtti_var->llvm_value;
+	const s32 index = tbl_lookup_index(ctx->rtti_cache, type->id.hash);
+	if (index != -1) {
+		return ctx->rtti_cache[index].value;
 	}
 
-	LLVMValueRef llvm_rtti_var = llvm_add_global(
-	    ctx->llvm_module, get_type(ctx, rtti_var->value.type), rtti_var->linkage_name);
+	struct mir_type *rtti_type = mir_get_rtti_type(ctx->assembly, type);
+	if (!rtti_type) {
+		str_buf_t type_name = mir_type2str(type, true);
+		babort("Missing LLVM RTTI generation for type '%s'", str_buf_to_c(type_name));
+	}
+
+	// Each type has its own global (even if the content is the same as for some other type), since
+	// type info pointers are used to compare types.
+	LLVMValueRef llvm_rtti_var =
+	    LLVMAddGlobal(ctx->llvm_module, get_type(ctx, rtti_type), ".rtti");
 	LLVMSetLinkage(llvm_rtti_var, LLVMPrivateLinkage);
 	LLVMSetGlobalConstant(llvm_rtti_var, true);
+	batomic_fetch_add_s32(&ctx->assembly->stats.rtti_bin_count, 1);
+	batomic_fetch_add_s64(&ctx->assembly->stats.rtti_bin_bytes, (s64)rtti_type->store_size_bytes);
 
 	LLVMValueRef llvm_value = NULL;
 
@@ -1489,7 +1519,7 @@ LLVMValueRef _rtti_emit(struct context *ctx, struct mir_type *type) {
 	LLVMSetInitializer(llvm_rtti_var, llvm_value);
 
 SKIP:
-	rtti_var->llvm_value = llvm_rtti_var;
+	tbl_insert(ctx->rtti_cache, ((struct cache_entry){.hash = type->id.hash, .value = llvm_rtti_var}));
 	return llvm_rtti_var;
 }
 
@@ -1503,8 +1533,8 @@ LLVMValueRef testing_emit_meta_case(struct context *ctx, struct mir_fn *fn) {
 	struct mir_type *type = ctx->builtin_types->t_TestCase;
 	LLVMValueRef     llvm_vals[4];
 
-	const str_t filename = fn->decl_node ? fn->decl_node->location->unit->filename : cstr("UNKNOWN");
-	const s32   line     = fn->decl_node ? fn->decl_node->location->line : 0;
+	const str_t filename = fn->decl_node ? fn->decl_node->unit->filename : cstr("UNKNOWN");
+	const s32   line     = fn->decl_node ? ast_tmp_location(fn->decl_node)->line : 0;
 
 	llvm_vals[0] = emit_fn_proto(ctx, fn, true);
 	llvm_vals[1] = emit_const_string(ctx, fn->id->str);
@@ -2894,7 +2924,7 @@ enum state emit_instr_call_loc(struct context *ctx, struct mir_instr_call_loc *l
 	LLVMSetGlobalConstant(llvm_var, true);
 
 	bassert(loc->call_node);
-	struct location *call_location = loc->call_node->location;
+	struct location *call_location = ast_tmp_location(loc->call_node);
 
 	LLVMValueRef llvm_vals[5];
 	const str_t  filepath = call_location->unit->filepath;
@@ -2985,6 +3015,7 @@ enum state emit_instr_fn_proto(struct context *ctx, struct mir_instr_fn_proto *f
 
 	// External functions does not have any body block.
 	if (isnotflag(fn->flags, FLAG_EXTERN) && isnotflag(fn->flags, FLAG_INTRINSIC)) {
+		const f64 start_ms = builder.options->time_report ? get_tick_ms() : 0.;
 		if (ctx->generate_debug_info) emit_DI_fn(ctx, fn);
 		// Generate all blocks in the function body.
 		struct mir_instr_block *block = fn->first_block;
@@ -2996,6 +3027,10 @@ enum state emit_instr_fn_proto(struct context *ctx, struct mir_instr_fn_proto *f
 			}
 			block = (struct mir_instr_block *)block->base.next;
 		}
+		if (builder.options->time_report) {
+			fn->report.ir_ms += get_tick_ms() - start_ms;
+			fn->report.llvm_instr_count = (s32)llvm_get_instruction_count(fn->llvm_value);
+		}
 	}
 
 	return STATE_PASSED;
@@ -3251,6 +3286,9 @@ void ir_run(struct assembly *assembly) {
 
 	tbl_init(ctx.gstring_cache, 2048);
 	tbl_init(ctx.llvm_fn_cache, 2048);
+	tbl_init(ctx.rtti_cache, 1024);
+	tbl_init(ctx.rtti_dedup_cache, 256);
+	ctx.compact_rtti = assembly->target->compact_rtti;
 
 	init_llvm_module(&ctx);
 
@@ -3299,6 +3337,8 @@ void ir_run(struct assembly *assembly) {
 	arrfree(ctx.incomplete_rtti);
 	tbl_free(ctx.gstring_cache);
 	tbl_free(ctx.llvm_fn_cache);
+	tbl_free(ctx.rtti_cache);
+	tbl_free(ctx.rtti_dedup_cache);
 
 	return_zone();
 }
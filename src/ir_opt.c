@@ -5,6 +5,7 @@ void ir_opt_run(struct assembly *assembly) {
 	zone();
 	// 2024-08-09 LLVM is slow, so no passes for debug.
 	if (assembly->target->opt == ASSEMBLY_OPT_DEBUG) return_zone();
+	runtime_measure_begin(llvm_opt);
 
 	LLVMModuleRef        llvm_module = assembly->llvm.module;
 	LLVMTargetMachineRef llvm_tm     = assembly->llvm.TM;
@@ -25,5 +26,6 @@ void ir_opt_run(struct assembly *assembly) {
 	}
 
 	put_tmp_str(tmp);
+	batomic_fetch_add_s32(&assembly->stats.llvm_opt_ms, runtime_measure_end(llvm_opt));
 	return_zone();
 }
@@ -10,36 +10,245 @@
 #include <intrin.h>
 #endif
 
+#if defined(__x86_64__) || defined(_M_X64)
+#define LEXER_X86_64
+#include <immintrin.h>
+#if BL_COMPILER_MSVC
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
 #define is_ident(c) (isalnum(c) || (c) == '_')
 
+// Runs of characters not producing any tokens (blanks, comments and string bodies without escape
+// sequences) are skipped by vectorized functions selected on startup in 'lexer_init'. SSE2 is
+// always available on x86_64, AVX2 is used when supported by the CPU; other architectures use
+// the scalar fallback.
+//
+// Note that vectorized versions use aligned loads only, so they never read across the page
+// boundary behind the source zero terminator.
+
+// Returns count of characters preceding the first occurrence of 'a', 'b', 'd' or zero terminator.
+typedef usize (*find_any_fn_t)(const char *c, char a, char b, char d);
+// Returns count of spaces and tabs at the beginning of 'c'.
+typedef usize (*skip_blanks_fn_t)(const char *c);
+
+static usize find_any_scalar(const char *c, char a, char b, char d) {
+	const char *p = c;
+	while (*p && *p != a && *p != b && *p != d) ++p;
+	return (usize)(p - c);
+}
+
+static usize skip_blanks_scalar(const char *c) {
+	const char *p = c;
+	while (*p == ' ' || *p == '\t') ++p;
+	return (usize)(p - c);
+}
+
+#ifdef LEXER_X86_64
+
+static inline u32 ctz32(u32 v) {
+	bassert(v);
+#if BL_COMPILER_MSVC
+	unsigned long i;
+	_BitScanForward(&i, v);
+	return (u32)i;
+#else
+	return (u32)__builtin_ctz(v);
+#endif
+}
+
+static inline u32 find_any_mask_sse2(const char *p, __m128i a, __m128i b, __m128i d) {
+	const __m128i v = _mm_load_si128((const __m128i *)p);
+	const __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, a), _mm_cmpeq_epi8(v, b)),
+	                               _mm_or_si128(_mm_cmpeq_epi8(v, d), _mm_cmpeq_epi8(v, _mm_setzero_si128())));
+	return (u32)_mm_movemask_epi8(m);
+}
+
+static usize find_any_sse2(const char *c, char a, char b, char d) {
+	const __m128i va     = _mm_set1_epi8(a);
+	const __m128i vb     = _mm_set1_epi8(b);
+	const __m128i vd     = _mm_set1_epi8(d);
+	const usize   offset = (uintptr_t)c & 15;
+	const char   *p      = c - offset;
+
+	u32 mask = find_any_mask_sse2(p, va, vb, vd) >> offset;
+	if (mask) return ctz32(mask);
+	while (true) {
+		p += 16;
+		mask = find_any_mask_sse2(p, va, vb, vd);
+		if (mask) return (usize)(p - c) + ctz32(mask);
+	}
+}
+
+static inline u32 non_blank_mask_sse2(const char *p) {
+	const __m128i v = _mm_load_si128((const __m128i *)p);
+	const __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+	return ~(u32)_mm_movemask_epi8(m) & 0xFFFF;
+}
+
+static usize skip_blanks_sse2(const char *c) {
+	const usize offset = (uintptr_t)c & 15;
+	const char *p      = c - offset;
+
+	u32 mask = non_blank_mask_sse2(p) >> offset;
+	if (mask) return ctz32(mask);
+	while (true) {
+		p += 16;
+		mask = non_blank_mask_sse2(p);
+		if (mask) return (usize)(p - c) + ctz32(mask);
+	}
+}
+
+TARGET_AVX2 static inline u32 find_any_mask_avx2(const char *p, __m256i a, __m256i b, __m256i d) {
+	const __m256i v = _mm256_load_si256((const __m256i *)p);
+	const __m256i m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, a), _mm256_cmpeq_epi8(v, b)),
+	                                  _mm256_or_si256(_mm256_cmpeq_epi8(v, d), _mm256_cmpeq_epi8(v, _mm256_setzero_si256())));
+	return (u32)_mm256_movemask_epi8(m);
+}
+
+TARGET_AVX2 static usize find_any_avx2(const char *c, char a, char b, char d) {
+	const __m256i va     = _mm256_set1_epi8(a);
+	const __m256i vb     = _mm256_set1_epi8(b);
+	const __m256i vd     = _mm256_set1_epi8(d);
+	const usize   offset = (uintptr_t)c & 31;
+	const char   *p      = c - offset;
+
+	u32 mask = find_any_mask_avx2(p, va, vb, vd) >> offset;
+	if (mask) return ctz32(mask);
+	while (true) {
+		p += 32;
+		mask = find_any_mask_avx2(p, va, vb, vd);
+		if (mask) return (usize)(p - c) + ctz32(mask);
+	}
+}
+
+TARGET_AVX2 static inline u32 non_blank_mask_avx2(const char *p) {
+	const __m256i v = _mm256_load_si256((const __m256i *)p);
+	const __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')));
+	return ~(u32)_mm256_movemask_epi8(m);
+}
+
+TARGET_AVX2 static usize skip_blanks_avx2(const char *c) {
+	const usize offset = (uintptr_t)c & 31;
+	const char *p      = c - offset;
+
+	u32 mask = non_blank_mask_avx2(p) >> offset;
+	if (mask) return ctz32(mask);
+	while (true) {
+		p += 32;
+		mask = non_blank_mask_avx2(p);
+		if (mask) return (usize)(p - c) + ctz32(mask);
+	}
+}
+
+static bool cpu_has_avx2(void) {
+#if BL_COMPILER_MSVC
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) return false;
+	__cpuid(info, 1);
+	// The OS must save YMM registers on context switch.
+	if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6) return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // LEXER_X86_64
+
+static find_any_fn_t    find_any    = &find_any_scalar;
+static skip_blanks_fn_t skip_blanks = &skip_blanks_scalar;
+
 struct context {
 	struct assembly      *assembly;
 	struct unit          *unit;
 	struct tokens        *tokens;
+	array(u32) * line_starts;
 	struct string_cache **string_cache;
 	sarr_t(char, 64) strtmp; // @Cleanup: Use tmp string from builder.
 	char *c;
+	// Scanning stops on the first new line outside of any token ending at or behind this position.
+	char *end;
 	s32   line;
 	s32   col;
 
+	// Chunks of the source lexed in parallel do not report any errors, in case of an error, the
+	// whole unit is lexed again in one piece to report errors in correct order and location.
+	bool is_chunk;
+	bool has_error;
+
 	jmp_buf jmp_error;
 };
 
+// Big sources are split into chunks lexed in parallel, see lex_parallel.
+#define PARALLEL_LEXING_MIN_SIZE (1024 * 1024)
+#define LEXER_CHUNK_MIN_SIZE     (256 * 1024)
+#define LEXER_CHUNK_MAX_COUNT    16
+
+struct lexer_chunk {
+	struct tokens tokens;
+	array(u32) line_starts;
+	char *begin;
+	// Expected end of the chunk (beginning of the next one).
+	char *end;
+	// Position where scanning really stopped.
+	char *stop;
+	s32   new_lines;
+	s32   page_faults;
+	bool  has_error;
+};
+
+struct lexer_batch {
+	struct assembly   *assembly;
+	struct unit       *unit;
+	struct lexer_chunk chunks[LEXER_CHUNK_MAX_COUNT];
+	s32                chunk_count;
+	batomic_s32        next_chunk;
+	batomic_s32        done_count;
+	// Batch is shared with helper jobs which might start after all chunks are already lexed, so
+	// the last one using the batch is responsible for its release.
+	batomic_s32 ref_count;
+};
+
+// Token data used while scanning, pushed into the tokens container when complete.
+struct scanned_token {
+	enum sym        sym;
+	struct location location;
+	u32             value_index;
+};
+
 static void       scan(struct context *ctx);
-static bool       scan_comment(struct context *ctx, struct token *tok, const char *term);
-static bool       scan_docs(struct context *ctx, struct token *tok);
-static bool       scan_ident(struct context *ctx, struct token *tok);
-static bool       scan_string(struct context *ctx, struct token *tok);
-static bool       scan_char(struct context *ctx, struct token *tok);
-static bool       scan_number(struct context *ctx, struct token *tok);
+static bool       scan_comment(struct context *ctx, struct scanned_token *tok);
+static bool       scan_docs(struct context *ctx, struct scanned_token *tok);
+static bool       scan_ident(struct context *ctx, struct scanned_token *tok);
+static bool       scan_string(struct context *ctx, struct scanned_token *tok);
+static bool       scan_char(struct context *ctx, struct scanned_token *tok);
+static bool       scan_number(struct context *ctx, struct scanned_token *tok);
 static inline int c_to_number(char c, s32 base);
 
+// Register the beginning of a new line following the '\n' character under the cursor.
+static inline void push_line_start(struct context *ctx) {
+	const u32 offset = (u32)(ctx->c - ctx->unit->src) + 1;
+	// Lines might be already indexed in case some error was reported while lexing.
+	if (offset > arrlast(*ctx->line_starts)) arrput(*ctx->line_starts, offset);
+}
+
 static inline u32 add_token_value(struct context *ctx, union token_value value) {
 	const u32 index = (u32)arrlenu(ctx->tokens->values);
 	arrput(ctx->tokens->values, value);
 	return index;
 }
 
+static inline void push_token(struct context *ctx, struct scanned_token *tok) {
+	tokens_push(ctx->tokens, tok->sym, tok->location.line, tok->location.col, tok->location.len, tok->value_index);
+}
+
 #define report_error(ctx, code, ln, cl, len, cursor_position, format, ...)                                       \
 	{                                                                                                            \
 		_report((ctx), MSG_ERR, ERR_##code, (ln), (cl), (s32)(len), (cursor_position), (format), ##__VA_ARGS__); \
@@ -48,6 +257,10 @@ static inline u32 add_token_value(struct context *ctx, union token_value value)
 	(void)0
 
 static inline void _report(struct context *ctx, enum builder_msg_type type, s32 code, s32 ln, s32 cl, s32 len, enum builder_cur_pos cursor_position, const char *format, ...) {
+	if (ctx->is_chunk) {
+		ctx->has_error = true;
+		return;
+	}
 	struct location loc = {
 	    .line = ln,
 	    .col  = cl,
@@ -60,39 +273,51 @@ static inline void _report(struct context *ctx, enum builder_msg_type type, s32
 	va_end(args);
 }
 
-bool scan_comment(struct context *ctx, struct token *tok, const char *termminator) {
-	if (tok->sym == SYM_SHEBANG && ctx->line != 1) {
+bool scan_comment(struct context *ctx, struct scanned_token *tok) {
+	// Line numbers of parallel lexed chunks are relative to the chunk beginning, so we have to check
+	// the token position in the source.
+	if (tok->sym == SYM_SHEBANG && ctx->c - tok->location.len != ctx->unit->src) {
 		report_error(ctx, INVALID_TOKEN, ctx->line, ctx->col, 1, CARET_WORD, "Shebang is allowed only on the first line of the file.");
 	}
 
+	if (tok->sym != SYM_LBCOMMENT) {
+		// Line comment ends with the new line or the end of the file.
+		ctx->c += find_any(ctx->c, '\n', '\n', '\n');
+		if (*ctx->c == '\n') {
+			push_line_start(ctx);
+			ctx->line++;
+			ctx->col = 1;
+			ctx->c++;
+		}
+		return true;
+	}
+
 	const s32 start_ln = ctx->line;
 	const s32 start_cl = ctx->col;
 
-	const usize terminator_len = strlen(termminator);
-
 	while (true) {
-		if (*ctx->c == '\n') {
+		ctx->c += find_any(ctx->c, '*', '\n', '\n');
+		switch (*ctx->c) {
+		case '\n':
+			push_line_start(ctx);
 			ctx->line++;
 			ctx->col = 1;
-		} else if (*ctx->c == SYM_EOF) {
-			if (strcmp(termminator, "\n") == 0) {
+			break;
+		case '*':
+			if (ctx->c[1] == '/') {
+				ctx->c += 2;
 				return true;
 			}
-
+			break;
+		default:
 			report_error(ctx, UNTERMINATED_COMMENT, start_ln, start_cl, 1, CARET_WORD, "Unterminated comment block starting here:");
 		}
-
-		if (strncmp(ctx->c, termminator, terminator_len) == 0) break;
-
 		ctx->c++;
 	}
-
-	ctx->c += terminator_len;
-	return true;
 }
 
-bool scan_docs(struct context *ctx, struct token *tok) {
-	bassert(token_is(tok, SYM_DCOMMENT) || token_is(tok, SYM_DGCOMMENT));
+bool scan_docs(struct context *ctx, struct scanned_token *tok) {
+	bassert(tok->sym == SYM_DCOMMENT || tok->sym == SYM_DGCOMMENT);
 	tok->location.line = ctx->line;
 	tok->location.col  = ctx->col;
 
@@ -120,11 +345,10 @@ bool scan_docs(struct context *ctx, struct token *tok) {
 	return true;
 }
 
-bool scan_ident(struct context *ctx, struct token *tok) {
+bool scan_ident(struct context *ctx, struct scanned_token *tok) {
 	zone();
 	tok->location.line = ctx->line;
 	tok->location.col  = ctx->col;
-	tok->sym           = SYM_IDENT;
 
 	char *begin = ctx->c;
 
@@ -190,12 +414,13 @@ bool scan_ident(struct context *ctx, struct token *tok) {
 #endif
 
 	if (len == 0) return_zone(false);
+	tok->location.len = len;
+	ctx->col += len;
+	if ((tok->sym = sym_keyword(begin, len)) != SYM_IDENT) return_zone(true);
 	// Note that we use the string identificators directly (no copy is done). That means those might
 	// not to be zero terminated! This way we reduce amount of string duplication.
 	str_t str         = make_str(begin, len);
-	tok->value_index  = add_token_value(ctx, (union token_value){.str = str});
-	tok->location.len = len;
-	ctx->col += len;
+	tok->value_index = add_token_value(ctx, (union token_value){.str = str});
 	return_zone(true);
 }
 
@@ -269,7 +494,7 @@ static char scan_specch(struct context *ctx) {
 	}
 }
 
-bool scan_string(struct context *ctx, struct token *tok) {
+bool scan_string(struct context *ctx, struct scanned_token *tok) {
 	if (*ctx->c != '\"') return false;
 
 	zone();
@@ -301,10 +526,21 @@ bool scan_string(struct context *ctx, struct token *tok) {
 			c = scan_specch(ctx);
 			break;
 
-		default:
+		case '\n':
+			// New line is part of the string; it's not counted as a line break in locations.
+			push_line_start(ctx);
 			c = *ctx->c;
 			++ctx->col;
 			++ctx->c;
+			break;
+		default: {
+			// Copy the run of characters without any special meaning at once.
+			const usize len = find_any(ctx->c, '\"', '\\', '\n');
+			memcpy(sarraddn(&ctx->strtmp, len), ctx->c, len);
+			ctx->col += (s32)len;
+			ctx->c += len;
+			continue;
+		}
 		}
 		sarrput(&ctx->strtmp, c);
 	}
@@ -317,7 +553,7 @@ DONE: {
 }
 }
 
-bool scan_char(struct context *ctx, struct token *tok) {
+bool scan_char(struct context *ctx, struct scanned_token *tok) {
 	if (*ctx->c != '\'') return false;
 	tok->location.line = ctx->line;
 	tok->location.col  = ctx->col;
@@ -350,6 +586,7 @@ bool scan_char(struct context *ctx, struct token *tok) {
 		break;
 	}
 	default:
+		if (*ctx->c == '\n') push_line_start(ctx);
 		tok->value_index = add_token_value(ctx, (union token_value){.character = *ctx->c});
 		tok->location.len += 1;
 		ctx->c++;
@@ -411,7 +648,7 @@ static bool is_real(char *c) {
 	return false;
 }
 
-bool scan_number(struct context *ctx, struct token *tok) {
+bool scan_number(struct context *ctx, struct scanned_token *tok) {
 	tok->location.line = ctx->line;
 	tok->location.col  = ctx->col;
 
@@ -570,7 +807,7 @@ bool scan_number(struct context *ctx, struct token *tok) {
 		tok->value_index  = add_token_value(ctx, (union token_value){.number = n});
 
 		if (overflow) {
-			builder_msg(MSG_ERR, ERR_NUM_LIT_OVERFLOW, &tok->location, CARET_WORD, "Number literal is too big for u64 type.");
+			_report(ctx, MSG_ERR, ERR_NUM_LIT_OVERFLOW, tok->location.line, tok->location.col, len, CARET_WORD, "Number literal is too big for u64 type.");
 		}
 
 		return true;
@@ -580,7 +817,7 @@ bool scan_number(struct context *ctx, struct token *tok) {
 }
 
 void scan(struct context *ctx) {
-	struct token tok = {0};
+	struct scanned_token tok = {.location.unit = ctx->unit};
 SCAN:
 	tok.location.line = ctx->line;
 	tok.location.col  = ctx->col;
@@ -588,105 +825,348 @@ SCAN:
 	// Ignored characters
 	switch (*ctx->c) {
 	case '\0':
-		tok.sym = SYM_EOF;
-		tokens_push(ctx->tokens, tok);
+		tok.sym          = SYM_EOF;
+		tok.location.len = 1;
+		push_token(ctx, &tok);
 		return;
 	case '\r':
 		ctx->c++;
 		goto SCAN;
 	case '\n':
+		push_line_start(ctx);
 		ctx->line++;
 		ctx->col = 1;
 		ctx->c++;
+		if (ctx->c >= ctx->end) return;
 		goto SCAN;
 	case '\t':
-		ctx->col += 1;
-		ctx->c++;
-		goto SCAN;
-	case ' ':
-		ctx->col++;
-		ctx->c++;
+	case ' ': {
+		// Single blanks between tokens are the most common case.
+		const usize len = (ctx->c[1] == ' ' || ctx->c[1] == '\t') ? skip_blanks(ctx->c) : 1;
+		ctx->col += (s32)len;
+		ctx->c += len;
 		goto SCAN;
+	}
 	default:
 		break;
 	}
 
-	// Scan symbols described directly as strings.
-	usize      len                   = 0;
-	const bool is_current_char_ident = is_ident(*ctx->c);
-	const s32  start                 = is_current_char_ident ? SYM_IF : SYM_UNREACHABLE + 1;
-	const s32  end                   = is_current_char_ident ? SYM_UNREACHABLE + 1 : SYM_NONE;
-	for (s32 i = start; i < end; ++i) {
-		len = sym_lens[i];
+	// Identifiers and keywords are scanned in one pass; keywords are looked up in the perfect hash
+	// table when the identifier is complete.
+	if (is_ident(*ctx->c) && !isdigit(*ctx->c)) {
+		if (scan_ident(ctx, &tok)) goto PUSH_TOKEN;
+	}
+
+	// Operators and other symbols described directly as strings.
+	const u8 *candidates = operator_table[(u8)*ctx->c];
+	for (s32 i = 0; candidates[i] != SYM_NONE; ++i) {
+		const enum sym sym = candidates[i];
+		const s32      len = sym_lens[sym];
 		bassert(len > 0);
-		if (ctx->c[0] == sym_strings[i][0] && strncmp(ctx->c, sym_strings[i], len) == 0) {
-			ctx->c += len;
-			tok.sym          = (enum sym)i;
-			tok.location.len = (s32)len;
+		// First character already matches.
+		s32 j = 1;
+		while (j < len && ctx->c[j] == sym_strings[sym][j]) ++j;
+		if (j != len) continue;
 
-			// Two joined symbols will be parsed as identifier.
-			if (i >= SYM_IF && i <= SYM_UNREACHABLE && is_ident(*ctx->c)) {
-				// roll back
-				ctx->c -= len;
-				break;
-			}
+		ctx->c += len;
+		tok.sym          = sym;
+		tok.location.len = len;
 
 #ifndef _MSC_VER
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wimplicit-fallthrough"
 #endif
-			switch (tok.sym) {
-			case SYM_DCOMMENT:
-			case SYM_DGCOMMENT:
-				if (ctx->assembly && ctx->assembly->target->kind == ASSEMBLY_DOCS) {
-					scan_docs(ctx, &tok);
-					goto PUSH_TOKEN;
-				}
-			case SYM_SHEBANG:
-			case SYM_LCOMMENT:
-				scan_comment(ctx, &tok, "\n");
-				goto SCAN;
-			case SYM_LBCOMMENT:
-				scan_comment(ctx, &tok, sym_strings[SYM_RBCOMMENT]);
-				goto SCAN;
-			case SYM_RBCOMMENT: {
-				report_error(ctx, INVALID_TOKEN, ctx->line, ctx->col, 1, CARET_WORD, "Unexpected end of the comment block.");
-			}
-			default:
-				ctx->col += (s32)len;
+		switch (tok.sym) {
+		case SYM_DCOMMENT:
+		case SYM_DGCOMMENT:
+			if (ctx->assembly && ctx->assembly->target->kind == ASSEMBLY_DOCS) {
+				scan_docs(ctx, &tok);
 				goto PUSH_TOKEN;
 			}
+		case SYM_SHEBANG:
+		case SYM_LCOMMENT:
+		case SYM_LBCOMMENT:
+			scan_comment(ctx, &tok);
+			if (ctx->c >= ctx->end) return;
+			goto SCAN;
+		case SYM_RBCOMMENT: {
+			report_error(ctx, INVALID_TOKEN, ctx->line, ctx->col, 1, CARET_WORD, "Unexpected end of the comment block.");
+		}
+		default:
+			ctx->col += len;
+			goto PUSH_TOKEN;
+		}
 #ifndef _MSC_VER
 #pragma GCC diagnostic pop
 #endif
-		}
 	}
 
 	// Scan special tokens.
 	if (scan_number(ctx, &tok)) goto PUSH_TOKEN;
-	if (scan_ident(ctx, &tok)) goto PUSH_TOKEN;
 	if (scan_string(ctx, &tok)) goto PUSH_TOKEN;
 	if (scan_char(ctx, &tok)) goto PUSH_TOKEN;
 
 	// When symbol is unknown report error
 	report_error(ctx, INVALID_TOKEN, ctx->line, ctx->col, 1, CARET_WORD, "Unexpected symbol.");
 PUSH_TOKEN:
-	tok.location.unit = ctx->unit;
-	tokens_push(ctx->tokens, tok);
+	push_token(ctx, &tok);
 
 	goto SCAN;
 }
 
+void lexer_init(void) {
+#ifdef LEXER_X86_64
+	if (cpu_has_avx2()) {
+		find_any    = &find_any_avx2;
+		skip_blanks = &skip_blanks_avx2;
+	} else {
+		find_any    = &find_any_sse2;
+		skip_blanks = &skip_blanks_sse2;
+	}
+#endif
+}
+
+// Find chunks of the source to be lexed in parallel; each chunk begins behind a new line outside of
+// any string literal or comment. Returns count of chunks found.
+static s32 find_chunks(struct lexer_batch *batch, s32 count) {
+	char       *src     = batch->unit->src;
+	char *const src_end = src + batch->unit->src_len;
+	char       *c       = src;
+	char       *target  = src + batch->unit->src_len / count;
+	s32         n       = 0;
+
+	batch->chunks[0].begin = src;
+	while (n < count - 1) {
+		char *special = c + find_any(c, '\"', '/', '\'');
+		if (special > target) {
+			// There is no string or comment between the target and the next special character, so
+			// any new line in between is good enough.
+			char *from    = MAX(c, target);
+			char *newline = from + find_any(from, '\n', '\n', '\n');
+			if (newline < special) {
+				c                        = newline + 1;
+				batch->chunks[n].end     = c;
+				batch->chunks[++n].begin = c;
+				target                   = c + (src_end - c) / (count - n);
+				continue;
+			}
+		}
+
+		c = special;
+		switch (*c) {
+		case '\0':
+			goto DONE;
+		case '\"':
+			++c;
+			while (true) {
+				c += find_any(c, '\"', '\\', '\\');
+				if (*c == '\\' && c[1]) {
+					c += 2;
+					continue;
+				}
+				if (*c == '\"') ++c;
+				break;
+			}
+			break;
+		case '\'':
+			++c;
+			if (*c == '\\' && c[1]) c += 2;
+			c += find_any(c, '\'', '\n', '\n');
+			if (*c == '\'') ++c;
+			break;
+		case '/':
+			if (c[1] == '/') {
+				c += find_any(c, '\n', '\n', '\n');
+			} else if (c[1] == '*') {
+				c += 2;
+				while (true) {
+					c += find_any(c, '*', '*', '*');
+					if (*c == '\0') break;
+					if (*++c == '/') {
+						++c;
+						break;
+					}
+				}
+			} else {
+				++c;
+			}
+			break;
+		default:
+			bassert(false);
+		}
+	}
+DONE:
+	// The last chunk ends with the zero terminator.
+	batch->chunks[n].end = src_end + 1;
+	return n + 1;
+}
+
+static void lex_chunk(struct lexer_batch *batch, struct lexer_chunk *chunk) {
+	zone();
+	struct unit *unit        = batch->unit;
+	const s64    page_faults = get_thread_page_faults();
+
+	struct context ctx = {
+	    .assembly     = batch->assembly,
+	    .tokens       = &chunk->tokens,
+	    .line_starts  = &chunk->line_starts,
+	    .unit         = unit,
+	    .c            = chunk->begin,
+	    .end          = chunk->end,
+	    .line         = 1,
+	    .col          = 1,
+	    .strtmp       = SARR_ZERO,
+	    .string_cache = &batch->assembly->thread_local_contexts[get_worker_index()].string_cache,
+	    .is_chunk     = true,
+	};
+
+	tokens_init(&chunk->tokens, unit);
+	tokens_reserve(&chunk->tokens, MAX((usize)(chunk->end - chunk->begin) / 3, 256));
+	arrput(chunk->line_starts, (u32)(chunk->begin - unit->src));
+
+	if (setjmp(ctx.jmp_error)) {
+		ctx.has_error = true;
+	} else {
+		scan(&ctx);
+	}
+	sarrfree(&ctx.strtmp);
+
+	chunk->stop        = ctx.c;
+	chunk->new_lines   = ctx.line - 1;
+	chunk->has_error   = ctx.has_error;
+	chunk->page_faults = (s32)(get_thread_page_faults() - page_faults);
+	return_zone();
+}
+
+static void lex_chunks(struct lexer_batch *batch) {
+	s32 index;
+	while ((index = batomic_fetch_add_s32(&batch->next_chunk, 1)) < batch->chunk_count) {
+		lex_chunk(batch, &batch->chunks[index]);
+		batomic_fetch_add_s32(&batch->done_count, 1);
+	}
+}
+
+static void release_batch(struct lexer_batch *batch) {
+	if (batomic_fetch_add_s32(&batch->ref_count, -1) == 1) bfree(batch);
+}
+
+static void lexer_chunk_job(struct job_context *job_ctx) {
+	lex_chunks(job_ctx->lexer.batch);
+	release_batch(job_ctx->lexer.batch);
+}
+
+// Append tokens and line starts of all chunks into the unit.
+static void join_chunks(struct lexer_batch *batch, s32 *lines) {
+	struct unit   *unit        = batch->unit;
+	struct tokens *tokens      = &unit->tokens;
+	usize          token_count = 0;
+	usize          value_count = 0;
+	for (s32 i = 0; i < batch->chunk_count; ++i) {
+		token_count += tokens_len(&batch->chunks[i].tokens);
+		value_count += arrlenu(batch->chunks[i].tokens.values);
+	}
+	tokens_reserve(tokens, token_count);
+	arrsetcap(tokens->values, value_count);
+
+	u32 line_offset = 0;
+	for (s32 i = 0; i < batch->chunk_count; ++i) {
+		struct lexer_chunk *chunk      = &batch->chunks[i];
+		const usize         len        = tokens_len(&chunk->tokens);
+		const u32           value_base = (u32)arrlenu(tokens->values);
+
+		memcpy(arraddnptr(tokens->buf, len), chunk->tokens.buf, len * sizeof(struct token));
+		memcpy(arraddnptr(tokens->lens, len), chunk->tokens.lens, len * sizeof(u32));
+		u32 *positions     = arraddnptr(tokens->positions, len);
+		u32 *value_indices = arraddnptr(tokens->value_indices, len);
+		for (usize j = 0; j < len; ++j) {
+			// Line is stored in upper 16 bits.
+			positions[j]     = chunk->tokens.positions[j] + (line_offset << 16);
+			value_indices[j] = chunk->tokens.value_indices[j] + value_base;
+		}
+		const usize values_len = arrlenu(chunk->tokens.values);
+		memcpy(arraddnptr(tokens->values, values_len), chunk->tokens.values, values_len * sizeof(union token_value));
+
+		// The first line start is the beginning of the chunk already registered.
+		const usize line_starts_len = arrlenu(chunk->line_starts) - 1;
+		memcpy(arraddnptr(unit->line_starts, line_starts_len), chunk->line_starts + 1, line_starts_len * sizeof(u32));
+
+		line_offset += (u32)chunk->new_lines;
+		unit->stats.page_faults += chunk->page_faults;
+	}
+	*lines = (s32)line_offset + 1;
+}
+
+// Lex big unit split into multiple chunks in parallel. Chunks are lexed by the current thread and
+// helper jobs submitted into the job queue. Returns false in case the unit should be lexed serially
+// (it's too small, there are no threads to help or some chunk failed).
+static bool lex_parallel(struct assembly *assembly, struct unit *unit, s32 *chunk_count, s32 *lines) {
+	if (unit->src_len < PARALLEL_LEXING_MIN_SIZE) return false;
+	// There are always at least two worker threads, but it makes no sense to split the work on
+	// single CPU machines.
+	const usize threads = (usize)MIN((s32)get_thread_count(), cpu_thread_count());
+	const s32   count   = (s32)MIN(MIN(threads, unit->src_len / LEXER_CHUNK_MIN_SIZE), LEXER_CHUNK_MAX_COUNT);
+	if (count < 2) return false;
+
+	zone();
+	struct lexer_batch *batch = bmalloc(sizeof(struct lexer_batch));
+	bl_zeromem(batch, sizeof(struct lexer_batch));
+	batch->assembly    = assembly;
+	batch->unit        = unit;
+	batch->chunk_count = find_chunks(batch, count);
+	if (batch->chunk_count < 2) {
+		bfree(batch);
+		return_zone(false);
+	}
+
+	// Owner of the batch is the current thread and all helpers.
+	batch->ref_count = batch->chunk_count;
+	for (s32 i = 1; i < batch->chunk_count; ++i) {
+		submit_job(&lexer_chunk_job, &(struct job_context){.lexer = {.batch = batch}});
+	}
+	lex_chunks(batch);
+	// Wait for chunks being lexed by helpers.
+	while (batomic_load_s32(&batch->done_count) < batch->chunk_count) {
+		thrd_yield();
+	}
+
+	// Each chunk except the last one must stop exactly at the beginning of the following chunk;
+	// otherwise it was not split at the correct position.
+	bool is_valid = true;
+	for (s32 i = 0; i < batch->chunk_count; ++i) {
+		struct lexer_chunk *chunk = &batch->chunks[i];
+		if (chunk->has_error || (i < batch->chunk_count - 1 && chunk->stop != chunk->end)) {
+			is_valid = false;
+			break;
+		}
+	}
+	if (is_valid) {
+		join_chunks(batch, lines);
+		*chunk_count = batch->chunk_count;
+	}
+
+	for (s32 i = 0; i < batch->chunk_count; ++i) {
+		tokens_terminate(&batch->chunks[i].tokens);
+		arrfree(batch->chunks[i].line_starts);
+	}
+	release_batch(batch);
+	return_zone(is_valid);
+}
+
 void lexer_run(struct assembly *assembly, struct unit *unit) {
 	runtime_measure_begin(lex);
+	const f64 start_ms = get_tick_ms();
 
 	const u32 thread_index = get_worker_index();
+	// In case the source file is memory-mapped, pages are loaded lazily while lexing.
+	const s64 page_faults = get_thread_page_faults();
 
 	struct context ctx = {
 	    .assembly     = assembly,
 	    .tokens       = &unit->tokens,
+	    .line_starts  = &unit->line_starts,
 	    .unit         = unit,
 	    .c            = unit->src,
+	    .end          = unit->src + unit->src_len + 1,
 	    .line         = 1,
 	    .col          = 1,
 	    .strtmp       = SARR_ZERO,
@@ -694,17 +1174,42 @@ void lexer_run(struct assembly *assembly, struct unit *unit) {
 	};
 
 	zone();
-	s32 error = 0;
-	if ((error = setjmp(ctx.jmp_error))) {
+	arrsetlen(unit->line_starts, 0);
+	arrsetcap(unit->line_starts, 256);
+	arrput(unit->line_starts, 0);
+
+	s32 chunk_count = 1;
+	s32 lines       = 0;
+	if (!lex_parallel(assembly, unit, &chunk_count, &lines)) {
+		// Growing of multiple token arrays is expensive, so we try to guess the token count from
+		// the source length (there is usually one token per 4 or more bytes of the source code).
+		tokens_reserve(&unit->tokens, MAX(unit->src_len / 3, 256));
+
+		if (setjmp(ctx.jmp_error)) {
+			sarrfree(&ctx.strtmp);
+			unit->stats.page_faults += (s32)(get_thread_page_faults() - page_faults);
+			unit->stats.lex_ms = get_tick_ms() - start_ms;
+			batomic_fetch_add_s32(&assembly->stats.lexing_ms, runtime_measure_end(lex));
+			return_zone();
+		}
+
+		scan(&ctx);
 		sarrfree(&ctx.strtmp);
-		batomic_fetch_add_s32(&assembly->stats.lexing_ms, runtime_measure_end(lex));
-		return_zone();
+		lines = ctx.line;
 	}
 
-	scan(&ctx);
-	sarrfree(&ctx.strtmp);
-
-	batomic_fetch_add_s32(&builder.total_lines, ctx.line);
+	unit->stats.page_faults += (s32)(get_thread_page_faults() - page_faults);
+	builder_log("Lexed: " STR_FMT " (%s, loaded in %.3f ms, %d page faults, %d chunks)",
+	            STR_ARG(unit->name),
+	            unit->src_mapped_size ? "mapped" : "read",
+	            unit->stats.load_ms,
+	            unit->stats.page_faults,
+	            chunk_count);
+
+	batomic_fetch_add_s32(&builder.total_lines, lines);
+	batomic_fetch_add_s32(&assembly->stats.token_count, (s32)tokens_len(&unit->tokens));
+	batomic_fetch_add_s64(&assembly->stats.token_bytes, (s64)tokens_size_bytes(&unit->tokens));
+	unit->stats.lex_ms = get_tick_ms() - start_ms;
 	batomic_fetch_add_s32(&assembly->stats.lexing_ms, runtime_measure_end(lex));
 	return_zone();
 }
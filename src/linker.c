@@ -4,13 +4,13 @@
 #include "conf.h"
 #include "stb_ds.h"
 
-#define link_error(code, tok, pos, format, ...)                                             \
-	{                                                                                       \
-		if (tok)                                                                            \
-			builder_msg(MSG_ERR, (code), &(tok)->location, (pos), (format), ##__VA_ARGS__); \
-		else                                                                                \
-			builder_error((format), ##__VA_ARGS__);                                         \
-	}                                                                                       \
+#define link_error(code, loc, pos, format, ...)                                  \
+	{                                                                            \
+		if (loc)                                                                 \
+			builder_msg(MSG_ERR, (code), (loc), (pos), (format), ##__VA_ARGS__); \
+		else                                                                     \
+			builder_error((format), ##__VA_ARGS__);                              \
+	}                                                                            \
 	(void)0
 
 struct context {
@@ -247,23 +247,23 @@ void linker_run(struct assembly *assembly) {
 
 #if BL_PLATFORM_WIN
 	if (!link_working_environment(&ctx, MSVC_CRT)) {
-		struct token *dummy = NULL;
+		struct location *dummy = NULL;
 		link_error(ERR_LIB_NOT_FOUND, dummy, CARET_WORD, "Cannot link " MSVC_CRT);
 		return_zone();
 	}
 	if (!link_working_environment(&ctx, KERNEL32)) {
-		struct token *dummy = NULL;
+		struct location *dummy = NULL;
 		link_error(ERR_LIB_NOT_FOUND, dummy, CARET_WORD, "Cannot link " KERNEL32);
 		return_zone();
 	}
 	if (!link_working_environment(&ctx, SHLWAPI)) {
-		struct token *dummy = NULL;
+		struct location *dummy = NULL;
 		link_error(ERR_LIB_NOT_FOUND, dummy, CARET_WORD, "Cannot link " SHLWAPI);
 		return_zone();
 	}
 #endif
 	if (!link_working_environment(&ctx, NULL)) {
-		struct token *dummy = NULL;
+		struct location *dummy = NULL;
 		link_error(ERR_LIB_NOT_FOUND, dummy, CARET_WORD, "Cannot link working environment.");
 		return_zone();
 	}
@@ -105,6 +105,15 @@ LLVMValueRef llvm_add_function(LLVMModuleRef M, const str_t Name, LLVMTypeRef Fu
 	    unwrap<FunctionType>(FunctionTy), GlobalValue::ExternalLinkage, sName, unwrap(M)));
 }
 
+LLVMValueRef llvm_get_named_function(LLVMModuleRef M, const str_t Name) {
+	StringRef sName(Name.ptr, (size_t)Name.len);
+	return wrap(unwrap(M)->getFunction(sName));
+}
+
+u32 llvm_get_instruction_count(LLVMValueRef Fn) {
+	return unwrap<Function>(Fn)->getInstructionCount();
+}
+
 LLVMValueRef llvm_build_alloca(LLVMBuilderRef B, LLVMTypeRef Ty, const str_t Name) {
 	StringRef sName(Name.ptr, (size_t)Name.len);
 	return wrap(unwrap(B)->CreateAlloca(unwrap(Ty), nullptr, sName));
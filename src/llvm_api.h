@@ -101,6 +101,8 @@ LLVMTypeRef        llvm_void_type_in_context(llvm_context_ref_t ctx);
 LLVMTypeRef        llvm_struct_create_named(llvm_context_ref_t ctx, const str_t Name);
 LLVMValueRef       llvm_add_global(LLVMModuleRef M, LLVMTypeRef Ty, const str_t Name);
 LLVMValueRef       llvm_add_function(LLVMModuleRef M, const str_t Name, LLVMTypeRef FunctionTy);
+LLVMValueRef       llvm_get_named_function(LLVMModuleRef M, const str_t Name);
+u32                llvm_get_instruction_count(LLVMValueRef Fn);
 LLVMValueRef       llvm_build_alloca(LLVMBuilderRef B, LLVMTypeRef Ty, const str_t Name);
 LLVMBasicBlockRef  llvm_append_basic_block_in_context(llvm_context_ref_t ctx, LLVMValueRef Fn, const str_t Name);
 LLVMMetadataRef    llvm_di_builder_create_debug_location(llvm_context_ref_t ctx, s32 line, s32 col, LLVMMetadataRef scope, LLVMMetadataRef inlined_at);
@@ -300,6 +300,7 @@ int main(s32 argc, char *argv[]) {
 	const f64 start_time_ms = get_tick_ms();
 
 	opt.builder.error_limit = 100;
+	opt.builder.jobs        = 1;
 	opt.builder.doc_out_dir = "out";
 	builder_init(&opt.builder);
 	builder_log("Compiler version: %s, LLVM: %d", BL_VERSION, LLVM_VERSION_MAJOR);
@@ -371,6 +372,26 @@ int main(s32 argc, char *argv[]) {
 	                      "by default.)",
 	        .property.s = &opt.builder.doc_out_dir,
 	    },
+	    {
+	        .kind       = STRING,
+	        .name       = "--load-mir",
+	        .help       = "Load MIR from binary file created by '--emit-mir-binary' instead of compiling "
+	                      "the input files.",
+	        .property.s = &opt.builder.load_mir,
+	    },
+	    {
+	        .kind       = STRING,
+	        .name       = "--stats-json",
+	        .help       = "Write compilation statistics of all compiled targets into the JSON file.",
+	        .property.s = &opt.builder.stats_json_file,
+	    },
+	    {
+	        .kind       = STRING,
+	        .name       = "--trace",
+	        .help       = "Write begin and end events of compiler stages into the file in Chrome trace "
+	                      "JSON format (viewable in 'chrome://tracing' or Perfetto).",
+	        .property.s = &opt.builder.trace_file,
+	    },
 	    {
 	        .kind       = STRING,
 	        .name       = "--output",
@@ -455,6 +476,14 @@ int main(s32 argc, char *argv[]) {
 	        .property.b = &opt.builder.no_color,
 	        .help       = "Disable colored output.",
 	    },
+	    {
+	        .name       = "--message-format",
+	        .kind       = ENUM,
+	        .property.n = (s32 *)&opt.builder.message_format,
+	        .variants   = "text|json",
+	        .help       = "Set format of reported compiler messages ('json' prints one JSON object per "
+	                      "line).",
+	    },
 #if BL_PLATFORM_WIN
 	    {
 	        .name       = "--legacy-colors",
@@ -467,6 +496,12 @@ int main(s32 argc, char *argv[]) {
 	        .property.b = &opt.builder.no_jobs,
 	        .help       = "Enable single-thread mode. This is mainly useful for compiler debugging.",
 	    },
+	    {
+	        .name       = "--jobs",
+	        .kind       = NUMBER,
+	        .property.n = &opt.builder.jobs,
+	        .help       = "Set maximum count of build script targets compiled in parallel (0 for CPU thread count).",
+	    },
 	    {
 	        .name       = "--no-warning",
 	        .property.b = &opt.builder.no_warning,
@@ -482,11 +517,67 @@ int main(s32 argc, char *argv[]) {
 	        .property.b = &opt.builder.no_usage_check,
 	        .help       = "Disable checking of unused symbols.",
 	    },
+	    {
+	        .name       = "--streaming-memory",
+	        .property.b = &opt.builder.streaming_memory,
+	        .help       = "Release token data of each unit as soon as MIR is generated to reduce peak memory usage.",
+	    },
+	    {
+	        .name       = "--lazy-fn-bodies",
+	        .property.b = &opt.builder.lazy_fn_bodies,
+	        .help       = "Parse bodies of global functions only when they are used (errors in unused function bodies are not reported).",
+	    },
+	    {
+	        .name       = "--reachable-only",
+	        .property.b = &opt.builder.reachable_only,
+	        .help       = "Analyze only functions reachable from the entry, build entry, exported and test functions.",
+	    },
+	    {
+	        .name       = "--no-mir-fold-branches",
+	        .property.b = &opt.builder.no_mir_fold_branches,
+	        .help       = "Disable folding of switch statements and conditional breaks with compile-time known value.",
+	    },
+	    {
+	        .name       = "--no-mir-jump-threading",
+	        .property.b = &opt.builder.no_mir_jump_threading,
+	        .help       = "Disable redirection of breaks into empty blocks to their final destination.",
+	    },
+	    {
+	        .name       = "--no-mir-dead-blocks",
+	        .property.b = &opt.builder.no_mir_dead_blocks,
+	        .help       = "Disable removal of unreachable basic blocks.",
+	    },
+	    {
+	        .name       = "--no-mir-merge-blocks",
+	        .property.b = &opt.builder.no_mir_merge_blocks,
+	        .help       = "Disable merging of basic blocks with their only predecessor.",
+	    },
+	    {
+	        .name       = "--no-mir-inline",
+	        .property.b = &opt.builder.no_mir_inline,
+	        .help       = "Disable inlining of small functions into their callers.",
+	    },
+	    {
+	        .name       = "--no-mir-copy-propagation",
+	        .property.b = &opt.builder.no_mir_copy_propagation,
+	        .help       = "Disable propagation of variables assigned only once and folding of constant expressions.",
+	    },
+	    {
+	        .name       = "--no-mir-dead-stores",
+	        .property.b = &opt.builder.no_mir_dead_stores,
+	        .help       = "Disable removal of stores into variables which are never read.",
+	    },
 	    {
 	        .name       = "--stats",
 	        .property.b = &opt.builder.stats,
 	        .help       = "Print compilation statistics.",
 	    },
+	    {
+	        .name       = "--time-report",
+	        .property.b = &opt.builder.time_report,
+	        .help       = "Print functions most expensive to analyze, execute in compile-time and "
+	                      "generate LLVM IR for, and polymorphs with most instances.",
+	    },
 	    {
 	        .name       = "--lex-dump",
 	        .property.b = &opt.target->print_tokens,
@@ -522,6 +613,11 @@ int main(s32 argc, char *argv[]) {
 	        .property.b = &opt.target->emit_mir,
 	        .help       = "Write MIR to file.",
 	    },
+	    {
+	        .name       = "--emit-mir-binary",
+	        .property.b = &opt.target->emit_mir_binary,
+	        .help       = "Write MIR to compact binary file.",
+	    },
 	    {
 	        .name       = "--di",
 	        .kind       = ENUM,
@@ -559,6 +655,11 @@ int main(s32 argc, char *argv[]) {
 	        .help       = "Enable/disable splitting of structures passed into the function by value into "
 	                      "registers. This feature is supposed to be enabled on System V ABI compatible systems.",
 	    },
+	    {
+	        .name       = "--compact-rtti",
+	        .property.b = &opt.target->compact_rtti,
+	        .help       = "Emit type information without type and function argument names into the binary.",
+	    },
 	    {
 	        .name       = "--verify-llvm",
 	        .property.b = &opt.target->verify_llvm,
@@ -804,7 +905,10 @@ SKIP:
 		EXIT(EXIT_SUCCESS);
 	}
 
-	if (opt.target->kind != ASSEMBLY_BUILD_PIPELINE && !has_input_files) {
+	if (opt.builder.load_mir) {
+		// Loaded MIR already contains everything needed.
+		opt.target->no_api = true;
+	} else if (opt.target->kind != ASSEMBLY_BUILD_PIPELINE && !has_input_files) {
 		builder_error("No input files, use 'blc my-source-file.bl' or 'blc -build' in case the "
 		              "'build.bl' is present. For more info type 'blc --help'.");
 		EXIT(EXIT_FAILURE);
@@ -832,7 +936,11 @@ SKIP:
 
 	opt.builder.do_cleanup_when_done = opt.app.do_cleanup_when_done;
 
+	if (opt.builder.stats_json_file) bl_alloc_enable_stats();
+	builder_start_tracing();
 	state = builder_compile(opt.target);
+	builder_write_trace();
+	builder_write_stats_json();
 	if (!no_finish_msg) {
 		const f64 runtime_ms = get_tick_ms() - start_time_ms;
 		builder_info("Finished in %.3f seconds.", runtime_ms * 0.001);
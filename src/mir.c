@@ -4,6 +4,7 @@
 #include "builder.h"
 #include "common.h"
 #include "mir_printer.h"
+#include "parser.h"
 #include "stb_ds.h"
 #include "table.h"
 #include "threading.h"
@@ -59,6 +60,18 @@
 #include "mir.def"
 #undef GEN_INSTR_SIZEOF
 
+static const usize instr_sizes[] = {
+#define GEN_INSTR_SIZES
+#include "mir.def"
+#undef GEN_INSTR_SIZES
+};
+
+// Any instruction can be mutated into constant, so the smallest size class must fit it.
+#define INSTR_SIZE_CLASS_BASE sizeof(struct mir_instr_const)
+#define INSTR_SIZE_CLASS_STEP 8
+static_assert(INSTR_SIZE_CLASS_BASE + INSTR_SIZE_CLASS_STEP * (MIR_INSTR_SIZE_CLASS_COUNT - 1) >= SIZEOF_MIR_INSTR,
+              "Instruction size classes does not cover the largest instruction!");
+
 // Sets is_naked flag to 'v' if '_instr' is valid compound expression.
 #define set_compound_naked(_instr, v)                          \
 	if ((_instr) && (_instr)->kind == MIR_INSTR_COMPOUND) {    \
@@ -85,6 +98,9 @@ struct context {
 	struct mir_arenas         *mir_arenas;
 	struct scope_thread_local *scope_thread_local;
 	struct arena              *small_array_arena;
+	// Set only for the analyze pass.
+	struct opt_context *opt;
+	array(struct mir_fn *) opt_queue; // Fully analyzed functions waiting for optimization.
 
 	// Ast -> MIR generation
 	struct {
@@ -113,6 +129,11 @@ struct context {
 	} fn_generate;
 };
 
+// Context kept per thread for RTTI generation (see mir_gen_rtti).
+struct mir_rtti_context {
+	struct context ctx;
+};
+
 enum result_state {
 	// Analyze pass failed.
 	ANALYZE_FAILED = 0,
@@ -157,6 +178,7 @@ static void fn_dtor(struct mir_fn *fn) {
 static void fn_poly_dtor(struct mir_fn_generated_recipe *recipe) {
 	bmagic_assert(recipe);
 	tbl_free(recipe->entries);
+	tbl_free(recipe->comptime_entries);
 }
 
 // FW decls
@@ -176,6 +198,8 @@ static struct scope_entry *register_symbol(struct context *ctx, struct ast *node
 // complete when analyze pass id completed!).
 static struct mir_type *lookup_builtin_type(struct context *ctx, enum builtin_id_kind kind);
 static struct mir_fn   *lookup_builtin_fn(struct context *ctx, enum builtin_id_kind kind);
+// Increase function reference count, lazy function body is generated on the first use.
+static void ref_fn(struct context *ctx, struct mir_fn *fn);
 
 // @HACK: Better way to do this will be enable compiler to have default preload file; we need to
 //  make lexing, parsing, MIR generation and analyze of this file first and then process rest of the
@@ -582,6 +606,7 @@ static struct mir_instr *ast_expr_lit_fn(struct context      *ctx,
                                          bool                 is_global,
                                          enum ast_flags       flags,
                                          enum builtin_id_kind builtin_id);
+static void              ast_fn_body(struct context *ctx, struct mir_fn *fn, struct ast *lit_fn);
 static struct mir_instr *ast_expr_lit_fn_group(struct context *ctx, struct ast *group);
 static struct mir_instr *ast_expr_lit_string(struct context *ctx, struct ast *lit_string);
 static struct mir_instr *ast_expr_lit_char(struct context *ctx, struct ast *expr);
@@ -720,6 +745,10 @@ static void          analyze_report_unresolved(struct context *ctx);
 static void          analyze_report_unused(struct context *ctx);
 static void          analyze_report_skipped(struct context *ctx);
 
+// Optimization passes
+static void optimize_completed_fns(struct context *ctx);
+static void optimize(struct context *ctx);
+
 // =================================================================================================
 //  RTTI
 // =================================================================================================
@@ -784,7 +813,7 @@ static inline void analyze_instr_rq(struct context *ctx, struct mir_instr *instr
 }
 
 static inline void _report(enum builder_msg_type type, s32 code, const struct ast *node, enum builder_cur_pos cursor_position, const char *format, ...) {
-	struct location *loc = node ? node->location : NULL;
+	struct location *loc = node ? ast_tmp_location(node) : NULL;
 	va_list          args;
 	va_start(args, format);
 	builder_vmsg(type, code, loc, cursor_position, format, args);
@@ -919,31 +948,51 @@ static inline struct mir_type *is_incomplete_struct_inheritance_hierarchy(struct
 // Checks whether type is complete type, checks also dependencies. In practice only composite types
 // can be incomplete, but in some cases (RTTI generation) we need to check whole dependency type
 // tree for completeness.
-// @Performance: this function visits all nested types of structs, this can be really expensive
-// eventually.
 //
-// The incomplete_type is optional parameter set in case it's not NULL and the function returns
-// TRUE. It points to the first incomplete type found in the tree.
+// Results are memoized; complete types are marked as checked_and_complete (this is final since
+// complete type can never become incomplete again), in case the type is incomplete, the first
+// incomplete type found is remembered together with current type completion epoch. The epoch is
+// incremented each time some forward declared struct is completed, so the remembered result is
+// valid until then.
+//
+// Returns the first incomplete type found in the tree or NULL.
 static struct mir_type *is_incomplete_type(struct context *ctx, struct mir_type *type) {
 	zone();
+	struct mir_analyze *analyze = ctx->analyze;
+	batomic_fetch_add_s32(&ctx->assembly->stats.complete_check_count, 1);
 
-	struct visited_entry {
-		struct mir_type *hash;
-	};
+	if (type->checked_and_complete) {
+		type->first_incomplete = NULL;
+		goto HIT;
+	}
+	if (type->first_incomplete) {
+		if (type->incomplete_epoch == analyze->type_completion_epoch) goto HIT;
+		if (is_incomplete_struct_type(type->first_incomplete)) {
+			// Some other type was completed, but not this one.
+			type->incomplete_epoch = analyze->type_completion_epoch;
+			goto HIT;
+		}
+		type->first_incomplete = NULL;
+	}
 
-	hash_table(struct visited_entry) visited = NULL;
+	const u32    mark    = ++analyze->complete_check_mark;
+	mir_types_t *stack   = &analyze->complete_check_type_stack;
+	mir_types_t *visited = &analyze->complete_check_visited;
+	s64          nodes   = 0;
 
-	mir_types_t *stack = &ctx->analyze->complete_check_type_stack;
 	sarrput(stack, type);
 	struct mir_type *first_incomplete_type = NULL;
 	while (sarrlenu(stack)) {
 		struct mir_type *top = sarrpop(stack);
 		bassert(top);
+		++nodes;
 		if (top->checked_and_complete) continue;
 		if (is_incomplete_struct_type(top)) {
 			first_incomplete_type = top;
 			goto DONE;
 		}
+		if (top->complete_check_mark == mark) continue;
+		top->complete_check_mark = mark;
 		switch (top->kind) {
 		case MIR_TYPE_PTR: {
 			sarrput(stack, top->data.ptr.expr);
@@ -966,10 +1015,6 @@ static struct mir_type *is_incomplete_type(struct context *ctx, struct mir_type
 		case MIR_TYPE_STRING:
 		case MIR_TYPE_VARGS:
 		case MIR_TYPE_STRUCT: {
-			const s32 index = tbl_lookup_index(visited, top);
-			if (index != -1) break;
-			struct visited_entry entry = (struct visited_entry){.hash = top};
-			tbl_insert(visited, entry);
 			mir_members_t *members = top->data.strct.members;
 			for (usize i = 0; i < sarrlenu(members); ++i) {
 				struct mir_member *member = sarrpeek(members, i);
@@ -980,12 +1025,28 @@ static struct mir_type *is_incomplete_type(struct context *ctx, struct mir_type
 		default:
 			continue;
 		}
+		sarrput(visited, top);
 	}
 DONE:
+	if (first_incomplete_type) {
+		type->first_incomplete = first_incomplete_type;
+		type->incomplete_epoch = analyze->type_completion_epoch;
+	} else {
+		// Whole dependency tree was visited and everything is complete, so all visited types are
+		// complete too.
+		for (usize i = 0; i < sarrlenu(visited); ++i) {
+			sarrpeek(visited, i)->checked_and_complete = true;
+		}
+		type->checked_and_complete = true;
+	}
 	sarrclear(stack);
-	tbl_free(visited);
-	type->checked_and_complete = !first_incomplete_type;
+	sarrclear(visited);
+	batomic_fetch_add_s64(&ctx->assembly->stats.complete_check_node_count, nodes);
 	return_zone(first_incomplete_type);
+
+HIT:
+	batomic_fetch_add_s32(&ctx->assembly->stats.complete_check_hit_count, 1);
+	return_zone(type->first_incomplete);
 }
 
 static inline void lock_type_cache(struct context *ctx) {
@@ -1000,7 +1061,8 @@ static inline struct mir_type *lookup_type(struct context *ctx, hash_t hash, str
 	zone();
 	mtx_lock(&ctx->mir->type_cache_lock);
 	struct mir_type *type = NULL;
-	const s32        i    = tbl_lookup_index_with_key(ctx->mir->type_cache, hash, name);
+	batomic_fetch_add_s32(&ctx->assembly->stats.type_name_lookup_count, 1);
+	const s32 i = tbl_lookup_index_with_key(ctx->mir->type_cache, hash, name);
 	if (i != -1) {
 		type = ctx->mir->type_cache[i].type;
 	}
@@ -1008,6 +1070,40 @@ static inline struct mir_type *lookup_type(struct context *ctx, hash_t hash, str
 	return_zone(type);
 }
 
+// Types built from other types (pointers, arrays, slices, ...) can be cached also by the structure;
+// the type kind and the child type pointer, in such case we don't need to generate type name string
+// used as a key in the type cache. This works only for children which can use the type cache, since
+// such types are unique per name. Must be called with the type cache locked.
+static inline u64 type_struct_hash(enum mir_type_kind kind, const struct mir_type *child, s64 len) {
+	u64 hash = ((u64)(uintptr_t)child) ^ ((u64)kind << 56) ^ ((u64)len * 0x9E3779B97F4A7C15ull);
+	// splitmix64 finalizer
+	hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+	hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+	return hash ^ (hash >> 31);
+}
+
+static inline struct mir_type *lookup_type_struct(struct context *ctx, u64 hash, enum mir_type_kind kind, const struct mir_type *child, s64 len) {
+	const s32 i = tbl_lookup_index(ctx->mir->type_struct_cache, hash);
+	if (i == -1) return NULL;
+	struct mir_type_struct_cache_entry *entry = &ctx->mir->type_struct_cache[i];
+	// Full key check in case of hash collision.
+	if (entry->kind != kind || entry->child != child || entry->len != len) return NULL;
+	batomic_fetch_add_s32(&ctx->assembly->stats.type_struct_cache_hit_count, 1);
+	return entry->type;
+}
+
+static inline void insert_type_struct(struct context *ctx, u64 hash, enum mir_type_kind kind, const struct mir_type *child, s64 len, struct mir_type *type) {
+	if (tbl_lookup_index(ctx->mir->type_struct_cache, hash) != -1) return; // Collision, keep the first one.
+	struct mir_type_struct_cache_entry entry = {
+	    .hash  = hash,
+	    .kind  = kind,
+	    .child = child,
+	    .len   = len,
+	    .type  = type,
+	};
+	tbl_insert(ctx->mir->type_struct_cache, entry);
+}
+
 static inline void insert_type_into_cache(struct context *ctx, struct mir_type *type, str_t name) {
 	zone();
 	mtx_lock(&ctx->mir->type_cache_lock);
@@ -1396,7 +1492,13 @@ static inline void commit_var(struct context *ctx, struct mir_var *var, const bo
 	if (entry->kind == SCOPE_ENTRY_UNNAMED) return;
 	entry->kind     = SCOPE_ENTRY_VAR;
 	entry->data.var = var;
-	if (isflag(var->iflags, MIR_VAR_GLOBAL) || var->value.is_comptime) analyze_notify_provided(ctx, id->hash);
+	// Local types might be waited for by nested functions analyzed before the deferred parent
+	// function body.
+	const bool is_deferred_local_type = var->value.type->kind == MIR_TYPE_TYPE &&
+	                                    (builder.options->reachable_only || builder.options->lazy_fn_bodies);
+	if (isflag(var->iflags, MIR_VAR_GLOBAL) || var->value.is_comptime || is_deferred_local_type) {
+		analyze_notify_provided(ctx, id->hash);
+	}
 	if (check_usage) usage_check_push(ctx, entry);
 }
 
@@ -1538,7 +1640,7 @@ struct scope_entry *register_symbol(struct context *ctx, struct ast *node, struc
 	scope_lookup(ctx->assembly, scope, &lookup_args, &collision, 1);
 
 	if (collision && scope->kind == SCOPE_PRIVATE) {
-		const bool collision_in_same_unit = (node ? node->location->unit : NULL) == (collision->node ? collision->node->location->unit : NULL);
+		const bool collision_in_same_unit = (node ? node->unit : NULL) == (collision->node ? collision->node->unit : NULL);
 		if (!collision_in_same_unit) collision = NULL;
 	}
 
@@ -1833,19 +1935,29 @@ struct mir_type *create_type_real(struct context *ctx, struct id *user_id, s32 b
 struct mir_type *create_type_null(struct context *ctx, struct mir_type *base_type) {
 	bassert(base_type);
 	// @Cleanup: this caching really doesn't work.
-	const bool       is_cached = base_type->can_use_cache;
+	const bool       is_cached   = base_type->can_use_cache;
+	const u64        struct_hash = type_struct_hash(MIR_TYPE_NULL, base_type, 0);
 	struct mir_type *tmp;
 
+	if (is_cached) {
+		lock_type_cache(ctx);
+		tmp = lookup_type_struct(ctx, struct_hash, MIR_TYPE_NULL, base_type, 0);
+		if (tmp) {
+			unlock_type_cache(ctx);
+			return tmp;
+		}
+	}
+
 	str_buf_t name = get_tmp_str();
 	str_buf_append(&name, cstr("n."));
 	str_buf_append(&name, base_type->id.str);
 
 	hash_t hash = strhash(name);
 	if (is_cached) {
-		lock_type_cache(ctx);
 		tmp = lookup_type(ctx, hash, str_buf_view(name));
 		if (tmp) {
 			bassert(tmp->kind == MIR_TYPE_NULL);
+			insert_type_struct(ctx, struct_hash, MIR_TYPE_NULL, base_type, 0, tmp);
 			unlock_type_cache(ctx);
 			goto DONE;
 		}
@@ -1861,6 +1973,7 @@ struct mir_type *create_type_null(struct context *ctx, struct mir_type *base_typ
 
 	if (is_cached) {
 		insert_type_into_cache(ctx, tmp, str_buf_view(name));
+		insert_type_struct(ctx, struct_hash, MIR_TYPE_NULL, base_type, 0, tmp);
 		unlock_type_cache(ctx);
 	}
 
@@ -1871,19 +1984,29 @@ DONE:
 
 struct mir_type *create_type_ptr(struct context *ctx, struct mir_type *src_type) {
 	bassert(src_type && "Invalid src type for pointer type.");
-	const bool       is_cached = src_type->can_use_cache;
+	const bool       is_cached   = src_type->can_use_cache;
+	const u64        struct_hash = type_struct_hash(MIR_TYPE_PTR, src_type, 0);
 	struct mir_type *tmp;
 
+	if (is_cached) {
+		lock_type_cache(ctx);
+		tmp = lookup_type_struct(ctx, struct_hash, MIR_TYPE_PTR, src_type, 0);
+		if (tmp) {
+			unlock_type_cache(ctx);
+			return tmp;
+		}
+	}
+
 	str_buf_t name = get_tmp_str();
 	str_buf_append(&name, cstr("p."));
 	str_buf_append(&name, src_type->id.str);
 
 	hash_t hash = strhash(name);
 	if (is_cached) {
-		lock_type_cache(ctx);
 		tmp = lookup_type(ctx, hash, str_buf_view(name));
 		if (tmp) {
 			bassert(tmp->kind == MIR_TYPE_PTR);
+			insert_type_struct(ctx, struct_hash, MIR_TYPE_PTR, src_type, 0, tmp);
 			unlock_type_cache(ctx);
 			goto DONE;
 		}
@@ -1898,6 +2021,7 @@ struct mir_type *create_type_ptr(struct context *ctx, struct mir_type *src_type)
 	type_init_llvm_ptr(ctx, tmp);
 	if (is_cached) {
 		insert_type_into_cache(ctx, tmp, str_buf_view(name));
+		insert_type_struct(ctx, struct_hash, MIR_TYPE_PTR, src_type, 0, tmp);
 		unlock_type_cache(ctx);
 	}
 
@@ -2022,6 +2146,16 @@ struct mir_type *create_type_array(struct context *ctx, struct id *user_id, stru
 	struct mir_type *result;
 
 	const bool can_use_cache = elem_type->can_use_cache;
+	const u64  struct_hash   = type_struct_hash(MIR_TYPE_ARRAY, elem_type, len);
+
+	if (can_use_cache) {
+		lock_type_cache(ctx);
+		result = lookup_type_struct(ctx, struct_hash, MIR_TYPE_ARRAY, elem_type, len);
+		if (result) {
+			unlock_type_cache(ctx);
+			return result;
+		}
+	}
 
 	str_buf_t name = get_tmp_str();
 
@@ -2031,10 +2165,10 @@ struct mir_type *create_type_array(struct context *ctx, struct id *user_id, stru
 	const hash_t hash = strhash(name);
 
 	if (can_use_cache) {
-		lock_type_cache(ctx);
 		result = lookup_type(ctx, hash, str_buf_view(name));
 		if (result) {
 			bassert(result->kind == MIR_TYPE_ARRAY);
+			insert_type_struct(ctx, struct_hash, MIR_TYPE_ARRAY, elem_type, len, result);
 			unlock_type_cache(ctx);
 			goto DONE;
 		}
@@ -2050,6 +2184,7 @@ struct mir_type *create_type_array(struct context *ctx, struct id *user_id, stru
 
 	if (can_use_cache) {
 		insert_type_into_cache(ctx, result, str_buf_view(name));
+		insert_type_struct(ctx, struct_hash, MIR_TYPE_ARRAY, elem_type, len, result);
 		result->can_use_cache = true;
 		unlock_type_cache(ctx);
 	}
@@ -2175,6 +2310,8 @@ static struct mir_type *complete_type_struct(struct context *ctx, complete_type_
 	incomplete_type->data.strct.is_union                = args->is_union;
 	incomplete_type->data.strct.is_multiple_return_type = args->is_multiple_return_type;
 	incomplete_type->data.strct.fwd_state               = MIR_TYPE_STRUCT_FWD_COMPLETE;
+	// Invalidate all memoized incomplete type checks.
+	++ctx->analyze->type_completion_epoch;
 
 #if TRACY_ENABLE
 	{
@@ -2193,8 +2330,18 @@ struct mir_type *create_type_slice(struct context *ctx, enum mir_type_kind kind,
 	struct mir_type *result;
 	struct mir_type *len_type = ctx->builtin_types->t_s64;
 
-	str_buf_t name          = get_tmp_str();
-	bool      can_use_cache = elem_ptr_type->can_use_cache;
+	const bool can_use_cache = elem_ptr_type->can_use_cache;
+	const u64  struct_hash   = type_struct_hash(kind, elem_ptr_type, 0);
+	if (can_use_cache) {
+		lock_type_cache(ctx);
+		result = lookup_type_struct(ctx, struct_hash, kind, elem_ptr_type, 0);
+		if (result) {
+			unlock_type_cache(ctx);
+			return result;
+		}
+	}
+
+	str_buf_t name = get_tmp_str();
 
 	switch (kind) {
 	case MIR_TYPE_SLICE:
@@ -2215,10 +2362,10 @@ struct mir_type *create_type_slice(struct context *ctx, enum mir_type_kind kind,
 	const hash_t hash = strhash(name);
 
 	if (can_use_cache) {
-		lock_type_cache(ctx);
 		result = lookup_type(ctx, hash, str_buf_view(name));
 		if (result) {
 			bassert(result->kind == kind);
+			insert_type_struct(ctx, struct_hash, kind, elem_ptr_type, 0, result);
 			unlock_type_cache(ctx);
 			goto DONE;
 		}
@@ -2255,6 +2402,7 @@ struct mir_type *create_type_slice(struct context *ctx, enum mir_type_kind kind,
 
 	if (can_use_cache) {
 		insert_type_into_cache(ctx, result, str_buf_view(name));
+		insert_type_struct(ctx, struct_hash, kind, elem_ptr_type, 0, result);
 		result->can_use_cache = true;
 		unlock_type_cache(ctx);
 	}
@@ -2273,13 +2421,22 @@ struct mir_type *create_type_struct_dynarr(struct context *ctx, enum mir_type_ki
 	struct mir_type *allocated_type = ctx->builtin_types->t_usize;
 	struct mir_type *allocator_type = ctx->builtin_types->t_u8_ptr;
 
-	bool      can_use_cache = elem_ptr_type->can_use_cache;
-	str_buf_t name          = get_tmp_str();
+	// 2025-02-15: String is just dynamic array with special semantics.
+	const bool can_use_cache = kind != MIR_TYPE_STRING && elem_ptr_type->can_use_cache;
+	const u64  struct_hash   = type_struct_hash(kind, elem_ptr_type, 0);
+	if (can_use_cache) {
+		lock_type_cache(ctx);
+		result = lookup_type_struct(ctx, struct_hash, kind, elem_ptr_type, 0);
+		if (result) {
+			unlock_type_cache(ctx);
+			return result;
+		}
+	}
+
+	str_buf_t name = get_tmp_str();
 
 	switch (kind) {
 	case MIR_TYPE_STRING:
-		// 2025-02-15: String is just dynamic array with special semantics.
-		can_use_cache = false;
 		str_buf_append(&name, user_id->str);
 		break;
 	case MIR_TYPE_DYNARR:
@@ -2291,10 +2448,10 @@ struct mir_type *create_type_struct_dynarr(struct context *ctx, enum mir_type_ki
 
 	const hash_t hash = strhash(name);
 	if (can_use_cache) {
-		lock_type_cache(ctx);
 		result = lookup_type(ctx, hash, str_buf_view(name));
 		if (result) {
 			bassert(result->kind == kind);
+			insert_type_struct(ctx, struct_hash, kind, elem_ptr_type, 0, result);
 			unlock_type_cache(ctx);
 			goto DONE;
 		}
@@ -2349,6 +2506,7 @@ struct mir_type *create_type_struct_dynarr(struct context *ctx, enum mir_type_ki
 
 	if (can_use_cache) {
 		insert_type_into_cache(ctx, result, str_buf_view(name));
+		insert_type_struct(ctx, struct_hash, kind, elem_ptr_type, 0, result);
 		result->can_use_cache = true;
 		unlock_type_cache(ctx);
 	}
@@ -2846,7 +3004,7 @@ static inline void report_unreachable_block(struct context *ctx, struct mir_inst
 	if (debug_replacement.len) {
 		builder_msg(MSG_WARN,
 		            0,
-		            block->entry_instr->node->location,
+		            ast_tmp_location(block->entry_instr->node),
 		            CARET_NONE,
 		            "Unreachable code detected in the function '" STR_FMT "' with polymorph replacement: " STR_FMT "",
 		            STR_ARG(fn_readable_name),
@@ -2855,7 +3013,7 @@ static inline void report_unreachable_block(struct context *ctx, struct mir_inst
 		builder_msg(
 		    MSG_WARN,
 		    0,
-		    block->entry_instr->node->location,
+		    ast_tmp_location(block->entry_instr->node),
 		    CARET_NONE,
 		    "Unreachable code detected in the function '" STR_FMT "'.",
 		    STR_ARG(fn_readable_name));
@@ -3044,14 +3202,21 @@ enum mir_cast_op get_cast_op(struct mir_type *from, struct mir_type *to) {
 #endif
 }
 
+static inline struct arena *get_instr_arena(struct mir_arenas *arenas, enum mir_instr_kind kind) {
+	bassert(kind > MIR_INSTR_INVALID && kind < static_arrlenu(instr_sizes));
+	const usize size  = instr_sizes[kind];
+	const usize index = size <= INSTR_SIZE_CLASS_BASE ? 0 : (size - INSTR_SIZE_CLASS_BASE + INSTR_SIZE_CLASS_STEP - 1) / INSTR_SIZE_CLASS_STEP;
+	bassert(index < MIR_INSTR_SIZE_CLASS_COUNT);
+	return &arenas->instr[index];
+}
+
 void *create_instr(struct context *ctx, enum mir_instr_kind kind, struct ast *node) {
-	static batomic_s64 _id_counter = 1;
+	static batomic_s32 _id_counter = 1;
 
-	struct mir_instr *tmp = arena_alloc(&ctx->mir_arenas->instr);
-	tmp->value.data       = (vm_stack_ptr_t)&tmp->value._tmp;
+	struct mir_instr *tmp = arena_alloc(get_instr_arena(ctx->mir_arenas, kind));
 	tmp->kind             = kind;
 	tmp->node             = node;
-	tmp->id               = batomic_fetch_add_s64(&_id_counter, 1);
+	tmp->id               = (u32)batomic_fetch_add_s32(&_id_counter, 1);
 	bmagic_set(tmp);
 	return tmp;
 }
@@ -3117,7 +3282,7 @@ struct mir_instr *create_instr_const_int(struct context *ctx, struct ast *node,
 	tmp->base.value.addr_mode   = MIR_VAM_RVALUE;
 	tmp->base.value.is_comptime = true;
 	tmp->volatile_type          = true;
-	MIR_CEV_WRITE_AS(u64, &tmp->base.value, val);
+	MIR_CEV_WRITE_AS(u64, ctx->assembly, &tmp->base.value, val);
 	return &tmp->base;
 }
 
@@ -3126,7 +3291,7 @@ struct mir_instr *create_instr_const_type(struct context *ctx, struct ast *node,
 	tmp->value.type        = ctx->builtin_types->t_type;
 	tmp->value.addr_mode   = MIR_VAM_RVALUE;
 	tmp->value.is_comptime = true;
-	MIR_CEV_WRITE_AS(struct mir_type *, &tmp->value, type);
+	MIR_CEV_WRITE_AS(struct mir_type *, ctx->assembly, &tmp->value, type);
 	return tmp;
 }
 
@@ -3135,7 +3300,7 @@ struct mir_instr *create_instr_const_float(struct context *ctx, struct ast *node
 	tmp->value.is_comptime = true;
 	tmp->value.type        = ctx->builtin_types->t_f32;
 	tmp->value.addr_mode   = MIR_VAM_RVALUE;
-	MIR_CEV_WRITE_AS(float, &tmp->value, val);
+	MIR_CEV_WRITE_AS(float, ctx->assembly, &tmp->value, val);
 	return tmp;
 }
 
@@ -3144,7 +3309,7 @@ struct mir_instr *create_instr_const_double(struct context *ctx, struct ast *nod
 	tmp->value.is_comptime = true;
 	tmp->value.type        = ctx->builtin_types->t_f64;
 	tmp->value.addr_mode   = MIR_VAM_RVALUE;
-	MIR_CEV_WRITE_AS(double, &tmp->value, val);
+	MIR_CEV_WRITE_AS(double, ctx->assembly, &tmp->value, val);
 	return tmp;
 }
 
@@ -3153,7 +3318,7 @@ struct mir_instr *create_instr_const_bool(struct context *ctx, struct ast *node,
 	tmp->value.type        = ctx->builtin_types->t_bool;
 	tmp->value.addr_mode   = MIR_VAM_RVALUE;
 	tmp->value.is_comptime = true;
-	MIR_CEV_WRITE_AS(bool, &tmp->value, val);
+	MIR_CEV_WRITE_AS(bool, ctx->assembly, &tmp->value, val);
 	return tmp;
 }
 
@@ -3171,7 +3336,7 @@ struct mir_instr *create_instr_const_ptr(struct context *ctx, struct ast *node,
 	tmp->value.is_comptime = true;
 	tmp->value.type        = type;
 	tmp->value.addr_mode   = MIR_VAM_LVALUE_CONST;
-	MIR_CEV_WRITE_AS(vm_stack_ptr_t, &tmp->value, ptr);
+	MIR_CEV_WRITE_AS(vm_stack_ptr_t, ctx->assembly, &tmp->value, ptr);
 	return tmp;
 }
 
@@ -3928,7 +4093,7 @@ inline struct mir_instr *append_instr_const_scope(struct context *ctx, struct as
 	tmp->value.type        = ctx->builtin_types->t_scope;
 	tmp->value.addr_mode   = MIR_VAM_RVALUE;
 	tmp->value.is_comptime = true;
-	MIR_CEV_WRITE_AS(struct scope *, &tmp->value, scope);
+	MIR_CEV_WRITE_AS(struct scope *, ctx->assembly, &tmp->value, scope);
 	append_current_block(ctx, tmp);
 	return tmp;
 }
@@ -3979,7 +4144,7 @@ inline struct mir_instr *append_instr_const_char(struct context *ctx, struct ast
 	tmp->value.is_comptime = true;
 	tmp->value.type        = ctx->builtin_types->t_u8;
 	tmp->value.addr_mode   = MIR_VAM_RVALUE;
-	MIR_CEV_WRITE_AS(char, &tmp->value, c);
+	MIR_CEV_WRITE_AS(char, ctx->assembly, &tmp->value, c);
 	append_current_block(ctx, tmp);
 	return tmp;
 }
@@ -3989,7 +4154,7 @@ inline struct mir_instr *append_instr_const_null(struct context *ctx, struct ast
 	tmp->value.is_comptime = true;
 	tmp->value.type        = create_type_null(ctx, ctx->builtin_types->t_u8_ptr);
 	tmp->value.addr_mode   = MIR_VAM_RVALUE;
-	MIR_CEV_WRITE_AS(void *, &tmp->value, NULL);
+	MIR_CEV_WRITE_AS(void *, ctx->assembly, &tmp->value, NULL);
 	append_current_block(ctx, tmp);
 	return tmp;
 }
@@ -3999,7 +4164,7 @@ inline struct mir_instr *append_instr_const_void(struct context *ctx, struct ast
 	tmp->value.is_comptime = true;
 	tmp->value.type        = ctx->builtin_types->t_void;
 	tmp->value.addr_mode   = MIR_VAM_RVALUE;
-	MIR_CEV_WRITE_AS(void *, &tmp->value, NULL);
+	MIR_CEV_WRITE_AS(void *, ctx->assembly, &tmp->value, NULL);
 	append_current_block(ctx, tmp);
 	return tmp;
 }
@@ -4233,6 +4398,8 @@ void erase_instr_tree(struct mir_instr *instr, bool keep_root, bool force) {
 
 		case MIR_INSTR_TYPE_DYNARR:
 		case MIR_INSTR_TYPE_SLICE:
+			break;
+
 		case MIR_INSTR_TYPE_STRUCT: {
 			struct mir_instr_type_struct *ts = (struct mir_instr_type_struct *)top;
 			for (usize i = 0; i < sarrlenu(ts->members); ++i) {
@@ -4428,9 +4595,9 @@ struct result analyze_instr_toany(struct context *ctx, struct mir_instr_to_any *
 		                                  });
 	}
 
-	// Generate RTTI for expression's type.
+	// RTTI for expression's type is generated lazily when the conversion is executed in compile
+	// time or emitted into the binary.
 	toany->rtti_type = rtti_type;
-	rtti_gen(ctx, rtti_type);
 
 	if (is_type) {
 		bassert(mir_is_comptime(expr));
@@ -4463,8 +4630,6 @@ struct result analyze_instr_toany(struct context *ctx, struct mir_instr_to_any *
 
 		bassert(rtti_data && "Missing specification type for RTTI generation!");
 		toany->rtti_data = rtti_data;
-
-		rtti_gen(ctx, rtti_data);
 		erase_instr_tree(expr, false, true);
 	}
 
@@ -5247,7 +5412,7 @@ struct result analyze_instr_member_ptr(struct context *ctx, struct mir_instr_mem
 		struct scope *scope = scope_entry->data.scope;
 		bmagic_assert(scope);
 		struct id   *rid         = &ast_member_ident->data.ident.id;
-		struct unit *parent_unit = ast_member_ident->location->unit;
+		struct unit *parent_unit = ast_member_ident->unit;
 		bassert(rid);
 		bassert(parent_unit);
 		struct mir_instr_decl_ref *decl_ref = (struct mir_instr_decl_ref *)mutate_instr(&member_ptr->base, MIR_INSTR_DECL_REF);
@@ -5277,7 +5442,7 @@ struct result analyze_instr_member_ptr(struct context *ctx, struct mir_instr_mem
 		bassert(scope->kind == SCOPE_MODULE);
 
 		struct id   *rid         = &ast_member_ident->data.ident.id;
-		struct unit *parent_unit = ast_member_ident->location->unit;
+		struct unit *parent_unit = ast_member_ident->unit;
 		bassert(rid);
 		bassert(parent_unit);
 
@@ -5311,7 +5476,7 @@ struct result analyze_instr_member_ptr(struct context *ctx, struct mir_instr_mem
 			len->base.value.is_comptime = true;
 			len->base.value.type        = ctx->builtin_types->t_s64;
 			target_addr_mode            = MIR_VAM_RVALUE;
-			MIR_CEV_WRITE_AS(s64, &len->base.value, target_type->data.array.len);
+			MIR_CEV_WRITE_AS(s64, ctx->assembly, &len->base.value, target_type->data.array.len);
 		} else if (member_ptr->builtin_id == BUILTIN_ID_ARR_PTR || is_builtin(ast_member_ident, BUILTIN_ID_ARR_PTR)) {
 			// @Incomplete <2022-06-21 Tue> I don't remember why we need both checks here.
 			// .ptr -> This will be replaced by:
@@ -5391,7 +5556,7 @@ struct result analyze_instr_member_ptr(struct context *ctx, struct mir_instr_mem
 				len->base.value.type        = ctx->builtin_types->t_type;
 				len->base.value.addr_mode   = target_addr_mode;
 				len->base.value.is_comptime = true;
-				MIR_CEV_WRITE_AS(struct mir_type *, &len->base.value, ctx->builtin_types->t_s64);
+				MIR_CEV_WRITE_AS(struct mir_type *, ctx->assembly, &len->base.value, ctx->builtin_types->t_s64);
 				return_zone(PASS);
 			} else if (member_ptr->builtin_id == BUILTIN_ID_ARR_PTR || is_builtin(ast_member_ident, BUILTIN_ID_ARR_PTR)) {
 				// @Incomplete 2022-06-21: I don't remember why we need both checks here.
@@ -5404,7 +5569,7 @@ struct result analyze_instr_member_ptr(struct context *ctx, struct mir_instr_mem
 				len->base.value.addr_mode      = target_addr_mode;
 				len->base.value.is_comptime    = true;
 				struct mir_type *elem_ptr_type = create_type_ptr(ctx, sub_type->data.array.elem_type);
-				MIR_CEV_WRITE_AS(struct mir_type *, &len->base.value, elem_ptr_type);
+				MIR_CEV_WRITE_AS(struct mir_type *, ctx->assembly, &len->base.value, elem_ptr_type);
 				return_zone(PASS);
 			} else {
 				report_error(INVALID_MEMBER_ACCESS, ast_member_ident, "Unknown member.");
@@ -5421,7 +5586,7 @@ struct result analyze_instr_member_ptr(struct context *ctx, struct mir_instr_mem
 			member_ptr->base.value.is_comptime = true;
 
 			// @Cleanup: This should be inside evaluator
-			MIR_CEV_WRITE_AS(struct mir_type *, &member_ptr->base.value, sub_type);
+			MIR_CEV_WRITE_AS(struct mir_type *, ctx->assembly, &member_ptr->base.value, sub_type);
 			return_zone(PASS);
 		} else if (mir_is_composite_type(sub_type)) {
 			struct scope       *scope       = sub_type->data.strct.scope;
@@ -5448,7 +5613,7 @@ struct result analyze_instr_member_ptr(struct context *ctx, struct mir_instr_mem
 			member_ptr->base.value.type        = ctx->builtin_types->t_type;
 
 			// @Cleanup: This should be inside evaluator
-			MIR_CEV_WRITE_AS(struct mir_type *, &member_ptr->base.value, found->data.member->type);
+			MIR_CEV_WRITE_AS(struct mir_type *, ctx->assembly, &member_ptr->base.value, found->data.member->type);
 			return_zone(PASS);
 		}
 	}
@@ -5591,7 +5756,7 @@ struct result analyze_instr_addrof(struct context *ctx, struct mir_instr_addrof
 		}
 
 		// @Note: Here we increase function ref count.
-		++fn->ref_count;
+		ref_fn(ctx, fn);
 		type = create_type_ptr(ctx, type);
 	}
 
@@ -5691,7 +5856,7 @@ struct result analyze_instr_sizeof(struct context *ctx, struct mir_instr_sizeof
 	// tree generated to get this expression
 	unref_instr(szof->expr);
 	erase_instr_tree(szof->expr, false, false);
-	MIR_CEV_WRITE_AS(u64, &szof->base.value, bytes);
+	MIR_CEV_WRITE_AS(u64, ctx->assembly, &szof->base.value, bytes);
 	return_zone(PASS);
 }
 
@@ -5717,7 +5882,7 @@ struct result analyze_instr_alignof(struct context *ctx, struct mir_instr_aligno
 		bmagic_assert(type);
 	}
 
-	MIR_CEV_WRITE_AS(s32, &alof->base.value, (s32)type->alignment);
+	MIR_CEV_WRITE_AS(s32, ctx->assembly, &alof->base.value, (s32)type->alignment);
 	return_zone(PASS);
 }
 
@@ -5786,7 +5951,7 @@ struct result analyze_instr_type_info(struct context *ctx, struct mir_instr_type
 		report_error(INVALID_TYPE, type_info->expr->node, "No type info available for polymorph function recipe.");
 		return_zone(FAIL);
 	}
-	rtti_gen(ctx, type_info->rtti_type);
+	// RTTI is generated when the instruction is evaluated.
 	type_info->base.value.type = ctx->builtin_types->t_TypeInfo_ptr;
 
 	erase_instr_tree(type_info->expr, false, true);
@@ -5873,7 +6038,7 @@ struct result analyze_instr_decl_ref(struct context *ctx, struct mir_instr_decl_
 		// struct type definition with tag defined after. Struct type is resolved in separate block so, we get to
 		// tag definition even when structure type is not complete yet. This might lead to breaking rules of
 		// definition flow in local scopes.
-		if (found->node->location->line > ref->base.node->location->line) {
+		if (ast_tmp_location(found->node)->line > ast_tmp_location(ref->base.node)->line) {
 			str_t sym_name = ref->rid->str;
 			report_error(UNKNOWN_SYMBOL, ref->base.node, "Symbol '" STR_FMT "' is used before it is declared.", STR_ARG(sym_name));
 			report_note(found->node, "Symbol declaration found here.");
@@ -5905,7 +6070,7 @@ struct result analyze_instr_decl_ref(struct context *ctx, struct mir_instr_decl_
 		// problem open, basically it's not an issue to have invalid function
 		// reference count, main goal is not to have zero ref count for function
 		// which are used.
-		++fn->ref_count;
+		ref_fn(ctx, fn);
 
 		const bool is_in_group = ref->scope->kind == SCOPE_FN_GROUP;
 
@@ -6026,14 +6191,14 @@ struct result analyze_instr_decl_direct_ref(struct context *ctx, struct mir_inst
 		struct mir_fn *fn = MIR_CEV_READ_AS(struct mir_fn *, &ref->ref->value);
 		bmagic_assert(fn);
 		bassert(fn->type && fn->type == ref->ref->value.type);
-		++fn->ref_count;
+		ref_fn(ctx, fn);
 
 		struct mir_instr_const *replacement = (struct mir_instr_const *)mutate_instr(&ref->base, MIR_INSTR_CONST);
 		replacement->volatile_type          = false;
-		replacement->base.value.data        = (vm_stack_ptr_t)&ref->base.value._tmp;
+		replacement->base.value.data        = NULL;
 
 		replacement->base.value.type = fn->type;
-		MIR_CEV_WRITE_AS(struct mir_fn *, &replacement->base.value, fn);
+		MIR_CEV_WRITE_AS(struct mir_fn *, ctx->assembly, &replacement->base.value, fn);
 	}
 	return_zone(PASS);
 }
@@ -6075,7 +6240,7 @@ struct result analyze_instr_unreachable(struct context *ctx, struct mir_instr_un
 	zone();
 	struct mir_fn *abort_fn = lookup_builtin_fn(ctx, BUILTIN_ID_ABORT_FN);
 	if (!abort_fn) return_zone(POSTPONE);
-	++abort_fn->ref_count;
+	ref_fn(ctx, abort_fn);
 	unr->abort_fn = abort_fn;
 	return_zone(PASS);
 }
@@ -6084,7 +6249,7 @@ struct result analyze_instr_debugbreak(struct context *ctx, struct mir_instr_deb
 	zone();
 	struct mir_fn *break_fn = lookup_builtin_fn(ctx, BUILTIN_ID_OS_DEBUG_BREAK_FN);
 	if (!break_fn) return_zone(POSTPONE);
-	++break_fn->ref_count;
+	ref_fn(ctx, break_fn);
 	debug_break->break_fn = break_fn;
 	return_zone(PASS);
 }
@@ -6099,6 +6264,66 @@ struct result analyze_instr_test_cases(struct context *ctx, struct mir_instr_tes
 	return_zone(PASS);
 }
 
+// Generate MIR of function body skipped by the parser (lazy parsing).
+static bool generate_lazy_fn_body(struct context *ctx, struct mir_fn *fn) {
+	struct ast *lit_fn = fn->lazy_lit_fn;
+	fn->lazy_lit_fn    = NULL;
+
+	const s32 prev_errorc = builder.errorc;
+	parser_parse_fn_body(ctx->assembly, lit_fn);
+	if (builder.errorc != prev_errorc) return false;
+
+	ast_push_defer_stack(ctx);
+	struct mir_instr_block *prev_block = ast_current_block(ctx);
+	ast_fn_body(ctx, fn, lit_fn);
+	set_current_block(ctx, prev_block);
+	ast_pop_defer_stack(ctx);
+	return builder.errorc == prev_errorc;
+}
+
+// Function body analysis might be deferred until the function is referenced for the first time.
+// This is done for lazy parsed functions and in reachable only mode for all functions declared in
+// some scope (except the roots).
+static bool is_fn_body_deferred(struct context *ctx, struct mir_fn *fn) {
+	if (fn->ref_count != 0) return false;
+	const u32 root_flags = FLAG_ENTRY | FLAG_BUILD_ENTRY | FLAG_EXPORT | FLAG_TEST_FN;
+	if (fn->flags & root_flags) return false;
+	if (fn == ctx->assembly->vm_run.entry) return false;
+	if (fn->lazy_lit_fn) return true;
+	return builder.options->reachable_only && fn->scope_entry;
+}
+
+static void schedule_fn_body(struct context *ctx, struct mir_fn *fn) {
+	if (fn->ret_tmp) {
+		bassert(fn->ret_tmp->kind == MIR_INSTR_DECL_VAR);
+		((struct mir_instr_decl_var *)fn->ret_tmp)->var->value.type = fn->type->data.fn.ret_type;
+	}
+	analyze_schedule(ctx, &fn->first_block->base);
+	// Count only declared and generated functions, not implicit type resolvers or initializers.
+	if (fn->scope_entry || fn->generated.first_call_node) {
+		batomic_fetch_add_s32(&ctx->assembly->stats.analyzed_fn_count, 1);
+	}
+}
+
+static inline struct unit *get_fn_unit(struct mir_fn *fn) {
+	return fn->decl_node ? fn->decl_node->unit : NULL;
+}
+
+static void resume_fn_body(struct context *ctx, struct mir_fn *fn) {
+	bassert(fn->is_body_deferred);
+	fn->is_body_deferred = false;
+	batomic_fetch_add_s32(&ctx->assembly->stats.deferred_fn_count, -1);
+	struct unit *unit = get_fn_unit(fn);
+	if (unit) --unit->deferred_fn_body_count;
+	if (fn->lazy_lit_fn && !generate_lazy_fn_body(ctx, fn)) return;
+	schedule_fn_body(ctx, fn);
+}
+
+void ref_fn(struct context *ctx, struct mir_fn *fn) {
+	++fn->ref_count;
+	if (fn->is_body_deferred) resume_fn_body(ctx, fn);
+}
+
 struct result analyze_instr_fn_proto(struct context *ctx, struct mir_instr_fn_proto *fn_proto) {
 	zone();
 	// resolve type
@@ -6253,17 +6478,28 @@ struct result analyze_instr_fn_proto(struct context *ctx, struct mir_instr_fn_pr
 	} else if (fn->generated_flavor) {
 		// Nothing to do, function is just a recipe.
 		bassert(fn->generation_recipe && "Missing generation recipe.");
+	} else if (is_fn_body_deferred(ctx, fn)) {
+		// Body is not analyzed until the function is used (see ref_fn).
+		fn->is_body_deferred = true;
+		if (fn->body_scope) {
+			struct deferred_fn_entry entry = {.hash = fn->body_scope, .fn = fn};
+			tbl_insert(ctx->analyze->deferred_fns, entry);
+		}
+		batomic_fetch_add_s32(&ctx->assembly->stats.deferred_fn_count, 1);
+		struct unit *unit = get_fn_unit(fn);
+		if (unit) ++unit->deferred_fn_body_count;
 	} else {
+		if (fn->lazy_lit_fn && !generate_lazy_fn_body(ctx, fn)) return_zone(FAIL);
+
 		// Add entry block of the function into analyze queue.
-		struct mir_instr *entry_block = (struct mir_instr *)fn->first_block;
-		if (!entry_block) {
+		if (!fn->first_block) {
 			// INCOMPLETE: not the best place to do this check, move into struct ast
 			// generation later
 			report_error(EXPECTED_BODY, fn_proto->base.node, "Missing function body.");
 			return_zone(FAIL);
 		}
 
-		analyze_schedule(ctx, entry_block);
+		schedule_fn_body(ctx, fn);
 	}
 
 	bool schedule_llvm_generation = false;
@@ -6375,7 +6611,7 @@ struct result analyze_instr_fn_group(struct context *ctx, struct mir_instr_fn_gr
 		sarrpeek(variant_types, i)     = fn->type;
 		sarrpeek(&validation_queue, i) = fn;
 		if (variant->kind == MIR_INSTR_FN_PROTO) {
-			++fn->ref_count;
+			ref_fn(ctx, fn);
 		}
 	}
 	// Validate group.
@@ -6392,7 +6628,7 @@ struct result analyze_instr_fn_group(struct context *ctx, struct mir_instr_fn_gr
 		prev_fn = it;
 	}
 	group->base.value.type = create_type_fn_group(ctx, NULL, variant_types);
-	MIR_CEV_WRITE_AS(struct mir_fn_group *, &group->base.value, create_fn_group(ctx, group->base.node, variant_fns));
+	MIR_CEV_WRITE_AS(struct mir_fn_group *, ctx->assembly, &group->base.value, create_fn_group(ctx, group->base.node, variant_fns));
 FINALLY:
 	sarrfree(&validation_queue);
 	return_zone(result);
@@ -6736,7 +6972,7 @@ struct result analyze_instr_type_fn(struct context *ctx, struct mir_instr_type_f
 	                                                  .is_polymorph     = is_polymorph,
 	                                              });
 
-	MIR_CEV_WRITE_AS(struct mir_type *, &type_fn->base.value, result_type);
+	MIR_CEV_WRITE_AS(struct mir_type *, ctx->assembly, &type_fn->base.value, result_type);
 	return_zone(PASS);
 }
 
@@ -6770,7 +7006,7 @@ struct result analyze_instr_type_fn_group(struct context *ctx, struct mir_instr_
 		}
 		sarrpeek(variant_types, i) = variant_type;
 	}
-	MIR_CEV_WRITE_AS(struct mir_type *, &group->base.value, create_type_fn_group(ctx, NULL, variant_types));
+	MIR_CEV_WRITE_AS(struct mir_type *, ctx->assembly, &group->base.value, create_type_fn_group(ctx, NULL, variant_types));
 	return_zone(PASS);
 }
 
@@ -7062,7 +7298,7 @@ struct result analyze_instr_type_struct(struct context *ctx, struct mir_instr_ty
 	}
 
 	bassert(result_type);
-	MIR_CEV_WRITE_AS(struct mir_type *, &type_struct->base.value, result_type);
+	MIR_CEV_WRITE_AS(struct mir_type *, ctx->assembly, &type_struct->base.value, result_type);
 	return_zone(PASS);
 }
 
@@ -7080,7 +7316,7 @@ struct result analyze_instr_type_slice(struct context *ctx, struct mir_instr_typ
 	}
 
 	if (mir_is_placeholder(type_slice->elem_type)) {
-		MIR_CEV_WRITE_AS(struct mir_type *, &type_slice->base.value, ctx->builtin_types->t_placeholer);
+		MIR_CEV_WRITE_AS(struct mir_type *, ctx->assembly, &type_slice->base.value, ctx->builtin_types->t_placeholer);
 		return_zone(PASS);
 	}
 
@@ -7100,7 +7336,7 @@ struct result analyze_instr_type_slice(struct context *ctx, struct mir_instr_typ
 
 	elem_type = create_type_ptr(ctx, elem_type);
 
-	MIR_CEV_WRITE_AS(struct mir_type *, &type_slice->base.value, create_type_slice(ctx, MIR_TYPE_SLICE, user_id, elem_type, false));
+	MIR_CEV_WRITE_AS(struct mir_type *, ctx->assembly, &type_slice->base.value, create_type_slice(ctx, MIR_TYPE_SLICE, user_id, elem_type, false));
 
 	return_zone(PASS);
 }
@@ -7125,7 +7361,7 @@ struct result analyze_instr_type_dynarr(struct context *ctx, struct mir_instr_ty
 	}
 
 	if (mir_is_placeholder(type_dynarr->elem_type)) {
-		MIR_CEV_WRITE_AS(struct mir_type *, &type_dynarr->base.value, ctx->builtin_types->t_placeholer);
+		MIR_CEV_WRITE_AS(struct mir_type *, ctx->assembly, &type_dynarr->base.value, ctx->builtin_types->t_placeholer);
 		return_zone(PASS);
 	}
 
@@ -7148,7 +7384,7 @@ struct result analyze_instr_type_dynarr(struct context *ctx, struct mir_instr_ty
 
 	elem_type = create_type_ptr(ctx, elem_type);
 
-	MIR_CEV_WRITE_AS(struct mir_type *, &type_dynarr->base.value, create_type_struct_dynarr(ctx, MIR_TYPE_DYNARR, user_id, elem_type));
+	MIR_CEV_WRITE_AS(struct mir_type *, ctx->assembly, &type_dynarr->base.value, create_type_struct_dynarr(ctx, MIR_TYPE_DYNARR, user_id, elem_type));
 
 	return_zone(PASS);
 }
@@ -7176,7 +7412,7 @@ struct result analyze_instr_type_vargs(struct context *ctx, struct mir_instr_typ
 	}
 	bassert(elem_type);
 	elem_type = create_type_ptr(ctx, elem_type);
-	MIR_CEV_WRITE_AS(struct mir_type *, &type_vargs->base.value, create_type_slice(ctx, MIR_TYPE_VARGS, NULL, elem_type, false));
+	MIR_CEV_WRITE_AS(struct mir_type *, ctx->assembly, &type_vargs->base.value, create_type_slice(ctx, MIR_TYPE_VARGS, NULL, elem_type, false));
 
 	return_zone(PASS);
 }
@@ -7201,7 +7437,7 @@ struct result analyze_instr_type_array(struct context *ctx, struct mir_instr_typ
 	}
 
 	if (mir_is_placeholder(type_arr->elem_type)) {
-		MIR_CEV_WRITE_AS(struct mir_type *, &type_arr->base.value, ctx->builtin_types->t_placeholer);
+		MIR_CEV_WRITE_AS(struct mir_type *, ctx->assembly, &type_arr->base.value, ctx->builtin_types->t_placeholer);
 		return_zone(PASS);
 	}
 
@@ -7228,7 +7464,7 @@ struct result analyze_instr_type_array(struct context *ctx, struct mir_instr_typ
 		return_zone(FAIL);
 	}
 
-	MIR_CEV_WRITE_AS(struct mir_type *, &type_arr->base.value, create_type_array(ctx, type_arr->id, elem_type, len));
+	MIR_CEV_WRITE_AS(struct mir_type *, ctx->assembly, &type_arr->base.value, create_type_array(ctx, type_arr->id, elem_type, len));
 	return_zone(PASS);
 }
 
@@ -7281,7 +7517,7 @@ struct result analyze_instr_type_enum(struct context *ctx, struct mir_instr_type
 	                                             .is_flags  = is_flags,
 	                                         });
 
-	MIR_CEV_WRITE_AS(struct mir_type *, &type_enum->base.value, type);
+	MIR_CEV_WRITE_AS(struct mir_type *, ctx->assembly, &type_enum->base.value, type);
 	return_zone(PASS);
 }
 
@@ -7317,7 +7553,7 @@ struct result analyze_instr_type_ptr(struct context *ctx, struct mir_instr_type_
 		return_zone(FAIL);
 	}
 
-	MIR_CEV_WRITE_AS(struct mir_type *, &type_ptr->base.value, create_type_ptr(ctx, src_type_value));
+	MIR_CEV_WRITE_AS(struct mir_type *, ctx->assembly, &type_ptr->base.value, create_type_ptr(ctx, src_type_value));
 	return_zone(PASS);
 }
 
@@ -7441,7 +7677,7 @@ struct result analyze_instr_call_loc(struct context *ctx, struct mir_instr_call_
 	struct mir_type *dest_internal_type = mir_get_struct_elem_type(type, 4);
 	vm_stack_ptr_t   dest_internal      = vm_get_struct_elem_ptr(ctx->assembly, type, dest, 4);
 
-	struct location *call_location = loc->call_node->location;
+	struct location *call_location = ast_tmp_location(loc->call_node);
 
 	const str_t          filepath = call_location->unit->filepath;
 	const struct mir_fn *owner_fn = mir_instr_owner_fn(&loc->base);
@@ -8007,7 +8243,7 @@ static inline struct mir_instr *replace_default_argument_placeholder(struct cont
 		// Original InstrCallLoc is used only as note that we must generate real one
 		// containing information about call instruction location.
 		bassert(call->base.node);
-		bassert(call->base.node->location);
+		bassert(call->base.node->unit);
 		struct ast *orig_node = fn_arg->default_value->node;
 		call_default_arg      = create_instr_call_loc(ctx, orig_node, call->base.node);
 	} else {
@@ -8030,7 +8266,7 @@ static inline struct mir_instr *insert_default_argument_call_value(struct contex
 		// Original InstrCallLoc is used only as note that we must generate real one
 		// containing information about call instruction location.
 		bassert(call->base.node);
-		bassert(call->base.node->location);
+		bassert(call->base.node->unit);
 		struct ast *orig_node = default_value->node;
 		call_default_arg      = ref_instr(create_instr_call_loc(ctx, orig_node, call->base.node));
 	} else {
@@ -8225,6 +8461,38 @@ struct result analyze_call_stage_resolve_overload(struct context *ctx, struct mi
 	return_zone(PASS);
 }
 
+// Mixed functions are generated for each call by default, however the generated function depends
+// only on values of compile-time known arguments (and polymorph replacement types); calls with the
+// same values can share one implementation. This function builds a key identifying such an
+// implementation. We use only complete scalar values and types, false is returned in case some
+// of the compile-time arguments cannot be used.
+static bool get_comptime_instance_key(struct mir_instr_call *call, const struct mir_type *recipe_fn_type, hash_t replacement_hash, str_buf_t *key) {
+	str_buf_append(key, make_str(&replacement_hash, sizeof(replacement_hash)));
+	for (usize index = 0; index < sarrlenu(recipe_fn_type->data.fn.args); ++index) {
+		struct mir_arg *recipe_fn_arg = sarrpeek(recipe_fn_type->data.fn.args, index);
+		if (isnotflag(recipe_fn_arg->flags, FLAG_COMPTIME)) continue;
+		struct mir_instr *call_arg_instr = sarrpeekor(call->args, index, NULL);
+		if (!call_arg_instr || call_arg_instr->state != MIR_IS_COMPLETE) return false;
+		if (!mir_is_comptime(call_arg_instr) || is_load_needed(call_arg_instr) || !call_arg_instr->value.data) return false;
+		struct mir_type *type = call_arg_instr->value.type;
+		switch (type->kind) {
+		case MIR_TYPE_INT:
+		case MIR_TYPE_REAL:
+		case MIR_TYPE_BOOL:
+		case MIR_TYPE_ENUM:
+		case MIR_TYPE_TYPE:
+			break;
+		default:
+			return false;
+		}
+		const u32 i = (u32)index;
+		str_buf_append(key, make_str(&i, sizeof(i)));
+		str_buf_append(key, make_str(&type, sizeof(type)));
+		str_buf_append(key, make_str(call_arg_instr->value.data, type->store_size_bytes));
+	}
+	return true;
+}
+
 struct result analyze_call_stage_generate(struct context *ctx, struct mir_instr_call *call) {
 	zone();
 	bcalled_once_assert(call, generate);
@@ -8246,6 +8514,7 @@ struct result analyze_call_stage_generate(struct context *ctx, struct mir_instr_
 	bassert(recipe);
 
 	str_buf_t debug_replacement_str = get_tmp_str();
+	str_buf_t comptime_key          = get_tmp_str();
 
 	const bool is_polymorph = isflag(recipe_fn->generated_flavor, MIR_FN_GENERATED_POLY);
 	if (is_polymorph) {
@@ -8347,7 +8616,22 @@ struct result analyze_call_stage_generate(struct context *ctx, struct mir_instr_
 	}
 #endif
 
-	const s32 index = replacement_hash ? tbl_lookup_index(recipe->entries, replacement_hash) : -1;
+	s32 index = -1;
+
+	hash_t     comptime_key_hash = 0;
+	const bool is_mixed          = isflag(recipe_fn->generated_flavor, MIR_FN_GENERATED_MIXED);
+	const bool has_comptime_key  = is_mixed && get_comptime_instance_key(call, recipe_fn->type, replacement_hash, &comptime_key);
+	if (has_comptime_key) {
+		comptime_key_hash = strhash(comptime_key);
+		index             = tbl_lookup_index_with_key(recipe->comptime_entries, comptime_key_hash, str_buf_view(comptime_key));
+		if (index != -1) {
+			replacement_fn = recipe->comptime_entries[index].replacement;
+			batomic_fetch_add_s32(&ctx->assembly->stats.mixed_fn_reused_count, 1);
+		}
+	} else if (!is_mixed && replacement_hash) {
+		index = tbl_lookup_index(recipe->entries, replacement_hash);
+		if (index != -1) replacement_fn = recipe->entries[index].replacement;
+	}
 
 	if (index == -1) {
 		// Prepare global state for the function generation.
@@ -8367,7 +8651,10 @@ struct result analyze_call_stage_generate(struct context *ctx, struct mir_instr_
 
 		const s32 prev_errorc = builder.errorc;
 		// Generate new function.
+		builder_trace_begin("Polymorph generation", original_fn_name);
 		struct mir_instr *instr_fn_proto = ast_expr_lit_fn(ctx, recipe->ast_lit_fn, recipe_fn->decl_node, unique_name(ctx, original_fn_name), recipe_fn->is_global, recipe_fn->flags, BUILTIN_ID_NONE);
+		builder_trace_end();
+		if (builder.options->time_report) ++recipe_fn->report.polymorph_count;
 
 		// Handle invalid AST generation.
 		// @Incomplete: Use FATAL analyze state!!!!
@@ -8393,7 +8680,15 @@ struct result analyze_call_stage_generate(struct context *ctx, struct mir_instr_
 		// Restore previous state.
 		memset(&ctx->fn_generate, 0, sizeof(ctx->fn_generate));
 
-		if (replacement_hash != 0) {
+		if (has_comptime_key) {
+			// Mixed function can be reused by other calls with the same compile-time arguments.
+			struct recipe_comptime_entry entry = {
+			    .hash        = comptime_key_hash,
+			    .key         = scdup2(ctx->string_cache, comptime_key),
+			    .replacement = replacement_fn,
+			};
+			tbl_insert(recipe->comptime_entries, entry);
+		} else if (!is_mixed && replacement_hash != 0) {
 			// Function can be identified by hash (calculated from arguments) so we can reuse the
 			// same implementation later!
 			struct recipe_entry entry = (struct recipe_entry){.hash = replacement_hash, .replacement = replacement_fn};
@@ -8401,12 +8696,11 @@ struct result analyze_call_stage_generate(struct context *ctx, struct mir_instr_
 		}
 
 		batomic_fetch_add_s32(&ctx->assembly->stats.polymorph_count, 1);
-	} else {
-		replacement_fn = recipe->entries[index].replacement;
 	}
 
 DONE:
 	reset_poly_replacement_queue(ctx);
+	put_tmp_str(comptime_key);
 	put_tmp_str(debug_replacement_str);
 	batomic_fetch_add_s32(&ctx->assembly->stats.polymorph_ms, runtime_measure_end(generated));
 
@@ -8538,7 +8832,7 @@ struct result analyze_call_stage_finalize(struct context *ctx, struct mir_instr_
 	if (call->callee->kind == MIR_INSTR_FN_PROTO) {
 		bmagic_assert(call->called_function);
 		// Direct call of anonymous function.
-		++call->called_function->ref_count;
+		ref_fn(ctx, call->called_function);
 	}
 
 	struct mir_type *fn_type = get_called_function_type(call);
@@ -8640,6 +8934,12 @@ struct result analyze_call_stage_finalize(struct context *ctx, struct mir_instr_
 			// function is generated and we cannot analyze call arguments while the function is not
 			// generated yet, and we also want be able to use compile-time known arguments as values
 			// in the function signature.
+			//
+			// In case the called function was generated for another call with the same compile-time
+			// arguments, the function does not analyze our arguments, so we do it here.
+			if (fn_arg->generation_call && fn_arg->generation_call != call) {
+				if (analyze_call_slot(ctx, call, fn_arg).state != ANALYZE_PASSED) return_zone(FAIL);
+			}
 			continue;
 		}
 
@@ -8977,7 +9277,7 @@ enum stage_state analyze_stage_set_volatile_expr(struct context *ctx, struct mir
 	struct mir_const_expr_value *value = &(*input)->value;
 	vm_value_t                   tmp   = {0};
 	vm_do_cast((vm_stack_ptr_t)&tmp[0], value->data, slot_type, value->type, op);
-	memcpy(&value->_tmp[0], &tmp[0], sizeof(vm_value_t));
+	memcpy(mir_cev_storage(ctx->assembly, value), &tmp[0], sizeof(vm_value_t));
 	(*input)->value.type = slot_type;
 	return ANALYZE_STAGE_BREAK;
 }
@@ -9071,7 +9371,7 @@ struct result analyze_instr(struct context *ctx, struct mir_instr *instr) {
 	bassert((*analyze_state) != MIR_IS_ERASED && "Attempt to analyze already erased instruction?!");
 
 	if ((*analyze_state) == MIR_IS_PENDING) {
-		BL_TRACY_MESSAGE("ANALYZE", "[%llu] %s", instr->id, mir_instr_name(instr));
+		BL_TRACY_MESSAGE("ANALYZE", "[%u] %s", instr->id, mir_instr_name(instr));
 
 		switch (instr->kind) {
 		case MIR_INSTR_VARGS:
@@ -9277,6 +9577,8 @@ struct result analyze_instr(struct context *ctx, struct mir_instr *instr) {
 			state = POSTPONE;
 			break;
 		case VM_INTERP_PASSED: {
+			// Compile-time values not written by the evaluation are expected to be zero.
+			if (instr->value.is_comptime) mir_cev_storage(ctx->assembly, &instr->value);
 			(*analyze_state) = MIR_IS_COMPLETE;
 			break;
 		}
@@ -9296,7 +9598,7 @@ struct result analyze_instr(struct context *ctx, struct mir_instr *instr) {
 	return_zone(state);
 }
 
-static inline struct mir_instr *analyze_try_get_next(struct mir_instr *instr) {
+static inline struct mir_instr *analyze_try_get_next(struct context *ctx, struct mir_instr *instr) {
 	if (!instr) return NULL;
 	if (instr->kind == MIR_INSTR_BLOCK) {
 		struct mir_instr_block *block = (struct mir_instr_block *)instr;
@@ -9309,8 +9611,11 @@ static inline struct mir_instr *analyze_try_get_next(struct mir_instr *instr) {
 		if (owner_block->base.next == NULL && owner_block->owner_fn) {
 			// Instruction is last instruction of the function body, so the
 			// function can be executed in compile time if needed, we need to
-			// set flag with this information here.
-			owner_block->owner_fn->is_fully_analyzed = true;
+			// set flag with this information here. The function body is optimized
+			// before it's executed.
+			struct mir_fn *fn = owner_block->owner_fn;
+			if (!fn->is_fully_analyzed) arrput(ctx->opt_queue, fn);
+			fn->is_fully_analyzed = true;
 		}
 		// Return following block.
 		return owner_block->base.next;
@@ -9318,6 +9623,28 @@ static inline struct mir_instr *analyze_try_get_next(struct mir_instr *instr) {
 	return instr->next;
 }
 
+// Nested functions are analyzed independently of the parent function body, so they might wait for
+// some local symbol declared in the body of deferred parent function (i.e. local type used in
+// the nested function signature). In such a case we have to resume analysis of the parent body.
+static void analyze_resume_required_bodies(struct context *ctx, struct mir_instr *waiting_instr) {
+	if (!tbl_len(ctx->analyze->deferred_fns) || waiting_instr->kind != MIR_INSTR_DECL_REF) return;
+	for (struct scope *scope = ((struct mir_instr_decl_ref *)waiting_instr)->scope; scope; scope = scope->parent) {
+		if (scope->kind != SCOPE_FN_BODY) continue;
+		const s32 index = tbl_lookup_index(ctx->analyze->deferred_fns, scope);
+		if (index == -1) continue;
+		struct mir_fn *fn = ctx->analyze->deferred_fns[index].fn;
+		if (fn->is_body_deferred) resume_fn_body(ctx, fn);
+	}
+}
+
+// Function the instruction analyze time is attributed to in the time report; NULL for global
+// instructions.
+static inline struct mir_fn *get_report_fn(struct mir_instr *instr) {
+	if (instr->owner_block) return instr->owner_block->owner_fn;
+	if (instr->kind == MIR_INSTR_FN_PROTO) return MIR_CEV_READ_AS(struct mir_fn *, &instr->value);
+	return NULL;
+}
+
 void analyze(struct context *ctx) {
 	zone();
 	bcheck_main_thread();
@@ -9325,13 +9652,15 @@ void analyze(struct context *ctx) {
 	struct result     result;
 	usize             pc = 0, i = 0, si = analyze_swap(ctx);
 	struct mir_instr *ip = NULL, *pip = NULL;
-	bool              skip = false;
+	bool              skip        = false;
+	const bool        time_report = builder.options->time_report;
 
 	while (true) {
 		pip = ip;
-		ip  = skip ? NULL : analyze_try_get_next(ip);
+		ip  = skip ? NULL : analyze_try_get_next(ctx, ip);
 		// Remove unused instructions here!
 		if (pip && (pip->state == MIR_IS_COMPLETE) && pip->ref_count == 0) erase_instr_tree(pip, false, false);
+		if (arrlenu(ctx->opt_queue)) optimize_completed_fns(ctx);
 		if (ip == NULL) {
 			if (i >= arrlenu(ctx->analyze->stack[si])) {
 				// No other instructions in current analyzed stack, let's try the other one.
@@ -9344,7 +9673,17 @@ void analyze(struct context *ctx) {
 			skip = false;
 		}
 		bmagic_assert(ip);
-		result = analyze_instr(ctx, ip);
+		if (time_report) {
+			const f64 start_ms = get_tick_ms();
+			result             = analyze_instr(ctx, ip);
+			struct mir_fn *fn  = get_report_fn(ip);
+			if (fn) {
+				fn->report.analyze_ms += get_tick_ms() - start_ms;
+				if (result.state == ANALYZE_POSTPONE || result.state == ANALYZE_WAIT) ++fn->report.postpone_count;
+			}
+		} else {
+			result = analyze_instr(ctx, ip);
+		}
 
 		switch (result.state) {
 		case ANALYZE_PASSED:
@@ -9367,6 +9706,7 @@ void analyze(struct context *ctx) {
 			break;
 
 		case ANALYZE_WAIT: {
+			analyze_resume_required_bodies(ctx, ip);
 			instrs_t    *wq;
 			const hash_t hash  = result.waiting_for;
 			s32          index = tbl_lookup_index(ctx->analyze->waiting, hash);
@@ -9473,7 +9813,7 @@ void analyze_report_unresolved(struct context *ctx) {
 				break;
 			}
 			default:
-				blog("Waiting instruction: %%%llu %s", instr->id, mir_instr_name(instr));
+				blog("Waiting instruction: %%%u %s", instr->id, mir_instr_name(instr));
 				continue;
 			}
 
@@ -9492,14 +9832,32 @@ void analyze_report_unresolved(struct context *ctx) {
 	}
 }
 
+// Symbols declared inside the body of function never analyzed (i.e. nested functions) are not
+// checked for usage.
+static bool is_in_deferred_fn_body(struct context *ctx, struct scope *scope) {
+	if (!tbl_len(ctx->analyze->deferred_fns)) return false;
+	for (; scope; scope = scope->parent) {
+		if (scope->kind != SCOPE_FN_BODY) continue;
+		const s32 index = tbl_lookup_index(ctx->analyze->deferred_fns, scope);
+		if (index != -1 && ctx->analyze->deferred_fns[index].fn->is_body_deferred) return true;
+	}
+	return false;
+}
+
 void analyze_report_unused(struct context *ctx) {
 	for (usize i = 0; i < arrlenu(ctx->analyze->usage_check_arr); ++i) {
 		struct scope_entry *entry = ctx->analyze->usage_check_arr[i];
 		if (entry->ref_count > 0) continue;
 		if (!entry->node || !entry->id) continue;
-		bassert(entry->node->location);
+		bassert(entry->node->unit);
 		const str_t name = entry->id->str;
 
+		// Private global symbol might be used only in function bodies of the same unit never parsed
+		// or analyzed.
+		const struct unit *unit = entry->node->unit;
+		if (unit && unit->deferred_fn_body_count && !scope_is_subtree_of_kind(entry->parent_scope, SCOPE_FN)) continue;
+		if (is_in_deferred_fn_body(ctx, entry->parent_scope)) continue;
+
 		switch (entry->node->owner_scope->kind) {
 		case SCOPE_GLOBAL:
 		case SCOPE_PRIVATE: {
@@ -9525,133 +9883,1456 @@ void analyze_report_skipped(struct context *ctx) {
 	}
 }
 
-struct mir_var *testing_gen_meta(struct context *ctx) {
-	const s32 len = ctx->assembly->testing.expected_test_count;
-	if (len == 0) return NULL;
-	if (ctx->assembly->testing.meta_var) return ctx->assembly->testing.meta_var;
-	struct mir_type *type = create_type_array(ctx, NULL, ctx->builtin_types->t_TestCase, len);
-	struct mir_var  *var  = create_var_impl(ctx,
-                                          &(create_var_impl_args_t){
-	                                            .name        = IMPL_TESTCASES_TMP,
-	                                            .alloc_type  = type,
-	                                            .is_global   = true,
-	                                            .is_comptime = true,
-                                          });
-	vm_alloc_global(ctx->vm, ctx->assembly, var);
-	ctx->assembly->testing.meta_var = var;
-	return var;
-}
+// =================================================================================================
+// Optimization passes
+// =================================================================================================
 
-inline void testing_add_test_case(struct context *ctx, struct mir_fn *fn) {
-	struct mir_var *var = testing_gen_meta(ctx);
-	bassert(var);
-	bassert(var->value.data);
+// Optional passes executed on the control flow graph of each function as soon as its body is fully
+// analyzed, so both the compile-time execution and all backends use the simplified function body.
+// Functions are never touched again by analyze after this point. Calls of functions completed
+// later are inlined by one more run of the inlining pass done after analyze.
 
-	arrput(ctx->assembly->testing.cases, fn);
-	const usize i = arrlenu(ctx->assembly->testing.cases) - 1;
+struct opt_block_entry {
+	struct mir_instr_block *hash;
+	s32                     pred_count; // Count of terminals breaking into the block.
+	bool                    is_reachable;
+	bool                    is_phi_income; // Block is used as incoming block of some phi.
+};
 
-	vm_stack_ptr_t   var_ptr  = vm_read_var(ctx->vm, var);
-	struct mir_type *var_type = var->value.type;
-	bassert(var_type->kind == MIR_TYPE_ARRAY);
-	struct mir_type *elem_type = var_type->data.array.elem_type;
-	const ptrdiff_t  offset    = vm_get_array_elem_offset(var_type, (u32)i);
+// Usage of local variable declared in the function.
+struct opt_var_entry {
+	struct mir_var            *hash;
+	struct mir_instr_decl_var *decl;
+	s32                        load_count;
+	s32                        store_count;
+	bool                       is_escaped; // Variable address is used other way than by load or store.
+};
 
-	struct mir_type *func_type = mir_get_struct_elem_type(elem_type, 0);
-	struct mir_type *name_type = mir_get_struct_elem_type(elem_type, 1);
-	struct mir_type *file_type = mir_get_struct_elem_type(elem_type, 2);
-	struct mir_type *line_type = mir_get_struct_elem_type(elem_type, 3);
+struct opt_clone_entry {
+	struct mir_instr *hash;
+	struct mir_instr *clone;
+};
 
-	vm_stack_ptr_t func_ptr = vm_get_struct_elem_ptr(ctx->assembly, elem_type, var_ptr + offset, 0);
-	vm_stack_ptr_t name_ptr = vm_get_struct_elem_ptr(ctx->assembly, elem_type, var_ptr + offset, 1);
-	vm_stack_ptr_t file_ptr = vm_get_struct_elem_ptr(ctx->assembly, elem_type, var_ptr + offset, 2);
-	vm_stack_ptr_t line_ptr = vm_get_struct_elem_ptr(ctx->assembly, elem_type, var_ptr + offset, 3);
+struct opt_var_clone_entry {
+	struct mir_var   *hash;
+	struct mir_instr *decl;
+};
 
-	bassert(fn->id);
+struct opt_store_entry {
+	struct mir_var   *hash;
+	struct mir_instr *store; // Last store or declaration with initializer not followed by load.
+};
 
-	const str_t filename = fn->decl_node ? fn->decl_node->location->unit->filename : cstr("UNKNOWN");
-	const s32   line     = fn->decl_node ? fn->decl_node->location->line : 0;
+typedef sarr_t(struct mir_instr_block **, 16) opt_block_slots_t;
+typedef sarr_t(struct mir_instr **, 16) opt_operand_slots_t;
+
+struct opt_context {
+	struct context  *ctx;
+	struct assembly *assembly;
+	struct mir_fn   *fn;
+	hash_table(struct opt_block_entry) blocks;
+	hash_table(struct opt_var_entry) vars;
+	hash_table(struct opt_clone_entry) clones;
+	hash_table(struct opt_var_clone_entry) var_clones;
+	hash_table(struct opt_store_entry) stores;
+	array(struct mir_instr_block *) stack;
+	array(struct mir_instr_call *) calls;
+	array(bool) used_args;
+	opt_block_slots_t   slots;
+	opt_operand_slots_t operands;
+};
 
-	vm_write_ptr(func_type, func_ptr, (vm_stack_ptr_t)fn);
-	vm_write_string(ctx->vm, name_type, name_ptr, fn->id->str);
-	vm_write_string(ctx->vm, file_type, file_ptr, filename);
-	vm_write_int(line_type, line_ptr, line);
+// Maximum count of empty blocks skipped by one jump threading.
+#define OPT_MAX_THREADING_HOPS 8
+// Maximum count of instructions in body of inlined function.
+#define OPT_MAX_INLINE_INSTRS 32
+// Maximum count of instructions inlined into one function by one run of the inlining pass.
+#define OPT_MAX_INLINE_GROWTH 512
+
+
+static inline bool opt_is_block_removable(struct mir_fn *fn, struct mir_instr_block *block) {
+	return block != fn->first_block && block != fn->exit_block && !block->is_unreachable;
 }
 
-// Top-level rtti generation.
-inline struct mir_var *rtti_gen(struct context *ctx, struct mir_type *type) {
-	struct mir_var *tmp     = _rtti_gen(ctx, type);
-	mir_rttis_t    *pending = &ctx->analyze->incomplete_rtti;
-	while (sarrlenu(pending)) {
-		struct mir_rtti_incomplete incomplete = sarrpop(pending);
-		rtti_satisfy_incomplete(ctx, &incomplete);
+static inline bool opt_has_phi(struct mir_instr_block *block) {
+	for (struct mir_instr *instr = block->entry_instr; instr; instr = instr->next) {
+		if (instr->kind == MIR_INSTR_PHI) return true;
 	}
-	sarrclear(pending);
-	return tmp;
+	return false;
 }
 
-void rtti_satisfy_incomplete(struct context *ctx, struct mir_rtti_incomplete *incomplete) {
-	struct mir_type *type     = incomplete->type;
-	struct mir_var  *rtti_var = incomplete->var;
-
-	bassert(type->kind == MIR_TYPE_PTR);
-	rtti_gen_ptr(ctx, type, rtti_var);
+// Block containing only direct break into other block.
+static inline bool opt_is_forwarding_block(struct mir_fn *fn, struct mir_instr_block *block) {
+	return opt_is_block_removable(fn, block) && block->entry_instr == block->terminal && block->terminal->kind == MIR_INSTR_BR;
 }
 
-struct mir_var *get_rtti_no_lock(struct assembly *assembly, hash_t type_hash) {
-	bassert(type_hash);
-	const s32 i = tbl_lookup_index(assembly->mir.rtti_table, type_hash);
-	if (i < 0) return NULL;
-	struct mir_var *result = assembly->mir.rtti_table[i].value;
-	bassert(result);
-	return result;
+static inline struct opt_block_entry *opt_lookup_block(struct opt_context *octx, struct mir_instr_block *block) {
+	const s32 index = tbl_lookup_index(octx->blocks, block);
+	return index != -1 ? &octx->blocks[index] : NULL;
 }
 
-struct mir_var *_rtti_gen(struct context *ctx, struct mir_type *type) {
-	bassert(type);
-	struct mir_var *rtti_var = mir_get_rtti(ctx->assembly, type->id.hash);
-	if (rtti_var) return rtti_var;
-
-	switch (type->kind) {
-	case MIR_TYPE_INT:
-		rtti_var = rtti_gen_integer(ctx, type);
+// Collect all successor block slots of the block terminal instruction.
+static void opt_get_successor_slots(struct mir_instr_block *block, opt_block_slots_t *slots) {
+	sarrclear(slots);
+	struct mir_instr *terminal = block->terminal;
+	switch (terminal->kind) {
+	case MIR_INSTR_BR:
+		sarrput(slots, &((struct mir_instr_br *)terminal)->then_block);
 		break;
-
-	case MIR_TYPE_ENUM:
-		rtti_var = rtti_gen_enum(ctx, type);
+	case MIR_INSTR_COND_BR: {
+		struct mir_instr_cond_br *br = (struct mir_instr_cond_br *)terminal;
+		sarrput(slots, &br->then_block);
+		sarrput(slots, &br->else_block);
 		break;
-
-	case MIR_TYPE_REAL:
-		rtti_var = rtti_gen_real(ctx, type);
+	}
+	case MIR_INSTR_SWITCH: {
+		struct mir_instr_switch *sw = (struct mir_instr_switch *)terminal;
+		for (usize i = 0; i < sarrlenu(sw->cases); ++i) {
+			sarrput(slots, &sarrpeek(sw->cases, i).block);
+		}
+		sarrput(slots, &sw->default_block);
 		break;
-
-	case MIR_TYPE_BOOL:
-		rtti_var = rtti_gen_empty(ctx, type, ctx->builtin_types->t_TypeInfoBool);
+	}
+	default:
 		break;
+	}
+}
 
-	case MIR_TYPE_TYPE:
-		rtti_var = rtti_gen_empty(ctx, type, ctx->builtin_types->t_TypeInfoType);
-		break;
+static void opt_unlink_block(struct mir_fn *fn, struct mir_instr_block *block) {
+	struct mir_instr *prev = block->base.prev;
+	struct mir_instr *next = block->base.next;
+	if (prev) prev->next = next;
+	if (next) next->prev = prev;
+	if (fn->last_block == block) fn->last_block = (struct mir_instr_block *)prev;
+	block->base.prev  = NULL;
+	block->base.next  = NULL;
+	block->base.state = MIR_IS_ERASED;
+}
 
-	case MIR_TYPE_VOID:
-		rtti_var = rtti_gen_empty(ctx, type, ctx->builtin_types->t_TypeInfoVoid);
-		break;
+static inline bool opt_is_fn_supported(struct mir_fn *fn) {
+	if (!fn->is_fully_analyzed || !fn->first_block || fn->generation_recipe) return false;
+	if (isflag(fn->flags, FLAG_EXTERN) || isflag(fn->flags, FLAG_INTRINSIC)) return false;
+	for (struct mir_instr *it = &fn->first_block->base; it; it = it->next) {
+		if (!((struct mir_instr_block *)it)->terminal) return false;
+	}
+	return true;
+}
 
-	case MIR_TYPE_NULL:
-		rtti_var = rtti_gen_empty(ctx, type, ctx->builtin_types->t_TypeInfoNull);
+// Collect all value operand slots of the instruction; type operands are not included and optional
+// operands might be NULL. Compile-time known instructions are not executed, so their operands are
+// not reported. Returns false in case the instruction kind is not supported by the passes.
+static bool opt_get_operand_slots(struct mir_instr *instr, opt_operand_slots_t *slots) {
+	sarrclear(slots);
+	if (mir_is_comptime(instr)) return true;
+	switch (instr->kind) {
+	case MIR_INSTR_CONST:
+	case MIR_INSTR_DECL_REF:
+	case MIR_INSTR_ARG:
+	case MIR_INSTR_BR:
+	case MIR_INSTR_UNREACHABLE:
+	case MIR_INSTR_DEBUGBREAK:
+	case MIR_INSTR_CALL_LOC:
 		break;
-
-	case MIR_TYPE_STRING:
-		rtti_var = rtti_gen_empty(ctx, type, ctx->builtin_types->t_TypeInfoString);
+	case MIR_INSTR_DECL_VAR:
+		sarrput(slots, &((struct mir_instr_decl_var *)instr)->init);
 		break;
-
-	case MIR_TYPE_PTR:
-		// We generate dummy pointer RTTI when incomplete is enabled and complete
-		// this in second pass to prove endless looping.
-		rtti_var = rtti_gen_ptr(ctx, ctx->builtin_types->t_u8_ptr, NULL);
-		sarrput(&ctx->analyze->incomplete_rtti, ((struct mir_rtti_incomplete){.var = rtti_var, .type = type}));
+	case MIR_INSTR_DECL_DIRECT_REF:
+		sarrput(slots, &((struct mir_instr_decl_direct_ref *)instr)->ref);
 		break;
-
-	case MIR_TYPE_ARRAY:
+	case MIR_INSTR_LOAD:
+		sarrput(slots, &((struct mir_instr_load *)instr)->src);
+		break;
+	case MIR_INSTR_STORE: {
+		struct mir_instr_store *store = (struct mir_instr_store *)instr;
+		sarrput(slots, &store->src);
+		sarrput(slots, &store->dest);
+		break;
+	}
+	case MIR_INSTR_ADDROF:
+		sarrput(slots, &((struct mir_instr_addrof *)instr)->src);
+		break;
+	case MIR_INSTR_BINOP: {
+		struct mir_instr_binop *binop = (struct mir_instr_binop *)instr;
+		sarrput(slots, &binop->lhs);
+		sarrput(slots, &binop->rhs);
+		break;
+	}
+	case MIR_INSTR_UNOP:
+		sarrput(slots, &((struct mir_instr_unop *)instr)->expr);
+		break;
+	case MIR_INSTR_CAST:
+		sarrput(slots, &((struct mir_instr_cast *)instr)->expr);
+		break;
+	case MIR_INSTR_MEMBER_PTR:
+		sarrput(slots, &((struct mir_instr_member_ptr *)instr)->target_ptr);
+		break;
+	case MIR_INSTR_ELEM_PTR: {
+		struct mir_instr_elem_ptr *elem_ptr = (struct mir_instr_elem_ptr *)instr;
+		sarrput(slots, &elem_ptr->arr_ptr);
+		sarrput(slots, &elem_ptr->index);
+		break;
+	}
+	case MIR_INSTR_CALL: {
+		struct mir_instr_call *call = (struct mir_instr_call *)instr;
+		sarrput(slots, &call->callee);
+		for (usize i = 0; i < sarrlenu(call->args); ++i) {
+			sarrput(slots, &sarrpeek(call->args, i));
+		}
+		break;
+	}
+	case MIR_INSTR_COND_BR:
+		sarrput(slots, &((struct mir_instr_cond_br *)instr)->cond);
+		break;
+	case MIR_INSTR_SWITCH: {
+		struct mir_instr_switch *sw = (struct mir_instr_switch *)instr;
+		sarrput(slots, &sw->value);
+		for (usize i = 0; i < sarrlenu(sw->cases); ++i) {
+			sarrput(slots, &sarrpeek(sw->cases, i).on_value);
+		}
+		break;
+	}
+	case MIR_INSTR_RET:
+		sarrput(slots, &((struct mir_instr_ret *)instr)->value);
+		break;
+	case MIR_INSTR_PHI: {
+		struct mir_instr_phi *phi = (struct mir_instr_phi *)instr;
+		for (s32 i = 0; i < phi->num; ++i) {
+			sarrput(slots, &phi->incoming_values[i]);
+		}
+		break;
+	}
+	case MIR_INSTR_COMPOUND: {
+		struct mir_instr_compound *cmp = (struct mir_instr_compound *)instr;
+		for (usize i = 0; i < sarrlenu(cmp->values); ++i) {
+			sarrput(slots, &sarrpeek(cmp->values, i));
+		}
+		break;
+	}
+	case MIR_INSTR_VARGS: {
+		struct mir_instr_vargs *vargs = (struct mir_instr_vargs *)instr;
+		for (usize i = 0; i < sarrlenu(vargs->values); ++i) {
+			sarrput(slots, &sarrpeek(vargs->values, i));
+		}
+		break;
+	}
+	case MIR_INSTR_TOANY:
+		sarrput(slots, &((struct mir_instr_to_any *)instr)->expr);
+		break;
+	case MIR_INSTR_UNROLL: {
+		struct mir_instr_unroll *unroll = (struct mir_instr_unroll *)instr;
+		sarrput(slots, &unroll->src);
+		sarrput(slots, &unroll->prev);
+		break;
+	}
+	default:
+		return false;
+	}
+	return true;
+}
+
+// Returns local runtime variable referenced by the instruction or NULL.
+static struct mir_var *opt_get_local_var(struct mir_instr *instr) {
+	struct mir_var *var = NULL;
+	switch (instr->kind) {
+	case MIR_INSTR_DECL_REF: {
+		struct scope_entry *entry = ((struct mir_instr_decl_ref *)instr)->scope_entry;
+		if (entry && entry->kind == SCOPE_ENTRY_VAR) var = entry->data.var;
+		break;
+	}
+	case MIR_INSTR_DECL_DIRECT_REF: {
+		struct mir_instr *ref = ((struct mir_instr_decl_direct_ref *)instr)->ref;
+		if (ref->kind == MIR_INSTR_DECL_VAR) var = ((struct mir_instr_decl_var *)ref)->var;
+		break;
+	}
+	case MIR_INSTR_DECL_VAR:
+		var = ((struct mir_instr_decl_var *)instr)->var;
+		break;
+	default:
+		break;
+	}
+	if (!var || isflag(var->iflags, MIR_VAR_GLOBAL) || var->value.is_comptime) return NULL;
+	return var;
+}
+
+static inline struct opt_var_entry *opt_lookup_var(struct opt_context *octx, struct mir_var *var) {
+	if (!var) return NULL;
+	const s32 index = tbl_lookup_index(octx->vars, var);
+	return index != -1 ? &octx->vars[index] : NULL;
+}
+
+static inline void opt_mark_escaped(struct opt_context *octx, struct mir_var *var) {
+	struct opt_var_entry *entry = opt_lookup_var(octx, var);
+	if (entry) entry->is_escaped = true;
+}
+
+// Collect usage of all local variables declared in the function. Returns false in case the function
+// contains instructions not supported by the passes.
+static bool opt_scan_vars(struct opt_context *octx) {
+	struct mir_fn *fn = octx->fn;
+	tbl_clear(octx->vars);
+	for (struct mir_instr *it = &fn->first_block->base; it; it = it->next) {
+		struct mir_instr_block *block = (struct mir_instr_block *)it;
+		for (struct mir_instr *instr = block->entry_instr; instr; instr = instr->next) {
+			if (instr->kind != MIR_INSTR_DECL_VAR) continue;
+			struct mir_var *var = opt_get_local_var(instr);
+			if (!var || opt_lookup_var(octx, var)) continue;
+			struct opt_var_entry entry = {.hash = var, .decl = (struct mir_instr_decl_var *)instr};
+			tbl_insert(octx->vars, entry);
+		}
+	}
+
+	for (struct mir_instr *it = &fn->first_block->base; it; it = it->next) {
+		struct mir_instr_block *block = (struct mir_instr_block *)it;
+		for (struct mir_instr *instr = block->entry_instr; instr; instr = instr->next) {
+			if (!opt_get_operand_slots(instr, &octx->operands)) return false;
+			// Direct reference to the declaration is classified by its user.
+			if (instr->kind == MIR_INSTR_DECL_DIRECT_REF) continue;
+			for (usize i = 0; i < sarrlenu(&octx->operands); ++i) {
+				struct mir_instr **slot    = sarrpeek(&octx->operands, i);
+				struct mir_instr  *operand = *slot;
+				if (!operand) continue;
+				struct opt_var_entry *entry = opt_lookup_var(octx, opt_get_local_var(operand));
+				if (!entry) continue;
+				if (operand->kind == MIR_INSTR_DECL_VAR) {
+					entry->is_escaped = true;
+				} else if (instr->kind == MIR_INSTR_LOAD) {
+					++entry->load_count;
+				} else if (instr->kind == MIR_INSTR_STORE && slot == &((struct mir_instr_store *)instr)->dest) {
+					++entry->store_count;
+				} else {
+					entry->is_escaped = true;
+				}
+			}
+
+			// Implicit temporary variables used directly by the instruction.
+			switch (instr->kind) {
+			case MIR_INSTR_CALL: {
+				struct mir_instr *tmp = ((struct mir_instr_call *)instr)->tmp_var;
+				if (tmp && tmp->kind == MIR_INSTR_DECL_VAR) opt_mark_escaped(octx, ((struct mir_instr_decl_var *)tmp)->var);
+				break;
+			}
+			case MIR_INSTR_COMPOUND:
+				opt_mark_escaped(octx, ((struct mir_instr_compound *)instr)->tmp_var);
+				break;
+			case MIR_INSTR_VARGS:
+				opt_mark_escaped(octx, ((struct mir_instr_vargs *)instr)->arr_tmp);
+				opt_mark_escaped(octx, ((struct mir_instr_vargs *)instr)->vargs_tmp);
+				break;
+			case MIR_INSTR_TOANY:
+				opt_mark_escaped(octx, ((struct mir_instr_to_any *)instr)->tmp);
+				opt_mark_escaped(octx, ((struct mir_instr_to_any *)instr)->expr_tmp);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+	return true;
+}
+
+// Variable is never changed after its declaration with initializer.
+static inline bool opt_is_assigned_once(struct opt_var_entry *entry) {
+	return entry && !entry->is_escaped && entry->store_count == 0 && entry->decl->init && isnotflag(entry->hash->iflags, MIR_VAR_RET_TMP);
+}
+
+// Returns true in case the value can be removed together with its only user without side effects;
+// compile-time known values and values used by other instructions are kept.
+static bool opt_is_erasable(struct mir_instr *instr) {
+	if (!instr) return true;
+	if (instr->ref_count != 1) return mir_is_comptime(instr);
+	switch (instr->kind) {
+	case MIR_INSTR_CONST:
+	case MIR_INSTR_ARG:
+	case MIR_INSTR_DECL_REF:
+	case MIR_INSTR_DECL_DIRECT_REF:
+	case MIR_INSTR_SIZEOF:
+	case MIR_INSTR_ALIGNOF:
+	case MIR_INSTR_TYPE_INFO:
+	case MIR_INSTR_CALL_LOC:
+		return true;
+	case MIR_INSTR_LOAD:
+		return opt_is_erasable(((struct mir_instr_load *)instr)->src);
+	case MIR_INSTR_ADDROF:
+		return opt_is_erasable(((struct mir_instr_addrof *)instr)->src);
+	case MIR_INSTR_UNOP:
+		return opt_is_erasable(((struct mir_instr_unop *)instr)->expr);
+	case MIR_INSTR_CAST:
+		return opt_is_erasable(((struct mir_instr_cast *)instr)->expr);
+	case MIR_INSTR_MEMBER_PTR:
+		return opt_is_erasable(((struct mir_instr_member_ptr *)instr)->target_ptr);
+	case MIR_INSTR_BINOP: {
+		struct mir_instr_binop *binop = (struct mir_instr_binop *)instr;
+		return opt_is_erasable(binop->lhs) && opt_is_erasable(binop->rhs);
+	}
+	case MIR_INSTR_ELEM_PTR: {
+		struct mir_instr_elem_ptr *elem_ptr = (struct mir_instr_elem_ptr *)instr;
+		return opt_is_erasable(elem_ptr->arr_ptr) && opt_is_erasable(elem_ptr->index);
+	}
+	case MIR_INSTR_COMPOUND: {
+		struct mir_instr_compound *cmp = (struct mir_instr_compound *)instr;
+		for (usize i = 0; i < sarrlenu(cmp->values); ++i) {
+			if (!opt_is_erasable(sarrpeek(cmp->values, i))) return false;
+		}
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+static inline void opt_erase_value(struct mir_instr *instr) {
+	if (unref_instr(instr)->ref_count == 0) erase_instr_tree(instr, false, false);
+}
+
+static inline bool opt_is_simple_type(const struct mir_type *type) {
+	switch (type->kind) {
+	case MIR_TYPE_INT:
+	case MIR_TYPE_REAL:
+	case MIR_TYPE_BOOL:
+	case MIR_TYPE_ENUM:
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Loads of local variables assigned only by their declaration initializer are replaced by the
+// compile-time known initializer value or redirected into the variable the initializer is copied
+// from.
+static void opt_propagate_copies(struct opt_context *octx) {
+	if (!opt_scan_vars(octx)) return;
+	struct mir_fn *fn = octx->fn;
+	for (struct mir_instr *it = &fn->first_block->base; it; it = it->next) {
+		struct mir_instr_block *block = (struct mir_instr_block *)it;
+		for (struct mir_instr *instr = block->entry_instr; instr; instr = instr->next) {
+			if (instr->kind != MIR_INSTR_LOAD || mir_is_comptime(instr)) continue;
+			struct mir_instr_load *load  = (struct mir_instr_load *)instr;
+			struct mir_instr      *src   = load->src;
+			struct opt_var_entry  *entry = opt_lookup_var(octx, opt_get_local_var(src));
+			if (!opt_is_assigned_once(entry) || src->ref_count != 1) continue;
+			struct mir_var   *var  = entry->hash;
+			struct mir_instr *init = entry->decl->init;
+
+			if (mir_is_comptime(init)) {
+				if (!opt_is_simple_type(var->value.type) || init->value.type != load->base.value.type) continue;
+				struct mir_instr_const *cnst = mutate_instr(&load->base, MIR_INSTR_CONST);
+				cnst->base.value             = init->value;
+				cnst->volatile_type          = false;
+				opt_erase_value(src);
+			} else if (init->kind == MIR_INSTR_LOAD && !mir_is_comptime(init)) {
+				struct opt_var_entry *copied_entry = opt_lookup_var(octx, opt_get_local_var(((struct mir_instr_load *)init)->src));
+				if (!opt_is_assigned_once(copied_entry) || copied_entry->hash->value.type != var->value.type) continue;
+				if (src->kind == MIR_INSTR_DECL_DIRECT_REF) unref_instr(((struct mir_instr_decl_direct_ref *)src)->ref);
+				struct mir_instr_decl_direct_ref *ref = mutate_instr(src, MIR_INSTR_DECL_DIRECT_REF);
+				ref->ref                              = ref_instr(&copied_entry->decl->base);
+				++copied_entry->hash->ref_count;
+				++copied_entry->load_count;
+				--entry->load_count;
+			} else {
+				continue;
+			}
+			batomic_fetch_add_s32(&octx->assembly->stats.mir_opt_propagated_count, 1);
+		}
+	}
+}
+
+// Binary, unary and cast instructions with all operands compile-time known are evaluated and
+// replaced by constants.
+static void opt_fold_constants(struct opt_context *octx) {
+	struct context *ctx = octx->ctx;
+	struct mir_fn  *fn  = octx->fn;
+	for (struct mir_instr *it = &fn->first_block->base; it; it = it->next) {
+		struct mir_instr_block *block = (struct mir_instr_block *)it;
+		for (struct mir_instr *instr = block->entry_instr; instr; instr = instr->next) {
+			if (mir_is_comptime(instr) || !opt_is_simple_type(instr->value.type)) continue;
+			if (instr->kind != MIR_INSTR_BINOP && instr->kind != MIR_INSTR_UNOP && instr->kind != MIR_INSTR_CAST) continue;
+			opt_get_operand_slots(instr, &octx->operands);
+			bool is_foldable = true;
+			for (usize i = 0; i < sarrlenu(&octx->operands) && is_foldable; ++i) {
+				struct mir_instr *operand = *sarrpeek(&octx->operands, i);
+				is_foldable = mir_is_comptime(operand) && opt_is_simple_type(operand->value.type);
+			}
+			if (!is_foldable) continue;
+
+			if (instr->kind == MIR_INSTR_BINOP) {
+				// Keep operations failing in runtime as they are.
+				struct mir_instr_binop *binop    = (struct mir_instr_binop *)instr;
+				struct mir_type        *lhs_type = binop->lhs->value.type;
+				struct mir_type        *rhs_type = binop->rhs->value.type;
+				if (lhs_type->kind == MIR_TYPE_INT && rhs_type->kind == MIR_TYPE_INT) {
+					const s32 bitcount = lhs_type->data.integer.bitcount;
+					const u64 mask     = bitcount < 64 ? (1ull << bitcount) - 1 : (u64)-1;
+					const u64 lhs      = vm_read_int(lhs_type, binop->lhs->value.data) & mask;
+					const u64 rhs      = vm_read_int(rhs_type, binop->rhs->value.data);
+					if (binop->op == BINOP_DIV || binop->op == BINOP_MOD) {
+						if (rhs == 0) continue;
+						// Signed minimum divided by -1 overflows.
+						const bool is_min = lhs == 1ull << (bitcount - 1);
+						if (lhs_type->data.integer.is_signed && is_min && (rhs & mask) == mask) continue;
+					}
+					if ((binop->op == BINOP_SHL || binop->op == BINOP_SHR) && rhs >= (u64)bitcount) continue;
+				}
+			}
+
+			instr->value.is_comptime = true;
+			instr->value.data        = NULL;
+			const bool is_evaluated  = vm_eval_instr(ctx->vm, ctx->assembly, instr);
+			bassert(is_evaluated);
+			(void)is_evaluated;
+			for (usize i = 0; i < sarrlenu(&octx->operands); ++i) {
+				opt_erase_value(*sarrpeek(&octx->operands, i));
+			}
+			const bool              is_volatile = is_instr_type_volatile(instr);
+			struct mir_instr_const *cnst        = mutate_instr(instr, MIR_INSTR_CONST);
+			cnst->volatile_type                 = is_volatile;
+			batomic_fetch_add_s32(&octx->assembly->stats.mir_opt_const_folded_count, 1);
+		}
+	}
+}
+
+static inline struct mir_instr *opt_lookup_clone(struct opt_context *octx, struct mir_instr *instr) {
+	const s32 index = tbl_lookup_index(octx->clones, instr);
+	return index != -1 ? octx->clones[index].clone : NULL;
+}
+
+static inline bool opt_is_type_instr(struct mir_instr *instr) {
+	return mir_is_comptime(instr) && instr->value.type && instr->value.type->kind == MIR_TYPE_TYPE;
+}
+
+// Returns true in case the callee body can be inlined. All instructions and blocks to be cloned are
+// collected in the clone table, arguments used by the body are marked in the used arguments array.
+static bool opt_can_inline(struct opt_context *octx, struct mir_fn *callee, s32 *out_instr_count) {
+	if (callee == octx->fn || !opt_is_fn_supported(callee)) return false;
+	if (isflag(callee->flags, FLAG_NO_INLINE) || callee->generated_flavor == MIR_FN_GENERATED_MIXED) return false;
+	if (callee->type->data.fn.is_vargs) return false;
+
+	// Exit block is expected to contain only load of the return value followed by return.
+	struct mir_instr_block *exit_block = callee->exit_block;
+	struct mir_instr       *terminal   = &callee->terminal_instr->base;
+	if (!exit_block || !terminal || exit_block->terminal != terminal || terminal->kind != MIR_INSTR_RET) return false;
+	struct mir_instr *ret_value = ((struct mir_instr_ret *)terminal)->value;
+	if (ret_value) {
+		if (ret_value->kind != MIR_INSTR_LOAD || ret_value->next != terminal) return false;
+		struct mir_instr *ref = ((struct mir_instr_load *)ret_value)->src;
+		if (ref->kind != MIR_INSTR_DECL_DIRECT_REF || ((struct mir_instr_decl_direct_ref *)ref)->ref != callee->ret_tmp) return false;
+		if (exit_block->entry_instr != ref || ref->next != ret_value) return false;
+	} else if (exit_block->entry_instr != terminal) {
+		return false;
+	}
+
+	const usize fn_arg_count = sarrlenu(callee->type->data.fn.args);
+	arrsetlen(octx->used_args, fn_arg_count);
+	for (usize i = 0; i < fn_arg_count; ++i) {
+		octx->used_args[i] = false;
+	}
+
+	tbl_clear(octx->clones);
+	s32  count          = 0;
+	s32  arg_count      = 0;
+	s32  arg_decl_count = 0;
+	bool is_args_prefix = true; // Arguments are read only at the beginning of the entry block.
+	s32  last_arg       = -1;
+	for (struct mir_instr *it = &callee->first_block->base; it; it = it->next) {
+		struct mir_instr_block *block       = (struct mir_instr_block *)it;
+		struct opt_clone_entry  block_entry = {.hash = it};
+		tbl_insert(octx->clones, block_entry);
+		if (block == exit_block) continue;
+		for (struct mir_instr *instr = block->entry_instr; instr; instr = instr->next) {
+			if (opt_is_type_instr(instr)) continue;
+			if (++count > OPT_MAX_INLINE_INSTRS) return false;
+			bool is_arg_read = false;
+			switch (instr->kind) {
+			case MIR_INSTR_CONST:
+			case MIR_INSTR_LOAD:
+			case MIR_INSTR_STORE:
+			case MIR_INSTR_BINOP:
+			case MIR_INSTR_UNOP:
+			case MIR_INSTR_CAST:
+			case MIR_INSTR_ADDROF:
+			case MIR_INSTR_MEMBER_PTR:
+			case MIR_INSTR_ELEM_PTR:
+			case MIR_INSTR_BR:
+			case MIR_INSTR_SWITCH:
+			case MIR_INSTR_PHI:
+			case MIR_INSTR_UNREACHABLE:
+			case MIR_INSTR_DEBUGBREAK:
+			case MIR_INSTR_DECL_DIRECT_REF:
+				break;
+			case MIR_INSTR_ARG:
+				// Validated together with the declaration.
+				is_arg_read = true;
+				++arg_count;
+				break;
+			case MIR_INSTR_COND_BR:
+				// Condition value kept on the stack is used by phi in the interpreter.
+				if (((struct mir_instr_cond_br *)instr)->keep_stack_value) return false;
+				break;
+			case MIR_INSTR_DECL_VAR: {
+				struct mir_instr_decl_var *decl = (struct mir_instr_decl_var *)instr;
+				struct mir_var            *var  = decl->var;
+				if (var->value.is_comptime || isflag(var->iflags, MIR_VAR_GLOBAL)) return false;
+				if (decl->init && decl->init->kind == MIR_INSTR_ARG) {
+					// Argument values are passed on the stack in reverse order.
+					const s32 index = (s32)((struct mir_instr_arg *)decl->init)->i;
+					if (!is_args_prefix || index <= last_arg || (usize)index >= fn_arg_count || decl->init != instr->prev) return false;
+					last_arg               = index;
+					octx->used_args[index] = true;
+					is_arg_read            = true;
+					++arg_decl_count;
+					break;
+				}
+				// Initializer of unused variable would be left on the interpreter stack.
+				if (var->ref_count == 0 && decl->init && !mir_is_comptime(decl->init)) return false;
+				is_arg_read = !decl->init;
+				break;
+			}
+			case MIR_INSTR_DECL_REF: {
+				struct scope_entry *entry = ((struct mir_instr_decl_ref *)instr)->scope_entry;
+				if (!entry || entry->kind != SCOPE_ENTRY_VAR) return false;
+				struct mir_var *var = entry->data.var;
+				if (var->value.is_comptime && isnotflag(var->iflags, MIR_VAR_GLOBAL)) return false;
+				break;
+			}
+			case MIR_INSTR_CALL:
+				if (((struct mir_instr_call *)instr)->tmp_var) return false;
+				break;
+			default:
+				return false;
+			}
+			if (!is_arg_read && !mir_is_comptime(instr)) is_args_prefix = false;
+			if (instr->kind == MIR_INSTR_ARG && (block != callee->first_block || !is_args_prefix)) return false;
+			struct opt_clone_entry entry = {.hash = instr};
+			tbl_insert(octx->clones, entry);
+		}
+	}
+
+	// Arguments are read only by declarations of argument variables.
+	if (arg_count != arg_decl_count) return false;
+
+	// Values used by the body and not cloned are shared; only compile-time known values and global
+	// declarations can be used this way.
+	for (struct mir_instr *it = &callee->first_block->base; it; it = it->next) {
+		struct mir_instr_block *block = (struct mir_instr_block *)it;
+		if (block == exit_block) continue;
+		for (struct mir_instr *instr = block->entry_instr; instr; instr = instr->next) {
+			if (opt_is_type_instr(instr)) continue;
+			opt_get_operand_slots(instr, &octx->operands);
+			for (usize i = 0; i < sarrlenu(&octx->operands); ++i) {
+				struct mir_instr *operand = *sarrpeek(&octx->operands, i);
+				if (!operand || tbl_lookup_index(octx->clones, operand) != -1 || mir_is_comptime(operand)) continue;
+				if (operand->kind == MIR_INSTR_DECL_VAR && isflag(((struct mir_instr_decl_var *)operand)->var->iflags, MIR_VAR_GLOBAL)) continue;
+				return false;
+			}
+		}
+	}
+	*out_instr_count = count;
+	return true;
+}
+
+static struct mir_instr *opt_clone_instr(struct context *ctx, struct mir_instr *instr, struct ast *node) {
+	struct mir_instr *tmp = create_instr(ctx, instr->kind, node);
+	const u32         id  = tmp->id;
+	memcpy(tmp, instr, instr_sizes[instr->kind]);
+	tmp->id          = id;
+	tmp->node        = node;
+	tmp->owner_block = NULL;
+	tmp->prev        = NULL;
+	tmp->next        = NULL;
+	tmp->llvm_value  = NULL;
+	return tmp;
+}
+
+static void opt_append_instr(struct mir_instr_block *block, struct mir_instr *instr) {
+	instr->owner_block = block;
+	instr->prev        = block->last_instr;
+	if (block->last_instr) {
+		block->last_instr->next = instr;
+	} else {
+		block->entry_instr = instr;
+	}
+	block->last_instr = instr;
+}
+
+static void opt_insert_block_after(struct mir_fn *fn, struct mir_instr_block *after, struct mir_instr_block *block) {
+	block->base.prev = &after->base;
+	block->base.next = after->base.next;
+	if (after->base.next) {
+		after->base.next->prev = &block->base;
+	} else {
+		fn->last_block = block;
+	}
+	after->base.next = &block->base;
+}
+
+static inline struct mir_instr *opt_remap_operand(struct opt_context *octx, struct mir_instr *operand) {
+	if (!operand) return NULL;
+	struct mir_instr *clone = opt_lookup_clone(octx, operand);
+	return clone ? clone : ref_instr(operand);
+}
+
+// Cloned declarations use their own variables.
+static void opt_remap_decl(struct opt_context *octx, struct mir_instr_decl_var *decl, struct mir_instr_call *call) {
+	struct context *ctx = octx->ctx;
+	struct mir_var *var = arena_alloc(&ctx->mir_arenas->var);
+	memcpy(var, decl->var, sizeof(struct mir_var));
+	var->llvm_value   = NULL;
+	var->vm_ptr.local = 0;
+	var->arg_index    = -1;
+	setflag(var->iflags, MIR_VAR_IMPLICIT);
+	clrflag(var->iflags, MIR_VAR_ARG_TMP);
+	clrflag(var->iflags, MIR_VAR_RET_TMP);
+	arrput(octx->fn->variables, var);
+
+	struct opt_var_clone_entry entry = {.hash = decl->var, .decl = &decl->base};
+	tbl_insert(octx->var_clones, entry);
+	decl->var  = var;
+	decl->type = NULL;
+	if (decl->init && decl->init->kind == MIR_INSTR_ARG) {
+		// Argument value is moved into the variable.
+		decl->init     = sarrpeek(call->args, ((struct mir_instr_arg *)decl->init)->i);
+		var->ref_count = MAX(var->ref_count, 1);
+	} else {
+		decl->init = opt_remap_operand(octx, decl->init);
+	}
+}
+
+static void opt_remap_instr(struct opt_context *octx, struct mir_instr *instr) {
+	struct context *ctx = octx->ctx;
+	switch (instr->kind) {
+	case MIR_INSTR_DECL_VAR:
+		return;
+	case MIR_INSTR_DECL_REF: {
+		struct mir_var *var = ((struct mir_instr_decl_ref *)instr)->scope_entry->data.var;
+		if (isflag(var->iflags, MIR_VAR_GLOBAL)) {
+			++var->ref_count;
+			return;
+		}
+		const s32 index = tbl_lookup_index(octx->var_clones, var);
+		bassert(index != -1 && "Local variable declaration not found in the inlined body!");
+		struct mir_instr_decl_direct_ref *ref = mutate_instr(instr, MIR_INSTR_DECL_DIRECT_REF);
+		ref->ref                              = ref_instr(octx->var_clones[index].decl);
+		return;
+	}
+	case MIR_INSTR_CAST:
+		((struct mir_instr_cast *)instr)->type = NULL;
+		break;
+	case MIR_INSTR_CALL: {
+		struct mir_instr_call *call = (struct mir_instr_call *)instr;
+		if (!call->args) break;
+		mir_instrs_t *args = arena_alloc(ctx->small_array_arena);
+		for (usize i = 0; i < sarrlenu(call->args); ++i) {
+			sarrput(args, sarrpeek(call->args, i));
+		}
+		call->args = args;
+		break;
+	}
+	case MIR_INSTR_SWITCH: {
+		struct mir_instr_switch *sw    = (struct mir_instr_switch *)instr;
+		mir_switch_cases_t      *cases = arena_alloc(ctx->small_array_arena);
+		for (usize i = 0; i < sarrlenu(sw->cases); ++i) {
+			sarrput(cases, sarrpeek(sw->cases, i));
+		}
+		sw->cases = cases;
+		break;
+	}
+	case MIR_INSTR_PHI: {
+		struct mir_instr_phi *phi = (struct mir_instr_phi *)instr;
+		for (s32 i = 0; i < phi->num; ++i) {
+			phi->incoming_blocks[i] = (struct mir_instr_block *)opt_lookup_clone(octx, &phi->incoming_blocks[i]->base);
+		}
+		phi->origin_br = phi->origin_br ? opt_lookup_clone(octx, phi->origin_br) : NULL;
+		break;
+	}
+	default:
+		break;
+	}
+	opt_get_operand_slots(instr, &octx->operands);
+	for (usize i = 0; i < sarrlenu(&octx->operands); ++i) {
+		struct mir_instr **slot = sarrpeek(&octx->operands, i);
+		*slot                   = opt_remap_operand(octx, *slot);
+	}
+}
+
+// Replace the call by the callee body; the block containing the call is split into two, the body is
+// inserted in between.
+static void opt_inline_call(struct opt_context *octx, struct mir_instr_call *call, struct mir_fn *callee) {
+	struct context         *ctx        = octx->ctx;
+	struct mir_fn          *fn         = octx->fn;
+	struct ast             *node       = call->base.node;
+	struct mir_instr_block *call_block = call->base.owner_block;
+
+	// Continuation block contains the call and all following instructions and replaces the callee
+	// exit block.
+	struct mir_instr_block *cont = create_block(ctx, cstr("inline_continue"));
+	cont->owner_fn               = fn;
+	cont->base.state             = MIR_IS_COMPLETE;
+	cont->base.ref_count         = callee->exit_block->base.ref_count;
+	octx->clones[tbl_lookup_index(octx->clones, callee->exit_block)].clone = &cont->base;
+
+	struct mir_instr_block *prev_block = call_block;
+	for (struct mir_instr *it = &callee->first_block->base; it; it = it->next) {
+		struct mir_instr_block *block = (struct mir_instr_block *)it;
+		if (block == callee->exit_block) continue;
+		struct mir_instr_block *clone = (struct mir_instr_block *)opt_clone_instr(ctx, it, NULL);
+		clone->owner_fn               = fn;
+		clone->entry_instr            = NULL;
+		clone->last_instr             = NULL;
+		clone->terminal               = NULL;
+		opt_insert_block_after(fn, prev_block, clone);
+		octx->clones[tbl_lookup_index(octx->clones, it)].clone = &clone->base;
+		prev_block                                             = clone;
+
+		for (struct mir_instr *instr = block->entry_instr; instr; instr = instr->next) {
+			const s32 index = tbl_lookup_index(octx->clones, instr);
+			if (index == -1) continue;
+			if (instr->kind == MIR_INSTR_ARG) continue;
+			struct mir_instr *instr_clone = opt_clone_instr(ctx, instr, node);
+			octx->clones[index].clone     = instr_clone;
+			opt_append_instr(clone, instr_clone);
+		}
+		clone->terminal = opt_lookup_clone(octx, block->terminal);
+		bassert(clone->terminal);
+	}
+	opt_insert_block_after(fn, prev_block, cont);
+
+	// Declarations are remapped first, so all following variable references can be redirected.
+	tbl_clear(octx->var_clones);
+	struct mir_instr_block *first_clone = (struct mir_instr_block *)call_block->base.next;
+	for (struct mir_instr *it = &first_clone->base; it != &cont->base; it = it->next) {
+		struct mir_instr_block *block = (struct mir_instr_block *)it;
+		for (struct mir_instr *instr = block->entry_instr; instr; instr = instr->next) {
+			if (instr->kind == MIR_INSTR_DECL_VAR) opt_remap_decl(octx, (struct mir_instr_decl_var *)instr, call);
+		}
+	}
+	for (struct mir_instr *it = &first_clone->base; it != &cont->base; it = it->next) {
+		struct mir_instr_block *block = (struct mir_instr_block *)it;
+		for (struct mir_instr *instr = block->entry_instr; instr; instr = instr->next) {
+			opt_remap_instr(octx, instr);
+		}
+		opt_get_successor_slots(block, &octx->slots);
+		for (usize i = 0; i < sarrlenu(&octx->slots); ++i) {
+			struct mir_instr_block **slot = sarrpeek(&octx->slots, i);
+			*slot                         = (struct mir_instr_block *)opt_lookup_clone(octx, &(*slot)->base);
+		}
+	}
+
+	// Arguments not read by the body are not used anymore.
+	for (usize i = 0; i < sarrlenu(call->args); ++i) {
+		if (!octx->used_args[i]) opt_erase_value(sarrpeek(call->args, i));
+	}
+
+	// Move the call and all following instructions into the continuation block.
+	cont->entry_instr = &call->base;
+	cont->last_instr  = call_block->last_instr;
+	cont->terminal    = call_block->terminal;
+	for (struct mir_instr *instr = &call->base; instr; instr = instr->next) {
+		instr->owner_block = cont;
+	}
+	call_block->last_instr = call->base.prev;
+	if (call->base.prev) {
+		call->base.prev->next = NULL;
+	} else {
+		call_block->entry_instr = NULL;
+	}
+	call->base.prev = NULL;
+
+	// The first cloned block reference count is already set by the clone.
+	struct mir_instr_br *br = create_instr(ctx, MIR_INSTR_BR, node);
+	br->base.value.type     = ctx->builtin_types->t_void;
+	br->base.ref_count      = MIR_NO_REF_COUNTING;
+	br->base.state          = MIR_IS_COMPLETE;
+	br->then_block          = first_clone;
+	opt_append_instr(call_block, &br->base);
+	call_block->terminal = &br->base;
+
+	// Phi instructions of the original successors are now reached from the continuation block.
+	opt_get_successor_slots(cont, &octx->slots);
+	for (usize i = 0; i < sarrlenu(&octx->slots); ++i) {
+		struct mir_instr_block *succ = *sarrpeek(&octx->slots, i);
+		for (struct mir_instr *instr = succ->entry_instr; instr; instr = instr->next) {
+			if (instr->kind != MIR_INSTR_PHI) continue;
+			struct mir_instr_phi *phi = (struct mir_instr_phi *)instr;
+			for (s32 j = 0; j < phi->num; ++j) {
+				if (phi->incoming_blocks[j] == call_block) phi->incoming_blocks[j] = cont;
+			}
+		}
+	}
+
+	// Replace the call by load of the return value.
+	struct mir_instr *callee_instr = call->callee;
+	if (call->base.ref_count > 1 && callee->ret_tmp) {
+		struct mir_instr *exit_ref = ((struct mir_instr_load *)((struct mir_instr_ret *)callee->terminal_instr)->value)->src;
+		struct mir_instr *ret_decl = opt_lookup_clone(octx, callee->ret_tmp);
+		struct mir_instr *ref      = create_instr_decl_direct_ref(ctx, node, ret_decl);
+		ref->value                 = exit_ref->value;
+		ref->ref_count             = 1;
+		ref->state                 = MIR_IS_COMPLETE;
+		++((struct mir_instr_decl_var *)ret_decl)->var->ref_count;
+		insert_instr_before(&call->base, ref);
+
+		--call->base.ref_count;
+		struct mir_instr_load *load = mutate_instr(&call->base, MIR_INSTR_LOAD);
+		load->src                   = ref;
+		load->is_deref              = false;
+	} else {
+		erase_instr(&call->base);
+	}
+	opt_erase_value(callee_instr);
+	batomic_fetch_add_s32(&octx->assembly->stats.mir_opt_inlined_count, 1);
+}
+
+// Inline calls of small functions; returns true in case some call was inlined.
+static bool opt_inline_calls(struct opt_context *octx) {
+	arrsetlen(octx->calls, 0);
+	for (struct mir_instr *it = &octx->fn->first_block->base; it; it = it->next) {
+		struct mir_instr_block *block = (struct mir_instr_block *)it;
+		for (struct mir_instr *instr = block->entry_instr; instr; instr = instr->next) {
+			if (instr->kind != MIR_INSTR_CALL || mir_is_comptime(instr) || !instr->node) continue;
+			struct mir_instr_call *call = (struct mir_instr_call *)instr;
+			if (call->tmp_var || !mir_is_comptime(call->callee) || call->callee->value.type->kind != MIR_TYPE_FN) continue;
+			arrput(octx->calls, call);
+		}
+	}
+
+	s32  growth     = 0;
+	bool is_inlined = false;
+	for (usize i = 0; i < arrlenu(octx->calls); ++i) {
+		struct mir_instr_call *call   = octx->calls[i];
+		struct mir_fn         *callee = mir_get_callee(call);
+		s32                    count  = 0;
+		if (!opt_can_inline(octx, callee, &count)) continue;
+		if (sarrlenu(call->args) != arrlenu(octx->used_args) || growth + count > OPT_MAX_INLINE_GROWTH) continue;
+		bool is_valid = true;
+		for (usize j = 0; j < sarrlenu(call->args) && is_valid; ++j) {
+			struct mir_instr *arg = sarrpeek(call->args, j);
+			// Compound arguments are initialized directly in the callee frame by the interpreter.
+			is_valid = (arg->kind != MIR_INSTR_COMPOUND || mir_is_comptime(arg)) && (octx->used_args[j] || opt_is_erasable(arg));
+		}
+		if (!is_valid) continue;
+		// Inlining does not change what the caller does, so its purity is decided on the original
+		// body; inlined body of a trusted pure function might touch globals and the caller would look
+		// impure afterwards. The purity is decided later on the inlined body in case some of called
+		// functions is not analyzed yet; this is conservative.
+		if (!is_inlined) mir_is_fn_pure(octx->fn);
+		opt_inline_call(octx, call, callee);
+		growth += count;
+		is_inlined = true;
+	}
+	return is_inlined;
+}
+
+// Switch with compile-time known value is replaced by direct break into the matching case.
+static void opt_fold_switch(struct mir_instr_switch *sw) {
+	struct mir_type        *type           = sw->value->value.type;
+	const u64               value          = vm_read_int(type, _mir_cev_read(&sw->value->value));
+	struct mir_instr_block *continue_block = sw->default_block;
+	for (usize i = 0; i < sarrlenu(sw->cases); ++i) {
+		struct mir_switch_case *c = &sarrpeek(sw->cases, i);
+		if (value == vm_read_int(type, c->on_value->value.data)) {
+			continue_block = c->block;
+			break;
+		}
+	}
+
+	for (usize i = 0; i < sarrlenu(sw->cases); ++i) {
+		struct mir_switch_case *c = &sarrpeek(sw->cases, i);
+		unref_instr(&c->block->base);
+		unref_instr(c->on_value);
+	}
+	unref_instr(&sw->default_block->base);
+	opt_erase_value(sw->value);
+
+	struct mir_instr_br *br = mutate_instr(&sw->base, MIR_INSTR_BR);
+	br->then_block          = (struct mir_instr_block *)ref_instr(&continue_block->base);
+}
+
+// Conditional breaks with compile-time known condition are replaced during analyze already, but the
+// condition might become known after the copy propagation.
+static bool opt_fold_cond_br(struct mir_instr_cond_br *br) {
+	if (opt_has_phi(br->then_block) || opt_has_phi(br->else_block)) return false;
+	const bool              cond           = MIR_CEV_READ_AS(bool, &br->cond->value);
+	struct mir_instr_block *continue_block = cond ? br->then_block : br->else_block;
+	struct mir_instr_block *discard_block  = !cond ? br->then_block : br->else_block;
+	unref_instr(&discard_block->base);
+	opt_erase_value(br->cond);
+
+	struct mir_instr_br *new_br = mutate_instr(&br->base, MIR_INSTR_BR);
+	new_br->then_block          = continue_block;
+	return true;
+}
+
+static void opt_fold_branches(struct opt_context *octx) {
+	for (struct mir_instr *it = &octx->fn->first_block->base; it; it = it->next) {
+		struct mir_instr *terminal = ((struct mir_instr_block *)it)->terminal;
+		if (terminal->kind == MIR_INSTR_SWITCH) {
+			struct mir_instr_switch *sw = (struct mir_instr_switch *)terminal;
+			if (!mir_is_comptime(sw->value)) continue;
+			opt_fold_switch(sw);
+		} else if (terminal->kind == MIR_INSTR_COND_BR) {
+			struct mir_instr_cond_br *br = (struct mir_instr_cond_br *)terminal;
+			if (!mir_is_comptime(br->cond) || !opt_fold_cond_br(br)) continue;
+		} else {
+			continue;
+		}
+		batomic_fetch_add_s32(&octx->assembly->stats.mir_opt_folded_count, 1);
+	}
+}
+
+// Breaks into blocks containing only another direct break are redirected to the final destination.
+static void opt_thread_jumps(struct opt_context *octx) {
+	struct mir_fn *fn = octx->fn;
+	for (struct mir_instr *it = &fn->first_block->base; it; it = it->next) {
+		struct mir_instr_block *block = (struct mir_instr_block *)it;
+		opt_get_successor_slots(block, &octx->slots);
+		for (usize i = 0; i < sarrlenu(&octx->slots); ++i) {
+			struct mir_instr_block **slot   = sarrpeek(&octx->slots, i);
+			struct mir_instr_block  *target = *slot;
+			for (s32 hop = 0; hop < OPT_MAX_THREADING_HOPS && opt_is_forwarding_block(fn, target); ++hop) {
+				struct mir_instr_block *next = ((struct mir_instr_br *)target->terminal)->then_block;
+				// Keep phi incoming blocks and do not produce self-loops.
+				if (next == target || next == block || opt_has_phi(next)) break;
+				target = next;
+			}
+			if (target == *slot) continue;
+			unref_instr(&(*slot)->base);
+			*slot = (struct mir_instr_block *)ref_instr(&target->base);
+			batomic_fetch_add_s32(&octx->assembly->stats.mir_opt_threaded_count, 1);
+		}
+	}
+}
+
+// Find all blocks reachable from the function entry and count predecessors of all blocks. Unreachable
+// predecessors are counted too since they stay in the function in case the dead block removal is
+// disabled or cannot be done.
+static void opt_scan_blocks(struct opt_context *octx) {
+	struct mir_fn *fn = octx->fn;
+	tbl_clear(octx->blocks);
+	for (struct mir_instr *it = &fn->first_block->base; it; it = it->next) {
+		struct opt_block_entry entry = {.hash = (struct mir_instr_block *)it};
+		tbl_insert(octx->blocks, entry);
+	}
+
+	for (struct mir_instr *it = &fn->first_block->base; it; it = it->next) {
+		struct mir_instr_block *block = (struct mir_instr_block *)it;
+		opt_get_successor_slots(block, &octx->slots);
+		for (usize i = 0; i < sarrlenu(&octx->slots); ++i) {
+			++opt_lookup_block(octx, *sarrpeek(&octx->slots, i))->pred_count;
+		}
+
+		for (struct mir_instr *instr = block->entry_instr; instr; instr = instr->next) {
+			if (instr->kind != MIR_INSTR_PHI) continue;
+			struct mir_instr_phi *phi = (struct mir_instr_phi *)instr;
+			for (s32 i = 0; i < phi->num; ++i) {
+				opt_lookup_block(octx, phi->incoming_blocks[i])->is_phi_income = true;
+			}
+		}
+	}
+
+	arrsetlen(octx->stack, 0);
+	arrput(octx->stack, fn->first_block);
+	if (fn->exit_block) arrput(octx->stack, fn->exit_block);
+	while (arrlenu(octx->stack)) {
+		struct mir_instr_block *block = arrpop(octx->stack);
+		struct opt_block_entry *entry = opt_lookup_block(octx, block);
+		bassert(entry && "Block is not in the function block list!");
+		if (entry->is_reachable) continue;
+		entry->is_reachable = true;
+
+		opt_get_successor_slots(block, &octx->slots);
+		for (usize i = 0; i < sarrlenu(&octx->slots); ++i) {
+			arrput(octx->stack, *sarrpeek(&octx->slots, i));
+		}
+	}
+}
+
+// Returns true in case all phi instructions in the reachable block have at least one reachable
+// incoming block.
+static bool opt_has_valid_phi_incomes(struct opt_context *octx, struct mir_instr_block *block) {
+	for (struct mir_instr *instr = block->entry_instr; instr; instr = instr->next) {
+		if (instr->kind != MIR_INSTR_PHI) continue;
+		struct mir_instr_phi *phi  = (struct mir_instr_phi *)instr;
+		bool                  pass = false;
+		for (s32 i = 0; i < phi->num; ++i) {
+			pass |= opt_lookup_block(octx, phi->incoming_blocks[i])->is_reachable;
+		}
+		if (!pass) return false;
+	}
+	return true;
+}
+
+static void opt_remove_phi_incomes(struct mir_instr_block *block, struct mir_instr_block *dead_block) {
+	for (struct mir_instr *instr = block->entry_instr; instr; instr = instr->next) {
+		if (instr->kind != MIR_INSTR_PHI) continue;
+		struct mir_instr_phi *phi = (struct mir_instr_phi *)instr;
+		for (s32 i = phi->num; i-- > 0;) {
+			if (phi->incoming_blocks[i] != dead_block) continue;
+			unref_instr(phi->incoming_values[i]);
+			unref_instr(&dead_block->base);
+			for (s32 j = i + 1; j < phi->num; ++j) {
+				phi->incoming_values[j - 1] = phi->incoming_values[j];
+				phi->incoming_blocks[j - 1] = phi->incoming_blocks[j];
+			}
+			--phi->num;
+			phi->incoming_values[phi->num] = NULL;
+			phi->incoming_blocks[phi->num] = NULL;
+		}
+	}
+}
+
+// Remove all blocks not reachable from the function entry block.
+static void opt_remove_dead_blocks(struct opt_context *octx) {
+	struct mir_fn *fn = octx->fn;
+	for (struct mir_instr *it = &fn->first_block->base; it; it = it->next) {
+		struct mir_instr_block *block = (struct mir_instr_block *)it;
+		if (opt_lookup_block(octx, block)->is_reachable && !opt_has_valid_phi_incomes(octx, block)) return;
+	}
+
+	struct mir_instr *it = &fn->first_block->base;
+	while (it) {
+		struct mir_instr_block *block = (struct mir_instr_block *)it;
+		it                            = it->next;
+		if (opt_lookup_block(octx, block)->is_reachable) continue;
+
+		opt_get_successor_slots(block, &octx->slots);
+		for (usize i = 0; i < sarrlenu(&octx->slots); ++i) {
+			struct mir_instr_block *succ       = *sarrpeek(&octx->slots, i);
+			struct opt_block_entry *succ_entry = opt_lookup_block(octx, succ);
+			unref_instr(&succ->base);
+			--succ_entry->pred_count;
+			if (succ_entry->is_reachable) opt_remove_phi_incomes(succ, block);
+		}
+		opt_unlink_block(fn, block);
+		batomic_fetch_add_s32(&octx->assembly->stats.mir_opt_dead_block_count, 1);
+	}
+}
+
+// Merge block ending with direct break with its successor in case the block is the only predecessor.
+static bool opt_merge_with_successor(struct opt_context *octx, struct mir_instr_block *block) {
+	struct mir_fn *fn = octx->fn;
+	if (block->is_unreachable || block->terminal->kind != MIR_INSTR_BR) return false;
+	struct mir_instr_block *succ = ((struct mir_instr_br *)block->terminal)->then_block;
+	if (succ == block || !opt_is_block_removable(fn, succ)) return false;
+
+	struct opt_block_entry *entry = opt_lookup_block(octx, succ);
+	if (entry->pred_count != 1 || entry->is_phi_income || opt_has_phi(succ)) return false;
+	if (block->last_instr != block->terminal || succ->last_instr != succ->terminal) return false;
+
+	struct mir_instr *br = block->terminal;
+	struct mir_instr *prev_last = br->prev;
+	erase_instr(br);
+	unref_instr(&succ->base);
+
+	for (struct mir_instr *instr = succ->entry_instr; instr; instr = instr->next) {
+		instr->owner_block = block;
+	}
+	if (prev_last) {
+		prev_last->next = succ->entry_instr;
+	} else {
+		block->entry_instr = succ->entry_instr;
+	}
+	succ->entry_instr->prev = prev_last;
+	block->last_instr       = succ->last_instr;
+	block->terminal         = succ->terminal;
+
+	opt_unlink_block(fn, succ);
+	succ->entry_instr = NULL;
+	succ->last_instr  = NULL;
+	succ->terminal    = NULL;
+	batomic_fetch_add_s32(&octx->assembly->stats.mir_opt_merged_count, 1);
+	return true;
+}
+
+static void opt_merge_blocks(struct opt_context *octx) {
+	for (struct mir_instr *it = &octx->fn->first_block->base; it; it = it->next) {
+		struct mir_instr_block *block = (struct mir_instr_block *)it;
+		if (!opt_lookup_block(octx, block)->is_reachable) continue;
+		while (opt_merge_with_successor(octx, block)) {
+		}
+	}
+}
+
+static inline void opt_erase_store(struct opt_context *octx, struct mir_instr_store *store) {
+	erase_instr(&store->base);
+	opt_erase_value(store->dest);
+	opt_erase_value(store->src);
+	batomic_fetch_add_s32(&octx->assembly->stats.mir_opt_dead_store_count, 1);
+}
+
+// Stores into local variables which are never read are removed together with the variable, stores
+// overwritten in the same block before any read are removed too.
+static void opt_remove_dead_stores(struct opt_context *octx) {
+	if (!opt_scan_vars(octx)) return;
+	struct mir_fn *fn = octx->fn;
+	for (struct mir_instr *it = &fn->first_block->base; it; it = it->next) {
+		struct mir_instr_block *block = (struct mir_instr_block *)it;
+		tbl_clear(octx->stores);
+		struct mir_instr *instr = block->entry_instr;
+		while (instr) {
+			struct mir_instr *next = instr->next;
+			switch (instr->kind) {
+			case MIR_INSTR_LOAD: {
+				struct mir_var *var = opt_get_local_var(((struct mir_instr_load *)instr)->src);
+				if (var && tbl_lookup_index(octx->stores, var) != -1) tbl_erase(octx->stores, var);
+				break;
+			}
+			case MIR_INSTR_DECL_VAR: {
+				struct mir_instr_decl_var *decl  = (struct mir_instr_decl_var *)instr;
+				struct opt_var_entry      *entry = opt_lookup_var(octx, opt_get_local_var(instr));
+				if (!entry || entry->is_escaped || !decl->init) break;
+				struct opt_store_entry store_entry = {.hash = entry->hash, .store = instr};
+				tbl_insert(octx->stores, store_entry);
+				break;
+			}
+			case MIR_INSTR_STORE: {
+				struct mir_instr_store *store = (struct mir_instr_store *)instr;
+				struct opt_var_entry   *entry = opt_lookup_var(octx, opt_get_local_var(store->dest));
+				if (!entry || entry->is_escaped || mir_is_comptime(instr)) break;
+				if (entry->load_count == 0 && isnotflag(entry->hash->iflags, MIR_VAR_RET_TMP) && opt_is_erasable(store->src)) {
+					opt_erase_store(octx, store);
+					--entry->store_count;
+					break;
+				}
+				const s32 index = tbl_lookup_index(octx->stores, entry->hash);
+				if (index == -1) {
+					struct opt_store_entry store_entry = {.hash = entry->hash, .store = instr};
+					tbl_insert(octx->stores, store_entry);
+					break;
+				}
+				struct mir_instr *prev = octx->stores[index].store;
+				octx->stores[index].store = instr;
+				if (prev->kind == MIR_INSTR_STORE) {
+					struct mir_instr_store *prev_store = (struct mir_instr_store *)prev;
+					if (!opt_is_erasable(prev_store->src)) break;
+					opt_erase_store(octx, prev_store);
+					--entry->store_count;
+				} else {
+					struct mir_instr_decl_var *prev_decl = (struct mir_instr_decl_var *)prev;
+					if (!opt_is_erasable(prev_decl->init) || prev_decl->init->kind == MIR_INSTR_ARG) break;
+					opt_erase_value(prev_decl->init);
+					prev_decl->init = NULL;
+					batomic_fetch_add_s32(&octx->assembly->stats.mir_opt_dead_store_count, 1);
+				}
+				break;
+			}
+			default:
+				break;
+			}
+			instr = next;
+		}
+	}
+
+	// Remove declarations of variables which are never used.
+	for (u32 i = 0; i < tbl_len(octx->vars); ++i) {
+		struct opt_var_entry *entry = &octx->vars[i];
+		struct mir_var       *var   = entry->hash;
+		if (entry->is_escaped || entry->load_count || entry->store_count) continue;
+		if (isflag(var->iflags, MIR_VAR_RET_TMP) || !opt_is_erasable(entry->decl->init)) continue;
+		struct mir_instr_decl_var *decl = entry->decl;
+		if (decl->init) {
+			opt_erase_value(decl->init);
+			decl->init = NULL;
+			batomic_fetch_add_s32(&octx->assembly->stats.mir_opt_dead_store_count, 1);
+		}
+		if (decl->base.owner_block->last_instr == &decl->base) decl->base.owner_block->last_instr = decl->base.prev;
+		erase_instr(&decl->base);
+		var->ref_count = 0;
+	}
+}
+
+// Passes following the inlining.
+static void opt_run_passes(struct opt_context *octx) {
+	const struct builder_options *opt = builder.options;
+	if (!opt->no_mir_copy_propagation) {
+		opt_propagate_copies(octx);
+		opt_fold_constants(octx);
+	}
+	if (!opt->no_mir_fold_branches) opt_fold_branches(octx);
+	if (!opt->no_mir_jump_threading) opt_thread_jumps(octx);
+	if (!opt->no_mir_dead_blocks || !opt->no_mir_merge_blocks) {
+		opt_scan_blocks(octx);
+		if (!opt->no_mir_dead_blocks) opt_remove_dead_blocks(octx);
+		if (!opt->no_mir_merge_blocks) opt_merge_blocks(octx);
+	}
+	if (!opt->no_mir_dead_stores) opt_remove_dead_stores(octx);
+}
+
+// Optimize functions fully analyzed since the last call; this must be done before the function can
+// be executed in compile-time.
+void optimize_completed_fns(struct context *ctx) {
+	zone();
+	const f64           start = get_tick_ms();
+	struct opt_context *octx  = ctx->opt;
+	for (usize i = 0; i < arrlenu(ctx->opt_queue); ++i) {
+		struct mir_fn *fn = ctx->opt_queue[i];
+		if (builder.errorc || !opt_is_fn_supported(fn)) continue;
+		octx->fn = fn;
+		if (!builder.options->no_mir_inline) opt_inline_calls(octx);
+		opt_run_passes(octx);
+	}
+	arrsetlen(ctx->opt_queue, 0);
+	batomic_fetch_add_s64(&ctx->assembly->stats.mir_opt_us, (s64)((get_tick_ms() - start) * 1000.));
+	return_zone();
+}
+
+// Inline calls of functions fully analyzed after their callers.
+void optimize(struct context *ctx) {
+	if (builder.options->no_mir_inline) return;
+	zone();
+	const f64           start = get_tick_ms();
+	struct opt_context *octx  = ctx->opt;
+	for (usize i = 0; i < arrlenu(ctx->mir->global_instrs); ++i) {
+		struct mir_instr *instr = ctx->mir->global_instrs[i];
+		if (instr->kind != MIR_INSTR_FN_PROTO || instr->state != MIR_IS_COMPLETE) continue;
+		struct mir_fn *fn = MIR_CEV_READ_AS(struct mir_fn *, &instr->value);
+		bmagic_assert(fn);
+		if (!opt_is_fn_supported(fn)) continue;
+		octx->fn = fn;
+		if (opt_inline_calls(octx)) opt_run_passes(octx);
+	}
+	batomic_fetch_add_s64(&ctx->assembly->stats.mir_opt_us, (s64)((get_tick_ms() - start) * 1000.));
+	return_zone();
+}
+
+static void opt_terminate(struct opt_context *octx) {
+	tbl_free(octx->blocks);
+	tbl_free(octx->vars);
+	tbl_free(octx->clones);
+	tbl_free(octx->var_clones);
+	tbl_free(octx->stores);
+	arrfree(octx->stack);
+	arrfree(octx->calls);
+	arrfree(octx->used_args);
+	sarrfree(&octx->slots);
+	sarrfree(&octx->operands);
+}
+
+struct mir_var *testing_gen_meta(struct context *ctx) {
+	const s32 len = ctx->assembly->testing.expected_test_count;
+	if (len == 0) return NULL;
+	if (ctx->assembly->testing.meta_var) return ctx->assembly->testing.meta_var;
+	struct mir_type *type = create_type_array(ctx, NULL, ctx->builtin_types->t_TestCase, len);
+	struct mir_var  *var  = create_var_impl(ctx,
+                                          &(create_var_impl_args_t){
+	                                            .name        = IMPL_TESTCASES_TMP,
+	                                            .alloc_type  = type,
+	                                            .is_global   = true,
+	                                            .is_comptime = true,
+                                          });
+	vm_alloc_global(ctx->vm, ctx->assembly, var);
+	ctx->assembly->testing.meta_var = var;
+	return var;
+}
+
+inline void testing_add_test_case(struct context *ctx, struct mir_fn *fn) {
+	struct mir_var *var = testing_gen_meta(ctx);
+	bassert(var);
+	bassert(var->value.data);
+
+	arrput(ctx->assembly->testing.cases, fn);
+	const usize i = arrlenu(ctx->assembly->testing.cases) - 1;
+
+	vm_stack_ptr_t   var_ptr  = vm_read_var(ctx->vm, var);
+	struct mir_type *var_type = var->value.type;
+	bassert(var_type->kind == MIR_TYPE_ARRAY);
+	struct mir_type *elem_type = var_type->data.array.elem_type;
+	const ptrdiff_t  offset    = vm_get_array_elem_offset(var_type, (u32)i);
+
+	struct mir_type *func_type = mir_get_struct_elem_type(elem_type, 0);
+	struct mir_type *name_type = mir_get_struct_elem_type(elem_type, 1);
+	struct mir_type *file_type = mir_get_struct_elem_type(elem_type, 2);
+	struct mir_type *line_type = mir_get_struct_elem_type(elem_type, 3);
+
+	vm_stack_ptr_t func_ptr = vm_get_struct_elem_ptr(ctx->assembly, elem_type, var_ptr + offset, 0);
+	vm_stack_ptr_t name_ptr = vm_get_struct_elem_ptr(ctx->assembly, elem_type, var_ptr + offset, 1);
+	vm_stack_ptr_t file_ptr = vm_get_struct_elem_ptr(ctx->assembly, elem_type, var_ptr + offset, 2);
+	vm_stack_ptr_t line_ptr = vm_get_struct_elem_ptr(ctx->assembly, elem_type, var_ptr + offset, 3);
+
+	bassert(fn->id);
+
+	const str_t filename = fn->decl_node ? fn->decl_node->unit->filename : cstr("UNKNOWN");
+	const s32   line     = fn->decl_node ? ast_tmp_location(fn->decl_node)->line : 0;
+
+	vm_write_ptr(func_type, func_ptr, (vm_stack_ptr_t)fn);
+	vm_write_string(ctx->vm, name_type, name_ptr, fn->id->str);
+	vm_write_string(ctx->vm, file_type, file_ptr, filename);
+	vm_write_int(line_type, line_ptr, line);
+}
+
+// Top-level rtti generation.
+inline struct mir_var *rtti_gen(struct context *ctx, struct mir_type *type) {
+	struct mir_var *tmp     = _rtti_gen(ctx, type);
+	mir_rttis_t    *pending = &ctx->analyze->incomplete_rtti;
+	while (sarrlenu(pending)) {
+		struct mir_rtti_incomplete incomplete = sarrpop(pending);
+		rtti_satisfy_incomplete(ctx, &incomplete);
+	}
+	sarrclear(pending);
+	return tmp;
+}
+
+void rtti_satisfy_incomplete(struct context *ctx, struct mir_rtti_incomplete *incomplete) {
+	struct mir_type *type     = incomplete->type;
+	struct mir_var  *rtti_var = incomplete->var;
+
+	bassert(type->kind == MIR_TYPE_PTR);
+	rtti_gen_ptr(ctx, type, rtti_var);
+}
+
+struct mir_var *get_rtti_no_lock(struct assembly *assembly, hash_t type_hash) {
+	bassert(type_hash);
+	const s32 i = tbl_lookup_index(assembly->mir.rtti_table, type_hash);
+	if (i < 0) return NULL;
+	struct mir_var *result = assembly->mir.rtti_table[i].value;
+	bassert(result);
+	return result;
+}
+
+struct mir_var *_rtti_gen(struct context *ctx, struct mir_type *type) {
+	bassert(type);
+	struct mir_var *rtti_var = mir_get_rtti(ctx->assembly, type->id.hash);
+	if (rtti_var) return rtti_var;
+
+	switch (type->kind) {
+	case MIR_TYPE_INT:
+		rtti_var = rtti_gen_integer(ctx, type);
+		break;
+
+	case MIR_TYPE_ENUM:
+		rtti_var = rtti_gen_enum(ctx, type);
+		break;
+
+	case MIR_TYPE_REAL:
+		rtti_var = rtti_gen_real(ctx, type);
+		break;
+
+	case MIR_TYPE_BOOL:
+		rtti_var = rtti_gen_empty(ctx, type, ctx->builtin_types->t_TypeInfoBool);
+		break;
+
+	case MIR_TYPE_TYPE:
+		rtti_var = rtti_gen_empty(ctx, type, ctx->builtin_types->t_TypeInfoType);
+		break;
+
+	case MIR_TYPE_VOID:
+		rtti_var = rtti_gen_empty(ctx, type, ctx->builtin_types->t_TypeInfoVoid);
+		break;
+
+	case MIR_TYPE_NULL:
+		rtti_var = rtti_gen_empty(ctx, type, ctx->builtin_types->t_TypeInfoNull);
+		break;
+
+	case MIR_TYPE_STRING:
+		rtti_var = rtti_gen_empty(ctx, type, ctx->builtin_types->t_TypeInfoString);
+		break;
+
+	case MIR_TYPE_PTR:
+		// We generate dummy pointer RTTI when incomplete is enabled and complete
+		// this in second pass to prove endless looping.
+		rtti_var = rtti_gen_ptr(ctx, ctx->builtin_types->t_u8_ptr, NULL);
+		sarrput(&ctx->analyze->incomplete_rtti, ((struct mir_rtti_incomplete){.var = rtti_var, .type = type}));
+		break;
+
+	case MIR_TYPE_ARRAY:
 		rtti_var = rtti_gen_array(ctx, type);
 		break;
 
@@ -9701,9 +11382,16 @@ inline struct mir_var *rtti_create_and_alloc_var(struct context *ctx, struct mir
 	                                      });
 
 	vm_alloc_global(ctx->vm, ctx->assembly, var);
+	batomic_fetch_add_s32(&ctx->assembly->stats.rtti_vm_count, 1);
+	batomic_fetch_add_s64(&ctx->assembly->stats.rtti_vm_bytes, (s64)type->store_size_bytes);
 	return var;
 }
 
+static inline vm_stack_ptr_t rtti_alloc_array(struct context *ctx, struct mir_type *arr_type) {
+	batomic_fetch_add_s64(&ctx->assembly->stats.rtti_vm_bytes, (s64)arr_type->store_size_bytes);
+	return vm_alloc_raw(ctx->vm, ctx->assembly, arr_type);
+}
+
 static inline void rtti_gen_base(struct context *ctx, vm_stack_ptr_t dest, u8 kind, usize size_bytes, s8 alignment) {
 	struct mir_type *rtti_type      = ctx->builtin_types->t_TypeInfo;
 	struct mir_type *dest_kind_type = mir_get_struct_elem_type(rtti_type, 0);
@@ -9825,7 +11513,7 @@ void rtti_gen_enum_variant(struct context *ctx, vm_stack_ptr_t dest, struct mir_
 vm_stack_ptr_t rtti_gen_enum_variants_array(struct context *ctx, mir_variants_t *variants) {
 	struct mir_type *rtti_type    = ctx->builtin_types->t_TypeInfoEnumVariant;
 	struct mir_type *arr_tmp_type = create_type_array(ctx, NULL, rtti_type, sarrlen(variants));
-	vm_stack_ptr_t   dest_arr_tmp = vm_alloc_raw(ctx->vm, ctx->assembly, arr_tmp_type);
+	vm_stack_ptr_t   dest_arr_tmp = rtti_alloc_array(ctx, arr_tmp_type);
 	for (usize i = 0; i < sarrlenu(variants); ++i) {
 		struct mir_variant *it                = sarrpeek(variants, i);
 		vm_stack_ptr_t      dest_arr_tmp_elem = vm_get_array_elem_ptr(arr_tmp_type, dest_arr_tmp, (u32)i);
@@ -9913,7 +11601,7 @@ void rtti_gen_struct_member(struct context *ctx, vm_stack_ptr_t dest, struct mir
 vm_stack_ptr_t rtti_gen_struct_members_array(struct context *ctx, mir_members_t *members) {
 	struct mir_type *rtti_type    = ctx->builtin_types->t_TypeInfoStructMember;
 	struct mir_type *arr_tmp_type = create_type_array(ctx, NULL, rtti_type, sarrlen(members));
-	vm_stack_ptr_t   dest_arr_tmp = vm_alloc_raw(ctx->vm, ctx->assembly, arr_tmp_type);
+	vm_stack_ptr_t   dest_arr_tmp = rtti_alloc_array(ctx, arr_tmp_type);
 	for (usize i = 0; i < sarrlenu(members); ++i) {
 		struct mir_member *it                = sarrpeek(members, i);
 		vm_stack_ptr_t     dest_arr_tmp_elem = vm_get_array_elem_ptr(arr_tmp_type, dest_arr_tmp, (u32)i);
@@ -9993,7 +11681,7 @@ vm_stack_ptr_t rtti_gen_fn_args_array(struct context *ctx, mir_args_t *args) {
 	struct mir_type *rtti_type    = ctx->builtin_types->t_TypeInfoFnArg;
 	struct mir_type *arr_tmp_type = create_type_array(ctx, NULL, rtti_type, (s64)sarrlenu(args));
 
-	vm_stack_ptr_t dest_arr_tmp = vm_alloc_raw(ctx->vm, ctx->assembly, arr_tmp_type);
+	vm_stack_ptr_t dest_arr_tmp = rtti_alloc_array(ctx, arr_tmp_type);
 
 	for (usize i = 0; i < sarrlenu(args); ++i) {
 		struct mir_arg *it                = sarrpeek(args, i);
@@ -10007,7 +11695,7 @@ vm_stack_ptr_t rtti_gen_fn_args_array(struct context *ctx, mir_args_t *args) {
 vm_stack_ptr_t rtti_gen_fns_array(struct context *ctx, mir_types_t *fns) {
 	struct mir_type *rtti_type    = ctx->builtin_types->t_TypeInfoFn_ptr;
 	struct mir_type *arr_tmp_type = create_type_array(ctx, NULL, rtti_type, sarrlen(fns));
-	vm_stack_ptr_t   dest_arr_tmp = vm_alloc_raw(ctx->vm, ctx->assembly, arr_tmp_type);
+	vm_stack_ptr_t   dest_arr_tmp = rtti_alloc_array(ctx, arr_tmp_type);
 	for (usize i = 0; i < sarrlenu(fns); ++i) {
 		struct mir_type *it                = sarrpeek(fns, i);
 		vm_stack_ptr_t   dest_arr_tmp_elem = vm_get_array_elem_ptr(arr_tmp_type, dest_arr_tmp, (u32)i);
@@ -10746,7 +12434,7 @@ struct mir_instr *ast_expr_lit_fn(struct context      *ctx,
 		}
 	}
 
-	MIR_CEV_WRITE_AS(struct mir_fn *, &fn_proto->base.value, fn);
+	MIR_CEV_WRITE_AS(struct mir_fn *, ctx->assembly, &fn_proto->base.value, fn);
 
 	if ((isflag(fn->flags, FLAG_EXTERN) || isflag(fn->flags, FLAG_INTRINSIC) || isflag(fn->flags, FLAG_EXPORT)) && fn->generated_flavor) {
 		report_error(INVALID_CALL_CONVENTION,
@@ -10775,6 +12463,24 @@ struct mir_instr *ast_expr_lit_fn(struct context      *ctx,
 		goto FINISH;
 	}
 
+	if (ast_block->data.block.lazy_decl) {
+		// The body was skipped by the parser; it's generated on the first use of the function.
+		fn->lazy_lit_fn = lit_fn;
+		goto FINISH;
+	}
+
+	ast_fn_body(ctx, fn, lit_fn);
+
+FINISH:
+	set_current_block(ctx, prev_block);
+	ast_pop_defer_stack(ctx);
+	return &fn_proto->base;
+}
+
+void ast_fn_body(struct context *ctx, struct mir_fn *fn, struct ast *lit_fn) {
+	struct ast *ast_block   = lit_fn->data.expr_fn.block;
+	struct ast *ast_fn_type = lit_fn->data.expr_fn.type;
+
 	// Set body scope for DI.
 	bassert(ast_block->owner_scope && ast_block->owner_scope->kind == SCOPE_FN_BODY);
 	fn->body_scope = ast_block->owner_scope;
@@ -10843,17 +12549,12 @@ struct mir_instr *ast_expr_lit_fn(struct context      *ctx,
 		}
 	}
 
-	if (isflag(flags, FLAG_TEST_FN)) {
+	if (isflag(fn->flags, FLAG_TEST_FN)) {
 		++ctx->assembly->testing.expected_test_count;
 	}
 
 	// generate body instructions
 	ast(ctx, ast_block);
-
-FINISH:
-	set_current_block(ctx, prev_block);
-	ast_pop_defer_stack(ctx);
-	return &fn_proto->base;
 }
 
 struct mir_instr *ast_expr_lit_fn_group(struct context *ctx, struct ast *group) {
@@ -11060,14 +12761,14 @@ void report_poly(struct mir_instr *instr) {
 	struct mir_fn *owner_fn = mir_instr_owner_fn(instr);
 	if (!owner_fn) return;
 	if (!owner_fn->generated.first_call_node) return;
-	if (!owner_fn->generated.first_call_node->location) return;
+	if (!owner_fn->generated.first_call_node->unit) return;
 	const str_t debug_replacement = owner_fn->generated.debug_replacement_types;
 	if (debug_replacement.len) {
-		builder_msg(MSG_ERR_NOTE, 0, owner_fn->decl_node->location, CARET_WORD, "In polymorphic function with substitution: " STR_FMT "", STR_ARG(debug_replacement));
+		builder_msg(MSG_ERR_NOTE, 0, ast_tmp_location(owner_fn->decl_node), CARET_WORD, "In polymorphic function with substitution: " STR_FMT "", STR_ARG(debug_replacement));
 	} else {
-		builder_msg(MSG_ERR_NOTE, 0, owner_fn->decl_node->location, CARET_WORD, "In function:");
+		builder_msg(MSG_ERR_NOTE, 0, ast_tmp_location(owner_fn->decl_node), CARET_WORD, "In function:");
 	}
-	builder_msg(MSG_ERR_NOTE, 0, owner_fn->generated.first_call_node->location, CARET_WORD, "First called here:");
+	builder_msg(MSG_ERR_NOTE, 0, ast_tmp_location(owner_fn->generated.first_call_node), CARET_WORD, "First called here:");
 }
 
 // Helper for function declaration generation.
@@ -11430,7 +13131,7 @@ struct mir_instr *ast_ref(struct context *ctx, struct ast *ref) {
 	bassert(ident);
 	struct scope *scope       = ident->owner_scope;
 	const hash_t  scope_layer = ctx->fn_generate.current_scope_layer;
-	struct unit  *unit        = ident->location->unit;
+	struct unit  *unit        = ident->unit;
 	bassert(unit);
 	bassert(scope);
 	if (next) {
@@ -11692,7 +13393,7 @@ struct mir_instr *ast_type_poly(struct context *ctx, struct ast *poly) {
 	scope_entry->data.type       = slave_type;
 
 	struct mir_instr *instr_poly = append_instr_type_poly(ctx, poly, scope_entry->id);
-	MIR_CEV_WRITE_AS(struct mir_type *, &instr_poly->value, master_type);
+	MIR_CEV_WRITE_AS(struct mir_type *, ctx->assembly, &instr_poly->value, master_type);
 	return instr_poly;
 USE_DUMMY:
 	reset_poly_replacement_queue(ctx);
@@ -11733,7 +13434,7 @@ struct mir_instr *ast_create_expr_resolver_call(struct context *ctx, str_t fn_na
 	                                  .is_global    = true,
 	                              });
 
-	MIR_CEV_WRITE_AS(struct mir_fn *, &fn_proto->value, fn);
+	MIR_CEV_WRITE_AS(struct mir_fn *, ctx->assembly, &fn_proto->value, fn);
 
 	fn->type                      = fn_type;
 	struct mir_instr_block *entry = append_block(ctx, fn, cstr("entry"), false);
@@ -12022,6 +13723,115 @@ struct mir_fn *mir_get_callee(const struct mir_instr_call *call) {
 	return fn;
 }
 
+// Values of memoizable types are fully described by their bytes (no pointers to other data).
+static bool is_memoizable_type(const struct mir_type *type) {
+	switch (type->kind) {
+	case MIR_TYPE_VOID:
+	case MIR_TYPE_TYPE:
+	case MIR_TYPE_INT:
+	case MIR_TYPE_REAL:
+	case MIR_TYPE_BOOL:
+	case MIR_TYPE_ENUM:
+		return true;
+	case MIR_TYPE_ARRAY:
+		return is_memoizable_type(type->data.array.elem_type);
+	case MIR_TYPE_STRUCT: {
+		// Active member of union is not known and bytes of others might be uninitialized.
+		if (type->data.strct.is_union) return false;
+		const mir_members_t *members = type->data.strct.members;
+		for (usize i = 0; i < sarrlenu(members); ++i) {
+			if (!is_memoizable_type(sarrpeek(members, i)->type)) return false;
+		}
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+static inline bool is_runtime_global_var(const struct mir_var *var) {
+	return isflag(var->iflags, MIR_VAR_GLOBAL) && !var->value.is_comptime;
+}
+
+// Returns MIR_FN_PURITY_UNKNOWN in case the decision depends on function not analyzed yet.
+static enum mir_fn_purity check_fn_purity(struct mir_fn *fn) {
+	if (isflag(fn->flags, FLAG_EXTERN) || isflag(fn->flags, FLAG_INTRINSIC)) return MIR_FN_PURITY_IMPURE;
+	const struct mir_type *type = fn->type;
+	if (!is_memoizable_type(type->data.fn.ret_type)) return MIR_FN_PURITY_IMPURE;
+	for (usize i = 0; i < sarrlenu(type->data.fn.args); ++i) {
+		if (!is_memoizable_type(sarrpeek(type->data.fn.args, i)->type)) return MIR_FN_PURITY_IMPURE;
+	}
+	// Explicitly annotated functions are trusted.
+	if (isflag(fn->flags, FLAG_PURE)) return MIR_FN_PURITY_PURE;
+	if (!fn->first_block) return MIR_FN_PURITY_IMPURE;
+
+	for (struct mir_instr *it = &fn->first_block->base; it; it = it->next) {
+		struct mir_instr_block *block = (struct mir_instr_block *)it;
+		for (struct mir_instr *instr = block->entry_instr; instr; instr = instr->next) {
+			switch (instr->kind) {
+			case MIR_INSTR_DECL_REF: {
+				struct scope_entry *entry = ((struct mir_instr_decl_ref *)instr)->scope_entry;
+				if (entry && entry->kind == SCOPE_ENTRY_VAR && is_runtime_global_var(entry->data.var)) {
+					return MIR_FN_PURITY_IMPURE;
+				}
+				break;
+			}
+			case MIR_INSTR_DECL_DIRECT_REF: {
+				struct mir_instr *ref = ((struct mir_instr_decl_direct_ref *)instr)->ref;
+				if (ref->kind == MIR_INSTR_DECL_VAR && is_runtime_global_var(((struct mir_instr_decl_var *)ref)->var)) {
+					return MIR_FN_PURITY_IMPURE;
+				}
+				break;
+			}
+			case MIR_INSTR_CALL: {
+				struct mir_instr_call *call = (struct mir_instr_call *)instr;
+				// Calls via function pointers are not followed.
+				if (!mir_is_comptime(call->callee)) return MIR_FN_PURITY_IMPURE;
+				struct mir_fn *callee = mir_get_callee(call);
+				if (callee == fn) break; // Direct recursion.
+				if (!callee->is_fully_analyzed) return MIR_FN_PURITY_UNKNOWN;
+				if (!mir_is_fn_pure(callee)) {
+					return callee->purity == MIR_FN_PURITY_UNKNOWN ? MIR_FN_PURITY_UNKNOWN : MIR_FN_PURITY_IMPURE;
+				}
+				break;
+			}
+			case MIR_INSTR_MSG:
+			case MIR_INSTR_UNREACHABLE:
+			case MIR_INSTR_DEBUGBREAK:
+			case MIR_INSTR_CALL_LOC:
+			case MIR_INSTR_SET_INITIALIZER:
+			case MIR_INSTR_TEST_CASES:
+				return MIR_FN_PURITY_IMPURE;
+			default:
+				break;
+			}
+		}
+	}
+	return MIR_FN_PURITY_PURE;
+}
+
+// Checks whether the function result depends only on its argument values and the function has no
+// observable side-effects, so the result of its compile-time call can be reused for the same
+// arguments. Function is pure when it's explicitly marked as #pure or it does not touch any runtime
+// globals, calls only pure functions and all its arguments and the return value are pointer-free.
+// Mutual recursion is conservatively considered impure.
+bool mir_is_fn_pure(struct mir_fn *fn) {
+	bmagic_assert(fn);
+	switch (fn->purity) {
+	case MIR_FN_PURITY_PURE:
+		return true;
+	case MIR_FN_PURITY_IMPURE:
+	case MIR_FN_PURITY_CHECKING:
+		return false;
+	case MIR_FN_PURITY_UNKNOWN:
+		break;
+	}
+	if (!fn->is_fully_analyzed) return false;
+	fn->purity = MIR_FN_PURITY_CHECKING;
+	fn->purity = check_fn_purity(fn);
+	return fn->purity == MIR_FN_PURITY_PURE;
+}
+
 static void _type2str(str_buf_t *buf, const struct mir_type *type, bool prefer_name) {
 	if (!type) {
 		str_buf_append(buf, cstr("<unknown>"));
@@ -12160,6 +13970,35 @@ vm_stack_ptr_t _mir_cev_read(struct mir_const_expr_value *value) {
 }
 #endif
 
+vm_stack_ptr_t mir_cev_storage(struct assembly *assembly, struct mir_const_expr_value *value) {
+	bassert(value);
+	if (value->data) return value->data;
+	struct mir_arenas *arenas = &assembly->thread_local_contexts[get_worker_index()].mir_arenas;
+	value->data               = arena_alloc(&arenas->value);
+	return value->data;
+}
+
+void *mir_alloc_instr(struct assembly *assembly, enum mir_instr_kind kind) {
+	struct mir_arenas *arenas = &assembly->thread_local_contexts[get_worker_index()].mir_arenas;
+	struct mir_instr  *instr  = arena_alloc(get_instr_arena(arenas, kind));
+	instr->kind               = kind;
+	bmagic_set(instr);
+	return instr;
+}
+
+void mir_instr_memory_usage(struct assembly *assembly, s64 *count, s64 *bytes) {
+	*count = 0;
+	*bytes = 0;
+	for (usize i = 0; i < arrlenu(assembly->thread_local_contexts); ++i) {
+		struct mir_arenas *arenas = &assembly->thread_local_contexts[i].mir_arenas;
+		for (usize j = 0; j < MIR_INSTR_SIZE_CLASS_COUNT; ++j) {
+			*count += (s64)arenas->instr[j].num_allocations;
+			*bytes += (s64)(arenas->instr[j].num_allocations * arenas->instr[j].elem_size_bytes);
+		}
+		*bytes += (s64)(arenas->value.num_allocations * arenas->value.elem_size_bytes);
+	}
+}
+
 str_buf_t mir_type2str(const struct mir_type *type, bool prefer_name) {
 	str_buf_t buf = get_tmp_str();
 	_type2str(&buf, type, prefer_name);
@@ -12288,11 +14127,13 @@ str_t get_intrinsic(const str_t name) {
 }
 
 void mir_arenas_init(struct mir_arenas *arenas, u32 owner_thread_index) {
-	const usize instr_size = SIZEOF_MIR_INSTR;
-
 	const s32 PREALLOC_BASE = 1024;
 
-	arena_init(&arenas->instr, instr_size, ALIGNOF_MIR_INSTR, owner_thread_index == 0 ? PREALLOC_BASE * 10 : PREALLOC_BASE * 4, owner_thread_index, NULL);
+	for (usize i = 0; i < MIR_INSTR_SIZE_CLASS_COUNT; ++i) {
+		const usize instr_size = MIN(INSTR_SIZE_CLASS_BASE + INSTR_SIZE_CLASS_STEP * i, SIZEOF_MIR_INSTR);
+		arena_init(&arenas->instr[i], instr_size, ALIGNOF_MIR_INSTR, owner_thread_index == 0 ? PREALLOC_BASE * 10 : PREALLOC_BASE * 4, owner_thread_index, NULL);
+	}
+	arena_init(&arenas->value, sizeof(vm_value_t), alignment_of(u64), PREALLOC_BASE * 4, owner_thread_index, NULL);
 	arena_init(&arenas->type, sizeof(struct mir_type), alignment_of(struct mir_type), owner_thread_index == 0 ? PREALLOC_BASE * 2 : PREALLOC_BASE, owner_thread_index, NULL);
 	arena_init(&arenas->var, sizeof(struct mir_var), alignment_of(struct mir_var), PREALLOC_BASE * 2, owner_thread_index, NULL);
 	arena_init(&arenas->fn_generated, sizeof(struct mir_fn_generated_recipe), alignment_of(struct mir_fn_generated_recipe), PREALLOC_BASE, owner_thread_index, (arena_elem_dtor_t)&fn_poly_dtor);
@@ -12305,7 +14146,10 @@ void mir_arenas_init(struct mir_arenas *arenas, u32 owner_thread_index) {
 
 void mir_arenas_terminate(struct mir_arenas *arenas) {
 	arena_terminate(&arenas->fn);
-	arena_terminate(&arenas->instr);
+	for (usize i = 0; i < MIR_INSTR_SIZE_CLASS_COUNT; ++i) {
+		arena_terminate(&arenas->instr[i]);
+	}
+	arena_terminate(&arenas->value);
 	arena_terminate(&arenas->member);
 	arena_terminate(&arenas->type);
 	arena_terminate(&arenas->var);
@@ -12414,8 +14258,10 @@ void mir_init(struct assembly *assembly) {
 
 	mir->type_cache = NULL;
 	tbl_init(mir->type_cache, 2048);
+	tbl_init(mir->type_struct_cache, 2048);
 	tbl_init(mir->rtti_table, 2048);
 	tbl_init(mir->analyze.skipped_instructions, 1024);
+	tbl_init(mir->analyze.deferred_fns, 256);
 	arrsetcap(mir->global_instrs, 4096);
 	arrsetcap(mir->exported_instrs, 256);
 	arrsetcap(mir->analyze.usage_check_arr, 256);
@@ -12438,6 +14284,13 @@ void mir_init(struct assembly *assembly) {
 void mir_terminate(struct assembly *assembly) {
 	struct mir *mir = &assembly->mir;
 
+	for (usize i = 0; i < arrlenu(assembly->thread_local_contexts); ++i) {
+		struct mir_rtti_context *rtti_context = assembly->thread_local_contexts[i].rtti_context;
+		if (!rtti_context) continue;
+		terminate_context(&rtti_context->ctx);
+		bfree(rtti_context);
+	}
+
 	mtx_destroy(&mir->type_cache_lock);
 	spl_destroy(&mir->global_instrs_lock);
 	spl_destroy(&mir->rtti_table_lock);
@@ -12447,6 +14300,7 @@ void mir_terminate(struct assembly *assembly) {
 	arrfree(mir->global_instrs);
 	arrfree(mir->exported_instrs);
 	tbl_free(mir->type_cache);
+	tbl_free(mir->type_struct_cache);
 
 	mtx_destroy(&mir->analyze.stack_lock);
 
@@ -12455,8 +14309,10 @@ void mir_terminate(struct assembly *assembly) {
 	tbl_free(mir->analyze.skipped_instructions);
 	tbl_free(mir->analyze.waiting);
 	arrfree(mir->analyze.usage_check_arr);
+	tbl_free(mir->analyze.deferred_fns);
 	sarrfree(&mir->analyze.incomplete_rtti);
 	sarrfree(&mir->analyze.complete_check_type_stack);
+	sarrfree(&mir->analyze.complete_check_visited);
 }
 
 struct mir_var *mir_get_rtti(struct assembly *assembly, hash_t type_hash) {
@@ -12467,13 +14323,69 @@ struct mir_var *mir_get_rtti(struct assembly *assembly, hash_t type_hash) {
 	return result;
 }
 
+struct mir_var *mir_gen_rtti(struct assembly *assembly, struct mir_type *type) {
+	bassert(type);
+	struct mir_var *rtti_var = mir_get_rtti(assembly, type->id.hash);
+	if (rtti_var) return rtti_var;
+
+	const f64 start = get_tick_ms();
+
+	struct assembly_thread_local_context *local = &assembly->thread_local_contexts[get_worker_index()];
+	if (!local->rtti_context) {
+		local->rtti_context = bmalloc(sizeof(struct mir_rtti_context));
+		init_context(&local->rtti_context->ctx, assembly);
+	}
+	rtti_var = rtti_gen(&local->rtti_context->ctx, type);
+	batomic_fetch_add_s64(&assembly->stats.rtti_us, (s64)((get_tick_ms() - start) * 1000.));
+	return rtti_var;
+}
+
+struct mir_type *mir_get_rtti_type(struct assembly *assembly, const struct mir_type *type) {
+	struct builtin_types *bt = &assembly->builtin_types;
+	switch (type->kind) {
+	case MIR_TYPE_INT:
+		return bt->t_TypeInfoInt;
+	case MIR_TYPE_ENUM:
+		return bt->t_TypeInfoEnum;
+	case MIR_TYPE_REAL:
+		return bt->t_TypeInfoReal;
+	case MIR_TYPE_BOOL:
+		return bt->t_TypeInfoBool;
+	case MIR_TYPE_TYPE:
+		return bt->t_TypeInfoType;
+	case MIR_TYPE_VOID:
+		return bt->t_TypeInfoVoid;
+	case MIR_TYPE_NULL:
+		return bt->t_TypeInfoNull;
+	case MIR_TYPE_STRING:
+		return bt->t_TypeInfoString;
+	case MIR_TYPE_PTR:
+		return bt->t_TypeInfoPtr;
+	case MIR_TYPE_ARRAY:
+		return bt->t_TypeInfoArray;
+	case MIR_TYPE_DYNARR:
+	case MIR_TYPE_SLICE:
+	case MIR_TYPE_VARGS:
+	case MIR_TYPE_STRUCT:
+		return bt->t_TypeInfoStruct;
+	case MIR_TYPE_FN:
+		return bt->t_TypeInfoFn;
+	case MIR_TYPE_FN_GROUP:
+		return bt->t_TypeInfoFnGroup;
+	default:
+		return NULL;
+	}
+}
+
 void mir_unit_run(struct assembly *assembly, struct unit *unit) {
 	zone();
 	runtime_measure_begin(mir_unit);
+	const f64      start_ms = get_tick_ms();
 	struct context ctx;
 	init_context(&ctx, assembly);
 	ast(&ctx, unit->ast);
 	terminate_context(&ctx);
+	unit->stats.mir_generate_ms = get_tick_ms() - start_ms;
 	batomic_fetch_add_s32(&assembly->stats.mir_generate_ms, runtime_measure_end(mir_unit));
 	return_zone();
 }
@@ -12485,6 +14397,8 @@ void mir_analyze_run(struct assembly *assembly) {
 	// Analyze pass
 	struct context ctx;
 	init_context(&ctx, assembly);
+	struct opt_context octx = {.ctx = &ctx, .assembly = assembly};
+	ctx.opt                 = &octx;
 
 	// Register user-defined constants.
 	const struct target *target = assembly->target;
@@ -12505,11 +14419,16 @@ void mir_analyze_run(struct assembly *assembly) {
 	if (builder.errorc) goto DONE;
 
 	analyze_report_unused(&ctx);
+	if (builder.errorc) goto DONE;
+
+	optimize(&ctx);
 
 	blog("Analyze queue push count: %i", push_count);
 
 DONE:
 	batomic_fetch_add_s32(&assembly->stats.mir_analyze_ms, runtime_measure_end(mir_analyze));
+	opt_terminate(&octx);
+	arrfree(ctx.opt_queue);
 
 	if (!builder.options->do_cleanup_when_done) return_zone();
 	terminate_context(&ctx);
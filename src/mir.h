@@ -23,8 +23,8 @@ vm_stack_ptr_t _mir_cev_read(struct mir_const_expr_value *value);
 #endif
 
 // Helper macro for reading Const Expression Values of fundamental types.
-#define MIR_CEV_READ_AS(T, src)        (*((T *)_mir_cev_read(src)))
-#define MIR_CEV_WRITE_AS(T, dest, src) (*((T *)(dest)->data) = (src))
+#define MIR_CEV_READ_AS(T, src)                  (*((T *)_mir_cev_read(src)))
+#define MIR_CEV_WRITE_AS(T, assembly, dest, src) (*((T *)mir_cev_storage((assembly), (dest))) = (src))
 
 #define UNROLL_LAST_INDEX -1
 
@@ -47,8 +47,13 @@ struct mir_const_expr_value;
 #include "mir.def"
 #undef GEN_INSTR
 
+// Instructions are allocated by size from arenas of 8 byte stepped size classes, so small (and
+// most common) instructions does not waste the space of the largest one.
+#define MIR_INSTR_SIZE_CLASS_COUNT 8
+
 struct mir_arenas {
-	struct arena instr;
+	struct arena instr[MIR_INSTR_SIZE_CLASS_COUNT];
+	struct arena value;
 	struct arena type;
 	struct arena var;
 	struct arena fn;
@@ -82,6 +87,11 @@ struct skipped_instr_entry {
 	struct mir_instr *hash;
 };
 
+struct deferred_fn_entry {
+	struct scope  *hash; // Function body scope.
+	struct mir_fn *fn;
+};
+
 struct waiting_entry {
 	hash_t   hash;
 	instrs_t value;
@@ -104,10 +114,21 @@ struct mir_analyze {
 	mir_rttis_t incomplete_rtti;
 
 	// Incomplete type check stack.
-	mir_types_t          complete_check_type_stack;
+	mir_types_t complete_check_type_stack;
+	// Types visited by the last incomplete type check, the check visit mark is used as the
+	// membership test, so the set is "cleared" just by incrementing the mark.
+	mir_types_t complete_check_visited;
+	u32         complete_check_mark;
+	// Incremented every time some forward declared structure is completed, incomplete type
+	// check results are valid only in the epoch they were produced in.
+	u32 type_completion_epoch;
+
 	struct scope_entry **usage_check_arr;
 	struct scope_entry  *unnamed_entry;
 
+	// Functions with body analysis deferred until the first use mapped by the body scope.
+	hash_table(struct deferred_fn_entry) deferred_fns;
+
 	// Table of instruction being skipped in analyze pass, this should be empty at the end
 	// of analyze!
 	hash_table(struct skipped_instr_entry) skipped_instructions;
@@ -124,6 +145,7 @@ struct mir {
 	spl_t exported_instrs_lock;
 
 	hash_table(struct mir_type_cache_entry) type_cache;
+	hash_table(struct mir_type_struct_cache_entry) type_struct_cache;
 	mtx_t type_cache_lock;
 
 	struct mir_analyze analyze;
@@ -159,6 +181,15 @@ enum mir_type_kind {
 	MIR_TYPE_PLACEHOLDER = 19,
 };
 
+// Structural type cache entry; type is identified by kind, child type and optional length.
+struct mir_type_struct_cache_entry {
+	u64                    hash;
+	enum mir_type_kind     kind;
+	const struct mir_type *child;
+	s64                    len;
+	struct mir_type       *type;
+};
+
 // External function arguments passing composite types by value needs special handling in IR.
 enum llvm_extern_arg_struct_generation_mode {
 	LLVM_EASGM_NONE,  // No special handling
@@ -218,6 +249,14 @@ struct recipe_entry {
 	struct mir_fn *replacement;
 };
 
+// Generated mixed function identified by the polymorph replacement types and values of compile-time
+// known arguments.
+struct recipe_comptime_entry {
+	hash_t         hash;
+	str_t          key;
+	struct mir_fn *replacement;
+};
+
 struct mir_fn_generated_recipe {
 	// Function literal (used for function replacement generation).
 	struct ast *ast_lit_fn;
@@ -225,9 +264,20 @@ struct mir_fn_generated_recipe {
 	hash_t scope_layer;
 	// Cache of already generated functions (replacement hash -> struct mir_fn*).
 	hash_table(struct recipe_entry) entries;
+	// Cache of already generated mixed functions (instance key -> struct mir_fn*). Generated functions
+	// live in the assembly arenas, so both caches are valid only within one assembly.
+	hash_table(struct recipe_comptime_entry) comptime_entries;
 	bmagic_member
 };
 
+// Cached result of the function side-effect analysis used for memoization of compile-time calls.
+enum mir_fn_purity {
+	MIR_FN_PURITY_UNKNOWN = 0,
+	MIR_FN_PURITY_CHECKING,
+	MIR_FN_PURITY_PURE,
+	MIR_FN_PURITY_IMPURE,
+};
+
 enum mir_fn_generated_flavor_flags {
 	MIR_FN_GENERATED_NONE  = 0,
 	MIR_FN_GENERATED_POLY  = 1 << 1,
@@ -268,6 +318,9 @@ struct mir_fn {
 
 	// function body scope if there is one (optional)
 	struct scope    *body_scope;
+	// Optional, set for functions with body skipped by the parser (lazy parsing), the body is
+	// parsed and generated when the function is referenced for the first time.
+	struct ast *lazy_lit_fn;
 	struct mir_type *type;
 	array(struct mir_var *) variables;
 	// Linkage name of the function, this name is used during linking to identify function,
@@ -280,6 +333,8 @@ struct mir_fn {
 	bool                 is_fully_analyzed;
 	bool                 is_global;
 	bool                 is_disabled; // Set based on optional enable_if expression in function prototype.
+	bool                 is_body_deferred; // Prototype is analyzed, but the body is waiting for the first use.
+	enum mir_fn_purity   purity;           // See mir_is_fn_pure.
 	s32                  ref_count;
 	enum ast_flags       flags;
 	enum builtin_id_kind builtin_id;
@@ -300,6 +355,16 @@ struct mir_fn {
 	} dyncall;              // dyncall external context
 	str_t obsolete_message; // Optional, check len!
 
+	// Collected only when '--time-report' is enabled.
+	struct {
+		f64 analyze_ms; // Including compile-time execution triggered from the function.
+		f64 comptime_ms;
+		f64 ir_ms;
+		s32 postpone_count;  // Analyze of an instruction postponed or waiting for a symbol.
+		s32 polymorph_count; // Count of functions generated from this recipe.
+		s32 llvm_instr_count;
+	} report;
+
 	bmagic_member
 };
 
@@ -455,6 +520,12 @@ struct mir_type {
 	s8                 alignment;
 	bool               checked_and_complete;
 
+	// Memoized result of the last incomplete type check. The first_incomplete is valid only in
+	// case the incomplete_epoch matches current type completion epoch.
+	u32              complete_check_mark;
+	u32              incomplete_epoch;
+	struct mir_type *first_incomplete;
+
 	// In case this is true, the type does not hold any unique state (e.g. s32, pointer to s32,
 	// etc.) and thus it can be cached instead of created each time when needed.
 	bool can_use_cache;
@@ -536,9 +607,6 @@ enum mir_instr_state {
 
 struct mir_instr {
 	struct mir_const_expr_value value;
-	enum mir_instr_kind         kind;
-	enum mir_instr_state        state;
-	u64                         id;
 	struct ast                 *node;
 	struct mir_instr_block     *owner_block;
 
@@ -550,10 +618,13 @@ struct mir_instr {
 	struct mir_instr *prev;
 	struct mir_instr *next;
 
+	enum mir_instr_kind  kind;
+	enum mir_instr_state state;
+	u32                  id; // Used only for debug output.
+	s32                  ref_count;
 #if defined(BL_DEBUG) || defined(BL_ASSERT_ENABLE)
 	enum mir_instr_kind _orig_kind;
 #endif
-	s32  ref_count;
 	bool is_implicit;
 	bmagic_member
 };
@@ -1084,7 +1155,7 @@ static inline bool mir_type_has_llvm_representation(const struct mir_type *type)
 
 static inline bool mir_type_cmp(const struct mir_type *first, const struct mir_type *second) {
 	bassert(first && second);
-	return first->id.hash == second->id.hash;
+	return first == second || first->id.hash == second->id.hash;
 }
 
 static inline bool mir_is_zero_initialized(const struct mir_instr_compound *compound) {
@@ -1103,15 +1174,30 @@ static inline struct mir_fn *mir_instr_owner_fn(struct mir_instr *instr) {
 
 void            mir_init(struct assembly *assembly);
 void            mir_arenas_init(struct mir_arenas *arenas, u32 owner_thread_index);
+// Returns the value data pointer, in case there is none, the small value storage is allocated. We
+// don't allocate the storage for each instruction since most of them never hold any compile-time
+// value.
+vm_stack_ptr_t  mir_cev_storage(struct assembly *assembly, struct mir_const_expr_value *value);
+// Allocate zero initialized instruction of the kind without any other setup, this is used to
+// reconstruct instructions not generated from the AST.
+void           *mir_alloc_instr(struct assembly *assembly, enum mir_instr_kind kind);
+// Count of all allocated instructions and bytes used by them including compile-time value storage.
+void            mir_instr_memory_usage(struct assembly *assembly, s64 *count, s64 *bytes);
 void            mir_arenas_terminate(struct mir_arenas *arenas);
 void            mir_terminate(struct assembly *assembly);
 struct mir_var *mir_get_rtti(struct assembly *assembly, hash_t type_hash);
+// Returns RTTI variable of the type; the variable (including RTTI of all nested types) is generated
+// in the VM memory on the first request.
+struct mir_var *mir_gen_rtti(struct assembly *assembly, struct mir_type *type);
+// Returns builtin TypeInfo structure type used to describe the type.
+struct mir_type *mir_get_rtti_type(struct assembly *assembly, const struct mir_type *type);
 bool            mir_is_in_comptime_fn(struct mir_instr *instr);
 str_buf_t       mir_type2str(const struct mir_type *type, bool prefer_name);
 const char     *mir_instr_name(const struct mir_instr *instr);
 void            mir_unit_run(struct assembly *assembly, struct unit *unit);
 void            mir_analyze_run(struct assembly *assembly);
 struct mir_fn  *mir_get_callee(const struct mir_instr_call *call);
+bool            mir_is_fn_pure(struct mir_fn *fn);
 str_t           mir_get_fn_readable_name(struct mir_fn *fn);
 
 #endif
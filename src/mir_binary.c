@@ -0,0 +1,1315 @@
+#include "assembly.h"
+#include "builder.h"
+#include "mir.h"
+#include "stb_ds.h"
+#include "table.h"
+#include "tokens_inline_utils.h"
+#include "unit.h"
+
+// Binary MIR snapshot.
+//
+// The whole analyzed MIR graph reachable from the global instructions (types, functions, variables,
+// instructions, compile-time values and source locations) is flattened into sections of objects
+// referencing each other by index. All integers are stored as LEB128 variable length numbers, so
+// the most of references, ids and flags take one or two bytes.
+//
+// File layout:
+//   magic, format version, compiler version
+//   string count and object count of each section
+//   kinds of all instructions (needed to preallocate instructions before loading)
+//   string table
+//   global instruction references
+//   section data in order of 'enum section_kind'
+//
+// Objects are serialized and deserialized by the same functions, so the writer and the loader cannot
+// diverge. The loaded MIR is supposed to be used for inspection; runtime state of the compiler
+// process (LLVM values, external symbol handles, VM stack) is not part of the snapshot.
+
+#define MIR_BINARY_MAGIC   "BLMB"
+#define MIR_BINARY_VERSION 1
+
+enum section_kind {
+	SECTION_UNIT,
+	SECTION_ID,
+	SECTION_SCOPE,
+	SECTION_NODE,
+	SECTION_TYPE,
+	SECTION_MEMBER,
+	SECTION_ARG,
+	SECTION_VARIANT,
+	SECTION_FN,
+	SECTION_VAR,
+	SECTION_INSTR,
+	SECTION_COUNT,
+};
+
+struct object_entry {
+	void *hash;
+	u32   index;
+};
+
+struct string_entry {
+	hash_t hash;
+	str_t  key;
+	u32    index;
+};
+
+struct section {
+	// Object to index mapping (used only by writer).
+	hash_table(struct object_entry) table;
+	array(void *) objects;
+	array(u8) data;
+	usize done;
+	// Index of the last object of each section referenced from this section; references are stored
+	// relative to it, so references to neighbouring objects take only one byte.
+	s64 last_refs[SECTION_COUNT];
+};
+
+struct context {
+	struct assembly                      *assembly;
+	struct assembly_thread_local_context *local;
+	bool                                  is_loading;
+	struct section                        sections[SECTION_COUNT];
+	s64                                  *last_refs;
+	u32                                   last_instr_id;
+
+	// All strings are stored only once and referenced by index.
+	hash_table(struct string_entry) string_table;
+	array(str_t) strings;
+
+	// Writer
+	array(u8) *out;
+	array(u8) instr_kinds;
+
+	// Loader
+	const u8 *data;
+	usize     len;
+	usize     pos;
+	bool      is_corrupted;
+};
+
+// =================================================================================================
+// Primitives
+// =================================================================================================
+static void write_u64(struct context *ctx, u64 v) {
+	while (v >= 0x80) {
+		arrput(*ctx->out, (u8)(v | 0x80));
+		v >>= 7;
+	}
+	arrput(*ctx->out, (u8)v);
+}
+
+static u64 read_u64(struct context *ctx) {
+	u64 v     = 0;
+	s32 shift = 0;
+	while (true) {
+		if (ctx->pos >= ctx->len || shift > 63) {
+			ctx->is_corrupted = true;
+			return 0;
+		}
+		const u8 b = ctx->data[ctx->pos++];
+		v |= (u64)(b & 0x7f) << shift;
+		if (!(b & 0x80)) return v;
+		shift += 7;
+	}
+}
+
+// Zig-zag encoding keeps small negative numbers short.
+static inline u64 zigzag_encode(s64 v) {
+	return ((u64)v << 1) ^ (u64)(v >> 63);
+}
+
+static inline s64 zigzag_decode(u64 v) {
+	return (s64)(v >> 1) ^ -(s64)(v & 1);
+}
+
+static void serialize_s64(struct context *ctx, s64 *v) {
+	if (ctx->is_loading) {
+		*v = zigzag_decode(read_u64(ctx));
+	} else {
+		write_u64(ctx, zigzag_encode(*v));
+	}
+}
+
+// Serialize any integer, enum or boolean field.
+#define serialize_int(C, F)      \
+	{                            \
+		s64 _v = (s64)(F);       \
+		serialize_s64((C), &_v); \
+		(F) = _v;                \
+	}                            \
+	(void)0
+
+static bool check_available(struct context *ctx, s64 size) {
+	if (size < 0 || (usize)size > ctx->len - ctx->pos) {
+		ctx->is_corrupted = true;
+		return false;
+	}
+	return true;
+}
+
+// Serialize count of following items, each item takes at least one byte, so the count can be
+// validated against the rest of the loaded data.
+static void serialize_count(struct context *ctx, s64 *count) {
+	serialize_s64(ctx, count);
+	if (ctx->is_loading && !check_available(ctx, *count)) *count = 0;
+}
+
+static void serialize_bytes(struct context *ctx, void *ptr, usize size) {
+	if (!size) return;
+	if (ctx->is_loading) {
+		if (!check_available(ctx, (s64)size)) return;
+		memcpy(ptr, ctx->data + ctx->pos, size);
+		ctx->pos += size;
+	} else {
+		memcpy(arraddnptr(*ctx->out, size), ptr, size);
+	}
+}
+
+static void serialize_str_content(struct context *ctx, str_t *str) {
+	s64 len = str->len;
+	serialize_count(ctx, &len);
+	if (ctx->is_loading) {
+		*str = len ? _scdup2(&ctx->local->string_cache, (char *)ctx->data + ctx->pos, (s32)len) : make_str(NULL, 0);
+		ctx->pos += len;
+	} else {
+		serialize_bytes(ctx, str->ptr, str->len);
+	}
+}
+
+// String is stored as index into the string table plus one, zero is used for empty string.
+static void serialize_str(struct context *ctx, str_t *str) {
+	if (ctx->is_loading) {
+		u64 v = read_u64(ctx);
+		if (v > arrlenu(ctx->strings)) {
+			ctx->is_corrupted = true;
+			v                 = 0;
+		}
+		*str = v ? ctx->strings[v - 1] : make_str(NULL, 0);
+		return;
+	}
+	if (!str->len) {
+		write_u64(ctx, 0);
+		return;
+	}
+	const hash_t hash = strhash(*str);
+	const s32    i    = tbl_lookup_index_with_key(ctx->string_table, hash, *str);
+	if (i != -1) {
+		write_u64(ctx, (u64)ctx->string_table[i].index + 1);
+		return;
+	}
+	struct string_entry entry = {.hash = hash, .key = *str, .index = (u32)arrlenu(ctx->strings)};
+	tbl_insert(ctx->string_table, entry);
+	arrput(ctx->strings, *str);
+	write_u64(ctx, (u64)entry.index + 1);
+}
+
+// Zero terminated string, zero length is used for NULL.
+static void serialize_cstr(struct context *ctx, char **str) {
+	s64 len = *str ? (s64)strlen(*str) + 1 : 0;
+	serialize_count(ctx, &len);
+	if (!len) {
+		*str = NULL;
+	} else if (ctx->is_loading) {
+		*str = scdup(&ctx->local->string_cache, (const char *)ctx->data + ctx->pos, len - 1);
+		ctx->pos += len - 1;
+	} else {
+		serialize_bytes(ctx, *str, len - 1);
+	}
+}
+
+static void serialize_embedded_id(struct context *ctx, struct id *id) {
+	serialize_str(ctx, &id->str);
+	serialize_int(ctx, id->hash);
+}
+
+// Memory not owned by any MIR arena is allocated in the string cache (released together with the
+// assembly).
+static void *alloc_persistent(struct context *ctx, usize size) {
+	const usize alignment = 16;
+	void       *mem       = next_aligned(scdup(&ctx->local->string_cache, NULL, size + alignment), alignment);
+	bl_zeromem(mem, size);
+	return mem;
+}
+
+static u32 object_index(struct context *ctx, enum section_kind kind, void *object) {
+	struct section *section = &ctx->sections[kind];
+	const s32       i       = tbl_lookup_index(section->table, object);
+	if (i != -1) return section->table[i].index;
+
+	struct object_entry entry = {.hash = object, .index = (u32)arrlenu(section->objects)};
+	tbl_insert(section->table, entry);
+	arrput(section->objects, object);
+	if (kind == SECTION_INSTR) arrput(ctx->instr_kinds, (u8)((struct mir_instr *)object)->kind);
+	return entry.index;
+}
+
+// References are stored as distance to the last referenced object of the same section plus one,
+// zero is used for NULL.
+static void serialize_object_ref(struct context *ctx, enum section_kind kind, void **object) {
+	s64 *last = &ctx->last_refs[kind];
+	if (ctx->is_loading) {
+		const u64 v = read_u64(ctx);
+		if (!v) {
+			*object = NULL;
+			return;
+		}
+		const s64 index = *last + zigzag_decode(v - 1);
+		if (index < 0 || index >= arrlen(ctx->sections[kind].objects)) {
+			ctx->is_corrupted = true;
+			*object           = NULL;
+			return;
+		}
+		*object = ctx->sections[kind].objects[index];
+		*last   = index;
+	} else if (*object) {
+		const s64 index = object_index(ctx, kind, *object);
+		write_u64(ctx, zigzag_encode(index - *last) + 1);
+		*last = index;
+	} else {
+		write_u64(ctx, 0);
+	}
+}
+
+// Serialize pointer to object of section kind.
+#define serialize_ref(C, K, F)                   \
+	{                                            \
+		void *_p = (void *)(F);                  \
+		serialize_object_ref((C), (K), &_p);     \
+		(F) = _p;                                \
+	}                                            \
+	(void)0
+
+// Serialize optional small array of object pointers.
+#define serialize_refs(C, K, A)                                                         \
+	{                                                                                   \
+		s64 _len = (A) ? sarrlen(A) + 1 : 0;                                            \
+		serialize_count((C), &_len);                                                    \
+		if ((C)->is_loading) (A) = _len ? arena_alloc(&(C)->local->small_array) : NULL; \
+		for (s64 _i = 0; _i < _len - 1; ++_i) {                                         \
+			if ((C)->is_loading) sarrput((A), NULL);                                    \
+			serialize_ref((C), (K), sarrpeek((A), _i));                                 \
+		}                                                                               \
+	}                                                                                   \
+	(void)0
+
+// =================================================================================================
+// Compile-time values
+// =================================================================================================
+static bool is_plain_type(const struct mir_type *type) {
+	switch (type->kind) {
+	case MIR_TYPE_INT:
+	case MIR_TYPE_ENUM:
+	case MIR_TYPE_REAL:
+	case MIR_TYPE_BOOL:
+	case MIR_TYPE_NULL:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void serialize_value_content(struct context *ctx, const struct mir_type *type, vm_stack_ptr_t ptr) {
+	if (ctx->is_corrupted) return;
+	if (is_plain_type(type)) {
+		serialize_bytes(ctx, ptr, type->store_size_bytes);
+		return;
+	}
+
+	switch (type->kind) {
+	case MIR_TYPE_TYPE:
+		serialize_ref(ctx, SECTION_TYPE, vm_read_as(struct mir_type *, ptr));
+		break;
+
+	case MIR_TYPE_FN:
+		serialize_ref(ctx, SECTION_FN, vm_read_as(struct mir_fn *, ptr));
+		break;
+
+	case MIR_TYPE_NAMED_SCOPE:
+		serialize_ref(ctx, SECTION_SCOPE, vm_read_as(struct scope *, ptr));
+		break;
+
+	case MIR_TYPE_PTR:
+		if (mir_deref_type(type)->kind == MIR_TYPE_FN) {
+			serialize_ref(ctx, SECTION_FN, vm_read_as(struct mir_fn *, ptr));
+		} else {
+			// Other pointers are kept as they are only to be printed out, they're not valid
+			// outside of the original compiler process.
+			serialize_bytes(ctx, ptr, type->store_size_bytes);
+		}
+		break;
+
+	case MIR_TYPE_STRING:
+	case MIR_TYPE_SLICE:
+	case MIR_TYPE_DYNARR:
+	case MIR_TYPE_VARGS:
+	case MIR_TYPE_STRUCT: {
+		mir_members_t *members = type->data.strct.members;
+		for (usize i = 0; i < sarrlenu(members); ++i) {
+			struct mir_member *member = sarrpeek(members, i);
+			if (member->offset_bytes < 0 || (usize)member->offset_bytes + member->type->store_size_bytes > type->store_size_bytes) {
+				ctx->is_corrupted = true;
+				return;
+			}
+			vm_stack_ptr_t member_ptr = ptr + member->offset_bytes;
+			if (type->kind == MIR_TYPE_STRING && i == MIR_SLICE_PTR_INDEX) {
+				// String data are stored including the content.
+				serialize_cstr(ctx, &vm_read_as(char *, member_ptr));
+			} else {
+				serialize_value_content(ctx, member->type, member_ptr);
+			}
+		}
+		break;
+	}
+
+	case MIR_TYPE_ARRAY: {
+		struct mir_type *elem_type = type->data.array.elem_type;
+		if ((usize)type->data.array.len * elem_type->store_size_bytes > type->store_size_bytes) {
+			ctx->is_corrupted = true;
+			break;
+		}
+		if (is_plain_type(elem_type)) {
+			serialize_bytes(ctx, ptr, type->store_size_bytes);
+			break;
+		}
+		for (u32 i = 0; i < (u32)type->data.array.len; ++i) {
+			serialize_value_content(ctx, elem_type, ptr + vm_get_array_elem_offset(type, i));
+		}
+		break;
+	}
+
+	default:
+		// Values of other types have no content worth keeping.
+		break;
+	}
+}
+
+static void serialize_value_blob(struct context *ctx, const struct mir_type *type, vm_stack_ptr_t *data) {
+	if (ctx->is_loading) {
+		if (!type) {
+			ctx->is_corrupted = true;
+			return;
+		}
+		*data = alloc_persistent(ctx, MAX(type->store_size_bytes, sizeof(vm_value_t)));
+	}
+	serialize_value_content(ctx, type, *data);
+}
+
+static void serialize_value_data(struct context *ctx, const struct mir_type *type, vm_stack_ptr_t *data) {
+	bool has_data = type && *data;
+	serialize_int(ctx, has_data);
+	if (has_data) serialize_value_blob(ctx, type, data);
+}
+
+static void serialize_const_expr_value(struct context *ctx, struct mir_const_expr_value *value, bool with_data) {
+	serialize_ref(ctx, SECTION_TYPE, value->type);
+	vm_stack_ptr_t data = with_data && value->type ? value->data : NULL;
+	// Address mode, compile-time flag and data presence are packed together.
+	s64 bits = ((s64)value->addr_mode << 2) | ((s64)value->is_comptime << 1) | (data != NULL);
+	serialize_s64(ctx, &bits);
+	if (ctx->is_loading) {
+		value->addr_mode   = (enum mir_value_address_mode)(bits >> 2);
+		value->is_comptime = (bits >> 1) & 1;
+		value->data        = NULL;
+	}
+	if (bits & 1) serialize_value_blob(ctx, value->type, ctx->is_loading ? &value->data : &data);
+}
+
+// =================================================================================================
+// Objects
+// =================================================================================================
+static void serialize_unit(struct context *ctx, struct unit **unit) {
+	str_t filepath = *unit ? (*unit)->filepath : make_str(NULL, 0);
+	str_t name     = *unit ? (*unit)->name : make_str(NULL, 0);
+	serialize_str(ctx, &filepath);
+	serialize_str(ctx, &name);
+	if (ctx->is_loading) {
+		*unit = unit_new(ctx->assembly, filepath, name, unit_get_hash(filepath), NULL, NULL, NULL);
+		arrput(ctx->assembly->units, *unit);
+	}
+}
+
+static void serialize_id(struct context *ctx, struct id **id) {
+	if (ctx->is_loading) *id = alloc_persistent(ctx, sizeof(struct id));
+	serialize_embedded_id(ctx, *id);
+}
+
+static void serialize_scope(struct context *ctx, struct scope **scope) {
+	enum scope_kind kind = *scope ? (*scope)->kind : SCOPE_NONE;
+	str_t           name = *scope ? (*scope)->name : make_str(NULL, 0);
+	serialize_int(ctx, kind);
+	serialize_str(ctx, &name);
+	if (!ctx->is_loading) return;
+	if (kind <= SCOPE_NONE || kind > SCOPE_MODULE_PRIVATE) {
+		ctx->is_corrupted = true;
+		return;
+	}
+	*scope       = scope_create(&ctx->local->scope_thread_local, kind, NULL, NULL);
+	(*scope)->name = name;
+}
+
+static void serialize_node(struct context *ctx, struct ast **node) {
+	enum ast_kind    kind     = *node ? (*node)->kind : AST_BAD;
+	struct location *location = *node ? ast_tmp_location(*node) : NULL;
+	serialize_int(ctx, kind);
+	if (ctx->is_loading && (kind <= AST_BAD || kind > AST_EXPR_LIT_FN_GROUP)) {
+		ctx->is_corrupted = true;
+		return;
+	}
+	bool has_location = location;
+	serialize_int(ctx, has_location);
+	struct location loaded_location = {0};
+	if (ctx->is_loading) location = has_location ? &loaded_location : NULL;
+	if (location) {
+		serialize_ref(ctx, SECTION_UNIT, location->unit);
+		serialize_int(ctx, location->line);
+		serialize_int(ctx, location->col);
+		serialize_int(ctx, location->len);
+	}
+	if (ctx->is_loading) {
+		// Node location is computed from token positions, so we add one position for each loaded
+		// node into the token data of the unit.
+		struct unit *unit        = location ? location->unit : NULL;
+		u32          token_index = 0;
+		if (unit) {
+			token_index = (u32)tokens_len(&unit->tokens);
+			tokens_push(&unit->tokens, SYM_NONE, location->line, location->col, location->len, 0);
+		} else if (location) {
+			ctx->is_corrupted = true;
+			return;
+		}
+		*node = ast_create_node(&ctx->local->ast_arena, kind, unit, token_index, NULL);
+	}
+	if (kind == AST_IDENT) serialize_embedded_id(ctx, &(*node)->data.ident.id);
+}
+
+static void serialize_type(struct context *ctx, struct mir_type *type) {
+	serialize_int(ctx, type->kind);
+	if (type->kind < MIR_TYPE_INVALID || type->kind > MIR_TYPE_PLACEHOLDER) {
+		ctx->is_corrupted = true;
+		return;
+	}
+	serialize_ref(ctx, SECTION_ID, type->user_id);
+	serialize_embedded_id(ctx, &type->id);
+	serialize_int(ctx, type->size_bits);
+	serialize_int(ctx, type->store_size_bytes);
+	serialize_int(ctx, type->alignment);
+	serialize_int(ctx, type->checked_and_complete);
+	serialize_int(ctx, type->can_use_cache);
+
+	switch (type->kind) {
+	case MIR_TYPE_INT:
+		serialize_int(ctx, type->data.integer.bitcount);
+		serialize_int(ctx, type->data.integer.is_signed);
+		break;
+	case MIR_TYPE_REAL:
+		serialize_int(ctx, type->data.real.bitcount);
+		break;
+	case MIR_TYPE_FN: {
+		struct mir_type_fn *fn = &type->data.fn;
+		serialize_ref(ctx, SECTION_TYPE, fn->ret_type);
+		serialize_refs(ctx, SECTION_ARG, fn->args);
+		serialize_int(ctx, fn->argument_hash);
+		serialize_int(ctx, fn->flags);
+		serialize_int(ctx, fn->builtin_id);
+		serialize_int(ctx, fn->is_vargs);
+		serialize_int(ctx, fn->is_polymorph);
+		serialize_int(ctx, fn->has_default_args);
+		serialize_int(ctx, fn->has_byval);
+		serialize_int(ctx, fn->has_sret);
+		break;
+	}
+	case MIR_TYPE_FN_GROUP:
+		serialize_refs(ctx, SECTION_TYPE, type->data.fn_group.variants);
+		break;
+	case MIR_TYPE_PTR:
+		serialize_ref(ctx, SECTION_TYPE, type->data.ptr.expr);
+		if (ctx->is_loading && !type->data.ptr.expr) ctx->is_corrupted = true;
+		break;
+	case MIR_TYPE_ARRAY:
+		serialize_ref(ctx, SECTION_TYPE, type->data.array.elem_type);
+		serialize_int(ctx, type->data.array.len);
+		if (ctx->is_loading && !type->data.array.elem_type) ctx->is_corrupted = true;
+		break;
+	case MIR_TYPE_STRUCT:
+	case MIR_TYPE_STRING:
+	case MIR_TYPE_SLICE:
+	case MIR_TYPE_DYNARR:
+	case MIR_TYPE_VARGS: {
+		struct mir_type_struct *strct = &type->data.strct;
+		serialize_int(ctx, strct->scope_layer);
+		serialize_refs(ctx, SECTION_MEMBER, strct->members);
+		serialize_ref(ctx, SECTION_TYPE, strct->base_type);
+		serialize_int(ctx, strct->fwd_state);
+		serialize_int(ctx, strct->is_packed);
+		serialize_int(ctx, strct->is_union);
+		serialize_int(ctx, strct->is_multiple_return_type);
+		serialize_int(ctx, strct->is_string_literal);
+		break;
+	}
+	case MIR_TYPE_ENUM:
+		serialize_ref(ctx, SECTION_TYPE, type->data.enm.base_type);
+		serialize_refs(ctx, SECTION_VARIANT, type->data.enm.variants);
+		serialize_int(ctx, type->data.enm.is_flags);
+		if (ctx->is_loading && !type->data.enm.base_type) ctx->is_corrupted = true;
+		break;
+	case MIR_TYPE_NULL:
+		serialize_ref(ctx, SECTION_TYPE, type->data.null.base_type);
+		break;
+	case MIR_TYPE_POLY:
+		serialize_int(ctx, type->data.poly.is_master);
+		break;
+	default:
+		break;
+	}
+}
+
+static void serialize_member(struct context *ctx, struct mir_member *member) {
+	serialize_ref(ctx, SECTION_TYPE, member->type);
+	serialize_ref(ctx, SECTION_ID, member->id);
+	serialize_int(ctx, member->index);
+	serialize_int(ctx, member->tag);
+	serialize_int(ctx, member->offset_bytes);
+	serialize_int(ctx, member->is_base);
+	serialize_int(ctx, member->is_parent_union);
+	if (ctx->is_loading && (!member->type || !member->id)) ctx->is_corrupted = true;
+}
+
+static void serialize_arg(struct context *ctx, struct mir_arg *arg) {
+	serialize_ref(ctx, SECTION_TYPE, arg->type);
+	serialize_ref(ctx, SECTION_ID, arg->id);
+	serialize_int(ctx, arg->index);
+	serialize_int(ctx, arg->is_inside_recipe);
+	serialize_int(ctx, arg->is_inside_declaration);
+	serialize_int(ctx, arg->ref_count);
+	serialize_int(ctx, arg->flags);
+	serialize_int(ctx, arg->llvm_index);
+	serialize_ref(ctx, SECTION_INSTR, arg->default_value);
+	serialize_ref(ctx, SECTION_INSTR, arg->generation_call);
+	serialize_int(ctx, arg->llvm_easgm);
+}
+
+static void serialize_variant(struct context *ctx, struct mir_variant *variant) {
+	serialize_ref(ctx, SECTION_ID, variant->id);
+	serialize_ref(ctx, SECTION_TYPE, variant->value_type);
+	serialize_int(ctx, variant->value);
+	if (ctx->is_loading && !variant->id) ctx->is_corrupted = true;
+}
+
+static void serialize_fn(struct context *ctx, struct mir_fn *fn) {
+	serialize_ref(ctx, SECTION_INSTR, fn->prototype);
+	serialize_ref(ctx, SECTION_ID, fn->id);
+	serialize_ref(ctx, SECTION_TYPE, fn->type);
+	serialize_int(ctx, fn->generated_flavor);
+	serialize_str(ctx, &fn->generated.debug_replacement_types);
+	serialize_str(ctx, &fn->linkage_name);
+	serialize_str(ctx, &fn->full_name);
+	serialize_int(ctx, fn->is_fully_analyzed);
+	serialize_int(ctx, fn->is_global);
+	serialize_int(ctx, fn->is_disabled);
+	serialize_int(ctx, fn->is_body_deferred);
+	serialize_int(ctx, fn->ref_count);
+	serialize_int(ctx, fn->flags);
+	serialize_int(ctx, fn->builtin_id);
+	serialize_ref(ctx, SECTION_INSTR, fn->first_block);
+	serialize_ref(ctx, SECTION_INSTR, fn->last_block);
+	serialize_ref(ctx, SECTION_INSTR, fn->exit_block);
+	serialize_ref(ctx, SECTION_INSTR, fn->ret_tmp);
+	serialize_ref(ctx, SECTION_INSTR, fn->terminal_instr);
+	s64 variable_count = arrlen(fn->variables);
+	serialize_count(ctx, &variable_count);
+	for (s64 i = 0; i < variable_count; ++i) {
+		if (ctx->is_loading) arrput(fn->variables, NULL);
+		serialize_ref(ctx, SECTION_VAR, fn->variables[i]);
+	}
+	serialize_str(ctx, &fn->obsolete_message);
+}
+
+static void serialize_var(struct context *ctx, struct mir_var *var) {
+	serialize_const_expr_value(ctx, &var->value, var->value.is_comptime);
+	serialize_ref(ctx, SECTION_ID, var->id);
+	serialize_ref(ctx, SECTION_INSTR, var->initializer_block);
+	serialize_str(ctx, &var->linkage_name);
+	serialize_int(ctx, var->builtin_id);
+	serialize_int(ctx, var->flags);
+	serialize_int(ctx, var->iflags);
+	serialize_int(ctx, var->arg_index);
+	serialize_int(ctx, var->ref_count);
+	if (isflag(var->iflags, MIR_VAR_GLOBAL)) {
+		// Global runtime variable is initialized in compile-time, we keep its initial value.
+		vm_stack_ptr_t global = var->value.is_comptime ? NULL : var->vm_ptr.global;
+		serialize_value_data(ctx, var->value.type, &global);
+		if (ctx->is_loading) var->vm_ptr.global = global;
+	} else {
+		serialize_int(ctx, var->vm_ptr.local);
+	}
+}
+
+static void serialize_instr(struct context *ctx, struct mir_instr *instr) {
+	// Only values of analyzed instructions are valid, constants and function prototypes have values
+	// set from the beginning.
+	const bool has_value = instr->value.is_comptime && (instr->state == MIR_IS_COMPLETE ||
+	                                                    instr->kind == MIR_INSTR_CONST ||
+	                                                    instr->kind == MIR_INSTR_FN_PROTO);
+	// Instruction ids are mostly increasing.
+	s64 id_delta = (s64)instr->id - (s64)ctx->last_instr_id;
+	serialize_s64(ctx, &id_delta);
+	instr->id          = (u32)(ctx->last_instr_id + id_delta);
+	ctx->last_instr_id = instr->id;
+	s64 bits = ((s64)instr->state << 1) | instr->is_implicit;
+	serialize_s64(ctx, &bits);
+	instr->state       = (enum mir_instr_state)(bits >> 1);
+	instr->is_implicit = bits & 1;
+	serialize_int(ctx, instr->ref_count);
+	serialize_const_expr_value(ctx, &instr->value, has_value);
+	serialize_ref(ctx, SECTION_NODE, instr->node);
+	serialize_ref(ctx, SECTION_INSTR, instr->owner_block);
+	serialize_ref(ctx, SECTION_INSTR, instr->prev);
+	serialize_ref(ctx, SECTION_INSTR, instr->next);
+
+	switch (instr->kind) {
+	case MIR_INSTR_BLOCK: {
+		struct mir_instr_block *block = (struct mir_instr_block *)instr;
+		serialize_str(ctx, &block->name);
+		serialize_ref(ctx, SECTION_INSTR, block->entry_instr);
+		serialize_ref(ctx, SECTION_INSTR, block->last_instr);
+		serialize_ref(ctx, SECTION_INSTR, block->terminal);
+		serialize_ref(ctx, SECTION_FN, block->owner_fn);
+		serialize_int(ctx, block->is_unreachable);
+		break;
+	}
+	case MIR_INSTR_DECL_VAR: {
+		struct mir_instr_decl_var *decl = (struct mir_instr_decl_var *)instr;
+		serialize_ref(ctx, SECTION_VAR, decl->var);
+		serialize_ref(ctx, SECTION_INSTR, decl->type);
+		serialize_ref(ctx, SECTION_INSTR, decl->init);
+		if (ctx->is_loading && !decl->var) ctx->is_corrupted = true;
+		break;
+	}
+	case MIR_INSTR_DECL_MEMBER: {
+		struct mir_instr_decl_member *decl = (struct mir_instr_decl_member *)instr;
+		serialize_ref(ctx, SECTION_MEMBER, decl->member);
+		serialize_ref(ctx, SECTION_INSTR, decl->type);
+		serialize_ref(ctx, SECTION_INSTR, decl->tag);
+		if (ctx->is_loading && !decl->member) ctx->is_corrupted = true;
+		break;
+	}
+	case MIR_INSTR_DECL_VARIANT: {
+		struct mir_instr_decl_variant *decl = (struct mir_instr_decl_variant *)instr;
+		serialize_ref(ctx, SECTION_VARIANT, decl->variant);
+		serialize_ref(ctx, SECTION_VARIANT, decl->prev_variant);
+		serialize_ref(ctx, SECTION_INSTR, decl->value);
+		serialize_ref(ctx, SECTION_INSTR, decl->base_type);
+		serialize_int(ctx, decl->is_flags);
+		if (ctx->is_loading && !decl->variant) ctx->is_corrupted = true;
+		break;
+	}
+	case MIR_INSTR_DECL_ARG: {
+		struct mir_instr_decl_arg *decl = (struct mir_instr_decl_arg *)instr;
+		serialize_ref(ctx, SECTION_ARG, decl->arg);
+		serialize_ref(ctx, SECTION_INSTR, decl->type);
+		if (ctx->is_loading && !decl->arg) ctx->is_corrupted = true;
+		break;
+	}
+	case MIR_INSTR_CONST:
+		serialize_int(ctx, ((struct mir_instr_const *)instr)->volatile_type);
+		break;
+	case MIR_INSTR_LOAD: {
+		struct mir_instr_load *load = (struct mir_instr_load *)instr;
+		serialize_ref(ctx, SECTION_INSTR, load->src);
+		serialize_int(ctx, load->is_deref);
+		break;
+	}
+	case MIR_INSTR_STORE: {
+		struct mir_instr_store *store = (struct mir_instr_store *)instr;
+		serialize_ref(ctx, SECTION_INSTR, store->src);
+		serialize_ref(ctx, SECTION_INSTR, store->dest);
+		break;
+	}
+	case MIR_INSTR_BINOP: {
+		struct mir_instr_binop *binop = (struct mir_instr_binop *)instr;
+		serialize_int(ctx, binop->op);
+		serialize_ref(ctx, SECTION_INSTR, binop->lhs);
+		serialize_ref(ctx, SECTION_INSTR, binop->rhs);
+		serialize_int(ctx, binop->volatile_type);
+		serialize_int(ctx, binop->is_condition);
+		break;
+	}
+	case MIR_INSTR_RET: {
+		struct mir_instr_ret *ret = (struct mir_instr_ret *)instr;
+		serialize_ref(ctx, SECTION_INSTR, ret->value);
+		serialize_int(ctx, ret->expected_comptime);
+		break;
+	}
+	case MIR_INSTR_FN_PROTO: {
+		struct mir_instr_fn_proto *fn_proto = (struct mir_instr_fn_proto *)instr;
+		serialize_ref(ctx, SECTION_INSTR, fn_proto->type);
+		serialize_ref(ctx, SECTION_INSTR, fn_proto->user_type);
+		serialize_ref(ctx, SECTION_INSTR, fn_proto->enable_if);
+		serialize_int(ctx, fn_proto->pushed_for_analyze);
+		break;
+	}
+	case MIR_INSTR_FN_GROUP:
+		serialize_refs(ctx, SECTION_INSTR, ((struct mir_instr_fn_group *)instr)->variants);
+		break;
+	case MIR_INSTR_TYPE_FN: {
+		struct mir_instr_type_fn *type_fn = (struct mir_instr_type_fn *)instr;
+		serialize_ref(ctx, SECTION_INSTR, type_fn->ret_type);
+		serialize_refs(ctx, SECTION_INSTR, type_fn->args);
+		serialize_int(ctx, type_fn->builtin_id);
+		serialize_int(ctx, type_fn->is_polymorph);
+		serialize_int(ctx, type_fn->is_inside_declaration);
+		break;
+	}
+	case MIR_INSTR_TYPE_FN_GROUP: {
+		struct mir_instr_type_fn_group *group = (struct mir_instr_type_fn_group *)instr;
+		serialize_ref(ctx, SECTION_ID, group->id);
+		serialize_refs(ctx, SECTION_INSTR, group->variants);
+		break;
+	}
+	case MIR_INSTR_TYPE_STRUCT: {
+		struct mir_instr_type_struct *type_struct = (struct mir_instr_type_struct *)instr;
+		serialize_ref(ctx, SECTION_INSTR, type_struct->fwd_decl);
+		serialize_ref(ctx, SECTION_ID, type_struct->user_id);
+		serialize_int(ctx, type_struct->scope_layer);
+		serialize_refs(ctx, SECTION_INSTR, type_struct->members);
+		serialize_int(ctx, type_struct->is_packed);
+		serialize_int(ctx, type_struct->is_union);
+		serialize_int(ctx, type_struct->is_multiple_return_type);
+		break;
+	}
+	case MIR_INSTR_TYPE_ENUM: {
+		struct mir_instr_type_enum *type_enum = (struct mir_instr_type_enum *)instr;
+		serialize_ref(ctx, SECTION_ID, type_enum->user_id);
+		serialize_refs(ctx, SECTION_INSTR, type_enum->variants);
+		serialize_ref(ctx, SECTION_INSTR, type_enum->base_type);
+		serialize_int(ctx, type_enum->is_flags);
+		break;
+	}
+	case MIR_INSTR_TYPE_PTR:
+		serialize_ref(ctx, SECTION_INSTR, ((struct mir_instr_type_ptr *)instr)->type);
+		break;
+	case MIR_INSTR_TYPE_ARRAY: {
+		struct mir_instr_type_array *type_array = (struct mir_instr_type_array *)instr;
+		serialize_ref(ctx, SECTION_INSTR, type_array->elem_type);
+		serialize_ref(ctx, SECTION_INSTR, type_array->len);
+		serialize_ref(ctx, SECTION_ID, type_array->id);
+		break;
+	}
+	case MIR_INSTR_TYPE_SLICE:
+		serialize_ref(ctx, SECTION_INSTR, ((struct mir_instr_type_slice *)instr)->elem_type);
+		break;
+	case MIR_INSTR_TYPE_DYNARR:
+		serialize_ref(ctx, SECTION_INSTR, ((struct mir_instr_type_dyn_arr *)instr)->elem_type);
+		break;
+	case MIR_INSTR_TYPE_VARGS:
+		serialize_ref(ctx, SECTION_INSTR, ((struct mir_instr_type_vargs *)instr)->elem_type);
+		break;
+	case MIR_INSTR_TYPE_POLY:
+		serialize_ref(ctx, SECTION_ID, ((struct mir_instr_type_poly *)instr)->T_id);
+		break;
+	case MIR_INSTR_CALL: {
+		struct mir_instr_call *call = (struct mir_instr_call *)instr;
+		serialize_ref(ctx, SECTION_INSTR, call->callee);
+		serialize_ref(ctx, SECTION_FN, call->called_function);
+		serialize_refs(ctx, SECTION_INSTR, call->args);
+		serialize_ref(ctx, SECTION_INSTR, call->tmp_var);
+		serialize_int(ctx, call->is_inside_recipe);
+		if (ctx->is_loading && !call->callee) ctx->is_corrupted = true;
+		break;
+	}
+	case MIR_INSTR_DECL_REF: {
+		struct mir_instr_decl_ref *ref = (struct mir_instr_decl_ref *)instr;
+		serialize_ref(ctx, SECTION_UNIT, ref->parent_unit);
+		serialize_ref(ctx, SECTION_ID, ref->rid);
+		serialize_int(ctx, ref->scope_layer);
+		serialize_int(ctx, ref->accept_incomplete_type);
+		serialize_int(ctx, ref->ignore_scope_parents);
+		if (ctx->is_loading && !ref->rid) ctx->is_corrupted = true;
+		break;
+	}
+	case MIR_INSTR_DECL_DIRECT_REF:
+		serialize_ref(ctx, SECTION_INSTR, ((struct mir_instr_decl_direct_ref *)instr)->ref);
+		break;
+	case MIR_INSTR_UNREACHABLE:
+		serialize_ref(ctx, SECTION_FN, ((struct mir_instr_unreachable *)instr)->abort_fn);
+		break;
+	case MIR_INSTR_DEBUGBREAK:
+		serialize_ref(ctx, SECTION_FN, ((struct mir_instr_debugbreak *)instr)->break_fn);
+		break;
+	case MIR_INSTR_COND_BR: {
+		struct mir_instr_cond_br *cond_br = (struct mir_instr_cond_br *)instr;
+		serialize_ref(ctx, SECTION_INSTR, cond_br->cond);
+		serialize_ref(ctx, SECTION_INSTR, cond_br->then_block);
+		serialize_ref(ctx, SECTION_INSTR, cond_br->else_block);
+		serialize_int(ctx, cond_br->keep_stack_value);
+		serialize_int(ctx, cond_br->is_static);
+		serialize_int(ctx, cond_br->is_catch);
+		if (ctx->is_loading && (!cond_br->then_block || !cond_br->else_block)) ctx->is_corrupted = true;
+		break;
+	}
+	case MIR_INSTR_BR: {
+		struct mir_instr_br *br = (struct mir_instr_br *)instr;
+		serialize_ref(ctx, SECTION_INSTR, br->then_block);
+		if (ctx->is_loading && !br->then_block) ctx->is_corrupted = true;
+		break;
+	}
+	case MIR_INSTR_UNOP: {
+		struct mir_instr_unop *unop = (struct mir_instr_unop *)instr;
+		serialize_int(ctx, unop->op);
+		serialize_ref(ctx, SECTION_INSTR, unop->expr);
+		serialize_int(ctx, unop->volatile_type);
+		serialize_int(ctx, unop->is_condition);
+		break;
+	}
+	case MIR_INSTR_ARG:
+		serialize_int(ctx, ((struct mir_instr_arg *)instr)->i);
+		break;
+	case MIR_INSTR_ELEM_PTR: {
+		struct mir_instr_elem_ptr *elem_ptr = (struct mir_instr_elem_ptr *)instr;
+		serialize_ref(ctx, SECTION_INSTR, elem_ptr->arr_ptr);
+		serialize_ref(ctx, SECTION_INSTR, elem_ptr->index);
+		break;
+	}
+	case MIR_INSTR_MEMBER_PTR: {
+		struct mir_instr_member_ptr *member_ptr = (struct mir_instr_member_ptr *)instr;
+		serialize_ref(ctx, SECTION_NODE, member_ptr->member_ident);
+		serialize_ref(ctx, SECTION_INSTR, member_ptr->target_ptr);
+		serialize_int(ctx, member_ptr->builtin_id);
+		break;
+	}
+	case MIR_INSTR_ADDROF:
+		serialize_ref(ctx, SECTION_INSTR, ((struct mir_instr_addrof *)instr)->src);
+		break;
+	case MIR_INSTR_CAST: {
+		struct mir_instr_cast *cast = (struct mir_instr_cast *)instr;
+		serialize_int(ctx, cast->op);
+		serialize_ref(ctx, SECTION_INSTR, cast->type);
+		serialize_ref(ctx, SECTION_INSTR, cast->expr);
+		serialize_int(ctx, cast->auto_cast);
+		break;
+	}
+	case MIR_INSTR_SIZEOF: {
+		struct mir_instr_sizeof *szof = (struct mir_instr_sizeof *)instr;
+		serialize_refs(ctx, SECTION_INSTR, szof->args);
+		serialize_ref(ctx, SECTION_INSTR, szof->expr);
+		serialize_ref(ctx, SECTION_TYPE, szof->resolved_type);
+		break;
+	}
+	case MIR_INSTR_ALIGNOF: {
+		struct mir_instr_alignof *alof = (struct mir_instr_alignof *)instr;
+		serialize_refs(ctx, SECTION_INSTR, alof->args);
+		serialize_ref(ctx, SECTION_INSTR, alof->expr);
+		break;
+	}
+	case MIR_INSTR_TYPEOF: {
+		struct mir_instr_typeof *type_of = (struct mir_instr_typeof *)instr;
+		serialize_refs(ctx, SECTION_INSTR, type_of->args);
+		serialize_ref(ctx, SECTION_INSTR, type_of->expr);
+		break;
+	}
+	case MIR_INSTR_MSG: {
+		struct mir_instr_msg *msg = (struct mir_instr_msg *)instr;
+		serialize_refs(ctx, SECTION_INSTR, msg->args);
+		serialize_int(ctx, msg->message_kind);
+		serialize_ref(ctx, SECTION_INSTR, msg->expr);
+		break;
+	}
+	case MIR_INSTR_COMPOUND: {
+		struct mir_instr_compound *cmp = (struct mir_instr_compound *)instr;
+		serialize_ref(ctx, SECTION_INSTR, cmp->type);
+		serialize_refs(ctx, SECTION_INSTR, cmp->values);
+		s64 mapping_len = cmp->value_member_mapping ? sarrlen(cmp->value_member_mapping) + 1 : 0;
+		serialize_count(ctx, &mapping_len);
+		if (ctx->is_loading) cmp->value_member_mapping = mapping_len ? arena_alloc(&ctx->local->small_array) : NULL;
+		for (s64 i = 0; i < mapping_len - 1; ++i) {
+			if (ctx->is_loading) sarrput(cmp->value_member_mapping, 0);
+			serialize_s64(ctx, &sarrpeek(cmp->value_member_mapping, i));
+		}
+		serialize_ref(ctx, SECTION_VAR, cmp->tmp_var);
+		serialize_int(ctx, cmp->is_naked);
+		serialize_int(ctx, cmp->is_multiple_return_value);
+		break;
+	}
+	case MIR_INSTR_VARGS: {
+		struct mir_instr_vargs *vargs = (struct mir_instr_vargs *)instr;
+		serialize_ref(ctx, SECTION_VAR, vargs->arr_tmp);
+		serialize_ref(ctx, SECTION_VAR, vargs->vargs_tmp);
+		serialize_ref(ctx, SECTION_TYPE, vargs->type);
+		serialize_refs(ctx, SECTION_INSTR, vargs->values);
+		break;
+	}
+	case MIR_INSTR_TYPE_INFO: {
+		struct mir_instr_type_info *type_info = (struct mir_instr_type_info *)instr;
+		serialize_refs(ctx, SECTION_INSTR, type_info->args);
+		serialize_ref(ctx, SECTION_INSTR, type_info->expr);
+		serialize_ref(ctx, SECTION_TYPE, type_info->rtti_type);
+		break;
+	}
+	case MIR_INSTR_CALL_LOC: {
+		struct mir_instr_call_loc *loc = (struct mir_instr_call_loc *)instr;
+		serialize_ref(ctx, SECTION_NODE, loc->call_node);
+		serialize_ref(ctx, SECTION_VAR, loc->meta_var);
+		serialize_str(ctx, &loc->function_name);
+		serialize_int(ctx, loc->hash);
+		break;
+	}
+	case MIR_INSTR_UNROLL: {
+		struct mir_instr_unroll *unroll = (struct mir_instr_unroll *)instr;
+		serialize_ref(ctx, SECTION_INSTR, unroll->src);
+		serialize_ref(ctx, SECTION_INSTR, unroll->prev);
+		serialize_int(ctx, unroll->index);
+		serialize_int(ctx, unroll->remove);
+		serialize_int(ctx, unroll->force_call_tmp);
+		break;
+	}
+	case MIR_INSTR_USING:
+		serialize_ref(ctx, SECTION_INSTR, ((struct mir_instr_using *)instr)->scope_expr);
+		break;
+	case MIR_INSTR_DESIGNATOR: {
+		struct mir_instr_designator *designator = (struct mir_instr_designator *)instr;
+		serialize_ref(ctx, SECTION_NODE, designator->ident);
+		serialize_ref(ctx, SECTION_INSTR, designator->value);
+		break;
+	}
+	case MIR_INSTR_PHI: {
+		struct mir_instr_phi *phi = (struct mir_instr_phi *)instr;
+		serialize_int(ctx, phi->num);
+		if (phi->num < 0 || phi->num > (s32)static_arrlenu(phi->incoming_values)) {
+			ctx->is_corrupted = true;
+			break;
+		}
+		for (s32 i = 0; i < phi->num; ++i) {
+			serialize_ref(ctx, SECTION_INSTR, phi->incoming_values[i]);
+			serialize_ref(ctx, SECTION_INSTR, phi->incoming_blocks[i]);
+		}
+		serialize_ref(ctx, SECTION_INSTR, phi->origin_br);
+		break;
+	}
+	case MIR_INSTR_TOANY: {
+		struct mir_instr_to_any *toany = (struct mir_instr_to_any *)instr;
+		serialize_ref(ctx, SECTION_INSTR, toany->expr);
+		serialize_ref(ctx, SECTION_TYPE, toany->rtti_type);
+		serialize_ref(ctx, SECTION_VAR, toany->tmp);
+		serialize_ref(ctx, SECTION_TYPE, toany->rtti_data);
+		serialize_ref(ctx, SECTION_VAR, toany->expr_tmp);
+		break;
+	}
+	case MIR_INSTR_SWITCH: {
+		struct mir_instr_switch *sw = (struct mir_instr_switch *)instr;
+		serialize_ref(ctx, SECTION_INSTR, sw->value);
+		serialize_ref(ctx, SECTION_INSTR, sw->default_block);
+		s64 case_count = sw->cases ? sarrlen(sw->cases) + 1 : 0;
+		serialize_count(ctx, &case_count);
+		if (ctx->is_loading) sw->cases = case_count ? arena_alloc(&ctx->local->small_array) : NULL;
+		for (s64 i = 0; i < case_count - 1; ++i) {
+			if (ctx->is_loading) sarrput(sw->cases, ((struct mir_switch_case){0}));
+			struct mir_switch_case *c = &sarrpeek(sw->cases, i);
+			serialize_ref(ctx, SECTION_INSTR, c->on_value);
+			serialize_ref(ctx, SECTION_INSTR, c->block);
+			if (ctx->is_loading && !c->block) ctx->is_corrupted = true;
+		}
+		serialize_int(ctx, sw->has_user_defined_default);
+		if (ctx->is_loading && !sw->default_block) ctx->is_corrupted = true;
+		break;
+	}
+	case MIR_INSTR_SET_INITIALIZER: {
+		struct mir_instr_set_initializer *si = (struct mir_instr_set_initializer *)instr;
+		serialize_ref(ctx, SECTION_INSTR, si->dest);
+		serialize_ref(ctx, SECTION_INSTR, si->src);
+		if (ctx->is_loading && (!si->dest || si->dest->kind != MIR_INSTR_DECL_VAR)) ctx->is_corrupted = true;
+		break;
+	}
+	case MIR_INSTR_TEST_CASES:
+	case MIR_INSTR_INVALID:
+		break;
+	}
+}
+
+static void serialize_object(struct context *ctx, enum section_kind kind, void **object) {
+	switch (kind) {
+	case SECTION_UNIT:
+		serialize_unit(ctx, (struct unit **)object);
+		break;
+	case SECTION_ID:
+		serialize_id(ctx, (struct id **)object);
+		break;
+	case SECTION_SCOPE:
+		serialize_scope(ctx, (struct scope **)object);
+		break;
+	case SECTION_NODE:
+		serialize_node(ctx, (struct ast **)object);
+		break;
+	case SECTION_TYPE:
+		serialize_type(ctx, *object);
+		break;
+	case SECTION_MEMBER:
+		serialize_member(ctx, *object);
+		break;
+	case SECTION_ARG:
+		serialize_arg(ctx, *object);
+		break;
+	case SECTION_VARIANT:
+		serialize_variant(ctx, *object);
+		break;
+	case SECTION_FN:
+		serialize_fn(ctx, *object);
+		break;
+	case SECTION_VAR:
+		serialize_var(ctx, *object);
+		break;
+	case SECTION_INSTR:
+		serialize_instr(ctx, *object);
+		break;
+	case SECTION_COUNT:
+		babort("Invalid section kind.");
+	}
+}
+
+static void terminate_context(struct context *ctx) {
+	for (usize i = 0; i < SECTION_COUNT; ++i) {
+		tbl_free(ctx->sections[i].table);
+		arrfree(ctx->sections[i].objects);
+		arrfree(ctx->sections[i].data);
+	}
+	arrfree(ctx->instr_kinds);
+	tbl_free(ctx->string_table);
+	arrfree(ctx->strings);
+}
+
+// =================================================================================================
+// Writer
+// =================================================================================================
+void mir_binary_writer_run(struct assembly *assembly) {
+	zone();
+	struct context ctx = {
+	    .assembly = assembly,
+	    .local    = &assembly->thread_local_contexts[get_worker_index()],
+	};
+
+	array(u8) globals                     = NULL;
+	s64       global_refs[SECTION_COUNT] = {0};
+	ctx.out                              = &globals;
+	ctx.last_refs                        = global_refs;
+	s64 global_count  = arrlen(assembly->mir.global_instrs);
+	serialize_count(&ctx, &global_count);
+	for (usize i = 0; i < arrlenu(assembly->mir.global_instrs); ++i) {
+		serialize_ref(&ctx, SECTION_INSTR, assembly->mir.global_instrs[i]);
+	}
+
+	// Serializing of one object might register new ones in any section, repeat until all registered
+	// objects are written.
+	bool is_done;
+	do {
+		is_done = true;
+		for (usize kind = 0; kind < SECTION_COUNT; ++kind) {
+			struct section *section = &ctx.sections[kind];
+			ctx.out                 = &section->data;
+			ctx.last_refs           = section->last_refs;
+			while (section->done < arrlenu(section->objects)) {
+				serialize_object(&ctx, kind, &section->objects[section->done++]);
+				is_done = false;
+			}
+		}
+	} while (!is_done);
+	bassert(!ctx.is_corrupted && "Invalid MIR cannot be serialized!");
+
+	array(u8) header = NULL;
+	ctx.out          = &header;
+	serialize_bytes(&ctx, MIR_BINARY_MAGIC, 4);
+	write_u64(&ctx, MIR_BINARY_VERSION);
+	str_t version = cstr(BL_VERSION);
+	serialize_str_content(&ctx, &version);
+	s64 string_count = arrlen(ctx.strings);
+	serialize_count(&ctx, &string_count);
+	for (usize kind = 0; kind < SECTION_COUNT; ++kind) {
+		s64 count = arrlen(ctx.sections[kind].objects);
+		serialize_count(&ctx, &count);
+	}
+	bassert(arrlenu(ctx.instr_kinds) == arrlenu(ctx.sections[SECTION_INSTR].objects));
+	serialize_bytes(&ctx, ctx.instr_kinds, arrlenu(ctx.instr_kinds));
+	for (usize i = 0; i < arrlenu(ctx.strings); ++i) {
+		serialize_str_content(&ctx, &ctx.strings[i]);
+	}
+
+	str_buf_t export_file = get_tmp_str();
+	str_buf_append_fmt(&export_file, "{str}/{s}.blmb", assembly->target->out_dir, assembly->target->name);
+	FILE *f = fopen(str_buf_to_c(export_file), "wb");
+	if (f == NULL) {
+		builder_error("Cannot open file " STR_FMT, STR_ARG(export_file));
+	} else {
+		usize size = fwrite(header, 1, arrlenu(header), f);
+		size += fwrite(globals, 1, arrlenu(globals), f);
+		for (usize kind = 0; kind < SECTION_COUNT; ++kind) {
+			size += fwrite(ctx.sections[kind].data, 1, arrlenu(ctx.sections[kind].data), f);
+		}
+		fclose(f);
+		builder_info("Binary MIR written into " STR_FMT " (%.2f kB)", STR_ARG(export_file), (f64)size / 1024.);
+	}
+
+	put_tmp_str(export_file);
+	arrfree(header);
+	arrfree(globals);
+	terminate_context(&ctx);
+	return_zone();
+}
+
+// =================================================================================================
+// Loader
+// =================================================================================================
+static bool load_header(struct context *ctx, const char *filepath) {
+	char magic[4];
+	serialize_bytes(ctx, magic, 4);
+	if (ctx->is_corrupted || memcmp(magic, MIR_BINARY_MAGIC, 4) != 0) {
+		builder_error("File '%s' is not a binary MIR file.", filepath);
+		return false;
+	}
+	const u64 format_version = read_u64(ctx);
+	str_t     version        = make_str(NULL, 0);
+	serialize_str_content(ctx, &version);
+	if (ctx->is_corrupted) {
+		builder_error("Binary MIR file '%s' is corrupted.", filepath);
+		return false;
+	}
+	if (format_version != MIR_BINARY_VERSION || !str_match(version, cstr(BL_VERSION))) {
+		builder_error("Binary MIR file '%s' was created by incompatible compiler version '" STR_FMT "'.",
+		              filepath,
+		              STR_ARG(version));
+		return false;
+	}
+
+	s64 string_count = 0;
+	serialize_count(ctx, &string_count);
+	s64 counts[SECTION_COUNT];
+	for (usize kind = 0; kind < SECTION_COUNT; ++kind) {
+		serialize_count(ctx, &counts[kind]);
+	}
+	if (ctx->is_corrupted) {
+		builder_error("Binary MIR file '%s' is corrupted.", filepath);
+		return false;
+	}
+
+	// Objects referenced before they are loaded are preallocated, units, identifiers, scopes and
+	// nodes are created while loaded since their sections precede all references.
+	struct mir_arenas *arenas = &ctx->local->mir_arenas;
+	for (usize kind = 0; kind < SECTION_COUNT; ++kind) {
+		struct section *section = &ctx->sections[kind];
+		arrsetlen(section->objects, counts[kind]);
+		for (s64 i = 0; i < counts[kind]; ++i) {
+			void *object = NULL;
+			switch (kind) {
+			case SECTION_TYPE:
+				object = arena_alloc(&arenas->type);
+				bmagic_set((struct mir_type *)object);
+				break;
+			case SECTION_MEMBER:
+				object = arena_alloc(&arenas->member);
+				bmagic_set((struct mir_member *)object);
+				break;
+			case SECTION_ARG:
+				object = arena_alloc(&arenas->arg);
+				bmagic_set((struct mir_arg *)object);
+				break;
+			case SECTION_VARIANT:
+				object = arena_alloc(&arenas->variant);
+				break;
+			case SECTION_FN:
+				object = arena_alloc(&arenas->fn);
+				bmagic_set((struct mir_fn *)object);
+				break;
+			case SECTION_VAR:
+				object = arena_alloc(&arenas->var);
+				break;
+			case SECTION_INSTR: {
+				u8 instr_kind = 0;
+				serialize_bytes(ctx, &instr_kind, 1);
+				if (instr_kind <= MIR_INSTR_INVALID || instr_kind > MIR_INSTR_DESIGNATOR) {
+					builder_error("Binary MIR file '%s' is corrupted.", filepath);
+					return false;
+				}
+				object = mir_alloc_instr(ctx->assembly, instr_kind);
+				break;
+			}
+			default:
+				break;
+			}
+			section->objects[i] = object;
+		}
+	}
+
+	arrsetlen(ctx->strings, string_count);
+	for (s64 i = 0; i < string_count; ++i) {
+		serialize_str_content(ctx, &ctx->strings[i]);
+	}
+	return true;
+}
+
+void mir_binary_loader_run(struct assembly *assembly) {
+	zone();
+	const char *filepath = builder.options->load_mir;
+	bassert(filepath);
+
+	FILE *f = fopen(filepath, "rb");
+	if (f == NULL) {
+		builder_error("Cannot open file '%s'.", filepath);
+		return_zone();
+	}
+	fseek(f, 0, SEEK_END);
+	const long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	u8 *data = bmalloc(MAX(size, 1));
+	if (size < 0 || fread(data, 1, size, f) != (usize)size) {
+		builder_error("Cannot read file '%s'.", filepath);
+		fclose(f);
+		bfree(data);
+		return_zone();
+	}
+	fclose(f);
+
+	struct context ctx = {
+	    .assembly   = assembly,
+	    .local      = &assembly->thread_local_contexts[get_worker_index()],
+	    .is_loading = true,
+	    .data       = data,
+	    .len        = (usize)size,
+	};
+
+	if (load_header(&ctx, filepath)) {
+		s64 global_refs[SECTION_COUNT] = {0};
+		ctx.last_refs                  = global_refs;
+		s64 global_count               = 0;
+		serialize_count(&ctx, &global_count);
+		array(struct mir_instr *) globals = NULL;
+		for (s64 i = 0; i < global_count; ++i) {
+			struct mir_instr *instr = NULL;
+			serialize_ref(&ctx, SECTION_INSTR, instr);
+			if (instr) arrput(globals, instr);
+		}
+
+		for (usize kind = 0; kind < SECTION_COUNT && !ctx.is_corrupted; ++kind) {
+			struct section *section = &ctx.sections[kind];
+			ctx.last_refs           = section->last_refs;
+			for (usize i = 0; i < arrlenu(section->objects) && !ctx.is_corrupted; ++i) {
+				serialize_object(&ctx, kind, &section->objects[i]);
+			}
+		}
+
+		if (ctx.is_corrupted || ctx.pos != ctx.len) {
+			builder_error("Binary MIR file '%s' is corrupted.", filepath);
+		} else {
+			// Builtin globals created with the assembly are replaced by the loaded ones.
+			arrsetlen(assembly->mir.global_instrs, 0);
+			for (usize i = 0; i < arrlenu(globals); ++i) {
+				arrput(assembly->mir.global_instrs, globals[i]);
+			}
+			builder_info("Binary MIR loaded from '%s' (%llu instructions).",
+			             filepath,
+			             (unsigned long long)arrlenu(ctx.sections[SECTION_INSTR].objects));
+		}
+		arrfree(globals);
+	}
+
+	terminate_context(&ctx);
+	bfree(data);
+	return_zone();
+}
@@ -70,7 +70,8 @@ _print_const_value(struct context *ctx, struct mir_type *type, vm_stack_ptr_t va
 	switch (type->kind) {
 	case MIR_TYPE_ENUM:
 	case MIR_TYPE_INT: {
-		if (type->data.integer.is_signed) {
+		const struct mir_type *int_type = type->kind == MIR_TYPE_ENUM ? type->data.enm.base_type : type;
+		if (int_type->data.integer.is_signed) {
 			switch (type->store_size_bytes) {
 			case 1:
 				fprintf(ctx->stream, "%d", vm_read_as(s8, value));
@@ -158,14 +159,13 @@ _print_const_value(struct context *ctx, struct mir_type *type, vm_stack_ptr_t va
 	case MIR_TYPE_STRING:
 		fprintf(ctx->stream, "{");
 
-		struct mir_type *elem_type = mir_get_struct_elem_type(type, 0);
-		ptrdiff_t        offset    = vm_get_struct_elem_offset(ctx->assembly, type, 0);
-		_print_const_value(ctx, elem_type, value + offset);
+		struct mir_member *len_member = sarrpeek(type->data.strct.members, 0);
+		_print_const_value(ctx, len_member->type, value + len_member->offset_bytes);
 
 		fprintf(ctx->stream, ",\"");
 
-		offset                 = vm_get_struct_elem_offset(ctx->assembly, type, 1);
-		vm_stack_ptr_t str_ptr = value + offset;
+		struct mir_member *ptr_member = sarrpeek(type->data.strct.members, 1);
+		vm_stack_ptr_t     str_ptr    = value + ptr_member->offset_bytes;
 		str_ptr                = VM_STACK_PTR_DEREF(str_ptr);
 		if (str_ptr) {
 			str_buf_t tmp = get_tmp_str();
@@ -195,10 +195,8 @@ _print_const_value(struct context *ctx, struct mir_type *type, vm_stack_ptr_t va
 		fprintf(ctx->stream, "{");
 		mir_members_t *members = type->data.strct.members;
 		for (usize i = 0; i < sarrlenu(members); ++i) {
-			struct mir_member *it          = sarrpeek(members, i);
-			struct mir_type   *member_type = it->type;
-			const ptrdiff_t    offset2     = vm_get_struct_elem_offset(ctx->assembly, type, (u32)i);
-			_print_const_value(ctx, member_type, value + offset2);
+			struct mir_member *it = sarrpeek(members, i);
+			_print_const_value(ctx, it->type, value + it->offset_bytes);
 			if (i < sarrlenu(members) - 1) fprintf(ctx->stream, ",");
 		}
 		fprintf(ctx->stream, "}");
@@ -1118,6 +1116,7 @@ void print_instr(struct context *ctx, struct mir_instr *instr) {
 		break;
 	case MIR_INSTR_USING:
 		print_instr_using(ctx, (struct mir_instr_using *)instr);
+		break;
 	case MIR_INSTR_DESIGNATOR:
 		print_instr_designator(ctx, (struct mir_instr_designator *)instr);
 		break;
@@ -1130,8 +1129,8 @@ void print_instr(struct context *ctx, struct mir_instr *instr) {
 	}
 
 	if (ctx->assembly->target->opt == ASSEMBLY_OPT_DEBUG) {
-		if (instr->node && instr->node->location) {
-			const struct location *loc = instr->node->location;
+		if (instr->node && instr->node->unit) {
+			const struct location *loc = ast_tmp_location(instr->node);
 			fprintf(ctx->stream, " %s[" STR_FMT ":%d]", has_comment ? "" : "// ", STR_ARG(loc->unit->filename), loc->line);
 		}
 	}
@@ -72,6 +72,7 @@ void blc(void) {
 	    "./src/main.c",
 	    "./src/mir_printer.c",
 	    "./src/mir_writer.c",
+	    "./src/mir_binary.c",
 	    "./src/mir.c",
 	    "./src/native_bin.c",
 	    "./src/obj_writer.c",
@@ -1,11 +1,14 @@
 #include "builder.h"
+#include "parser.h"
 #include "table.h"
 #include "tokens_inline_utils.h"
 #include <setjmp.h>
 
-#define report_error(code, tok, pos, format, ...) builder_msg(MSG_ERR, ERR_##code, &(tok)->location, (pos), (format), ##__VA_ARGS__)
-#define report_warning(tok, pos, format, ...)     builder_msg(MSG_WARN, 0, &(tok)->location, (pos), (format), ##__VA_ARGS__)
-#define report_note(tok, pos, format, ...)        builder_msg(MSG_ERR_NOTE, 0, &(tok)->location, (pos), (format), ##__VA_ARGS__)
+#define tmp_location(ctx, tok) tokens_location((ctx)->tokens, (tok), &(struct location){0})
+
+#define report_error(code, tok, pos, format, ...) builder_msg(MSG_ERR, ERR_##code, tmp_location(ctx, tok), (pos), (format), ##__VA_ARGS__)
+#define report_warning(tok, pos, format, ...)     builder_msg(MSG_WARN, 0, tmp_location(ctx, tok), (pos), (format), ##__VA_ARGS__)
+#define report_note(tok, pos, format, ...)        builder_msg(MSG_ERR_NOTE, 0, tmp_location(ctx, tok), (pos), (format), ##__VA_ARGS__)
 
 #define scope_push(ctx, scope) arrput((ctx)->scope_stack, (scope))
 #define scope_pop(ctx)         arrpop((ctx)->scope_stack)
@@ -41,13 +44,14 @@ struct hash_directive_entry {
 struct context {
 	hash_table(struct hash_directive_entry) hash_directive_table;
 
-	struct assembly           *assembly;
-	struct unit               *unit;
-	struct arena              *ast_arena;
-	struct arena              *sarr_arena;
-	struct scope_thread_local *scope_thread_local;
-	struct tokens             *tokens;
-	struct string_cache      **string_cache;
+	struct assembly                      *assembly;
+	struct unit                          *unit;
+	struct arena                         *ast_arena;
+	struct arena                         *sarr_arena;
+	struct scope_thread_local            *scope_thread_local;
+	struct tokens                        *tokens;
+	struct string_cache                 **string_cache;
+	struct assembly_thread_local_context *thread_local;
 
 	// tmps
 	array(struct scope *) scope_stack;
@@ -57,6 +61,12 @@ struct context {
 	bool        is_inside_loop;
 	bool        is_inside_expression;
 	struct ast *current_docs;
+
+	// Global function declaration candidate for lazy body parsing; the token is the first token of
+	// the function literal and the block is set once the body was skipped.
+	bool          is_lazy_parsing_enabled;
+	struct token *lazy_fn_token;
+	struct ast   *lazy_fn_block;
 };
 
 // helpers
@@ -72,6 +82,10 @@ static struct ast     *parse_debugbreak(struct context *ctx);
 static struct ast     *parse_ident_group(struct context *ctx);
 static struct ast     *parse_single_block_stmt_or_expr(struct context *ctx, bool *out_require_semicolon);
 static struct ast     *parse_block(struct context *ctx, enum scope_kind scope_kind);
+static bool            parse_block_content(struct context *ctx, struct ast *block, struct token *tok_begin);
+static bool            is_lazy_fn_candidate(struct ast *fn, struct ast *decl);
+static struct ast     *skip_fn_body(struct context *ctx, struct ast *decl);
+static void            parse_lazy_fn_body(struct context *ctx, struct ast *block);
 static struct ast     *parse_decl(struct context *ctx);
 static struct ast     *parse_decl_member(struct context *ctx, s32 index);
 static struct ast     *parse_decl_arg(struct context *ctx, bool named);
@@ -129,8 +143,20 @@ static struct ast *parse_expr_compound(struct context *ctx, struct ast *prev);
 static struct ast *parse_expr_catch(struct context *ctx, struct ast *call);
 
 static inline union token_value get_token_value(struct context *ctx, struct token *token) {
-	bassert(token && token->value_index < arrlenu(ctx->tokens->values));
-	return ctx->tokens->values[token->value_index];
+	bassert(token && ctx->tokens->value_indices[tokens_index(ctx->tokens, token)] < arrlenu(ctx->tokens->values));
+	return tokens_value(ctx->tokens, token);
+}
+
+// Persistent location record of the token referenced from scopes and units; locations of AST
+// nodes are computed from the token data on demand.
+static struct location *get_location(struct context *ctx, struct token *token) {
+	if (!token) return NULL;
+	return tokens_location(ctx->tokens, token, new_location(ctx->thread_local));
+}
+
+static inline struct ast *create_node(struct context *ctx, enum ast_kind kind, struct token *tok, struct scope *parent_scope) {
+	if (!tok) return ast_create_node(ctx->ast_arena, kind, NULL, 0, parent_scope);
+	return ast_create_node(ctx->ast_arena, kind, ctx->tokens->unit, (u32)tokens_index(ctx->tokens, tok), parent_scope);
 }
 
 // Tries to move the current token cursor to the next closing symbol on current nesting.
@@ -153,7 +179,7 @@ static inline struct ast *_parse_ident(struct context *ctx) {
 	zone();
 	struct token *tok_ident = tokens_consume(ctx->tokens);
 	assert(tok_ident->sym == SYM_IDENT);
-	struct ast *ident = ast_create_node(ctx->ast_arena, AST_IDENT, tok_ident, scope_get(ctx));
+	struct ast *ident = create_node(ctx, AST_IDENT, tok_ident, scope_get(ctx));
 	id_init(&ident->data.ident.id, get_token_value(ctx, tok_ident).str);
 	return_zone(ident);
 }
@@ -276,7 +302,7 @@ struct ast *parse_expr_ref(struct context *ctx) {
 	if (tok->sym != SYM_IDENT) return_zone(NULL);
 	struct ast *ident = parse_ident(ctx);
 	bassert(ident);
-	struct ast *ref            = ast_create_node(ctx->ast_arena, AST_REF, tok, scope_get(ctx));
+	struct ast *ref            = create_node(ctx, AST_REF, tok, scope_get(ctx));
 	ref->data.ref.ident        = ident;
 	ref->data.ref.used_in_decl = decl_get(ctx);
 	return_zone(ref);
@@ -300,7 +326,7 @@ bool parse_docs(struct context *ctx) {
 		put_tmp_str(tmp);
 	}
 
-	struct ast *docs     = ast_create_node(ctx->ast_arena, AST_DOCS, tok_begin, scope_get(ctx));
+	struct ast *docs     = create_node(ctx, AST_DOCS, tok_begin, scope_get(ctx));
 	docs->data.docs.text = str_value;
 	ctx->current_docs    = docs;
 	return_zone(true);
@@ -340,10 +366,10 @@ struct ast *parse_hash_directive(struct context *ctx, s32 expected_mask, enum ha
 			if (isnotflag(expected_mask, HD_STATIC_IF)) {
 				builder_msg(MSG_ERR,
 				            0,
-				            if_stmt->location,
+				            ast_tmp_location(if_stmt),
 				            CARET_WORD,
 				            "Static if is not allowed in this context.");
-				return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_hash, scope_get(ctx)));
+				return_zone(create_node(ctx, AST_BAD, tok_hash, scope_get(ctx)));
 			}
 			return_zone(if_stmt);
 		}
@@ -361,7 +387,7 @@ struct ast *parse_hash_directive(struct context *ctx, s32 expected_mask, enum ha
 
 	if (isnotflag(expected_mask, hd_flag)) {
 		report_error(UNEXPECTED_DIRECTIVE, tok_directive, CARET_WORD, "Unexpected directive.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_directive, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_directive, scope_get(ctx)));
 	}
 	set_satisfied(hd_flag);
 
@@ -379,6 +405,7 @@ struct ast *parse_hash_directive(struct context *ctx, s32 expected_mask, enum ha
 	case HD_ENTRY:
 	case HD_MAYBE_UNUSED:
 	case HD_COMPTIME:
+	case HD_PURE:
 	case HD_COMPILER: {
 		// only flags
 		return_zone(NULL);
@@ -392,15 +419,15 @@ struct ast *parse_hash_directive(struct context *ctx, s32 expected_mask, enum ha
 			             tok_err,
 			             CARET_WORD,
 			             "Expected path pointing to valid BL source file after 'load' directive.");
-			return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_directive, scope_get(ctx)));
+			return_zone(create_node(ctx, AST_BAD, tok_directive, scope_get(ctx)));
 		}
 
 		struct scope *current_scope = scope_get(ctx);
 		bassert(current_scope);
-		struct ast *load         = ast_create_node(ctx->ast_arena, AST_LOAD, tok_directive, current_scope);
+		struct ast *load         = create_node(ctx, AST_LOAD, tok_directive, current_scope);
 		load->data.load.filepath = get_token_value(ctx, tok_path).str;
 		if (ctx->assembly->target->kind != ASSEMBLY_DOCS) {
-			assembly_add_unit(ctx->assembly, load->data.load.filepath, tok_path, current_scope, ctx->unit->module);
+			assembly_add_unit(ctx->assembly, load->data.load.filepath, get_location(ctx, tok_path), current_scope, ctx->unit->module);
 		}
 		return_zone(load);
 	}
@@ -416,12 +443,12 @@ struct ast *parse_hash_directive(struct context *ctx, s32 expected_mask, enum ha
 			             tok_err,
 			             CARET_WORD,
 			             "Expected path pointing to valid BL module after 'import' directive.");
-			return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_directive, current_scope));
+			return_zone(create_node(ctx, AST_BAD, tok_directive, current_scope));
 		}
 
-		struct ast *import = ast_create_node(ctx->ast_arena, AST_IMPORT, tok_directive, current_scope);
+		struct ast *import = create_node(ctx, AST_IMPORT, tok_directive, current_scope);
 		if (ctx->assembly->target->kind != ASSEMBLY_DOCS) {
-			struct module *module = assembly_import_module(ctx->assembly, get_token_value(ctx, tok_path).str, tok_path, current_scope);
+			struct module *module = assembly_import_module(ctx->assembly, get_token_value(ctx, tok_path).str, get_location(ctx, tok_path), current_scope);
 			if (module) {
 				import->data.import.module = module;
 				if (!is_in_expression) {
@@ -443,15 +470,15 @@ struct ast *parse_hash_directive(struct context *ctx, s32 expected_mask, enum ha
 
 	case HD_FILE: {
 		struct ast *file =
-		    ast_create_node(ctx->ast_arena, AST_EXPR_LIT_STRING, tok_directive, scope_get(ctx));
-		file->data.expr_string.val = tok_directive->location.unit->filepath;
+		    create_node(ctx, AST_EXPR_LIT_STRING, tok_directive, scope_get(ctx));
+		file->data.expr_string.val = ctx->unit->filepath;
 		return_zone(file);
 	}
 
 	case HD_LINE: {
 		struct ast *line =
-		    ast_create_node(ctx->ast_arena, AST_EXPR_LIT_INT, tok_directive, scope_get(ctx));
-		line->data.expr_integer.val = tok_directive->location.line;
+		    create_node(ctx, AST_EXPR_LIT_INT, tok_directive, scope_get(ctx));
+		line->data.expr_integer.val = tokens_line(ctx->tokens, tok_directive);
 		return_zone(line);
 	}
 
@@ -460,7 +487,7 @@ struct ast *parse_hash_directive(struct context *ctx, s32 expected_mask, enum ha
 		if (!type) {
 			struct token *tok_err = tokens_peek(ctx->tokens);
 			report_error(EXPECTED_NAME, tok_err, CARET_WORD, "Expected struct base type name.");
-			return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_directive, scope_get(ctx)));
+			return_zone(create_node(ctx, AST_BAD, tok_directive, scope_get(ctx)));
 		}
 		return_zone(type);
 	}
@@ -471,15 +498,15 @@ struct ast *parse_hash_directive(struct context *ctx, s32 expected_mask, enum ha
 		if (!expr) {
 			struct token *tok_err = tokens_peek(ctx->tokens);
 			report_error(EXPECTED_NAME, tok_err, CARET_WORD, "Expected tag expression.");
-			return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_directive, scope_get(ctx)));
+			return_zone(create_node(ctx, AST_BAD, tok_directive, scope_get(ctx)));
 		}
-		struct ast *tag    = ast_create_node(ctx->ast_arena, AST_TAG, tok_directive, scope_get(ctx));
+		struct ast *tag    = create_node(ctx, AST_TAG, tok_directive, scope_get(ctx));
 		tag->data.tag.expr = expr;
 		return_zone(tag);
 	}
 
 	case HD_CALL_LOC: {
-		return_zone(ast_create_node(ctx->ast_arena, AST_CALL_LOC, tok_directive, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_CALL_LOC, tok_directive, scope_get(ctx)));
 	}
 
 	case HD_EXTERN: {
@@ -487,7 +514,7 @@ struct ast *parse_hash_directive(struct context *ctx, s32 expected_mask, enum ha
 		struct token *tok_ext = tokens_consume_if(ctx->tokens, SYM_STRING);
 		if (!tok_ext) return_zone(NULL);
 		// Parse extension token.
-		struct ast *ext = ast_create_node(ctx->ast_arena, AST_IDENT, tok_ext, scope_get(ctx));
+		struct ast *ext = create_node(ctx, AST_IDENT, tok_ext, scope_get(ctx));
 		id_init(&ext->data.ident.id, get_token_value(ctx, tok_ext).str);
 		return_zone(ext);
 	}
@@ -497,7 +524,7 @@ struct ast *parse_hash_directive(struct context *ctx, s32 expected_mask, enum ha
 		struct token *tok_ext = tokens_consume_if(ctx->tokens, SYM_STRING);
 		if (!tok_ext) return_zone(NULL);
 		// Parse extension token.
-		struct ast *ext = ast_create_node(ctx->ast_arena, AST_IDENT, tok_ext, scope_get(ctx));
+		struct ast *ext = create_node(ctx, AST_IDENT, tok_ext, scope_get(ctx));
 		id_init(&ext->data.ident.id, get_token_value(ctx, tok_ext).str);
 		return_zone(ext);
 	}
@@ -506,7 +533,7 @@ struct ast *parse_hash_directive(struct context *ctx, s32 expected_mask, enum ha
 		// Parse optional message.
 		struct token *tok_message = tokens_consume_if(ctx->tokens, SYM_STRING);
 		if (!tok_message) return_zone(NULL);
-		struct ast *message           = ast_create_node(ctx->ast_arena, AST_EXPR_LIT_STRING, tok_message, scope_get(ctx));
+		struct ast *message           = create_node(ctx, AST_EXPR_LIT_STRING, tok_message, scope_get(ctx));
 		message->data.expr_string.val = get_token_value(ctx, tok_message).str;
 		return_zone(message);
 	}
@@ -516,7 +543,7 @@ struct ast *parse_hash_directive(struct context *ctx, s32 expected_mask, enum ha
 		struct token *tok_ext = tokens_consume_if(ctx->tokens, SYM_STRING);
 		if (!tok_ext) return_zone(NULL);
 		// Parse extension token.
-		struct ast *ext = ast_create_node(ctx->ast_arena, AST_IDENT, tok_ext, scope_get(ctx));
+		struct ast *ext = create_node(ctx, AST_IDENT, tok_ext, scope_get(ctx));
 		id_init(&ext->data.ident.id, get_token_value(ctx, tok_ext).str);
 		return_zone(ext);
 	}
@@ -530,20 +557,20 @@ struct ast *parse_hash_directive(struct context *ctx, s32 expected_mask, enum ha
 			struct module *module       = ctx->unit->module;
 			struct scope  *parent_scope = module ? module->private_scope : ctx->unit->parent_scope;
 			bassert(parent_scope);
-			scope = scope_create(ctx->scope_thread_local, SCOPE_PRIVATE, parent_scope, &tok_directive->location);
+			scope = scope_create(ctx->scope_thread_local, SCOPE_PRIVATE, parent_scope, get_location(ctx, tok_directive));
 			scope_reserve(scope, 256);
 			ctx->unit->private_scope = scope;
 		}
 
 		scope_set(ctx, scope);
-		return_zone(ast_create_node(ctx->ast_arena, AST_PRIVATE, tok_directive, current_scope));
+		return_zone(create_node(ctx, AST_PRIVATE, tok_directive, current_scope));
 	}
 
 	case HD_SCOPE_PUBLIC: {
 		struct scope *current_scope = scope_get(ctx);
 		bassert(current_scope);
 		scope_set(ctx, ctx->unit->parent_scope);
-		return_zone(ast_create_node(ctx->ast_arena, AST_PUBLIC, tok_directive, current_scope));
+		return_zone(create_node(ctx, AST_PUBLIC, tok_directive, current_scope));
 	}
 
 	case HD_SCOPE_MODULE: {
@@ -553,7 +580,7 @@ struct ast *parse_hash_directive(struct context *ctx, s32 expected_mask, enum ha
 			struct module *module = ctx->unit->module;
 			if (!module) {
 				report_error(UNEXPECTED_DIRECTIVE, tok_directive, CARET_WORD, "Module private scope cannot be created outside of module.");
-				return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_directive, current_scope));
+				return_zone(create_node(ctx, AST_BAD, tok_directive, current_scope));
 			}
 
 			bassert(module->private_scope);
@@ -564,7 +591,7 @@ struct ast *parse_hash_directive(struct context *ctx, s32 expected_mask, enum ha
 			struct scope *scope = ctx->unit->private_scope;
 			if (!scope) {
 				struct scope *parent_scope = ctx->unit->parent_scope;
-				scope                      = scope_create(ctx->scope_thread_local, SCOPE_PRIVATE, parent_scope, &tok_directive->location);
+				scope                      = scope_create(ctx->scope_thread_local, SCOPE_PRIVATE, parent_scope, get_location(ctx, tok_directive));
 				scope_reserve(scope, 256);
 				ctx->unit->private_scope = scope;
 			}
@@ -572,21 +599,21 @@ struct ast *parse_hash_directive(struct context *ctx, s32 expected_mask, enum ha
 			scope_set(ctx, scope);
 		}
 
-		return_zone(ast_create_node(ctx->ast_arena, AST_MODULE_PRIVATE, tok_directive, current_scope));
+		return_zone(create_node(ctx, AST_MODULE_PRIVATE, tok_directive, current_scope));
 	}
 
 	case HD_ENABLE_IF: {
 		struct ast *expr = parse_expr(ctx);
 		if (!expr) {
 			report_error(INVALID_DIRECTIVE, tok_directive, CARET_AFTER, "Expected comptime expression.");
-			return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_directive, scope_get(ctx)));
+			return_zone(create_node(ctx, AST_BAD, tok_directive, scope_get(ctx)));
 		}
 		return_zone(expr);
 	}
 	}
 INVALID:
 	report_error(UNEXPECTED_DIRECTIVE, tok_directive, CARET_WORD, "Unknown directive.");
-	return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_directive, scope_get(ctx)));
+	return_zone(create_node(ctx, AST_BAD, tok_directive, scope_get(ctx)));
 #undef set_satisfied
 }
 
@@ -596,7 +623,7 @@ struct ast *parse_expr_compound(struct context *ctx, struct ast *prev) {
 	tokens_consume(ctx->tokens);                                     // eat .
 	struct token *tok_begin           = tokens_consume(ctx->tokens); // eat {
 	struct ast   *type                = prev;
-	struct ast   *compound            = ast_create_node(ctx->ast_arena, AST_EXPR_COMPOUND, tok_begin, scope_get(ctx));
+	struct ast   *compound            = create_node(ctx, AST_EXPR_COMPOUND, tok_begin, scope_get(ctx));
 	compound->data.expr_compound.type = type;
 	// parse values
 	struct ast *tmp;
@@ -626,14 +653,14 @@ struct ast *parse_expr_test_cases(struct context *ctx) {
 	zone();
 	struct token *tok_begin = tokens_consume_if(ctx->tokens, SYM_TESTCASES);
 	if (!tok_begin) return_zone(NULL);
-	struct ast *tc = ast_create_node(ctx->ast_arena, AST_EXPR_TEST_CASES, tok_begin, scope_get(ctx));
+	struct ast *tc = create_node(ctx, AST_EXPR_TEST_CASES, tok_begin, scope_get(ctx));
 	return_zone(tc);
 }
 
 struct ast *parse_expr_capture_last(struct context *ctx) {
 	struct token *tok = tokens_consume_if(ctx->tokens, SYM_LAST);
 	if (!tok) return NULL;
-	return ast_create_node(ctx->ast_arena, AST_EXPR_ERR, tok, scope_get(ctx));
+	return create_node(ctx, AST_EXPR_ERR, tok, scope_get(ctx));
 }
 
 struct ast *parse_expr_cast_auto(struct context *ctx) {
@@ -641,7 +668,7 @@ struct ast *parse_expr_cast_auto(struct context *ctx) {
 	struct token *tok_begin = tokens_consume_if(ctx->tokens, SYM_CAST_AUTO);
 	if (!tok_begin) return_zone(NULL);
 
-	struct ast *cast               = ast_create_node(ctx->ast_arena, AST_EXPR_CAST, tok_begin, scope_get(ctx));
+	struct ast *cast               = create_node(ctx, AST_EXPR_CAST, tok_begin, scope_get(ctx));
 	cast->data.expr_cast.auto_cast = true;
 
 	cast->data.expr_cast.next = _parse_expr(ctx, token_prec(tok_begin).priority);
@@ -649,7 +676,7 @@ struct ast *parse_expr_cast_auto(struct context *ctx) {
 		struct token *tok = tokens_peek(ctx->tokens);
 		report_error(EXPECTED_EXPR, tok_begin, CARET_AFTER, "Expected expression after auto cast.");
 		tokens_consume_till(ctx->tokens, SYM_SEMICOLON);
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok, scope_get(ctx)));
 	}
 
 	return_zone(cast);
@@ -664,23 +691,23 @@ struct ast *parse_expr_cast(struct context *ctx) {
 	if (!token_is(tok, SYM_LPAREN)) {
 		report_error(MISSING_BRACKET, tok_begin, CARET_WORD, "Expected '(' after expression.");
 		tokens_consume_till(ctx->tokens, SYM_SEMICOLON);
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_begin, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_begin, scope_get(ctx)));
 	}
 
-	struct ast *cast          = ast_create_node(ctx->ast_arena, AST_EXPR_CAST, tok_begin, scope_get(ctx));
+	struct ast *cast          = create_node(ctx, AST_EXPR_CAST, tok_begin, scope_get(ctx));
 	cast->data.expr_cast.type = parse_type(ctx);
 	if (!cast->data.expr_cast.type) {
 		struct token *tok_err = tokens_peek(ctx->tokens);
 		report_error(EXPECTED_TYPE, tok_err, CARET_WORD, "Expected type name as cast parameter.");
 		tokens_consume_till(ctx->tokens, SYM_SEMICOLON);
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_err, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_err, scope_get(ctx)));
 	}
 
 	tok = tokens_consume(ctx->tokens);
 	if (!token_is(tok, SYM_RPAREN)) {
 		report_error(MISSING_BRACKET, tok, CARET_WORD, "Expected ')' after cast expression.");
 		tokens_consume_till(ctx->tokens, SYM_SEMICOLON);
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok, scope_get(ctx)));
 	}
 
 	cast->data.expr_cast.next = _parse_expr(ctx, token_prec(tok_begin).priority);
@@ -688,7 +715,7 @@ struct ast *parse_expr_cast(struct context *ctx) {
 		tok = tokens_peek(ctx->tokens);
 		report_error(EXPECTED_EXPR, tok, CARET_WORD, "Expected expression after cast.");
 		tokens_consume_till(ctx->tokens, SYM_SEMICOLON);
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok, scope_get(ctx)));
 	}
 
 	return_zone(cast);
@@ -706,7 +733,7 @@ struct ast *parse_decl_member(struct context *ctx, s32 UNUSED(index)) {
 		if (!name) {
 			builder_msg(MSG_ERR,
 			            ERR_EXPECTED_TYPE,
-			            &tok_begin->location,
+			            tmp_location(ctx, tok_begin),
 			            CARET_AFTER,
 			            "Expected member name.");
 			tokens_consume(ctx->tokens);
@@ -715,8 +742,8 @@ struct ast *parse_decl_member(struct context *ctx, s32 UNUSED(index)) {
 		tokens_consume(ctx->tokens);
 		type = parse_type(ctx);
 		if (!type) {
-			builder_msg(MSG_ERR, ERR_EXPECTED_TYPE, name->location, CARET_AFTER, "Expected type.");
-			return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_begin, scope_get(ctx)));
+			builder_msg(MSG_ERR, ERR_EXPECTED_TYPE, ast_tmp_location(name), CARET_AFTER, "Expected type.");
+			return_zone(create_node(ctx, AST_BAD, tok_begin, scope_get(ctx)));
 		}
 	} else {
 		type = parse_type(ctx);
@@ -730,13 +757,13 @@ struct ast *parse_decl_member(struct context *ctx, s32 UNUSED(index)) {
 		const s32 len = snprintf(buf, static_arrlenu(buf), "_%d", index);
 		bassert(len >= 0 && len < (s32)static_arrlenu(buf) && "Buffer overflow!");
 		const str_t ident = scdup2(ctx->string_cache, make_str(buf, len));
-		name              = ast_create_node(ctx->ast_arena, AST_IDENT, tok_begin, scope_get(ctx));
+		name              = create_node(ctx, AST_IDENT, tok_begin, scope_get(ctx));
 		id_init(&name->data.ident.id, ident);
 	}
 
 	enum hash_directive_flags found_hd = HD_NONE;
 	struct ast               *tag      = parse_hash_directive(ctx, HD_TAG, &found_hd, false);
-	struct ast               *mem      = ast_create_node(ctx->ast_arena, AST_DECL_MEMBER, tok_begin, scope_get(ctx));
+	struct ast               *mem      = create_node(ctx, AST_DECL_MEMBER, tok_begin, scope_get(ctx));
 
 	mem->docs           = pop_docs(ctx);
 	mem->data.decl.type = type;
@@ -760,11 +787,11 @@ struct ast *parse_decl_arg(struct context *ctx, bool named) {
 		struct token *tok_err = tokens_peek_prev(ctx->tokens);
 		builder_msg(MSG_ERR,
 		            ERR_EXPECTED_NAME,
-		            &tok_err->location,
+		            tmp_location(ctx, tok_err),
 		            CARET_AFTER,
 		            "Invalid function argument declaration. Expected is format is '<name>: <type>' or '<name> : [type] = <value>'.");
 
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_err, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_err, scope_get(ctx)));
 	}
 	type = parse_type(ctx);
 	// Parse optional default value expression.
@@ -775,14 +802,14 @@ struct ast *parse_decl_arg(struct context *ctx, bool named) {
 		if (!value) value = parse_expr(ctx);
 		if (!value) {
 			struct token *tok_err = tokens_peek(ctx->tokens);
-			builder_msg(MSG_ERR, ERR_EXPECTED_NAME, &tok_err->location, CARET_AFTER, "Expected .");
-			return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_err, scope_get(ctx)));
+			builder_msg(MSG_ERR, ERR_EXPECTED_NAME, tmp_location(ctx, tok_err), CARET_AFTER, "Expected .");
+			return_zone(create_node(ctx, AST_BAD, tok_err, scope_get(ctx)));
 		}
 	} else if (!type) {
 		builder_msg(
-		    MSG_ERR, ERR_EXPECTED_TYPE, name->location, CARET_AFTER, "Expected argument type.");
+		    MSG_ERR, ERR_EXPECTED_TYPE, ast_tmp_location(name), CARET_AFTER, "Expected argument type.");
 		return_zone(
-		    ast_create_node(ctx->ast_arena, AST_BAD, tokens_peek(ctx->tokens), scope_get(ctx)));
+		    create_node(ctx, AST_BAD, tokens_peek(ctx->tokens), scope_get(ctx)));
 	}
 
 	// Parse hash directives.
@@ -805,7 +832,7 @@ struct ast *parse_decl_arg(struct context *ctx, bool named) {
 		set_parent_function_type_flavor(ctx, AST_TYPE_FN_FLAVOR_MIXED);
 	}
 
-	struct ast *arg          = ast_create_node(ctx->ast_arena, AST_DECL_ARG, tok_begin, scope_get(ctx));
+	struct ast *arg          = create_node(ctx, AST_DECL_ARG, tok_begin, scope_get(ctx));
 	arg->data.decl_arg.value = value;
 	arg->data.decl.type      = type;
 	arg->data.decl.name      = name;
@@ -819,7 +846,7 @@ struct ast *parse_decl_variant(struct context *ctx, struct ast *prev) {
 	struct ast   *name      = parse_ident(ctx);
 	if (!name) return_zone(NULL);
 	struct ast *variant =
-	    ast_create_node(ctx->ast_arena, AST_DECL_VARIANT, tok_begin, scope_get(ctx));
+	    create_node(ctx, AST_DECL_VARIANT, tok_begin, scope_get(ctx));
 	variant->docs = pop_docs(ctx);
 
 	struct token *tok_assign = tokens_consume_if(ctx->tokens, SYM_ASSIGN);
@@ -829,10 +856,10 @@ struct ast *parse_decl_variant(struct context *ctx, struct ast *prev) {
 			struct token *tok_err = tokens_peek(ctx->tokens);
 			builder_msg(MSG_ERR,
 			            ERR_EXPECTED_NAME,
-			            &tok_err->location,
+			            tmp_location(ctx, tok_err),
 			            CARET_AFTER,
 			            "Expected enumerator variant value.");
-			return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_err, scope_get(ctx)));
+			return_zone(create_node(ctx, AST_BAD, tok_err, scope_get(ctx)));
 		}
 		variant->data.decl_variant.value = expr;
 	}
@@ -877,6 +904,7 @@ bool hash_directive_to_flags(enum hash_directive_flags hd, u32 *out_flags) {
 		FLAG_CASE(HD_COMPTIME, FLAG_COMPTIME);
 		FLAG_CASE(HD_MAYBE_UNUSED, FLAG_MAYBE_UNUSED);
 		FLAG_CASE(HD_OBSOLETE, FLAG_OBSOLETE);
+		FLAG_CASE(HD_PURE, FLAG_PURE);
 	default:
 		break;
 	}
@@ -890,7 +918,7 @@ struct ast *parse_stmt_using(struct context *ctx) {
 	if (!tok_begin) return_zone(NULL);
 
 	struct ast *stmt_using =
-	    ast_create_node(ctx->ast_arena, AST_STMT_USING, tok_begin, scope_get(ctx));
+	    create_node(ctx, AST_STMT_USING, tok_begin, scope_get(ctx));
 	struct ast *expr = parse_expr(ctx);
 	if (!expr) {
 		struct token *tok_err = tokens_consume(ctx->tokens);
@@ -898,7 +926,7 @@ struct ast *parse_stmt_using(struct context *ctx) {
 		             tok_err,
 		             CARET_WORD,
 		             "Expected scope or enumerator name after 'using' statement.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_err, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_err, scope_get(ctx)));
 	}
 
 	stmt_using->data.stmt_using.scope_expr = expr;
@@ -909,7 +937,7 @@ struct ast *parse_stmt_return(struct context *ctx) {
 	zone();
 	struct token *tok_begin = tokens_consume_if(ctx->tokens, SYM_RETURN);
 	if (!tok_begin) return_zone(NULL);
-	struct ast *ret               = ast_create_node(ctx->ast_arena, AST_STMT_RETURN, tok_begin, scope_get(ctx));
+	struct ast *ret               = create_node(ctx, AST_STMT_RETURN, tok_begin, scope_get(ctx));
 	ret->data.stmt_return.fn_decl = decl_get(ctx);
 	tok_begin                     = tokens_peek(ctx->tokens);
 
@@ -927,7 +955,7 @@ NEXT:
 	} else if (tok_comma) {
 		report_error(EXPECTED_EXPR, tok_comma, CARET_AFTER, "Expected another return value expression after comma ','.");
 		consume_till(ctx->tokens, SYM_SEMICOLON, SYM_RBLOCK, SYM_IDENT);
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_begin, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_begin, scope_get(ctx)));
 	}
 	return_zone(ret);
 }
@@ -936,7 +964,7 @@ NEXT:
 //                   target statement. We should not allow declarations and other concepts there.
 static void check_valid_inline_branch_node(struct ast *node) {
 	bassert(node);
-	bassert(node->location);
+	bassert(node->unit);
 	const char *what = NULL;
 	switch (node->kind) {
 	case AST_DECL_ENTITY:
@@ -955,7 +983,7 @@ static void check_valid_inline_branch_node(struct ast *node) {
 	if (!what) return;
 	builder_msg(MSG_ERR,
 	            ERR_UNEXPECTED_DECL,
-	            node->location,
+	            ast_tmp_location(node),
 	            CARET_WORD,
 	            "%s is not allowed here.",
 	            what);
@@ -969,7 +997,7 @@ struct ast *parse_stmt_if(struct context *ctx, bool is_static) {
 
 	const bool is_expression = ctx->is_inside_expression;
 
-	struct ast *stmt_if                 = ast_create_node(ctx->ast_arena, AST_STMT_IF, tok_begin, scope_get(ctx));
+	struct ast *stmt_if                 = create_node(ctx, AST_STMT_IF, tok_begin, scope_get(ctx));
 	stmt_if->data.stmt_if.is_static     = is_static;
 	stmt_if->data.stmt_if.is_expression = is_expression;
 	stmt_if->data.stmt_if.test          = parse_expr(ctx);
@@ -981,7 +1009,7 @@ struct ast *parse_stmt_if(struct context *ctx, bool is_static) {
 	if (!tok_then && is_expression) {
 		struct token *tok_err = tokens_peek(ctx->tokens);
 		report_error(INVALID_EXPR, tok_err, CARET_WORD, "Expected 'then' keyword after ternary if statement expression.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_err, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_err, scope_get(ctx)));
 	}
 
 	bool is_semicolon_required = !is_expression;
@@ -993,7 +1021,7 @@ struct ast *parse_stmt_if(struct context *ctx, bool is_static) {
 	struct ast *true_branch = parse_block(ctx, SCOPE_LEXICAL);
 	if (true_branch) {
 		if (is_expression) {
-			builder_msg(MSG_ERR, ERR_EXPECTED_EXPR, true_branch->location, CARET_WORD, "Blocks cannot be used in ternary if expressions.");
+			builder_msg(MSG_ERR, ERR_EXPECTED_EXPR, ast_tmp_location(true_branch), CARET_WORD, "Blocks cannot be used in ternary if expressions.");
 		}
 		is_semicolon_required = false;
 		has_explicit_true_branch_block = true;
@@ -1007,9 +1035,9 @@ struct ast *parse_stmt_if(struct context *ctx, bool is_static) {
 			if (true_branch) check_valid_inline_branch_node(true_branch);
 		} else {
 			// @Note 2025-03-10: Create implicit scope and block so defer will work correctly.
-			struct scope *scope = scope_create(ctx->scope_thread_local, SCOPE_LEXICAL, scope_get(ctx), &tok_then->location);
+			struct scope *scope = scope_create(ctx->scope_thread_local, SCOPE_LEXICAL, scope_get(ctx), get_location(ctx, tok_then));
 			scope_push(ctx, scope);
-			struct ast *block       = ast_create_node(ctx->ast_arena, AST_BLOCK, tok_then, scope_get(ctx));
+			struct ast *block       = create_node(ctx, AST_BLOCK, tok_then, scope_get(ctx));
 			block->data.block.nodes = arena_alloc(ctx->sarr_arena);
 			block_push(ctx, block);
 			true_branch = parse_single_block_stmt_or_expr(ctx, NULL);
@@ -1029,7 +1057,7 @@ struct ast *parse_stmt_if(struct context *ctx, bool is_static) {
 		             tok_err,
 		             CARET_WORD,
 		             "Expected statement, expression or block for the true result of the if test.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_err, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_err, scope_get(ctx)));
 	}
 
 	bassert(true_branch);
@@ -1045,7 +1073,7 @@ struct ast *parse_stmt_if(struct context *ctx, bool is_static) {
 		if (!false_branch) false_branch = parse_block(ctx, SCOPE_LEXICAL);
 		if (false_branch) {
 			if (is_expression) {
-				builder_msg(MSG_ERR, ERR_EXPECTED_EXPR, false_branch->location, CARET_WORD, "Blocks cannot be used in ternary if expressions.");
+				builder_msg(MSG_ERR, ERR_EXPECTED_EXPR, ast_tmp_location(false_branch), CARET_WORD, "Blocks cannot be used in ternary if expressions.");
 			}
 			is_semicolon_required = false;
 		} else if (has_explicit_true_branch_block) {
@@ -1059,9 +1087,9 @@ struct ast *parse_stmt_if(struct context *ctx, bool is_static) {
 				false_branch = parse_single_block_stmt_or_expr(ctx, NULL);
 				if (false_branch) check_valid_inline_branch_node(false_branch);
 			} else {
-				struct scope *scope = scope_create(ctx->scope_thread_local, SCOPE_LEXICAL, scope_get(ctx), &tok_then->location);
+				struct scope *scope = scope_create(ctx->scope_thread_local, SCOPE_LEXICAL, scope_get(ctx), get_location(ctx, tok_then));
 				scope_push(ctx, scope);
-				struct ast *block       = ast_create_node(ctx->ast_arena, AST_BLOCK, tok_then, scope_get(ctx));
+				struct ast *block       = create_node(ctx, AST_BLOCK, tok_then, scope_get(ctx));
 				block->data.block.nodes = arena_alloc(ctx->sarr_arena);
 				block_push(ctx, block);
 				false_branch = parse_single_block_stmt_or_expr(ctx, NULL);
@@ -1081,7 +1109,7 @@ struct ast *parse_stmt_if(struct context *ctx, bool is_static) {
 			             tok_err,
 			             CARET_WORD,
 			             "Expected statement, expression or block for the false result of the if test.");
-			return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_err, scope_get(ctx)));
+			return_zone(create_node(ctx, AST_BAD, tok_err, scope_get(ctx)));
 		}
 
 		bassert(false_branch);
@@ -1092,7 +1120,7 @@ struct ast *parse_stmt_if(struct context *ctx, bool is_static) {
 		             tok_err,
 		             CARET_WORD,
 		             "Expected else branch for ternary if expression. Ternary if expression evaluates into value which must be known for both expression test results.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_err, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_err, scope_get(ctx)));
 	}
 
 	stmt_if->data.stmt_if.false_stmt = false_branch;
@@ -1111,14 +1139,14 @@ struct ast *parse_stmt_switch(struct context *ctx) {
 		struct token *tok_err = tokens_consume(ctx->tokens);
 		report_error(
 		    EXPECTED_EXPR, tok_err, CARET_WORD, "Expected expression for the switch statement.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_err, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_err, scope_get(ctx)));
 	}
 
 	struct token *tok = tokens_consume_if(ctx->tokens, SYM_LBLOCK);
 	if (!tok) {
 		struct token *tok_err = tokens_peek(ctx->tokens);
 		report_error(EXPECTED_BODY, tok_err, CARET_WORD, "Expected switch body block.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_err, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_err, scope_get(ctx)));
 	}
 
 	ast_nodes_t *cases        = arena_alloc(ctx->sarr_arena);
@@ -1132,12 +1160,12 @@ NEXT:
 			if (default_case) {
 				builder_msg(MSG_ERR,
 				            ERR_INVALID_SWITCH_CASE,
-				            stmt_case->location,
+				            ast_tmp_location(stmt_case),
 				            CARET_WORD,
 				            "Switch statement cannot have more than one default cases.");
 
 				builder_msg(
-				    MSG_ERR_NOTE, 0, default_case->location, CARET_WORD, "Previous found here.");
+				    MSG_ERR_NOTE, 0, ast_tmp_location(default_case), CARET_WORD, "Previous found here.");
 			} else {
 				default_case = stmt_case;
 			}
@@ -1153,11 +1181,11 @@ NEXT:
 	if (!tok) {
 		struct token *tok_err = tokens_peek(ctx->tokens);
 		report_error(EXPECTED_BODY, tok_err, CARET_WORD, "Expected end of switch body block.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_err, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_err, scope_get(ctx)));
 	}
 
 	struct ast *stmt_switch =
-	    ast_create_node(ctx->ast_arena, AST_STMT_SWITCH, tok_switch, scope_get(ctx));
+	    create_node(ctx, AST_STMT_SWITCH, tok_switch, scope_get(ctx));
 
 	stmt_switch->data.stmt_switch.expr  = expr;
 	stmt_switch->data.stmt_switch.cases = cases;
@@ -1187,7 +1215,7 @@ NEXT:
 		if (tok_comma) goto NEXT;
 	} else if (tok_comma) {
 		report_error(EXPECTED_NAME, tok_comma, CARET_AFTER, "Expected case value expression after comma.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_case, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_case, scope_get(ctx)));
 	}
 
 SKIP_EXPRS:
@@ -1199,11 +1227,11 @@ SKIP_EXPRS:
 			report_error(MISSING_SEMICOLON, tok_err, CARET_AFTER, "Expected semicolon ';', comma ',' or block handling switch case. Use ';' "
 			                                                      "when you don't want to handle this case, use ',' in case you need just "
 			                                                      "fall-through or specify case handling block in curly braces.");
-			return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_err, scope_get(ctx)));
+			return_zone(create_node(ctx, AST_BAD, tok_err, scope_get(ctx)));
 		}
 	}
 
-	struct ast *stmt_case                = ast_create_node(ctx->ast_arena, AST_STMT_CASE, tok_case, scope_get(ctx));
+	struct ast *stmt_case                = create_node(ctx, AST_STMT_CASE, tok_case, scope_get(ctx));
 	stmt_case->data.stmt_case.exprs      = exprs;
 	stmt_case->data.stmt_case.is_default = !exprs;
 	stmt_case->data.stmt_case.block      = block;
@@ -1228,11 +1256,11 @@ struct ast *parse_stmt_loop(struct context *ctx) {
 	// Loop statement is immediately followed by block; this should act like while (true) {} in C.
 	const bool while_true = tokens_current_is(ctx->tokens, SYM_LBLOCK);
 
-	struct ast *loop         = ast_create_node(ctx->ast_arena, AST_STMT_LOOP, tok_begin, scope_get(ctx));
+	struct ast *loop         = create_node(ctx, AST_STMT_LOOP, tok_begin, scope_get(ctx));
 	const bool  prev_in_loop = ctx->is_inside_loop;
 	ctx->is_inside_loop      = true;
 
-	struct scope *scope = scope_create(ctx->scope_thread_local, SCOPE_LEXICAL, scope_get(ctx), &tok_begin->location);
+	struct scope *scope = scope_create(ctx->scope_thread_local, SCOPE_LEXICAL, scope_get(ctx), get_location(ctx, tok_begin));
 
 	scope_push(ctx, scope);
 
@@ -1263,7 +1291,7 @@ struct ast *parse_stmt_loop(struct context *ctx) {
 		report_error(EXPECTED_BODY, tok_err, CARET_WORD, "Expected loop body block.");
 		ctx->is_inside_loop = prev_in_loop;
 		scope_pop(ctx);
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_err, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_err, scope_get(ctx)));
 	}
 
 	ctx->is_inside_loop = prev_in_loop;
@@ -1279,7 +1307,7 @@ struct ast *parse_stmt_break(struct context *ctx) {
 	if (!ctx->is_inside_loop) {
 		report_error(BREAK_OUTSIDE_LOOP, tok, CARET_WORD, "Break statement outside a loop.");
 	}
-	return_zone(ast_create_node(ctx->ast_arena, AST_STMT_BREAK, tok, scope_get(ctx)));
+	return_zone(create_node(ctx, AST_STMT_BREAK, tok, scope_get(ctx)));
 }
 
 struct ast *parse_stmt_continue(struct context *ctx) {
@@ -1291,7 +1319,7 @@ struct ast *parse_stmt_continue(struct context *ctx) {
 		report_error(CONTINUE_OUTSIDE_LOOP, tok, CARET_WORD, "Continue statement outside a loop.");
 	}
 
-	return_zone(ast_create_node(ctx->ast_arena, AST_STMT_CONTINUE, tok, scope_get(ctx)));
+	return_zone(create_node(ctx, AST_STMT_CONTINUE, tok, scope_get(ctx)));
 }
 
 struct ast *parse_stmt_defer(struct context *ctx) {
@@ -1305,10 +1333,10 @@ struct ast *parse_stmt_defer(struct context *ctx) {
 	if (!expr) {
 		report_error(EXPECTED_EXPR, tok, CARET_WORD, "Expected expression after 'defer' statement.");
 		struct token *tok_err = tokens_peek(ctx->tokens);
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_err, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_err, scope_get(ctx)));
 	}
 
-	struct ast *defer           = ast_create_node(ctx->ast_arena, AST_STMT_DEFER, tok, scope_get(ctx));
+	struct ast *defer           = create_node(ctx, AST_STMT_DEFER, tok, scope_get(ctx));
 	defer->data.stmt_defer.expr = expr;
 
 	return_zone(defer);
@@ -1385,7 +1413,7 @@ struct ast *parse_expr_unary(struct context *ctx) {
 	if (!token_is_unary(op)) return_zone(NULL);
 
 	tokens_consume(ctx->tokens);
-	struct ast *unary           = ast_create_node(ctx->ast_arena, AST_EXPR_UNARY, op, scope_get(ctx));
+	struct ast *unary           = create_node(ctx, AST_EXPR_UNARY, op, scope_get(ctx));
 	unary->data.expr_unary.next = _parse_expr(ctx, token_prec(op).priority);
 	unary->data.expr_unary.kind = sym_to_unop_kind(op->sym);
 
@@ -1394,7 +1422,7 @@ struct ast *parse_expr_unary(struct context *ctx) {
 		report_error(
 		    EXPECTED_EXPR, err_tok, CARET_WORD, "Expected expression after unary operator.");
 		tokens_consume_till(ctx->tokens, SYM_SEMICOLON);
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, op, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, op, scope_get(ctx)));
 	}
 
 	if (unary->data.expr_unary.next->kind == AST_BAD) return_zone(unary->data.expr_unary.next);
@@ -1434,7 +1462,7 @@ parse_expr_binary(struct context *ctx, struct ast *lhs, struct ast *rhs, struct
 	zone();
 	if (!token_is_binop(op)) return_zone(NULL);
 
-	struct ast *binop           = ast_create_node(ctx->ast_arena, AST_EXPR_BINOP, op, scope_get(ctx));
+	struct ast *binop           = create_node(ctx, AST_EXPR_BINOP, op, scope_get(ctx));
 	binop->data.expr_binop.kind = sym_to_binop_kind(op->sym);
 	binop->data.expr_binop.lhs  = lhs;
 	binop->data.expr_binop.rhs  = rhs;
@@ -1446,12 +1474,12 @@ struct ast *parse_expr_addrof(struct context *ctx) {
 	struct token *tok = tokens_consume_if(ctx->tokens, SYM_AND);
 	if (!tok) return_zone(NULL);
 
-	struct ast *addrof            = ast_create_node(ctx->ast_arena, AST_EXPR_ADDROF, tok, scope_get(ctx));
+	struct ast *addrof            = create_node(ctx, AST_EXPR_ADDROF, tok, scope_get(ctx));
 	addrof->data.expr_addrof.next = _parse_expr(ctx, token_prec(tok).priority);
 
 	if (addrof->data.expr_addrof.next == NULL) {
 		report_error(EXPECTED_EXPR, tok, CARET_AFTER, "Expected expression after '&' address of operator.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok, scope_get(ctx)));
 	}
 
 	if (addrof->data.expr_addrof.next->kind == AST_BAD) return_zone(addrof->data.expr_addrof.next);
@@ -1463,12 +1491,12 @@ struct ast *parse_expr_deref(struct context *ctx) {
 	struct token *tok = tokens_consume_if(ctx->tokens, SYM_AT);
 	if (!tok) return_zone(NULL);
 
-	struct ast *deref           = ast_create_node(ctx->ast_arena, AST_EXPR_DEREF, tok, scope_get(ctx));
+	struct ast *deref           = create_node(ctx, AST_EXPR_DEREF, tok, scope_get(ctx));
 	deref->data.expr_deref.next = _parse_expr(ctx, token_prec(tok).priority);
 
 	if (deref->data.expr_deref.next == NULL) {
 		report_error(EXPECTED_EXPR, tok, CARET_AFTER, "Expected expression after '@' pointer dereference operator.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok, scope_get(ctx)));
 	}
 
 	if (deref->data.expr_deref.next->kind == AST_BAD) return_zone(deref->data.expr_deref.next);
@@ -1482,40 +1510,40 @@ struct ast *parse_expr_lit(struct context *ctx) {
 
 	switch (tok->sym) {
 	case SYM_NUM:
-		lit                        = ast_create_node(ctx->ast_arena, AST_EXPR_LIT_INT, tok, scope_get(ctx));
+		lit                        = create_node(ctx, AST_EXPR_LIT_INT, tok, scope_get(ctx));
 		lit->data.expr_integer.val = get_token_value(ctx, tok).number;
 		break;
 
 	case SYM_CHAR:
-		lit                          = ast_create_node(ctx->ast_arena, AST_EXPR_LIT_CHAR, tok, scope_get(ctx));
+		lit                          = create_node(ctx, AST_EXPR_LIT_CHAR, tok, scope_get(ctx));
 		lit->data.expr_character.val = (u8)get_token_value(ctx, tok).character;
 
 		break;
 
 	case SYM_TRUE:
-		lit                        = ast_create_node(ctx->ast_arena, AST_EXPR_LIT_BOOL, tok, scope_get(ctx));
+		lit                        = create_node(ctx, AST_EXPR_LIT_BOOL, tok, scope_get(ctx));
 		lit->data.expr_boolean.val = true;
 		break;
 
 	case SYM_FALSE:
-		lit                        = ast_create_node(ctx->ast_arena, AST_EXPR_LIT_BOOL, tok, scope_get(ctx));
+		lit                        = create_node(ctx, AST_EXPR_LIT_BOOL, tok, scope_get(ctx));
 		lit->data.expr_boolean.val = false;
 		break;
 
 	case SYM_DOUBLE:
-		lit                       = ast_create_node(ctx->ast_arena, AST_EXPR_LIT_DOUBLE, tok, scope_get(ctx));
+		lit                       = create_node(ctx, AST_EXPR_LIT_DOUBLE, tok, scope_get(ctx));
 		lit->data.expr_double.val = get_token_value(ctx, tok).double_number;
 		break;
 
 	case SYM_FLOAT:
-		lit                      = ast_create_node(ctx->ast_arena, AST_EXPR_LIT_FLOAT, tok, scope_get(ctx));
+		lit                      = create_node(ctx, AST_EXPR_LIT_FLOAT, tok, scope_get(ctx));
 		lit->data.expr_float.val = (f32)get_token_value(ctx, tok).double_number;
 		break;
 
 	case SYM_STRING: {
 		// There is special case for string literals, those can be split into multiple lines and we
 		// should handle such situation here, so some pre-scan is needed.
-		lit                    = ast_create_node(ctx->ast_arena, AST_EXPR_LIT_STRING, tok, scope_get(ctx));
+		lit                    = create_node(ctx, AST_EXPR_LIT_STRING, tok, scope_get(ctx));
 		struct token *tok_next = tokens_peek_2nd(ctx->tokens);
 		if (tok_next->sym == SYM_STRING) {
 			str_buf_t tmp = get_tmp_str();
@@ -1549,13 +1577,13 @@ struct ast *parse_expr_lit_fn(struct context *ctx) {
 	zone();
 	if (!tokens_is_seq(ctx->tokens, 2, SYM_FN, SYM_LPAREN)) return_zone(NULL);
 	struct token *tok_fn = tokens_peek(ctx->tokens);
-	struct ast   *fn     = ast_create_node(ctx->ast_arena, AST_EXPR_LIT_FN, tok_fn, scope_get(ctx));
+	struct ast   *fn     = create_node(ctx, AST_EXPR_LIT_FN, tok_fn, scope_get(ctx));
 
 	const bool prev_is_inside_expression = ctx->is_inside_expression;
 	ctx->is_inside_expression            = false;
 
 	// Create function scope for function signature.
-	struct scope *scope = scope_create(ctx->scope_thread_local, SCOPE_FN, scope_get(ctx), &tok_fn->location);
+	struct scope *scope = scope_create(ctx->scope_thread_local, SCOPE_FN, scope_get(ctx), get_location(ctx, tok_fn));
 	scope_push(ctx, scope);
 
 	struct ast *type = parse_type_fn(ctx, /* named_args */ true, /* create_scope */ false);
@@ -1566,7 +1594,7 @@ struct ast *parse_expr_lit_fn(struct context *ctx) {
 	if (curr_decl && curr_decl->kind == AST_DECL_ENTITY) {
 		u32 accepted = HD_EXTERN | HD_NO_INLINE | HD_INLINE | HD_COMPILER | HD_ENTRY |
 		               HD_BUILD_ENTRY | HD_INTRINSIC | HD_TEST_FN | HD_EXPORT | HD_COMPTIME |
-		               HD_MAYBE_UNUSED | HD_OBSOLETE | HD_ENABLE_IF;
+		               HD_MAYBE_UNUSED | HD_OBSOLETE | HD_ENABLE_IF | HD_PURE;
 		u32 flags = 0;
 		while (true) {
 			enum hash_directive_flags found        = HD_NONE;
@@ -1598,7 +1626,14 @@ struct ast *parse_expr_lit_fn(struct context *ctx) {
 	}
 
 	// parse block (block is optional function body can be external)
-	fn->data.expr_fn.block = parse_block(ctx, SCOPE_FN_BODY);
+	if (tok_fn == ctx->lazy_fn_token && is_lazy_fn_candidate(fn, curr_decl)) {
+		ctx->lazy_fn_token     = NULL;
+		fn->data.expr_fn.block = skip_fn_body(ctx, curr_decl);
+		ctx->lazy_fn_block     = fn->data.expr_fn.block;
+	}
+	if (!fn->data.expr_fn.block) {
+		fn->data.expr_fn.block = parse_block(ctx, SCOPE_FN_BODY);
+	}
 
 	ctx->is_inside_expression = prev_is_inside_expression;
 
@@ -1611,9 +1646,9 @@ struct ast *parse_expr_lit_fn_group(struct context *ctx) {
 	if (!tokens_is_seq(ctx->tokens, 2, SYM_FN, SYM_LBLOCK)) return_zone(NULL);
 	struct token *tok_group = tokens_consume(ctx->tokens); // eat fn
 	struct token *tok_begin = tokens_consume(ctx->tokens); // eat {
-	struct ast   *group     = ast_create_node(ctx->ast_arena, AST_EXPR_LIT_FN_GROUP, tok_group, scope_get(ctx));
+	struct ast   *group     = create_node(ctx, AST_EXPR_LIT_FN_GROUP, tok_group, scope_get(ctx));
 
-	struct scope *scope = scope_create(ctx->scope_thread_local, SCOPE_FN_GROUP, scope_get(ctx), &tok_begin->location);
+	struct scope *scope = scope_create(ctx->scope_thread_local, SCOPE_FN_GROUP, scope_get(ctx), get_location(ctx, tok_begin));
 	scope_push(ctx, scope);
 
 	ast_nodes_t *variants              = arena_alloc(ctx->sarr_arena);
@@ -1633,7 +1668,7 @@ NEXT:
 		tok = tokens_peek_prev(ctx->tokens);
 		report_error(EXPECTED_BODY_END, tok, CARET_AFTER, "Expected end of block '}'.");
 		report_note(tok_begin, CARET_WORD, "Block starting here.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_begin, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_begin, scope_get(ctx)));
 	}
 	return_zone(group);
 }
@@ -1655,7 +1690,7 @@ struct ast *parse_expr_nested(struct context *ctx) {
 		struct token *tok_err = tokens_peek(ctx->tokens);
 		report_error(MISSING_BRACKET, tok_err, CARET_WORD, "Unterminated sub-expression, missing ')'.");
 		report_note(tok_begin, CARET_WORD, "starting here");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_begin, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_begin, scope_get(ctx)));
 	}
 
 	return_zone(expr);
@@ -1667,7 +1702,7 @@ struct ast *parse_expr_elem(struct context *ctx, struct ast *prev) {
 	struct token *tok_elem = tokens_consume_if(ctx->tokens, SYM_LBRACKET);
 	if (!tok_elem) return_zone(NULL);
 
-	struct ast *elem           = ast_create_node(ctx->ast_arena, AST_EXPR_ELEM, tok_elem, scope_get(ctx));
+	struct ast *elem           = create_node(ctx, AST_EXPR_ELEM, tok_elem, scope_get(ctx));
 	elem->data.expr_elem.index = parse_expr(ctx);
 	elem->data.expr_elem.next  = prev;
 
@@ -1703,7 +1738,7 @@ NEXT:
 		struct token *tok_err = tokens_peek(ctx->tokens);
 		report_error(EXPECTED_NAME, tok_err, CARET_WORD, "Expected name after comma ','.");
 		consume_till(ctx->tokens, SYM_COLON, SYM_SEMICOLON, SYM_IDENT);
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_err, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_err, scope_get(ctx)));
 	}
 	return_zone(root);
 }
@@ -1713,11 +1748,11 @@ struct ast *parse_type_ptr(struct context *ctx) {
 	struct token *tok_begin = tokens_consume_if(ctx->tokens, SYM_ASTERISK);
 	if (!tok_begin) return_zone(NULL);
 
-	struct ast *ptr      = ast_create_node(ctx->ast_arena, AST_TYPE_PTR, tok_begin, scope_get(ctx));
+	struct ast *ptr      = create_node(ctx, AST_TYPE_PTR, tok_begin, scope_get(ctx));
 	struct ast *sub_type = parse_type(ctx);
 	if (!sub_type) {
 		report_error(EXPECTED_TYPE, tok_begin, CARET_AFTER, "Expected a type name or type declaration after '*' in pointer declaration, '*<type>'.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_begin, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_begin, scope_get(ctx)));
 	}
 	ptr->data.type_ptr.type = sub_type;
 	return_zone(ptr);
@@ -1728,7 +1763,7 @@ struct ast *parse_type_vargs(struct context *ctx) {
 	struct token *tok_begin = tokens_consume_if(ctx->tokens, SYM_VARGS);
 	if (!tok_begin) return_zone(NULL);
 
-	struct ast *ptr         = ast_create_node(ctx->ast_arena, AST_TYPE_VARGS, tok_begin, scope_get(ctx));
+	struct ast *ptr         = create_node(ctx, AST_TYPE_VARGS, tok_begin, scope_get(ctx));
 	ptr->data.type_ptr.type = parse_type(ctx);
 	return_zone(ptr);
 }
@@ -1738,7 +1773,7 @@ struct ast *parse_type_enum(struct context *ctx) {
 	struct token *tok_enum = tokens_consume_if(ctx->tokens, SYM_ENUM);
 	if (!tok_enum) return_zone(NULL);
 
-	struct ast *enm             = ast_create_node(ctx->ast_arena, AST_TYPE_ENUM, tok_enum, scope_get(ctx));
+	struct ast *enm             = create_node(ctx, AST_TYPE_ENUM, tok_enum, scope_get(ctx));
 	enm->data.type_enm.variants = arena_alloc(ctx->sarr_arena);
 	enm->data.type_enm.type     = parse_type(ctx);
 
@@ -1762,10 +1797,10 @@ struct ast *parse_type_enum(struct context *ctx) {
 	struct token *tok = tokens_consume(ctx->tokens);
 	if (token_is_not(tok, SYM_LBLOCK)) {
 		report_error(MISSING_BRACKET, tok, CARET_WORD, "Expected enum variant list.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok, scope_get(ctx)));
 	}
 
-	struct scope *scope = scope_create(ctx->scope_thread_local, SCOPE_TYPE_ENUM, scope_get(ctx), &tok->location);
+	struct scope *scope = scope_create(ctx->scope_thread_local, SCOPE_TYPE_ENUM, scope_get(ctx), get_location(ctx, tok));
 	scope_reserve(scope, 256);
 
 	enm->data.type_enm.scope = scope;
@@ -1792,7 +1827,7 @@ NEXT:
 		if (tokens_peek_2nd(ctx->tokens)->sym == SYM_RBLOCK) {
 			report_error(EXPECTED_NAME, tok_err, CARET_WORD, "Expected variant after semicolon.");
 			scope_pop(ctx);
-			return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok, scope_get(ctx)));
+			return_zone(create_node(ctx, AST_BAD, tok, scope_get(ctx)));
 		}
 	}
 
@@ -1804,7 +1839,7 @@ NEXT:
 		             "Expected end of variant list '}' or another variant separated by semicolon.");
 		scope_pop(ctx);
 		tokens_consume_till(ctx->tokens, SYM_SEMICOLON);
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok, scope_get(ctx)));
 	}
 
 	scope_pop(ctx);
@@ -1816,7 +1851,7 @@ struct ast *parse_ref(struct context *ctx) {
 	struct token *tok   = tokens_peek(ctx->tokens);
 	struct ast   *ident = parse_ident(ctx);
 	if (!ident) return_zone(NULL);
-	struct ast *lhs            = ast_create_node(ctx->ast_arena, AST_REF, tok, scope_get(ctx));
+	struct ast *lhs            = create_node(ctx, AST_REF, tok, scope_get(ctx));
 	lhs->data.ref.ident        = ident;
 	lhs->data.ref.used_in_decl = decl_get(ctx);
 	struct ast *tmp            = NULL;
@@ -1840,10 +1875,10 @@ struct ast *parse_ref_nested(struct context *ctx, struct ast *prev) {
 	if (!ident) {
 		struct token *tok_err = tokens_peek(ctx->tokens);
 		report_error(EXPECTED_NAME, tok_err, CARET_WORD, "Expected name.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok, scope_get(ctx)));
 	}
 
-	struct ast *ref            = ast_create_node(ctx->ast_arena, AST_REF, tok, scope_get(ctx));
+	struct ast *ref            = create_node(ctx, AST_REF, tok, scope_get(ctx));
 	ref->data.ref.ident        = ident;
 	ref->data.ref.next         = prev;
 	ref->data.ref.used_in_decl = decl_get(ctx);
@@ -1861,7 +1896,7 @@ struct ast *parse_type_polymorph(struct context *ctx) {
 		             CARET_WORD,
 		             "Polymorph type can be specified only in function argument list.");
 		tokens_consume_till(ctx->tokens, SYM_SEMICOLON);
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_begin, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_begin, scope_get(ctx)));
 	}
 	set_parent_function_type_flavor(ctx, AST_TYPE_FN_FLAVOR_POLYMORPH);
 	struct ast *ident = parse_ident(ctx);
@@ -1869,9 +1904,9 @@ struct ast *parse_type_polymorph(struct context *ctx) {
 		struct token *tok_err = tokens_peek(ctx->tokens);
 		report_error(EXPECTED_NAME, tok_err, CARET_WORD, "Expected name of polymorph type.");
 		tokens_consume_till(ctx->tokens, SYM_SEMICOLON);
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_begin, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_begin, scope_get(ctx)));
 	}
-	struct ast *poly           = ast_create_node(ctx->ast_arena, AST_TYPE_POLY, tok_begin, scope_get(ctx));
+	struct ast *poly           = create_node(ctx, AST_TYPE_POLY, tok_begin, scope_get(ctx));
 	poly->data.type_poly.ident = ident;
 	return_zone(poly);
 }
@@ -1881,7 +1916,7 @@ struct ast *parse_type_arr(struct context *ctx) {
 	struct token *tok_begin = tokens_consume_if(ctx->tokens, SYM_LBRACKET);
 	if (!tok_begin) return_zone(NULL);
 
-	struct ast *arr        = ast_create_node(ctx->ast_arena, AST_TYPE_ARR, tok_begin, scope_get(ctx));
+	struct ast *arr        = create_node(ctx, AST_TYPE_ARR, tok_begin, scope_get(ctx));
 	struct ast *len        = parse_expr(ctx);
 	arr->data.type_arr.len = len;
 
@@ -1889,7 +1924,7 @@ struct ast *parse_type_arr(struct context *ctx) {
 		struct token *tok_err = tokens_peek(ctx->tokens);
 		report_error(EXPECTED_EXPR, tok_err, CARET_WORD, "Expected array size expression.");
 		tokens_consume_till(ctx->tokens, SYM_SEMICOLON);
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_begin, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_begin, scope_get(ctx)));
 	}
 
 	if (len->kind == AST_REF) {
@@ -1906,14 +1941,14 @@ struct ast *parse_type_arr(struct context *ctx) {
 		             "Expected closing ']' after array size expression.");
 		tokens_consume_till(ctx->tokens, SYM_SEMICOLON);
 
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_begin, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_begin, scope_get(ctx)));
 	}
 
 	arr->data.type_arr.elem_type = parse_type(ctx);
 	if (!arr->data.type_arr.elem_type) {
 		struct token *tok_err = tokens_peek(ctx->tokens);
 		report_error(INVALID_TYPE, tok_err, CARET_WORD, "Expected array element type.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_begin, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_begin, scope_get(ctx)));
 	}
 
 	return_zone(arr);
@@ -1928,13 +1963,13 @@ struct ast *parse_type_slice(struct context *ctx) {
 	struct token *tok_begin = tokens_consume(ctx->tokens);
 	tok_begin               = tokens_consume(ctx->tokens);
 
-	struct ast *slice = ast_create_node(ctx->ast_arena, AST_TYPE_SLICE, tok_begin, scope_get(ctx));
+	struct ast *slice = create_node(ctx, AST_TYPE_SLICE, tok_begin, scope_get(ctx));
 
 	slice->data.type_slice.elem_type = parse_type(ctx);
 
 	if (!slice->data.type_slice.elem_type) {
 		report_error(INVALID_TYPE, tok_begin, CARET_AFTER, "Expected slice element type.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_begin, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_begin, scope_get(ctx)));
 	}
 
 	return_zone(slice);
@@ -1958,15 +1993,15 @@ struct ast *parse_type_dynarr(struct context *ctx) {
 		             "Expected closing ']' after dynamic array signature.");
 		tokens_consume_till(ctx->tokens, SYM_SEMICOLON);
 
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_begin, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_begin, scope_get(ctx)));
 	}
 
-	struct ast *slice                 = ast_create_node(ctx->ast_arena, AST_TYPE_DYNARR, tok_begin, scope_get(ctx));
+	struct ast *slice                 = create_node(ctx, AST_TYPE_DYNARR, tok_begin, scope_get(ctx));
 	slice->data.type_dynarr.elem_type = parse_type(ctx);
 
 	if (!slice->data.type_dynarr.elem_type) {
 		report_error(INVALID_TYPE, tok_end, CARET_AFTER, "Expected dynamic array element type.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_begin, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_begin, scope_get(ctx)));
 	}
 
 	return_zone(slice);
@@ -2008,11 +2043,11 @@ struct ast *parse_type_fn_return(struct context *ctx) {
 		// multiple return type ( T1, T2 )
 		// eat (
 		struct token *tok_begin = tokens_consume(ctx->tokens);
-		struct scope *scope     = scope_create(ctx->scope_thread_local, SCOPE_TYPE_STRUCT, scope_get(ctx), &tok_begin->location);
+		struct scope *scope     = scope_create(ctx->scope_thread_local, SCOPE_TYPE_STRUCT, scope_get(ctx), get_location(ctx, tok_begin));
 		scope_push(ctx, scope);
 
 		struct ast *type_struct =
-		    ast_create_node(ctx->ast_arena, AST_TYPE_STRUCT, tok_begin, scope_get(ctx));
+		    create_node(ctx, AST_TYPE_STRUCT, tok_begin, scope_get(ctx));
 		type_struct->data.type_strct.scope                   = scope;
 		type_struct->data.type_strct.members                 = arena_alloc(ctx->sarr_arena);
 		type_struct->data.type_strct.is_multiple_return_type = true;
@@ -2032,7 +2067,7 @@ struct ast *parse_type_fn_return(struct context *ctx) {
 			             CARET_WORD,
 			             "Expected end of return list or another return type separated by comma.");
 			scope_pop(ctx);
-			return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_begin, scope_get(ctx)));
+			return_zone(create_node(ctx, AST_BAD, tok_begin, scope_get(ctx)));
 		}
 		scope_pop(ctx);
 		if (!sarrlenu(type_struct->data.type_strct.members)) {
@@ -2055,12 +2090,12 @@ struct ast *parse_type_fn(struct context *ctx, bool named_args, bool create_scop
 	struct token *tok = tokens_consume(ctx->tokens);
 	if (tok->sym != SYM_LPAREN) {
 		report_error(MISSING_BRACKET, tok, CARET_WORD, "Expected function parameter list.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_fn, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_fn, scope_get(ctx)));
 	}
-	struct ast *fn = ast_create_node(ctx->ast_arena, AST_TYPE_FN, tok_fn, scope_get(ctx));
+	struct ast *fn = create_node(ctx, AST_TYPE_FN, tok_fn, scope_get(ctx));
 
 	if (create_scope) {
-		struct scope *scope = scope_create(ctx->scope_thread_local, SCOPE_FN, scope_get(ctx), &tok_fn->location);
+		struct scope *scope = scope_create(ctx->scope_thread_local, SCOPE_FN, scope_get(ctx), get_location(ctx, tok_fn));
 		scope_push(ctx, scope);
 	}
 
@@ -2092,7 +2127,7 @@ NEXT:
 			report_error(EXPECTED_NAME, tok_err, CARET_WORD, "Expected type after comma ','.");
 			arrpop(ctx->fn_type_stack);
 			if (create_scope) scope_pop(ctx);
-			return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_fn, scope_get(ctx)));
+			return_zone(create_node(ctx, AST_BAD, tok_fn, scope_get(ctx)));
 		}
 	}
 
@@ -2105,7 +2140,7 @@ NEXT:
 		             "by comma.");
 		arrpop(ctx->fn_type_stack);
 		if (create_scope) scope_pop(ctx);
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_fn, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_fn, scope_get(ctx)));
 	}
 	fn->data.type_fn.ret_type = parse_type_fn_return((ctx));
 	arrpop(ctx->fn_type_stack);
@@ -2119,7 +2154,7 @@ struct ast *parse_type_fn_group(struct context *ctx) {
 	struct token *tok_group = tokens_consume(ctx->tokens); // eat fn
 	struct token *tok_begin = tokens_consume(ctx->tokens); // eat {
 	struct ast   *group =
-	    ast_create_node(ctx->ast_arena, AST_TYPE_FN_GROUP, tok_group, scope_get(ctx));
+	    create_node(ctx, AST_TYPE_FN_GROUP, tok_group, scope_get(ctx));
 
 	ast_nodes_t *variants              = arena_alloc(ctx->sarr_arena);
 	group->data.type_fn_group.variants = variants;
@@ -2130,7 +2165,7 @@ NEXT:
 		if (tmp->kind != AST_TYPE_FN) {
 			// This check is important, when we decide to remove this, validation should
 			// be handled in MIR.
-			builder_msg(MSG_ERR, ERR_INVALID_TYPE, tmp->location, CARET_WORD, "Expected function type.");
+			builder_msg(MSG_ERR, ERR_INVALID_TYPE, ast_tmp_location(tmp), CARET_WORD, "Expected function type.");
 		}
 		sarrput(variants, tmp);
 		goto NEXT;
@@ -2141,7 +2176,7 @@ NEXT:
 		tok = tokens_peek_prev(ctx->tokens);
 		report_error(EXPECTED_BODY_END, tok, CARET_AFTER, "Expected end of block '}'.");
 		report_note(tok_begin, CARET_WORD, "Block starting here.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_begin, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_begin, scope_get(ctx)));
 	}
 	return_zone(group);
 }
@@ -2179,14 +2214,14 @@ struct ast *parse_type_struct(struct context *ctx) {
 	struct token *tok = tokens_consume_if(ctx->tokens, SYM_LBLOCK);
 	if (!tok) {
 		report_error(MISSING_BRACKET, tok_struct, CARET_AFTER, "Expected struct member list.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_struct, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_struct, scope_get(ctx)));
 	}
 
-	struct scope *scope = scope_create(ctx->scope_thread_local, SCOPE_TYPE_STRUCT, scope_get(ctx), &tok->location);
+	struct scope *scope = scope_create(ctx->scope_thread_local, SCOPE_TYPE_STRUCT, scope_get(ctx), get_location(ctx, tok));
 	scope_push(ctx, scope);
 
 	struct ast *type_struct =
-	    ast_create_node(ctx->ast_arena, AST_TYPE_STRUCT, tok_struct, scope_get(ctx));
+	    create_node(ctx, AST_TYPE_STRUCT, tok_struct, scope_get(ctx));
 	type_struct->data.type_strct.scope          = scope;
 	type_struct->data.type_strct.members        = arena_alloc(ctx->sarr_arena);
 	type_struct->data.type_strct.base_type_expr = base_type_expr;
@@ -2218,7 +2253,7 @@ NEXT:
 		             "Expected end of member list '}' or another member separated by semicolon.");
 		tokens_consume_till(ctx->tokens, SYM_SEMICOLON);
 		scope_pop(ctx);
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_struct, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_struct, scope_get(ctx)));
 	}
 
 	scope_pop(ctx);
@@ -2247,7 +2282,7 @@ struct ast *parse_decl(struct context *ctx) {
 	// eat :
 	tokens_consume(ctx->tokens);
 
-	struct ast *decl           = ast_create_node(ctx->ast_arena, AST_DECL_ENTITY, tok_begin, scope_get(ctx));
+	struct ast *decl           = create_node(ctx, AST_DECL_ENTITY, tok_begin, scope_get(ctx));
 	decl->docs                 = pop_docs(ctx);
 	decl->data.decl.name       = ident;
 	decl->data.decl_entity.mut = true;
@@ -2264,19 +2299,36 @@ struct ast *parse_decl(struct context *ctx) {
 	if (tok_assign) {
 		decl->data.decl_entity.mut = token_is(tok_assign, SYM_ASSIGN);
 
+		if (ctx->is_lazy_parsing_enabled && !decl->data.decl_entity.mut && arrlenu(ctx->decl_stack) == 1 &&
+		    !scope_is_local(scope_get(ctx)) && tokens_is_seq(ctx->tokens, 2, SYM_FN, SYM_LPAREN)) {
+			ctx->lazy_fn_token = tokens_peek(ctx->tokens);
+		}
+
 		// parse declaration expression
 		decl->data.decl_entity.value = parse_expr(ctx);
+		ctx->lazy_fn_token           = NULL;
+		if (ctx->lazy_fn_block) {
+			// The body can stay unparsed only in case the function literal is directly the
+			// declaration value.
+			struct ast *value = decl->data.decl_entity.value;
+			if (!value || value->kind != AST_EXPR_LIT_FN || value->data.expr_fn.block != ctx->lazy_fn_block) {
+				parse_lazy_fn_body(ctx, ctx->lazy_fn_block);
+			} else {
+				batomic_fetch_add_s32(&ctx->assembly->stats.lazy_fn_count, 1);
+			}
+			ctx->lazy_fn_block = NULL;
+		}
 		if (AST_IS_BAD(decl->data.decl_entity.value)) {
 			tokens_consume_till(ctx->tokens, SYM_SEMICOLON);
 			decl_pop(ctx);
-			return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_begin, scope_get(ctx)));
+			return_zone(create_node(ctx, AST_BAD, tok_begin, scope_get(ctx)));
 		}
 
 		if (isnotflag(decl->data.decl.flags, FLAG_EXTERN)) {
 			if (!decl->data.decl_entity.value) {
 				report_error(EXPECTED_INITIALIZATION, tok_assign, CARET_AFTER, "Expected binding of declaration to some value.");
 				decl_pop(ctx);
-				return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_begin, scope_get(ctx)));
+				return_zone(create_node(ctx, AST_BAD, tok_begin, scope_get(ctx)));
 			}
 		}
 	} else {
@@ -2318,7 +2370,7 @@ struct ast *parse_expr_call(struct context *ctx, struct ast *prev) {
 	struct token *tok            = tokens_consume_if(ctx->tokens, SYM_LPAREN);
 	if (!tok) return_zone(NULL);
 	if (location_token && location_token->sym != SYM_IDENT) location_token = tok;
-	struct ast *call         = ast_create_node(ctx->ast_arena, AST_EXPR_CALL, location_token, scope_get(ctx));
+	struct ast *call         = create_node(ctx, AST_EXPR_CALL, location_token, scope_get(ctx));
 	call->data.expr_call.ref = prev;
 	// parse args
 	bool        rq = false;
@@ -2340,7 +2392,7 @@ arg:
 		if (tokens_peek_2nd(ctx->tokens)->sym == SYM_RBLOCK) {
 			report_error(
 			    EXPECTED_NAME, tok_err, CARET_WORD, "Expected function argument after comma ','.");
-			return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok, scope_get(ctx)));
+			return_zone(create_node(ctx, AST_BAD, tok, scope_get(ctx)));
 		}
 	}
 
@@ -2350,7 +2402,7 @@ arg:
 		             tok,
 		             CARET_WORD,
 		             "Expected end of parameter list ')' or another parameter separated by comma.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok, scope_get(ctx)));
 	}
 
 	// catch block
@@ -2371,9 +2423,9 @@ struct ast *parse_expr_catch(struct context *ctx, struct ast *call) {
 
 	struct ast *block_or_expr = parse_block(ctx, SCOPE_LEXICAL);
 	if (!block_or_expr) {
-		struct scope *scope = scope_create(ctx->scope_thread_local, SCOPE_LEXICAL, scope_get(ctx), &tok_catch->location);
+		struct scope *scope = scope_create(ctx->scope_thread_local, SCOPE_LEXICAL, scope_get(ctx), get_location(ctx, tok_catch));
 		scope_push(ctx, scope);
-		struct ast *block       = ast_create_node(ctx->ast_arena, AST_BLOCK, tok_catch, scope_get(ctx));
+		struct ast *block       = create_node(ctx, AST_BLOCK, tok_catch, scope_get(ctx));
 		block->data.block.nodes = arena_alloc(ctx->sarr_arena);
 		block_push(ctx, block);
 		block_or_expr = parse_single_block_stmt_or_expr(ctx, NULL);
@@ -2390,12 +2442,12 @@ struct ast *parse_expr_catch(struct context *ctx, struct ast *call) {
 		             tok_err,
 		             CARET_WORD,
 		             "Expected statement, expression or block handling catched error.");
-		return_zone(ast_create_node(ctx->ast_arena, AST_BAD, tok_catch, scope_get(ctx)));
+		return_zone(create_node(ctx, AST_BAD, tok_catch, scope_get(ctx)));
 	}
 
 	ctx->is_inside_expression = prev_is_inside_expression;
 
-	struct ast *catch                    = ast_create_node(ctx->ast_arena, AST_EXPR_CATCH, tok_catch, scope_get(ctx));
+	struct ast *catch                    = create_node(ctx, AST_EXPR_CATCH, tok_catch, scope_get(ctx));
 	catch->data.expr_catch.call          = call;
 	catch->data.expr_catch.block_or_expr = block_or_expr;
 
@@ -2405,20 +2457,20 @@ struct ast *parse_expr_catch(struct context *ctx, struct ast *call) {
 struct ast *parse_expr_null(struct context *ctx) {
 	struct token *tok_null = tokens_consume_if(ctx->tokens, SYM_NULL);
 	if (!tok_null) return NULL;
-	return ast_create_node(ctx->ast_arena, AST_EXPR_NULL, tok_null, scope_get(ctx));
+	return create_node(ctx, AST_EXPR_NULL, tok_null, scope_get(ctx));
 }
 
 struct ast *parse_unrecheable(struct context *ctx) {
 	struct token *tok = tokens_consume_if(ctx->tokens, SYM_UNREACHABLE);
 	if (!tok) return NULL;
 
-	return ast_create_node(ctx->ast_arena, AST_UNREACHABLE, tok, scope_get(ctx));
+	return create_node(ctx, AST_UNREACHABLE, tok, scope_get(ctx));
 }
 
 struct ast *parse_debugbreak(struct context *ctx) {
 	struct token *tok = tokens_consume_if(ctx->tokens, SYM_DEBUGBREAK);
 	if (!tok) return NULL;
-	return ast_create_node(ctx->ast_arena, AST_DEBUGBREAK, tok, scope_get(ctx));
+	return create_node(ctx, AST_DEBUGBREAK, tok, scope_get(ctx));
 }
 
 struct ast *parse_expr_type(struct context *ctx) {
@@ -2437,7 +2489,7 @@ struct ast *parse_expr_type(struct context *ctx) {
 	if (!type) type = parse_type_ptr(ctx);
 
 	if (type) {
-		struct ast *expr          = ast_create_node(ctx->ast_arena, AST_EXPR_TYPE, tok, scope_get(ctx));
+		struct ast *expr          = create_node(ctx, AST_EXPR_TYPE, tok, scope_get(ctx));
 		expr->data.expr_type.type = type;
 		return expr;
 	}
@@ -2539,13 +2591,21 @@ struct ast *parse_block(struct context *ctx, enum scope_kind scope_kind) {
 		bassert((scope_kind == SCOPE_LEXICAL || scope_kind == SCOPE_FN_BODY) &&
 		        "Unexpected scope kind, extend this assert in case it's intentional.");
 
-		struct scope *scope = scope_create(ctx->scope_thread_local, scope_kind, scope_get(ctx), &tok_begin->location);
+		struct scope *scope = scope_create(ctx->scope_thread_local, scope_kind, scope_get(ctx), get_location(ctx, tok_begin));
 
 		scope_push(ctx, scope);
 		scope_created = true;
 	}
-	struct ast *block = ast_create_node(ctx->ast_arena, AST_BLOCK, tok_begin, scope_get(ctx));
-	struct ast *tmp   = NULL;
+	struct ast *block = create_node(ctx, AST_BLOCK, tok_begin, scope_get(ctx));
+	const bool  is_ok = parse_block_content(ctx, block, tok_begin);
+
+	if (scope_created) scope_pop(ctx);
+	if (!is_ok) return create_node(ctx, AST_BAD, tok_begin, scope_get(ctx));
+	return block;
+}
+
+bool parse_block_content(struct context *ctx, struct ast *block, struct token *tok_begin) {
+	struct ast *tmp = NULL;
 
 	block->data.block.nodes = arena_alloc(ctx->sarr_arena);
 
@@ -2557,21 +2617,87 @@ struct ast *parse_block(struct context *ctx, enum scope_kind scope_kind) {
 		if (require_semicolon) parse_semicolon_rq(ctx);
 	}
 
+	block_pop(ctx);
+
 	struct token *tok = tokens_consume_if(ctx->tokens, SYM_RBLOCK);
 	if (!tok) {
 		tok = tokens_peek_prev(ctx->tokens);
 		report_error(EXPECTED_BODY_END, tok, CARET_AFTER, "Expected end of block '}'.");
 		report_note(tok_begin, CARET_WORD, "Block starting here.");
-		if (scope_created) scope_pop(ctx);
-		block_pop(ctx);
-		return ast_create_node(ctx->ast_arena, AST_BAD, tok_begin, scope_get(ctx));
+		return false;
 	}
+	return true;
+}
 
-	if (scope_created) scope_pop(ctx);
-	block_pop(ctx);
+bool is_lazy_fn_candidate(struct ast *fn, struct ast *decl) {
+	bassert(fn->kind == AST_EXPR_LIT_FN);
+	if (!decl || decl->kind != AST_DECL_ENTITY) return false;
+	// Generated functions have their own deferred generation.
+	struct ast *type = fn->data.expr_fn.type;
+	if (type->kind != AST_TYPE_FN || type->data.type_fn.flavor != AST_TYPE_FN_FLAVOR_NONE) return false;
+	// Entry points of the analysis and functions without body.
+	const u32 root_flags = FLAG_ENTRY | FLAG_BUILD_ENTRY | FLAG_EXPORT | FLAG_TEST_FN | FLAG_EXTERN | FLAG_INTRINSIC | FLAG_COMPILER;
+	return (decl->data.decl.flags & root_flags) == 0;
+}
+
+struct ast *skip_fn_body(struct context *ctx, struct ast *decl) {
+	struct tokens *tokens    = ctx->tokens;
+	struct token  *tok_begin = tokens_peek(tokens);
+	if (tok_begin->sym != SYM_LBLOCK) return NULL;
+
+	// Find the matching end of the body; unbalanced body is parsed immediately to get proper
+	// error reports.
+	const usize begin = tokens->iter;
+	const usize len   = arrlenu(tokens->buf);
+	s32         depth = 0;
+	usize       end   = begin;
+	for (; end < len; ++end) {
+		const enum sym sym = tokens->buf[end].sym;
+		if (sym == SYM_LBLOCK) {
+			++depth;
+		} else if (sym == SYM_RBLOCK) {
+			if (--depth == 0) break;
+		} else if (sym == SYM_EOF) {
+			return NULL;
+		}
+	}
+	if (end == len) return NULL;
+
+	struct scope *scope = scope_create(ctx->scope_thread_local, SCOPE_FN_BODY, scope_get(ctx), get_location(ctx, tok_begin));
+	struct ast   *block = create_node(ctx, AST_BLOCK, tok_begin, scope);
+
+	block->data.block.lazy_decl        = decl;
+	block->data.block.lazy_token_index = (u32)begin;
+
+	tokens->iter = end + 1;
 	return block;
 }
 
+void parse_lazy_fn_body(struct context *ctx, struct ast *block) {
+	bassert(block->kind == AST_BLOCK && block->data.block.lazy_decl);
+	const usize prev_iter = ctx->tokens->iter;
+	ctx->tokens->iter     = block->data.block.lazy_token_index;
+
+	struct token *tok_begin = tokens_consume(ctx->tokens);
+	bassert(tok_begin->sym == SYM_LBLOCK);
+
+	const bool prev_is_inside_loop       = ctx->is_inside_loop;
+	const bool prev_is_inside_expression = ctx->is_inside_expression;
+	ctx->is_inside_loop                  = false;
+	ctx->is_inside_expression            = false;
+
+	decl_push(ctx, block->data.block.lazy_decl);
+	scope_push(ctx, block->owner_scope);
+	parse_block_content(ctx, block, tok_begin);
+	scope_pop(ctx);
+	decl_pop(ctx);
+
+	ctx->is_inside_loop         = prev_is_inside_loop;
+	ctx->is_inside_expression   = prev_is_inside_expression;
+	ctx->tokens->iter           = prev_iter;
+	block->data.block.lazy_decl = NULL;
+}
+
 void parse_ublock_content(struct context *ctx, struct ast *ublock) {
 	bassert(ublock->kind == AST_UBLOCK);
 	arrsetcap(ublock->data.ublock.nodes, 64);
@@ -2649,6 +2775,7 @@ void parser_run(struct assembly *assembly, struct unit *unit) {
 
 	zone();
 	runtime_measure_begin(parse);
+	const f64 start_ms = get_tick_ms();
 
 	struct context ctx = {
 	    .assembly = assembly,
@@ -2659,13 +2786,19 @@ void parser_run(struct assembly *assembly, struct unit *unit) {
 	    .scope_thread_local = &assembly->thread_local_contexts[thread_index].scope_thread_local,
 	    .sarr_arena         = &assembly->thread_local_contexts[thread_index].small_array,
 	    .string_cache       = &assembly->thread_local_contexts[thread_index].string_cache,
+	    .thread_local       = &assembly->thread_local_contexts[thread_index],
 	};
 
 	init_hash_directives(&ctx);
 	bassert(unit->parent_scope);
 	scope_push(&ctx, unit->parent_scope);
 
-	struct ast *root       = ast_create_node(ctx.ast_arena, AST_UBLOCK, NULL, scope_get(&ctx));
+	// Skipped bodies are parsed during analysis, so the tokens must be still available then.
+	const struct target *t      = assembly->target;
+	ctx.is_lazy_parsing_enabled = builder.options->lazy_fn_bodies && !builder.options->streaming_memory &&
+	                              t->kind != ASSEMBLY_DOCS && !t->syntax_only && !t->no_analyze && !t->print_ast;
+
+	struct ast *root       = create_node(&ctx, AST_UBLOCK, NULL, scope_get(&ctx));
 	root->data.ublock.unit = unit;
 	unit->ast              = root;
 
@@ -2678,6 +2811,41 @@ void parser_run(struct assembly *assembly, struct unit *unit) {
 	arrfree(ctx.fn_type_stack);
 	arrfree(ctx.block_stack);
 
+	unit->stats.parse_ms = get_tick_ms() - start_ms;
 	batomic_fetch_add_s32(&assembly->stats.parsing_ms, runtime_measure_end(parse));
 	return_zone();
 }
+
+void parser_parse_fn_body(struct assembly *assembly, struct ast *lit_fn) {
+	bassert(lit_fn->kind == AST_EXPR_LIT_FN);
+	struct ast *block = lit_fn->data.expr_fn.block;
+	bassert(block && block->data.block.lazy_decl);
+	struct unit *unit = block->unit;
+	bassert(unit && arrlenu(unit->tokens.buf) && "Unit tokens were already released.");
+
+	const u32 thread_index = get_worker_index();
+
+	zone();
+	struct context ctx = {
+	    .assembly = assembly,
+	    .unit     = unit,
+	    .tokens   = &unit->tokens,
+
+	    .ast_arena          = &assembly->thread_local_contexts[thread_index].ast_arena,
+	    .scope_thread_local = &assembly->thread_local_contexts[thread_index].scope_thread_local,
+	    .sarr_arena         = &assembly->thread_local_contexts[thread_index].small_array,
+	    .string_cache       = &assembly->thread_local_contexts[thread_index].string_cache,
+	    .thread_local       = &assembly->thread_local_contexts[thread_index],
+	};
+
+	init_hash_directives(&ctx);
+	parse_lazy_fn_body(&ctx, block);
+	batomic_fetch_add_s32(&assembly->stats.lazy_fn_parsed_count, 1);
+
+	tbl_free(ctx.hash_directive_table);
+	arrfree(ctx.decl_stack);
+	arrfree(ctx.scope_stack);
+	arrfree(ctx.fn_type_stack);
+	arrfree(ctx.block_stack);
+	return_zone();
+}
@@ -0,0 +1,10 @@
+#ifndef BL_PARSER_H
+#define BL_PARSER_H
+
+struct assembly;
+struct ast;
+
+// Parse the function body skipped by the parser in lazy parsing mode.
+void parser_parse_fn_body(struct assembly *assembly, struct ast *lit_fn);
+
+#endif
@@ -9,9 +9,38 @@ BL_STATIC_ASSERT(sizeof(BL_TBL_HASH_T) == sizeof(u64), "Scope require hash value
 
 #define entry_hash(id, layer) ((((u64)layer) << 32) | (u64)id)
 
+#define BLOOM_WORDS (SCOPE_BLOOM_BITS / 64)
+BL_STATIC_ASSERT((SCOPE_LOOKUP_CACHE_SIZE & (SCOPE_LOOKUP_CACHE_SIZE - 1)) == 0, "Lookup cache size must be power of 2.");
+
+// Incremented every time a lookup result starting in non-local scope might change.
+static batomic_s32 scope_epoch = 1;
+
+static inline void bloom_bits(const hash_t hash, u32 *bit1, u32 *bit2) {
+	*bit1 = hash % SCOPE_BLOOM_BITS;
+	*bit2 = ((hash * 0x9E3779B1u) >> 16) % SCOPE_BLOOM_BITS;
+}
+
+static inline void bloom_insert(u64 *bloom, const hash_t hash) {
+	u32 bit1, bit2;
+	bloom_bits(hash, &bit1, &bit2);
+	bloom[bit1 / 64] |= 1ull << (bit1 % 64);
+	bloom[bit2 / 64] |= 1ull << (bit2 % 64);
+}
+
+// Returns false in case the scope does not contain entry with hash for sure. Bloom is updated only
+// under the scope lock, however we read it without locking; in the worst case we miss an entry
+// inserted concurrently with the lookup which is the same as if the lookup was done a bit sooner.
+static inline bool bloom_maybe_contains(const u64 *bloom, const hash_t hash) {
+	if (!bloom) return true;
+	u32 bit1, bit2;
+	bloom_bits(hash, &bit1, &bit2);
+	return (bloom[bit1 / 64] & (1ull << (bit1 % 64))) && (bloom[bit2 / 64] & (1ull << (bit2 % 64)));
+}
+
 static void scope_dtor(struct scope *scope) {
 	bmagic_assert(scope);
 	tbl_free(scope->entries);
+	bfree(scope->bloom);
 	arrfree(scope->injected);
 	mtx_destroy(&scope->lock);
 }
@@ -20,12 +49,25 @@ void scope_thread_local_init(struct scope_thread_local *local, u32 owner_thread_
 	arena_init(&local->scopes, sizeof(struct scope), alignment_of(struct scope), 256, owner_thread_index, (arena_elem_dtor_t)scope_dtor);
 	arena_init(&local->entries, sizeof(struct scope_entry), alignment_of(struct scope_entry), 8192, owner_thread_index, NULL);
 	local->lookup_queue = NULL;
+	local->lookup_cache = bmalloc(sizeof(struct scope_lookup_cache_entry) * SCOPE_LOOKUP_CACHE_SIZE);
+	bl_zeromem(local->lookup_cache, sizeof(struct scope_lookup_cache_entry) * SCOPE_LOOKUP_CACHE_SIZE);
 }
 
 void scope_thread_local_terminate(struct scope_thread_local *local) {
 	arena_terminate(&local->scopes);
 	arena_terminate(&local->entries);
 	tbl_free(local->lookup_queue);
+	bfree(local->lookup_cache);
+}
+
+void scope_thread_local_seal(struct scope_thread_local *local) {
+	array(struct scope *) scopes = NULL;
+	arena_get_flatten(&local->scopes, (array(void *) *)&scopes);
+	for (usize i = 0; i < arrlenu(scopes); ++i) {
+		batomic_store_s32(&scopes[i]->is_sealed, true);
+	}
+	arrfree(scopes);
+	local->seal_new_scopes = true;
 }
 
 struct scope *scope_create(struct scope_thread_local *local,
@@ -39,6 +81,11 @@ struct scope *scope_create(struct scope_thread_local *local,
 	scope->location     = loc;
 
 	mtx_init(&scope->lock, mtx_recursive);
+	if (local->seal_new_scopes) batomic_store_s32(&scope->is_sealed, true);
+	if (!scope_is_local(scope)) {
+		scope->bloom = bmalloc(sizeof(u64) * BLOOM_WORDS);
+		bl_zeromem(scope->bloom, sizeof(u64) * BLOOM_WORDS);
+	}
 
 	bmagic_set(scope);
 	return scope;
@@ -68,6 +115,7 @@ void scope_insert(struct scope *scope, hash_t layer, struct scope_entry *entry)
 	zone();
 	bassert(scope);
 	bassert(entry && entry->id);
+	if (scope_is_sealed(scope)) bcheck_main_thread();
 	const u64 hash = entry_hash(entry->id->hash, layer);
 	bassert(tbl_lookup_index_with_key(scope->entries, hash, entry->id->str) == -1 && "Duplicate scope entry key!!!");
 	entry->parent_scope              = scope;
@@ -77,12 +125,16 @@ void scope_insert(struct scope *scope, hash_t layer, struct scope_entry *entry)
 	    .value = entry,
 	};
 	tbl_insert(scope->entries, tbl_entry);
+	if (scope->bloom) bloom_insert(scope->bloom, entry->id->hash);
+	// Cached lookups starting in non-local scopes might be affected.
+	if (!scope_is_local(scope) || scope->is_injected) batomic_fetch_add_s32(&scope_epoch, 1);
 	return_zone();
 }
 
 struct search_context {
 	hash_table(struct scope_lookup_queue_entry) * queue;
-	u32 queue_index;
+	u32                        queue_index;
+	struct scope_thread_local *local;
 
 	s32                  found_num;
 	s32                  found_buf_size;
@@ -106,10 +158,24 @@ static void search_scope(struct search_context *RESTRICT ctx, struct scope *REST
 		const u64 hash = entry_hash(args->id->hash, layer);
 		layer          = SCOPE_DEFAULT_LAYER;
 
-		scope_lock(scope);
+		const bool maybe_contains = bloom_maybe_contains(scope->bloom, args->id->hash);
+		if (!maybe_contains) {
+			++ctx->local->bloom_skip_count;
+			if (!scope->injected) continue;
+		}
+
+		const bool is_sealed = scope_is_sealed(scope);
+		if (is_sealed) {
+			++ctx->local->lock_free_count;
+		} else {
+			++ctx->local->lock_count;
+			mtx_lock(&scope->lock);
+		}
 
-		const s64 index = tbl_lookup_index_with_key(scope->entries, hash, args->id->str);
-		if (index != -1) ctx->found_buf[ctx->found_num++] = scope->entries[index].value;
+		if (maybe_contains) {
+			const s64 index = tbl_lookup_index_with_key(scope->entries, hash, args->id->str);
+			if (index != -1) ctx->found_buf[ctx->found_num++] = scope->entries[index].value;
+		}
 
 		for (usize injected_index = 0; injected_index < arrlenu(scope->injected); ++injected_index) {
 			struct scope *injected_scope = scope->injected[injected_index];
@@ -117,17 +183,37 @@ static void search_scope(struct search_context *RESTRICT ctx, struct scope *REST
 			tbl_insert(*ctx->queue, (struct scope_lookup_queue_entry){.hash = injected_scope});
 		}
 
-		scope_unlock(scope);
+		if (!is_sealed) mtx_unlock(&scope->lock);
 	}
 }
 
 s32 scope_lookup(struct assembly *RESTRICT assembly, struct scope *RESTRICT scope, scope_lookup_args_t *RESTRICT args, struct scope_entry **RESTRICT out_buf, const s32 out_buf_size) {
 	zone();
 	bassert(scope && args->id);
-	const u32 thread_index = get_worker_index();
+	const u32                  thread_index = get_worker_index();
+	struct scope_thread_local *local        = &assembly->thread_local_contexts[thread_index].scope_thread_local;
+	++local->lookup_count;
+
+	// Lookups starting in non-local scope are cached; these are usually global symbols searched
+	// over all injected modules.
+	struct scope                    *start_scope = scope;
+	struct scope_lookup_cache_entry *cached      = NULL;
+	const u32                        epoch       = batomic_load_s32(&scope_epoch);
+	if (!scope_is_local(scope) && !args->local_only) {
+		const u64 key = ((u64)(uintptr_t)scope >> 4) ^ args->id->hash ^ (args->in_tree ? 0x5bd1e995u : 0);
+		cached        = &local->lookup_cache[(key ^ (key >> 17)) & (SCOPE_LOOKUP_CACHE_SIZE - 1)];
+		if (cached->scope == scope && cached->epoch == epoch && cached->in_tree == args->in_tree && cached->id_hash == args->id->hash &&
+		    cached->found_num <= out_buf_size && str_match(cached->id_str, args->id->str)) {
+			++local->lookup_cache_hit_count;
+			for (s32 i = 0; i < cached->found_num; ++i) out_buf[i] = cached->found[i];
+			if (args->out_of_function && cached->out_of_function_written) *(args->out_of_function) = false;
+			return_zone(cached->found_num);
+		}
+	}
 
 	struct search_context ctx = {
-	    .queue = &assembly->thread_local_contexts[thread_index].scope_thread_local.lookup_queue,
+	    .queue = &local->lookup_queue,
+	    .local = local,
 
 	    .found_buf      = out_buf,
 	    .found_buf_size = out_buf_size,
@@ -135,24 +221,40 @@ s32 scope_lookup(struct assembly *RESTRICT assembly, struct scope *RESTRICT scop
 
 	tbl_clear(*ctx.queue);
 
+	bool out_of_function_written = false;
 	while (scope && ctx.found_num < ctx.found_buf_size) {
 		search_scope(&ctx, scope, args);
 
 		if (ctx.found_num && scope->kind != SCOPE_MODULE_PRIVATE) break;
 		if (!args->in_tree) break;
 		if (args->out_of_function) *(args->out_of_function) = scope->kind == SCOPE_FN;
+		out_of_function_written = true;
 
 		scope = scope->parent;
 	}
 
+	// Do not cache truncated results.
+	if (cached && ctx.found_num < out_buf_size && ctx.found_num <= SCOPE_LOOKUP_CACHE_MAX_FOUND) {
+		cached->scope                   = start_scope;
+		cached->id_str                  = args->id->str;
+		cached->id_hash                 = args->id->hash;
+		cached->epoch                   = epoch;
+		cached->found_num               = ctx.found_num;
+		cached->in_tree                 = args->in_tree;
+		cached->out_of_function_written = out_of_function_written;
+		for (s32 i = 0; i < ctx.found_num; ++i) cached->found[i] = out_buf[i];
+	}
+
 	return_zone(ctx.found_num);
 }
 
 void scope_lock(struct scope *scope) {
+	if (scope_is_sealed(scope)) return;
 	mtx_lock(&scope->lock);
 }
 
 void scope_unlock(struct scope *scope) {
+	if (scope_is_sealed(scope)) return;
 	mtx_unlock(&scope->lock);
 }
 
@@ -171,6 +273,8 @@ void scope_inject(struct scope *dest, struct scope *src) {
 	}
 	if (arrlen(dest->injected) == 0) arrsetcap(dest->injected, 8); // Preallocate a bit...
 	arrput(dest->injected, src);
+	src->is_injected = true;
+	batomic_fetch_add_s32(&scope_epoch, 1);
 	scope_unlock(dest);
 }
 
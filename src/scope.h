@@ -2,6 +2,7 @@
 #define BL_SCOPE_H
 
 #include "arena.h"
+#include "atomics.h"
 #include "common.h"
 #include "llvm_api.h"
 
@@ -18,10 +19,40 @@ struct scope_lookup_queue_entry {
 };
 
 // Global context data used by all scopes in assembly.
+// Bloom filter size of non-local scopes (in bits).
+#define SCOPE_BLOOM_BITS 4096
+// Count of entries in per-thread lookup cache (must be power of 2).
+#define SCOPE_LOOKUP_CACHE_SIZE 1024
+// Maximum count of found entries stored in the lookup cache.
+#define SCOPE_LOOKUP_CACHE_MAX_FOUND 2
+
+// Cached result of the lookup starting in non-local scope. Entry is valid only while the epoch
+// matches the current scope epoch, see scope_insert and scope_inject.
+struct scope_lookup_cache_entry {
+	struct scope       *scope;
+	str_t               id_str;
+	hash_t              id_hash;
+	u32                 epoch;
+	s32                 found_num;
+	bool                in_tree;
+	bool                out_of_function_written;
+	struct scope_entry *found[SCOPE_LOOKUP_CACHE_MAX_FOUND];
+};
+
 struct scope_thread_local {
 	struct arena scopes;
 	struct arena entries;
 	hash_table(struct scope_lookup_queue_entry) lookup_queue;
+	struct scope_lookup_cache_entry *lookup_cache;
+	// Scopes created by this context are sealed implicitly when set.
+	bool seal_new_scopes;
+
+	// Statistics.
+	s64 lookup_count;
+	s64 lookup_cache_hit_count;
+	s64 bloom_skip_count;
+	s64 lock_count;
+	s64 lock_free_count;
 };
 
 enum scope_entry_kind {
@@ -89,6 +120,14 @@ struct scope {
 	array(struct scope *) injected;
 	LLVMMetadataRef llvm_meta;
 	hash_table(struct scope_tbl_entry) entries;
+	// Bloom filter of entry ids, used to skip lookups of missing symbols in non-local scopes. It's
+	// NULL for local scopes.
+	u64 *bloom;
+	// Set in case the scope was injected into some other scope.
+	bool is_injected;
+	// Sealed scopes are not modified concurrently anymore (they might be changed only from the main
+	// thread), so all lookups are done without locking.
+	batomic_s32 is_sealed;
 
 	mtx_t lock;
 	bmagic_member
@@ -96,6 +135,9 @@ struct scope {
 
 void scope_thread_local_init(struct scope_thread_local *local, u32 owner_thread_index);
 void scope_thread_local_terminate(struct scope_thread_local *local);
+// Seal all scopes created by the local context so far and all scopes created later. This must be
+// called only while no other thread is using the scopes.
+void scope_thread_local_seal(struct scope_thread_local *local);
 
 struct scope *scope_create(struct scope_thread_local *local,
                            enum scope_kind            kind,
@@ -137,6 +179,10 @@ static inline bool scope_is_local(const struct scope *scope) {
 	return scope->kind != SCOPE_GLOBAL && scope->kind != SCOPE_PRIVATE && scope->kind != SCOPE_MODULE && scope->kind != SCOPE_MODULE_PRIVATE;
 }
 
+static inline bool scope_is_sealed(struct scope *scope) {
+	return batomic_load_s32(&scope->is_sealed);
+}
+
 static inline struct scope_entry *scope_entry_ref(struct scope_entry *entry) {
 	bmagic_assert(entry);
 	++entry->ref_count;
@@ -12,6 +12,7 @@ struct job {
 };
 
 static array(struct job) jobs;
+static array(thrd_t) threads;
 static mtx_t jobs_mutex;
 static cnd_t jobs_cond;
 static cnd_t working_cond;
@@ -83,15 +84,15 @@ void start_threads(const s32 n) {
 	bassert(thread_count == 0 && "Thread pool is already running!");
 	thread_count     = n;
 	is_single_thread = false;
+	should_exit      = false;
 
 	mtx_init(&jobs_mutex, mtx_plain);
 	cnd_init(&jobs_cond);
 	cnd_init(&working_cond);
 
-	for (s32 i = 0; i < thread_count; ++i) {
-		thrd_t thread = 0;
-		thrd_create(&thread, &worker, (void *)(u64)i);
-		thrd_detach(thread);
+	arrsetlen(threads, n);
+	for (s32 i = 0; i < n; ++i) {
+		thrd_create(&threads[i], &worker, (void *)(u64)i);
 	}
 }
 
@@ -103,6 +104,11 @@ void stop_threads(void) {
 	mtx_unlock(&jobs_mutex);
 
 	wait_threads();
+	// Threads might still be finishing after the last notification.
+	for (usize i = 0; i < arrlenu(threads); ++i) {
+		thrd_join(threads[i], NULL);
+	}
+	arrfree(threads);
 
 	cnd_destroy(&working_cond);
 	cnd_destroy(&jobs_cond);
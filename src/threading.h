@@ -9,6 +9,7 @@ extern thrd_t MAIN_THREAD;
 
 struct context;
 struct mir_instr;
+struct lexer_batch;
 
 struct job_context {
 	union {
@@ -21,6 +22,10 @@ struct job_context {
 			struct context   *ctx;
 			struct mir_instr *top_instr;
 		} x64;
+
+		struct {
+			struct lexer_batch *batch;
+		} lexer;
 	};
 };
 
@@ -34,6 +39,7 @@ struct thread_local_storage {
 typedef void (*job_fn_t)(struct job_context *ctx);
 
 void start_threads(const s32 n);
+// Stop and join all worker threads; the thread pool can be started again later.
 void stop_threads(void);
 
 // In single thread mode, all jobs are executed on caller thread (main thread) directly.
@@ -2,22 +2,23 @@
 #include "stb_ds.h"
 
 void token_printer_run(struct assembly *UNUSED(assembly), struct unit *unit) {
-	struct token *tokens_arr = unit->tokens.buf;
+	struct tokens *tokens = &unit->tokens;
 	fprintf(stdout, "Tokens: \n");
-	struct token *tok;
-	s32           line = -1;
-	for (usize i = 0; i < arrlenu(tokens_arr); ++i) {
-		tok = &tokens_arr[i];
+	struct location loc;
+	s32             line = -1;
+	for (usize i = 0; i < arrlenu(tokens->buf); ++i) {
+		struct token *tok = &tokens->buf[i];
+		tokens_location(tokens, tok, &loc);
 
 		if (line == -1) {
-			line = tok->location.line;
+			line = loc.line;
 			fprintf(stdout, "%d: ", line);
-		} else if (tok->location.line != line) {
-			line = tok->location.line;
+		} else if (loc.line != line) {
+			line = loc.line;
 			fprintf(stdout, "\n%d: ", line);
 		}
 		fprintf(
-		    stdout, "['%s' %i:%i], ", sym_strings[tok->sym], tok->location.line, tok->location.col);
+		    stdout, "['%s' %i:%i], ", sym_strings[tok->sym], loc.line, loc.col);
 	}
 	fprintf(stdout, "\n");
 }
@@ -13,20 +13,85 @@ s32 sym_lens[] = {
 #undef sm
 };
 
-struct token *token_end = &(struct token){.sym = SYM_EOF};
+u8  keyword_table[KEYWORD_TABLE_SIZE];
+u32 keyword_hash_seed;
+u8  operator_table[256][OPERATOR_CANDIDATES];
+
+void tokens_init_lookup_tables(void) {
+	// Find the first hash seed without collisions of keywords, this is done only once on startup
+	// and usually takes just a few iterations. Keywords with the same hashed key (first two
+	// characters, the last character and the length) collide for every seed.
+	s32 collision_a = SYM_EOF, collision_b = SYM_EOF;
+	u32 seed        = 0x9E3779B1;
+	for (u32 attempt = 0; attempt < KEYWORD_MAX_SEED_ATTEMPTS; ++attempt, seed += 2) {
+		bl_zeromem(keyword_table, sizeof(keyword_table));
+		collision_a = SYM_EOF;
+		for (s32 i = SYM_IF; i <= SYM_UNREACHABLE; ++i) {
+			if (sym_lens[i] < KEYWORD_MIN_LEN || sym_lens[i] > KEYWORD_MAX_LEN) {
+				babort("Keyword '%s' length is out of supported range <%d, %d>.", sym_strings[i], KEYWORD_MIN_LEN, KEYWORD_MAX_LEN);
+			}
+			const u32 hash = keyword_hash(seed, sym_strings[i], sym_lens[i]);
+			if (keyword_table[hash] != SYM_EOF) {
+				collision_a = keyword_table[hash];
+				collision_b = i;
+				break;
+			}
+			keyword_table[hash] = (u8)i;
+		}
+		if (collision_a == SYM_EOF) {
+			keyword_hash_seed = seed;
+			break;
+		}
+	}
+	if (collision_a != SYM_EOF) {
+		babort("Cannot find perfect hash of keywords, '%s' collides with '%s'.", sym_strings[collision_b], sym_strings[collision_a]);
+	}
+
+	// Operators are matched in order of declaration, so the longer ones sharing the same prefix
+	// must be declared first.
+	memset(operator_table, SYM_NONE, sizeof(operator_table));
+	for (s32 i = SYM_UNREACHABLE + 1; i < SYM_NONE; ++i) {
+		u8 *candidates = operator_table[(u8)sym_strings[i][0]];
+		s32 j          = 0;
+		while (candidates[j] != SYM_NONE) ++j;
+		bassert(j < OPERATOR_CANDIDATES - 1 && "Too many operators starting with the same character.");
+		candidates[j] = (u8)i;
+	}
+}
+
+void tokens_init(struct tokens *tokens, struct unit *unit) {
+	bl_zeromem(tokens, sizeof(struct tokens));
+	tokens->unit = unit;
+}
 
-void tokens_init(struct tokens *tokens) {
-	tokens->buf  = NULL;
-	tokens->iter = 0;
-	arrsetcap(tokens->buf, 2048);
-	arrsetcap(tokens->values, 256);
+void tokens_reserve(struct tokens *tokens, usize count) {
+	arrsetcap(tokens->buf, count);
+	arrsetcap(tokens->positions, count);
+	arrsetcap(tokens->lens, count);
+	arrsetcap(tokens->value_indices, count);
+	arrsetcap(tokens->values, count / 2);
 }
 
 void tokens_terminate(struct tokens *tokens) {
 	arrfree(tokens->buf);
+	arrfree(tokens->positions);
+	arrfree(tokens->lens);
+	arrfree(tokens->value_indices);
 	arrfree(tokens->values);
 }
 
+void tokens_release_data(struct tokens *tokens) {
+	// Positions and lengths are used to compute locations of AST nodes.
+	arrfree(tokens->buf);
+	arrfree(tokens->value_indices);
+	arrfree(tokens->values);
+}
+
+usize tokens_size_bytes(struct tokens *tokens) {
+	const usize per_token = sizeof(struct token) + sizeof(u32) * 3; // sym, position, len and value index
+	return arrlenu(tokens->buf) * per_token + arrlenu(tokens->values) * sizeof(union token_value);
+}
+
 bool token_is_unary(struct token *token) {
 	switch (token->sym) {
 	case SYM_MINUS:
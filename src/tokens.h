@@ -3,17 +3,44 @@
 
 #include "common.h"
 
-#define TOKEN_OPTIONAL_LOCATION(tok) ((tok) ? &(tok)->location : NULL)
-
 enum sym {
 #define sm(tok, str, len) SYM_##tok,
 #include "tokens.def"
 #undef sm
 };
 
-extern char         *sym_strings[];
-extern s32           sym_lens[];
-extern struct token *token_end;
+static_assert(SYM_NONE <= 0xFF, "Token symbols are stored as bytes.");
+
+extern char *sym_strings[];
+extern s32   sym_lens[];
+
+// Lookup tables generated from 'tokens.def' by 'tokens_init_lookup_tables' used by lexer to
+// recognize symbols without iterating over all of them.
+#define KEYWORD_TABLE_SIZE        128
+#define KEYWORD_MIN_LEN           2
+#define KEYWORD_MAX_LEN           11
+#define KEYWORD_MAX_SEED_ATTEMPTS 4096
+#define OPERATOR_CANDIDATES       8
+
+// Perfect hash table of keywords (SYM_IF..SYM_UNREACHABLE), empty slots are SYM_EOF.
+extern u8  keyword_table[KEYWORD_TABLE_SIZE];
+extern u32 keyword_hash_seed;
+// Operator symbols indexed by the first character in order they should be matched; each list is
+// terminated by SYM_NONE.
+extern u8 operator_table[256][OPERATOR_CANDIDATES];
+
+static inline u32 keyword_hash(u32 seed, const char *str, s32 len) {
+	const u32 key = (u8)str[0] | ((u32)(u8)str[1] << 8) | ((u32)(u8)str[len - 1] << 16) | ((u32)len << 24);
+	return (key * seed) >> 25; // 7 bits for KEYWORD_TABLE_SIZE
+}
+
+// Returns keyword symbol matching the 'str' identifier or SYM_IDENT.
+static inline enum sym sym_keyword(const char *str, s32 len) {
+	if (len < KEYWORD_MIN_LEN || len > KEYWORD_MAX_LEN) return SYM_IDENT;
+	const enum sym sym = keyword_table[keyword_hash(keyword_hash_seed, str, len)];
+	if (sym == SYM_EOF || sym_lens[sym] != len || memcmp(str, sym_strings[sym], len) != 0) return SYM_IDENT;
+	return sym;
+}
 
 struct unit;
 struct location {
@@ -30,10 +57,11 @@ union token_value {
 	u64   number;
 };
 
+// Token is stored as structure of arrays in the 'tokens' container, the token pointer points
+// directly into the symbol array (symbol is the only information needed in most of the lookahead
+// checks). Use 'tokens_*' helpers to get the rest of token data.
 struct token {
-	struct location location;
-	enum sym        sym;
-	u32             value_index;
+	u8 sym;
 };
 
 enum token_associativity {
@@ -48,12 +76,36 @@ struct token_precedence {
 };
 
 struct tokens {
+	struct unit *unit;
 	array(struct token) buf;
+	array(u32) positions; // Line in upper 16 bits, column in lower 16 bits.
+	array(u32) lens;
+	array(u32) value_indices;
 	array(union token_value) values;
 
 	usize iter;
 };
 
+#define tokens_index(tokens, tok) ((usize)((tok) - (tokens)->buf))
+
+static inline u16 tokens_line(struct tokens *tokens, struct token *tok) {
+	return (u16)(tokens->positions[tokens_index(tokens, tok)] >> 16);
+}
+
+// Fill the 'dest' location with token location data and return pointer to the 'dest'.
+static inline struct location *tokens_location(struct tokens *tokens, struct token *tok, struct location *dest) {
+	const usize index = tokens_index(tokens, tok);
+	dest->line        = (u16)(tokens->positions[index] >> 16);
+	dest->col         = (u16)(tokens->positions[index] & 0xFFFF);
+	dest->len         = tokens->lens[index];
+	dest->unit        = tokens->unit;
+	return dest;
+}
+
+static inline union token_value tokens_value(struct tokens *tokens, struct token *tok) {
+	return tokens->values[tokens->value_indices[tokens_index(tokens, tok)]];
+}
+
 static inline bool sym_is_binop(enum sym sym) {
 	return sym >= SYM_EQ && sym <= SYM_ASTERISK;
 }
@@ -67,8 +119,12 @@ static inline bool token_is(struct token *token, enum sym sym) {
 
 #define token_is_not(token, sym) (!token_is(token, sym))
 
-void                    tokens_init(struct tokens *tokens);
+void                    tokens_init_lookup_tables(void);
+void                    tokens_init(struct tokens *tokens, struct unit *unit);
 void                    tokens_terminate(struct tokens *tokens);
+void                    tokens_release_data(struct tokens *tokens);
+void                    tokens_reserve(struct tokens *tokens, usize count);
+usize                   tokens_size_bytes(struct tokens *tokens);
 bool                    token_is_unary(struct token *token);
 struct token_precedence token_prec(struct token *token);
 
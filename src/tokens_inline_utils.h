@@ -41,19 +41,40 @@ enum tokens_lookahead_state {
 
 typedef enum tokens_lookahead_state (*token_cmp_func_t)(struct token *curr);
 
-#define tokens_len(tokens)     arrlenu((tokens)->buf)
-#define tokens_push(tokens, t) arrput((tokens)->buf, t)
+// Note that the last token is always SYM_EOF, so we return the last one in case we're out of
+// bounds.
+#define tokens_len(tokens)  arrlenu((tokens)->buf)
+#define tokens_last(tokens) ((tokens)->buf + tokens_len(tokens) - 1)
 #define tokens_peek_nth(tokens, n) \
-	((tokens)->iter + (n) < tokens_len(tokens) ? &(tokens)->buf[(tokens)->iter + (n)] : token_end)
+	((tokens)->iter + (n) < tokens_len(tokens) ? &(tokens)->buf[(tokens)->iter + (n)] : tokens_last(tokens))
 #define tokens_peek(tokens)      tokens_peek_nth(tokens, 0)
 #define tokens_peek_sym(tokens)  ((tokens)->buf[(tokens)->iter].sym)
 #define tokens_peek_2nd(tokens)  tokens_peek_nth(tokens, 1)
 #define tokens_peek_prev(tokens) tokens_peek_nth(tokens, -1)
 #define tokens_consume(tokens) \
-	((tokens)->iter < tokens_len(tokens) ? &(tokens)->buf[(tokens)->iter++] : token_end)
+	((tokens)->iter < tokens_len(tokens) ? &(tokens)->buf[(tokens)->iter++] : tokens_last(tokens))
 #define tokens_current_is(tokens, s)     (tokens_peek(tokens)->sym == (s))
 #define tokens_current_is_not(tokens, s) (tokens_peek(tokens)->sym != (s))
 
+static inline void tokens_push(struct tokens *tokens, enum sym sym, u16 line, u16 col, u32 len, u32 value_index) {
+	// All token arrays have the same length and capacity, so we check the capacity only once.
+	const usize index = tokens_len(tokens);
+	if (index == arrcap(tokens->buf)) tokens_reserve(tokens, MAX(index * 2, 256));
+	struct token *buf           = tokens->buf;
+	u32          *positions     = tokens->positions;
+	u32          *lens          = tokens->lens;
+	u32          *value_indices = tokens->value_indices;
+
+	buf[index].sym       = (u8)sym;
+	positions[index]     = ((u32)line << 16) | col;
+	lens[index]          = len;
+	value_indices[index] = value_index;
+	stbds_header(buf)->length           = index + 1;
+	stbds_header(positions)->length     = index + 1;
+	stbds_header(lens)->length          = index + 1;
+	stbds_header(value_indices)->length = index + 1;
+}
+
 // Consume all symbols until 'sym' is hit. The 'sym' is not consumed.
 static inline void tokens_consume_till(struct tokens *tokens, enum sym sym) {
 	while (tokens_current_is_not(tokens, sym) && tokens_current_is_not(tokens, SYM_EOF)) {
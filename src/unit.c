@@ -6,10 +6,12 @@
 
 #if BL_PLATFORM_WIN
 #include <windows.h>
+#else
+#include <sys/mman.h>
 #endif
 
 // public
-struct unit *unit_new(struct assembly *assembly, const str_t filepath, const str_t name, const hash_t hash, struct token *load_from, struct scope *parent_scope, struct module *module) {
+struct unit *unit_new(struct assembly *assembly, const str_t filepath, const str_t name, const hash_t hash, struct location *load_from, struct scope *parent_scope, struct module *module) {
 	struct unit *unit = bmalloc(sizeof(struct unit)); // @Performance 2024-09-14 Use arena?
 	bl_zeromem(unit, sizeof(struct unit));
 
@@ -31,38 +33,51 @@ struct unit *unit_new(struct assembly *assembly, const str_t filepath, const str
 
 	unit->module = module;
 
-	tokens_init(&unit->tokens);
+	tokens_init(&unit->tokens, unit);
 	put_tmp_str(tmp);
 	return unit;
 }
 
 void unit_delete(struct unit *unit) {
 	arrfree(unit->ublock_ast);
+	arrfree(unit->line_starts);
 	str_buf_free(&unit->file_docs_cache);
+#if !BL_PLATFORM_WIN
+	if (unit->src_mapped_size) {
+		munmap(unit->src, unit->src_mapped_size);
+	} else {
+		bfree(unit->src);
+	}
+#else
 	bfree(unit->src);
+#endif
 	tokens_terminate(&unit->tokens);
 	bfree(unit);
 }
 
+void unit_release_run(struct assembly *UNUSED(assembly), struct unit *unit) {
+	zone();
+	// Tokens are used only by the lexer and parser, only positions are kept for locations of AST
+	// nodes. Note that the source and line index are kept for diagnostics.
+	tokens_release_data(&unit->tokens);
+	return_zone();
+}
+
 const char *unit_get_src_ln(struct unit *unit, s32 line, long *len) {
-	if (line < 1) return NULL;
-	// Iterate from begin of the file looking for a specific line.
-	const char *c     = unit->src;
-	const char *begin = c;
-	while (true) {
-		if (*c == '\n') {
-			--line;
-			if (line == 0) break; // Line found.
-			begin = c + 1;
-		}
-		if (*c == '\0') {
-			--line;
-			break;
-		}
-		++c;
+	if (line < 1 || !unit->src) return NULL;
+	// Line starts are collected by the lexer, but in case the lexing is not finished yet (i.e. we
+	// report lexer error) we have to continue indexing from the last known line.
+	if (!arrlenu(unit->line_starts)) arrput(unit->line_starts, 0);
+	while (arrlen(unit->line_starts) < line) {
+		const char *c = unit->src + arrlast(unit->line_starts);
+		while (*c != '\n' && *c != '\0') ++c;
+		if (*c == '\0') return NULL; // Line not found.
+		arrput(unit->line_starts, (u32)(c - unit->src) + 1);
 	}
-	if (line > 0) return NULL; // Line not found.
+	const char *begin = unit->src + unit->line_starts[line - 1];
 	if (len) {
+		const char *c = begin;
+		while (*c != '\n' && *c != '\0') ++c;
 		long l = (long)(c - begin);
 		if (l && begin[l - 1] == '\r') --l;
 		bassert(l >= 0);
@@ -7,7 +7,6 @@
 #include "scope.h"
 #include "tokens.h"
 
-struct token;
 struct assembly;
 
 struct unit {
@@ -23,15 +22,37 @@ struct unit {
 	str_t           name;
 	str_t           filename;
 	char           *src;
-	struct token   *loaded_from;
+	usize           src_len; // Source length in bytes (without zero terminator).
+	// Size of the memory mapping in case the source file was mapped instead of loaded into the heap
+	// allocated buffer.
+	usize           src_mapped_size;
+	// Offsets of line beginnings in the source, line N starts at 'line_starts[N - 1]'. This table
+	// is filled by the lexer.
+	array(u32) line_starts;
+	struct location *loaded_from;
 	LLVMMetadataRef llvm_file_meta;
 	str_buf_t       file_docs_cache;
+	// Count of function bodies declared in the unit and deferred by analyze in lazy parsing or
+	// reachable only mode; usage of private symbols cannot be checked until all are resumed.
+	s32 deferred_fn_body_count;
+
+	struct {
+		f64 load_ms;
+		f64 lex_ms;
+		f64 parse_ms;
+		f64 mir_generate_ms;
+		s32 page_faults; // Page faults caused by loading and lexing of the source.
+	} stats;
 };
 
 // The inject_to_scope is supposed to be valid scope (parent scope of the #load directive or global scope).
-struct unit *unit_new(struct assembly *assembly, const str_t filepath, const str_t name, const hash_t hash, struct token *load_from, struct scope *parent_scope, struct module *module);
+struct unit *unit_new(struct assembly *assembly, const str_t filepath, const str_t name, const hash_t hash, struct location *load_from, struct scope *parent_scope, struct module *module);
 void         unit_delete(struct unit *unit);
-// Returns single line from the unit source code, len does not count last new line char.
+// Release unit data not needed after the unit is processed by all unit pipeline stages, this is
+// used only in streaming memory mode.
+void unit_release_run(struct assembly *assembly, struct unit *unit);
+// Returns single line from the unit source code, len does not count last new line char. Lines
+// already processed by the lexer are resolved in constant time.
 const char *unit_get_src_ln(struct unit *unit, s32 line, long *len);
 hash_t      unit_get_hash(const str_t filepath);
 
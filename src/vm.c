@@ -102,7 +102,7 @@ static inline bool fn_does_return(struct mir_fn *fn) {
 // Checks whether constant value needs some extra space or if it fits into small memory block hold
 // by the value itself.
 static inline bool needs_allocation(struct mir_const_expr_value *v) {
-	return v->type->store_size_bytes > sizeof(v->_tmp);
+	return v->type->store_size_bytes > sizeof(vm_value_t);
 }
 
 static inline void eval_abort(struct virtual_machine *vm) {
@@ -667,7 +667,7 @@ void dyncall_cb_read_arg(struct virtual_machine       UNUSED(*vm),
 	bassert(dest && "Argument destination is invalid!");
 	bassert(type && "Argument destination has no type specified!");
 
-	memset(dest, 0, sizeof(*dest_value->_tmp));
+	memset(dest, 0, sizeof(vm_value_t));
 
 	switch (type->kind) {
 	case MIR_TYPE_ENUM:
@@ -744,15 +744,17 @@ char dyncall_cb_handler(DCCallback UNUSED(*cb), DCArgs *dc_args, DCValue *result
 		babort("External function used as callback is not supported yet!");
 	}
 
-	mir_const_values_t arg_tmp = SARR_ZERO;
-	mir_args_t        *args    = fn->type->data.fn.args;
+	mir_const_values_t       arg_tmp  = SARR_ZERO;
+	sarr_t(vm_value_t, 32)   arg_data = SARR_ZERO;
+	mir_args_t              *args     = fn->type->data.fn.args;
 	if (sarrlenu(args)) {
 		sarrsetlen(&arg_tmp, sarrlenu(args));
+		sarrsetlen(&arg_data, sarrlenu(args));
 		for (usize i = 0; i < sarrlenu(args); ++i) {
 			struct mir_arg              *it = sarrpeek(args, i);
 			struct mir_const_expr_value *v  = &sarrpeek(&arg_tmp, i);
 			v->type                         = it->type;
-			v->data                         = &v->_tmp[0];
+			v->data                         = &sarrpeek(&arg_data, i)[0];
 
 			dyncall_cb_read_arg(vm, v, dc_args);
 		}
@@ -769,6 +771,7 @@ char dyncall_cb_handler(DCCallback UNUSED(*cb), DCArgs *dc_args, DCValue *result
 	}
 
 	sarrfree(&arg_tmp);
+	sarrfree(&arg_data);
 	return dyncall_generate_signature(vm, ret_type)[0];
 }
 
@@ -1212,7 +1215,7 @@ enum vm_interp_state interp_instr(struct virtual_machine *vm, struct mir_instr *
 
 void interp_instr_toany(struct virtual_machine *vm, struct mir_instr_to_any *toany) {
 	struct mir_var *dest_var  = toany->tmp;
-	struct mir_var *type_info = mir_get_rtti(vm->assembly, toany->rtti_type->id.hash);
+	struct mir_var *type_info = mir_gen_rtti(vm->assembly, toany->rtti_type);
 	bassert(type_info->value.is_comptime);
 
 	struct mir_type *dest_type = dest_var->value.type;
@@ -1242,7 +1245,7 @@ void interp_instr_toany(struct virtual_machine *vm, struct mir_instr_to_any *toa
 		// setup destination pointer
 		memcpy(dest_data, &dest_expr, dest_data_type->store_size_bytes);
 	} else if (toany->rtti_data) {
-		struct mir_var *rtti_data_var = mir_get_rtti(vm->assembly, toany->rtti_data->id.hash);
+		struct mir_var *rtti_data_var = mir_gen_rtti(vm->assembly, toany->rtti_data);
 		vm_stack_ptr_t  rtti_data     = vm_read_var(vm, rtti_data_var);
 		// setup destination pointer
 		memcpy(dest_data, &rtti_data, dest_data_type->store_size_bytes);
@@ -1894,7 +1897,7 @@ void interp_instr_binop(struct virtual_machine *vm, struct mir_instr_binop *bino
 		if (n == 0) {
 			builder_msg(MSG_ERR,
 			            ERR_DIV_BY_ZERO,
-			            binop->rhs->node->location,
+			            ast_tmp_location(binop->rhs->node),
 			            CARET_WORD,
 			            "Division by zero.");
 			eval_abort(vm);
@@ -2029,26 +2032,19 @@ void eval_instr(struct virtual_machine *vm, struct mir_instr *instr) {
 
 void eval_instr_type_info(struct virtual_machine *vm, struct mir_instr_type_info *type_info) {
 	bassert(type_info->rtti_type && "Missing RTTI type!");
-	struct mir_var *rtti_var = mir_get_rtti(vm->assembly, type_info->rtti_type->id.hash);
-#if defined(BL_DEBUG)
-	if (!rtti_var) {
-		const str_t  name = type_info->rtti_type->id.str;
-		const hash_t hash = type_info->rtti_type->id.hash;
-		blog("Rtti type " STR_FMT " [%lu] not found!", STR_ARG(name), hash);
-		bassert(rtti_var);
-	}
-#endif
+	struct mir_var *rtti_var = mir_gen_rtti(vm->assembly, type_info->rtti_type);
+	bassert(rtti_var);
 
-	MIR_CEV_WRITE_AS(vm_stack_ptr_t, &type_info->base.value, rtti_var->value.data);
+	MIR_CEV_WRITE_AS(vm_stack_ptr_t, vm->assembly, &type_info->base.value, rtti_var->value.data);
 }
 
 void eval_instr_typeof(struct virtual_machine *vm, struct mir_instr_typeof *type_of) {
-	MIR_CEV_WRITE_AS(struct mir_type *, &type_of->base.value, type_of->expr->value.type);
+	MIR_CEV_WRITE_AS(struct mir_type *, vm->assembly, &type_of->base.value, type_of->expr->value.type);
 }
 
 void eval_instr_call_loc(struct virtual_machine UNUSED(*vm), struct mir_instr_call_loc *loc) {
 	if (!loc->meta_var) return;
-	MIR_CEV_WRITE_AS(vm_stack_ptr_t, &loc->base.value, loc->meta_var->value.data);
+	MIR_CEV_WRITE_AS(vm_stack_ptr_t, vm->assembly, &loc->base.value, loc->meta_var->value.data);
 }
 
 void eval_instr_test_cases(struct virtual_machine *vm, struct mir_instr_test_case *tc) {
@@ -2058,7 +2054,7 @@ void eval_instr_test_cases(struct virtual_machine *vm, struct mir_instr_test_cas
 	struct mir_type *len_type = mir_get_struct_elem_type(tc_type, MIR_SLICE_LEN_INDEX);
 	struct mir_type *ptr_type = mir_get_struct_elem_type(tc_type, MIR_SLICE_PTR_INDEX);
 
-	vm_stack_ptr_t tc_ptr = tc->base.value.data;
+	vm_stack_ptr_t tc_ptr = mir_cev_storage(vm->assembly, &tc->base.value);
 
 	vm_stack_ptr_t len_ptr = vm_get_struct_elem_ptr(vm->assembly, tc_type, tc_ptr, 0);
 	vm_stack_ptr_t ptr_ptr = vm_get_struct_elem_ptr(vm->assembly, tc_type, tc_ptr, 1);
@@ -2103,7 +2099,7 @@ void eval_instr_elem_ptr(struct virtual_machine *vm, struct mir_instr_elem_ptr *
 		if (!ptr_tmp) {
 			builder_msg(MSG_ERR,
 			            ERR_JIT_RUN_FAILED,
-			            elem_ptr->base.node->location,
+			            ast_tmp_location(elem_ptr->base.node),
 			            CARET_WORD,
 			            "Dereferencing null pointer! Slice has not been set?");
 
@@ -2113,7 +2109,7 @@ void eval_instr_elem_ptr(struct virtual_machine *vm, struct mir_instr_elem_ptr *
 		if (index >= len_tmp) {
 			builder_msg(MSG_ERR,
 			            ERR_JIT_RUN_FAILED,
-			            elem_ptr->base.node->location,
+			            ast_tmp_location(elem_ptr->base.node),
 			            CARET_WORD,
 			            "Array index is out of the bounds! Array index is: %lli, but "
 			            "array size is: %lli",
@@ -2129,7 +2125,7 @@ void eval_instr_elem_ptr(struct virtual_machine *vm, struct mir_instr_elem_ptr *
 		babort("Invalid elem ptr target type!");
 	}
 
-	MIR_CEV_WRITE_AS(vm_stack_ptr_t, &elem_ptr->base.value, result_ptr);
+	MIR_CEV_WRITE_AS(vm_stack_ptr_t, vm->assembly, &elem_ptr->base.value, result_ptr);
 }
 
 void eval_instr_member_ptr(struct virtual_machine       UNUSED(*vm),
@@ -2144,7 +2140,7 @@ void eval_instr_member_ptr(struct virtual_machine       UNUSED(*vm),
 		vm_stack_ptr_t     strct_ptr;
 
 		if (member_ptr->target_ptr->kind == MIR_INSTR_CONST) {
-			strct_ptr = (vm_stack_ptr_t)&member_ptr->target_ptr->value;
+			strct_ptr = member_ptr->target_ptr->value.data;
 		} else {
 			strct_ptr = MIR_CEV_READ_AS(vm_stack_ptr_t, &member_ptr->target_ptr->value);
 		}
@@ -2152,13 +2148,13 @@ void eval_instr_member_ptr(struct virtual_machine       UNUSED(*vm),
 		vm_stack_ptr_t result_ptr = NULL;
 		result_ptr                = strct_ptr + member->offset_bytes;
 
-		MIR_CEV_WRITE_AS(vm_stack_ptr_t, &member_ptr->base.value, result_ptr);
+		MIR_CEV_WRITE_AS(vm_stack_ptr_t, vm->assembly, &member_ptr->base.value, result_ptr);
 		break;
 	}
 
 	case SCOPE_ENTRY_VARIANT: {
 		struct mir_variant *variant = member_ptr->scope_entry->data.variant;
-		MIR_CEV_WRITE_AS(u64, &member_ptr->base.value, variant->value);
+		MIR_CEV_WRITE_AS(u64, vm->assembly, &member_ptr->base.value, variant->value);
 		break;
 	}
 
@@ -2173,6 +2169,8 @@ void eval_instr_compound(struct virtual_machine *vm, struct mir_instr_compound *
 		// Compound data doesn't fit into default static memory register, we need to
 		// allocate temporary block on the stack.
 		value->data = stack_push_empty(vm, value->type);
+	} else {
+		mir_cev_storage(vm->assembly, value);
 	}
 
 	memset(value->data, 0, value->type->store_size_bytes);
@@ -2234,7 +2232,7 @@ void eval_instr_unroll(struct virtual_machine *vm, struct mir_instr_unroll *unro
 	if (mir_is_composite_type(src_type) && src_type->data.strct.is_multiple_return_type) {
 		vm_stack_ptr_t member_ptr =
 		    vm_get_struct_elem_ptr(vm->assembly, src_type, src->value.data, unroll->index);
-		MIR_CEV_WRITE_AS(vm_stack_ptr_t, &unroll->base.value, member_ptr);
+		MIR_CEV_WRITE_AS(vm_stack_ptr_t, vm->assembly, &unroll->base.value, member_ptr);
 		return;
 	}
 
@@ -2260,11 +2258,11 @@ void eval_instr_decl_var(struct virtual_machine UNUSED(*vm), struct mir_instr_de
 	bassert(var->value.data && "Invalid variable initializer!");
 }
 
-void eval_instr_cast(struct virtual_machine UNUSED(*vm), struct mir_instr_cast *cast) {
+void eval_instr_cast(struct virtual_machine *vm, struct mir_instr_cast *cast) {
 	struct mir_type *dest_type = cast->base.value.type;
 	struct mir_type *src_type  = cast->expr->value.type;
 	vm_stack_ptr_t   src       = cast->expr->value.data;
-	vm_do_cast(cast->base.value.data, src, dest_type, src_type, cast->op);
+	vm_do_cast(mir_cev_storage(vm->assembly, &cast->base.value), src, dest_type, src_type, cast->op);
 }
 
 void eval_instr_addrof(struct virtual_machine UNUSED(*vm), struct mir_instr_addrof *addrof) {
@@ -2276,22 +2274,22 @@ void eval_instr_load(struct virtual_machine *vm, struct mir_instr_load *load) {
 		struct mir_type *src_type = MIR_CEV_READ_AS(struct mir_type *, &load->src->value);
 		bmagic_assert(src_type);
 		if (mir_is_pointer_type(src_type)) {
-			MIR_CEV_WRITE_AS(struct mir_type *, &load->base.value, src_type->data.ptr.expr);
+			MIR_CEV_WRITE_AS(struct mir_type *, vm->assembly, &load->base.value, src_type->data.ptr.expr);
 		} else if (src_type->kind == MIR_TYPE_POLY) {
-			MIR_CEV_WRITE_AS(struct mir_type *, &load->base.value, src_type);
+			MIR_CEV_WRITE_AS(struct mir_type *, vm->assembly, &load->base.value, src_type);
 		} else {
 			assert(false && "Invalid type!");
 		}
 	} else if (load->src->value.type->kind == MIR_TYPE_POLY) {
 		struct mir_type *src_type = MIR_CEV_READ_AS(struct mir_type *, &load->src->value);
 		bmagic_assert(src_type);
-		MIR_CEV_WRITE_AS(struct mir_type *, &load->base.value, src_type);
+		MIR_CEV_WRITE_AS(struct mir_type *, vm->assembly, &load->base.value, src_type);
 	} else {
 		const vm_stack_ptr_t src = MIR_CEV_READ_AS(vm_stack_ptr_t, &load->src->value);
 		if (!src) {
 			builder_msg(MSG_ERR,
 			            ERR_NULL_POINTER,
-			            load->base.node ? load->base.node->location : NULL,
+			            load->base.node ? ast_tmp_location(load->base.node) : NULL,
 			            CARET_WORD,
 			            "Dereferencing null pointer!");
 			eval_abort(vm);
@@ -2321,21 +2319,21 @@ void eval_instr_set_initializer(struct virtual_machine *vm, struct mir_instr_set
 	}
 }
 
-void eval_instr_unop(struct virtual_machine UNUSED(*vm), struct mir_instr_unop *unop) {
+void eval_instr_unop(struct virtual_machine *vm, struct mir_instr_unop *unop) {
 	struct mir_type *type = unop->base.value.type;
 
 	vm_stack_ptr_t v_data    = unop->expr->value.data;
-	vm_stack_ptr_t dest_data = unop->base.value.data;
+	vm_stack_ptr_t dest_data = mir_cev_storage(vm->assembly, &unop->base.value);
 
 	calculate_unop(dest_data, v_data, unop->op, type);
 }
 
-void eval_instr_binop(struct virtual_machine UNUSED(*vm), struct mir_instr_binop *binop) {
+void eval_instr_binop(struct virtual_machine *vm, struct mir_instr_binop *binop) {
 	bassert(binop->lhs->value.is_comptime && binop->rhs->value.is_comptime);
 
 	vm_stack_ptr_t lhs_ptr  = binop->lhs->value.data;
 	vm_stack_ptr_t rhs_ptr  = binop->rhs->value.data;
-	vm_stack_ptr_t dest_ptr = binop->base.value.data;
+	vm_stack_ptr_t dest_ptr = mir_cev_storage(vm->assembly, &binop->base.value);
 
 	struct mir_type *src_type = binop->lhs->value.type;
 
@@ -2344,7 +2342,7 @@ void eval_instr_binop(struct virtual_machine UNUSED(*vm), struct mir_instr_binop
 		if (n == 0) {
 			builder_msg(MSG_ERR,
 			            ERR_DIV_BY_ZERO,
-			            binop->rhs->node->location,
+			            ast_tmp_location(binop->rhs->node),
 			            CARET_WORD,
 			            "Division by zero.");
 			eval_abort(vm);
@@ -2361,23 +2359,23 @@ void eval_instr_decl_ref(struct virtual_machine UNUSED(*vm), struct mir_instr_de
 
 	switch (entry->kind) {
 	case SCOPE_ENTRY_FN:
-		MIR_CEV_WRITE_AS(struct mir_fn *, &decl_ref->base.value, entry->data.fn);
+		MIR_CEV_WRITE_AS(struct mir_fn *, vm->assembly, &decl_ref->base.value, entry->data.fn);
 		break;
 
 	case SCOPE_ENTRY_TYPE:
-		MIR_CEV_WRITE_AS(struct mir_type *, &decl_ref->base.value, entry->data.type);
+		MIR_CEV_WRITE_AS(struct mir_type *, vm->assembly, &decl_ref->base.value, entry->data.type);
 		break;
 
 	case SCOPE_ENTRY_VAR:
-		MIR_CEV_WRITE_AS(vm_stack_ptr_t, &decl_ref->base.value, entry->data.var->value.data);
+		MIR_CEV_WRITE_AS(vm_stack_ptr_t, vm->assembly, &decl_ref->base.value, entry->data.var->value.data);
 		break;
 
 	case SCOPE_ENTRY_VARIANT:
-		MIR_CEV_WRITE_AS(u64 *, &decl_ref->base.value, &entry->data.variant->value);
+		MIR_CEV_WRITE_AS(u64 *, vm->assembly, &decl_ref->base.value, &entry->data.variant->value);
 		break;
 
 	case SCOPE_ENTRY_NAMED_SCOPE:
-		MIR_CEV_WRITE_AS(struct scope_entry *, &decl_ref->base.value, entry);
+		MIR_CEV_WRITE_AS(struct scope_entry *, vm->assembly, &decl_ref->base.value, entry);
 		break;
 
 	case SCOPE_ENTRY_ARG: {
@@ -2399,7 +2397,7 @@ void eval_instr_decl_ref(struct virtual_machine UNUSED(*vm), struct mir_instr_de
 void eval_instr_decl_direct_ref(struct virtual_machine            UNUSED(*vm),
                                 struct mir_instr_decl_direct_ref *decl_ref) {
 	struct mir_var *var = ((struct mir_instr_decl_var *)decl_ref->ref)->var;
-	MIR_CEV_WRITE_AS(vm_stack_ptr_t, &decl_ref->base.value, var->value.data);
+	MIR_CEV_WRITE_AS(vm_stack_ptr_t, vm->assembly, &decl_ref->base.value, var->value.data);
 }
 
 // =================================================================================================
@@ -2423,6 +2421,11 @@ void vm_terminate(struct virtual_machine *vm) {
 		terminate_stack(vm->comptime_call_stacks[i].stack);
 	}
 	tbl_free(vm->comptime_call_stacks);
+	for (u32 i = 0; i < tbl_len(vm->comptime_memo); ++i) {
+		bfree(vm->comptime_memo[i].key.ptr);
+	}
+	tbl_free(vm->comptime_memo);
+	arrfree(vm->comptime_memo_key);
 	terminate_stack(vm->main_stack);
 }
 
@@ -2439,7 +2442,7 @@ void vm_print_backtrace(struct virtual_machine *vm) {
 	}
 
 	// Print the last instruction
-	builder_msg(MSG_ERR_NOTE, 0, instr->node->location, CARET_NONE, "Last called:");
+	builder_msg(MSG_ERR_NOTE, 0, ast_tmp_location(instr->node), CARET_NONE, "Last called:");
 	while (fr) {
 		instr = &fr->caller->base;
 		fr    = fr->prev;
@@ -2453,12 +2456,12 @@ void vm_print_backtrace(struct virtual_machine *vm) {
 			const str_t replacement = fn->generated.debug_replacement_types;
 			builder_msg(MSG_ERR_NOTE,
 			            0,
-			            instr->node->location,
+			            ast_tmp_location(instr->node),
 			            CARET_NONE,
 			            "Called from following location with polymorph replacement: " STR_FMT "",
 			            STR_ARG(replacement));
 		} else {
-			builder_msg(MSG_ERR_NOTE, 0, instr->node->location, CARET_NONE, "Called from:");
+			builder_msg(MSG_ERR_NOTE, 0, ast_tmp_location(instr->node), CARET_NONE, "Called from:");
 		}
 		++n;
 	}
@@ -2603,6 +2606,80 @@ static struct get_snapshot_result get_snapshot(struct virtual_machine *vm, struc
 	return result;
 }
 
+static void set_comptime_call_result(struct virtual_machine *vm, struct mir_instr_call *call, struct mir_fn *fn, vm_stack_ptr_t result) {
+	if (!fn_does_return(fn)) {
+		call->base.value.data = NULL;
+		return;
+	}
+	struct mir_type *ret_type = fn->type->data.fn.ret_type;
+	bassert(ret_type->kind != MIR_TYPE_VOID);
+	bassert(result);
+	// Storage allocated by the previous execution of the same call (i.e. resumed call) is reused.
+	vm_stack_ptr_t dest = call->base.value.data;
+	if (!dest) {
+		dest = needs_allocation(&call->base.value) ? data_alloc(vm, ret_type) : mir_cev_storage(vm->assembly, &call->base.value);
+	}
+	memcpy(dest, result, ret_type->store_size_bytes);
+	call->base.value.data = dest;
+}
+
+// Append bytes of the value into the memo key; structures are serialized member by member, so
+// possibly uninitialized padding bytes are not part of the key.
+static void append_comptime_memo_key_value(struct virtual_machine *vm, const struct mir_type *type, vm_stack_ptr_t ptr) {
+	switch (type->kind) {
+	case MIR_TYPE_STRUCT: {
+		const mir_members_t *members = type->data.strct.members;
+		for (usize i = 0; i < sarrlenu(members); ++i) {
+			struct mir_member *member = sarrpeek(members, i);
+			append_comptime_memo_key_value(vm, member->type, ptr + member->offset_bytes);
+		}
+		break;
+	}
+	case MIR_TYPE_ARRAY: {
+		const struct mir_type *elem_type = type->data.array.elem_type;
+		for (s64 i = 0; i < type->data.array.len; ++i) {
+			append_comptime_memo_key_value(vm, elem_type, ptr + i * elem_type->store_size_bytes);
+		}
+		break;
+	}
+	default: {
+		const usize size = type->store_size_bytes;
+		if (size) memcpy(arraddnptr(vm->comptime_memo_key, size), ptr, size);
+		break;
+	}
+	}
+}
+
+// Memo key is composed from the callee and bytes of all argument values; this is sufficient since
+// pure functions accept only pointer-free arguments.
+static str_t make_comptime_memo_key(struct virtual_machine *vm, struct mir_instr_call *call, struct mir_fn *fn) {
+	arrsetlen(vm->comptime_memo_key, 0);
+	memcpy(arraddnptr(vm->comptime_memo_key, sizeof(fn)), &fn, sizeof(fn));
+	mir_instrs_t *args = call->args;
+	for (usize i = 0; i < sarrlenu(args); ++i) {
+		struct mir_const_expr_value *value = &sarrpeek(args, i)->value;
+		if (!value->type->store_size_bytes) continue;
+		bassert(value->data);
+		append_comptime_memo_key_value(vm, value->type, value->data);
+	}
+	return make_str(vm->comptime_memo_key, arrlenu(vm->comptime_memo_key));
+}
+
+static void memoize_comptime_call(struct virtual_machine *vm, struct mir_instr_call *call, struct mir_fn *fn, vm_stack_ptr_t result) {
+	const str_t  key  = make_comptime_memo_key(vm, call, fn);
+	const hash_t hash = strhash(key);
+	if (tbl_lookup_index_with_key(vm->comptime_memo, hash, key) != -1) return;
+
+	struct vm_comptime_memo entry = {.hash = hash, .key = make_str(bmalloc(key.len), key.len)};
+	memcpy(entry.key.ptr, key.ptr, key.len);
+	struct mir_type *ret_type = fn->type->data.fn.ret_type;
+	if (result && ret_type->store_size_bytes) {
+		entry.result = data_alloc(vm, ret_type);
+		memcpy(entry.result, result, ret_type->store_size_bytes);
+	}
+	tbl_insert(vm->comptime_memo, entry);
+}
+
 enum vm_interp_state vm_execute_comptime_call(struct virtual_machine *vm, struct assembly *assembly, struct mir_instr_call *call) {
 	zone();
 	mtx_lock(&vm->lock);
@@ -2615,6 +2692,21 @@ enum vm_interp_state vm_execute_comptime_call(struct virtual_machine *vm, struct
 		babort("External function cannot be #comptime for now!");
 	}
 
+	// Pure function called again with the same arguments produces the same result, we can skip the
+	// execution.
+	const bool is_memoizable = mir_is_fn_pure(fn);
+	if (is_memoizable && tbl_lookup_index(vm->comptime_call_stacks, call) == -1) {
+		const str_t key   = make_comptime_memo_key(vm, call, fn);
+		const s32   index = tbl_lookup_index_with_key(vm->comptime_memo, strhash(key), key);
+		if (index != -1) {
+			set_comptime_call_result(vm, call, fn, vm->comptime_memo[index].result);
+			batomic_fetch_add_s32(&assembly->stats.comptime_memo_hit_count, 1);
+			mtx_unlock(&vm->lock);
+			return_zone(VM_INTERP_PASSED);
+		}
+		batomic_fetch_add_s32(&assembly->stats.comptime_memo_miss_count, 1);
+	}
+
 	// Compile-time calls use custom execution stack since its execution can be postponed.
 	struct get_snapshot_result snapshot       = get_snapshot(vm, call);
 	struct vm_stack           *previous_stack = swap_current_stack(vm, snapshot.stack);
@@ -2629,29 +2721,22 @@ enum vm_interp_state vm_execute_comptime_call(struct virtual_machine *vm, struct
 			stack_push(vm, value->data, value->type);
 		}
 	}
-	enum vm_interp_state state = execute_function(vm, fn, call, snapshot.resume);
+	builder_trace_begin("Comptime call", fn->linkage_name);
+	const f64            start_ms = builder.options->time_report ? get_tick_ms() : 0.;
+	enum vm_interp_state state    = execute_function(vm, fn, call, snapshot.resume);
+	if (builder.options->time_report) fn->report.comptime_ms += get_tick_ms() - start_ms;
+	builder_trace_end();
 	switch (state) {
-	case VM_INTERP_PASSED:
+	case VM_INTERP_PASSED: {
 		// Pop return value.
-		if (fn_does_return(fn)) {
-			struct mir_type *ret_type = fn->type->data.fn.ret_type;
-			bassert(ret_type->kind != MIR_TYPE_VOID);
-			vm_stack_ptr_t ptr  = stack_pop(vm, ret_type);
-			vm_stack_ptr_t dest = NULL;
-			if (needs_allocation(&call->base.value)) {
-				dest = data_alloc(vm, ret_type);
-			} else {
-				dest = (vm_stack_ptr_t)&call->base.value._tmp;
-			}
-			memcpy(dest, ptr, ret_type->store_size_bytes);
-			call->base.value.data = dest;
-		} else {
-			call->base.value.data = NULL;
-		}
+		vm_stack_ptr_t result = fn_does_return(fn) ? stack_pop(vm, fn->type->data.fn.ret_type) : NULL;
+		set_comptime_call_result(vm, call, fn, result);
+		if (is_memoizable) memoize_comptime_call(vm, call, fn, result);
 		// @Note: No cleanup is needed here, the stack is dedicated to this call and gets cleaned
 		// when it's reused eventually.
 		release_snapshot(vm, snapshot.stack);
 		break;
+	}
 
 	case VM_INTERP_POSTPONE:
 		store_snapshot(vm, snapshot.stack, call);
@@ -2679,10 +2764,8 @@ void vm_alloc_global(struct virtual_machine *vm, struct assembly *assembly, stru
 	bassert(type);
 	// @Cleanup: Consider if we can simplify this and use just one single pointer (local and global
 	// stored in union) here. Even constants can be allocated inside data buffer.
-	if (var->value.is_comptime && needs_allocation(&var->value)) {
+	if (var->value.is_comptime) {
 		var->value.data = data_alloc(vm, type);
-	} else if (var->value.is_comptime) {
-		var->value.data = (vm_stack_ptr_t)&var->value._tmp;
 	} else {
 		var->vm_ptr.global = data_alloc(vm, type);
 	}
@@ -89,6 +89,13 @@ struct vm_snapshot {
 	struct vm_stack       *stack;
 };
 
+// Result of the pure compile-time call, the key contains callee and argument value bytes.
+struct vm_comptime_memo {
+	hash_t         hash;
+	str_t          key;
+	vm_stack_ptr_t result; // Optional, NULL for void functions.
+};
+
 struct virtual_machine {
 	struct vm_stack   *stack;
 	struct vm_stack   *main_stack; // Owner pointer of the main execution stack.
@@ -108,6 +115,11 @@ struct virtual_machine {
 	// returned back to 'available_comptime_call_stacks' array.
 	hash_table(struct vm_snapshot) comptime_call_stacks;
 
+	// Results of already executed compile-time calls of pure functions (see mir_is_fn_pure).
+	hash_table(struct vm_comptime_memo) comptime_memo;
+	// Temporary buffer used to build memo keys.
+	array(char) comptime_memo_key;
+
 	mtx_t lock;
 };
 
@@ -124,9 +136,8 @@ enum mir_value_address_mode {
 };
 
 // This should not be there but whatever.
+// Small values of instructions are stored out-of-line, see mir_cev_storage.
 struct mir_const_expr_value {
-	// @Performance: _tmp and data can be packed in union
-	vm_value_t                  _tmp;
 	vm_stack_ptr_t              data;
 	struct mir_type            *type;
 	enum mir_value_address_mode addr_mode;
@@ -49,8 +49,8 @@ static struct virtual_machine *current_vm             = NULL;
 static hash_table(struct stack_context) stack_context = NULL;
 
 static void print(struct mir_instr *instr) {
-	if (!mir_mode && instr->node && instr->node->location) {
-		builder_print_location(stdout, instr->node->location, 0, 0);
+	if (!mir_mode && instr->node && instr->node->unit) {
+		builder_print_location(stdout, ast_tmp_location(instr->node), 0, 0);
 	} else {
 		if (instr->prev) {
 			printf("  ");
@@ -261,8 +261,8 @@ void vmdbg_notify_instr(struct mir_instr *instr) {
 	if (state != STEPPING) return;
 	if (mir_mode) {
 		print(instr);
-	} else if (instr->node && instr->node->location) {
-		struct location *loc = instr->node->location;
+	} else if (instr->node && instr->node->unit) {
+		struct location *loc = ast_tmp_location(instr->node);
 		if (last_unit == loc->unit && last_line == loc->line) {
 			return;
 		}
@@ -325,7 +325,7 @@ void vmdbg_notify_stack_op(enum vmdbg_stack_op op, struct mir_type *type, void *
 			color_print(stdout,
 			            BL_BLUE,
 			            "%6llu %20s  POP RA  (%p)\n",
-			            vm->stack->pc->id,
+			            (unsigned long long)vm->stack->pc->id,
 			            mir_instr_name(vm->stack->pc),
 			            ptr);
 			break;
@@ -359,7 +359,7 @@ void vmdbg_notify_stack_op(enum vmdbg_stack_op op, struct mir_type *type, void *
 				color_print(stdout,
 				            BL_BLUE,
 				            "%6llu %20s  POP     (%lluB, %p) %s\n",
-				            vm->stack->pc->id,
+				            (unsigned long long)vm->stack->pc->id,
 				            mir_instr_name(vm->stack->pc),
 				            size,
 				            ptr,
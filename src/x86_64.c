@@ -1022,15 +1022,14 @@ static hash_t emit_type_info(struct context *ctx, struct thread_context *tctx, s
 		return hash;
 	}
 
-	struct mir_var *var = mir_get_rtti(ctx->assembly, target_type->id.hash);
-	bassert(var);
-	const u32 dest_offset = add_data(tctx, NULL, (u32)var->value.type->store_size_bytes);
+	struct mir_type *type = mir_get_rtti_type(ctx->assembly, target_type);
+	bassert(type);
+	const u32 dest_offset = add_data(tctx, NULL, (u32)type->store_size_bytes);
 	add_sym(tctx, SECTION_DATA, dest_offset, str_buf_view(sym_name), IMAGE_SYM_CLASS_EXTERNAL, 0);
 
 #define write_member(offset, type, index, value) \
 	memcpy(vm_get_struct_elem_ptr(ctx->assembly, type, &tctx->data[offset], index), value, mir_get_struct_elem_type(type, index)->store_size_bytes);
 
-	struct mir_type *type = var->value.type;
 	{ // base
 		struct mir_type *base_type = mir_get_struct_elem_type(type, 0);
 		write_member(dest_offset, base_type, 0, &target_type->kind);
@@ -2205,7 +2204,7 @@ static void emit_instr(struct context *ctx, struct thread_context *tctx, struct
 		add_sym(tctx, SECTION_DATA, data_offset, str_buf_view(name), IMAGE_SYM_CLASS_EXTERNAL, 0);
 
 		bassert(loc->call_node);
-		struct location *call_location = loc->call_node->location;
+		struct location *call_location = ast_tmp_location(loc->call_node);
 
 		// Write file
 		const str_t filepath = call_location->unit->filepath;